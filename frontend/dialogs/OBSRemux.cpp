@@ -92,6 +92,9 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 	connect(&remuxer, &QThread::finished, worker.data(), &QObject::deleteLater);
 	connect(worker.data(), &RemuxWorker::remuxFinished, this, &OBSRemux::remuxFinished);
 	connect(this, &OBSRemux::remux, worker.data(), &RemuxWorker::remux);
+	connect(worker.data(), &RemuxWorker::entryFinished, this, &OBSRemux::entryFinished);
+	connect(worker.data(), &RemuxWorker::batchFinished, this, &OBSRemux::remuxBatchFinished);
+	connect(this, &OBSRemux::remuxBatch, worker.data(), &RemuxWorker::remuxBatch);
 
 	connect(queueModel.data(), &RemuxQueueModel::rowsInserted, this, &OBSRemux::rowCountChanged);
 	connect(queueModel.data(), &RemuxQueueModel::rowsRemoved, this, &OBSRemux::rowCountChanged);
@@ -225,7 +228,13 @@ void OBSRemux::beginRemux()
 	ui->buttonBox->button(QDialogButtonBox::Ok)->setText(QTStr("Remux.Stop"));
 	setAcceptDrops(false);
 
-	remuxNextEntry();
+	// Queued files are remuxed in parallel, see media_remux_scheduler_t
+	QStringList inputPaths, outputPaths;
+	worker->lastProgress = 0.f;
+	if (queueModel->beginAllEntries(inputPaths, outputPaths))
+		emit remuxBatch(inputPaths, outputPaths);
+	else
+		remuxNextEntry();
 }
 
 void OBSRemux::AutoRemux(QString inFile, QString outFile)
@@ -299,6 +308,19 @@ void OBSRemux::remuxFinished(bool success)
 	remuxNextEntry();
 }
 
+void OBSRemux::entryFinished(const QString &source, bool success)
+{
+	queueModel->finishEntry(source, success);
+}
+
+void OBSRemux::remuxBatchFinished()
+{
+	ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
+
+	// Nothing is pending anymore, so this only finishes processing
+	remuxNextEntry();
+}
+
 void OBSRemux::clearFinished()
 {
 	queueModel->clearFinished();
@@ -20,6 +20,7 @@
 #include "ui_OBSRemux.h"
 
 #include <QPointer>
+#include <QStringList>
 #include <QThread>
 
 class RemuxQueueModel;
@@ -62,6 +63,8 @@ private slots:
 public slots:
 	void updateProgress(float percent);
 	void remuxFinished(bool success);
+	void entryFinished(const QString &source, bool success);
+	void remuxBatchFinished();
 	void beginRemux();
 	bool stopRemux();
 	void clearFinished();
@@ -69,4 +72,5 @@ public slots:
 
 signals:
 	void remux(const QString &source, const QString &target);
+	void remuxBatch(const QStringList &sources, const QStringList &targets);
 };
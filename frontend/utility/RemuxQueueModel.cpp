@@ -322,8 +322,10 @@ void RemuxQueueModel::beginProcessing()
 
 void RemuxQueueModel::endProcessing()
 {
+	// Batches that were stopped leave the jobs they never started in
+	// progress.
 	for (RemuxQueueEntry &entry : queue) {
-		if (entry.state == RemuxEntryState::Pending) {
+		if (entry.state == RemuxEntryState::Pending || entry.state == RemuxEntryState::InProgress) {
 			entry.state = RemuxEntryState::Ready;
 		}
 	}
@@ -361,6 +363,24 @@ bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
 	return anyStarted;
 }
 
+bool RemuxQueueModel::beginAllEntries(QStringList &inputPaths, QStringList &outputPaths)
+{
+	for (int row = 0; row < queue.length(); row++) {
+		RemuxQueueEntry &entry = queue[row];
+		if (entry.state == RemuxEntryState::Pending) {
+			entry.state = RemuxEntryState::InProgress;
+
+			inputPaths.append(entry.sourcePath);
+			outputPaths.append(entry.targetPath);
+
+			QModelIndex index = this->index(row, RemuxEntryColumn::State);
+			emit dataChanged(index, index);
+		}
+	}
+
+	return !inputPaths.empty();
+}
+
 void RemuxQueueModel::finishEntry(bool success)
 {
 	for (int row = 0; row < queue.length(); row++) {
@@ -378,3 +398,21 @@ void RemuxQueueModel::finishEntry(bool success)
 		}
 	}
 }
+
+void RemuxQueueModel::finishEntry(const QString &inputPath, bool success)
+{
+	for (int row = 0; row < queue.length(); row++) {
+		RemuxQueueEntry &entry = queue[row];
+		if (entry.state == RemuxEntryState::InProgress && entry.sourcePath == inputPath) {
+			if (success)
+				entry.state = RemuxEntryState::Complete;
+			else
+				entry.state = RemuxEntryState::Error;
+
+			QModelIndex index = this->index(row, RemuxEntryColumn::State);
+			emit dataChanged(index, index);
+
+			break;
+		}
+	}
+}
@@ -54,7 +54,9 @@ public:
 	void beginProcessing();
 	void endProcessing();
 	bool beginNextEntry(QString &inputPath, QString &outputPath);
+	bool beginAllEntries(QStringList &inputPaths, QStringList &outputPaths);
 	void finishEntry(bool success);
+	void finishEntry(const QString &inputPath, bool success);
 	bool canClearFinished() const;
 	void clearFinished();
 	void clearAll();
@@ -17,8 +17,13 @@
 
 #include "RemuxWorker.hpp"
 
+#include <OBSApp.hpp>
+
 #include <media-io/media-remux.h>
 #include <qt-wrappers.hpp>
+#include <util/platform.h>
+
+#define BATCH_POLL_INTERVAL_MS 100
 
 void RemuxWorker::UpdateProgress(float percent)
 {
@@ -60,3 +65,60 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 
 	emit remuxFinished(!stopped && success);
 }
+
+void RemuxWorker::remuxBatch(const QStringList &sources, const QStringList &targets)
+{
+	isWorking = true;
+	batchSources.clear();
+
+	auto callback = [](void *data, size_t job, bool success) {
+		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
+		emit rw->entryFinished(rw->batchSources.value((int)job), success);
+	};
+
+	char journal[512];
+	if (GetAppConfigPath(journal, sizeof(journal), "obs-studio/remux-journal.json") <= 0)
+		journal[0] = 0;
+
+	media_remux_scheduler_t sched = media_remux_scheduler_create(0, journal);
+
+	for (int i = 0; i < sources.size(); i++) {
+		// Job indices follow the order jobs were added in
+		if (media_remux_scheduler_add_job(sched, QT_TO_UTF8(sources[i]), QT_TO_UTF8(targets[i])) != SIZE_MAX)
+			batchSources.append(sources[i]);
+		else
+			emit entryFinished(sources[i], false);
+	}
+
+	if (sched && media_remux_scheduler_start(sched, callback, this)) {
+		struct media_remux_progress progress;
+
+		for (;;) {
+			media_remux_scheduler_get_progress(sched, &progress);
+
+			{
+				QMutexLocker lock(&updateMutex);
+
+				UpdateProgress(progress.percent);
+
+				if (!isWorking) {
+					media_remux_scheduler_cancel(sched);
+					break;
+				}
+			}
+
+			if (progress.jobs_finished == progress.jobs)
+				break;
+
+			os_sleep_ms(BATCH_POLL_INTERVAL_MS);
+		}
+	}
+
+	media_remux_scheduler_wait(sched);
+	media_remux_scheduler_destroy(sched);
+	batchSources.clear();
+
+	isWorking = false;
+
+	emit batchFinished();
+}
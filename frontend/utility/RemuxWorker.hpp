@@ -19,6 +19,7 @@
 
 #include <QMutex>
 #include <QObject>
+#include <QStringList>
 
 class RemuxWorker : public QObject {
 	Q_OBJECT
@@ -30,15 +31,20 @@ class RemuxWorker : public QObject {
 	float lastProgress;
 	void UpdateProgress(float percent);
 
+	QStringList batchSources;
+
 	explicit RemuxWorker() : isWorking(false) {}
 	virtual ~RemuxWorker() {};
 
 private slots:
 	void remux(const QString &source, const QString &target);
+	void remuxBatch(const QStringList &sources, const QStringList &targets);
 
 signals:
 	void updateProgress(float percent);
 	void remuxFinished(bool success);
+	void entryFinished(const QString &source, bool success);
+	void batchFinished();
 
 	friend class OBSRemux;
 };
@@ -200,6 +200,7 @@ extern void setupDockAction(QDockWidget *dock);
 OBSBasic::OBSBasic(QWidget *parent) : OBSMainWindow(parent), undo_s(ui), ui(new Ui::OBSBasic)
 {
 	collections = {};
+	saveQueue = os_task_queue_create();
 
 	setAttribute(Qt::WA_NativeWindow);
 
@@ -1328,6 +1329,9 @@ OBSBasic::~OBSBasic()
 	if (patronJsonThread && patronJsonThread->isRunning())
 		patronJsonThread->wait();
 
+	os_task_queue_destroy(saveQueue);
+	obs_data_release(pendingSaveData);
+
 	delete screenshotData;
 	delete previewProjector;
 	delete studioProgramProjector;
@@ -34,12 +34,14 @@
 
 #include <graphics/matrix4.h>
 #include <util/platform.h>
+#include <util/task.h>
 #include <util/threading.h>
 #include <util/util.hpp>
 
 #include <QSystemTrayIcon>
 
 #include <deque>
+#include <mutex>
 
 extern volatile bool recording_paused;
 
@@ -1045,6 +1047,15 @@ private:
 	bool projectChanged = false;
 	bool clearingFailed = false;
 
+	/* scene collection files are written on a background queue, only the
+	 * most recent pending save is written */
+	os_task_queue_t *saveQueue = nullptr;
+	std::mutex pendingSaveMutex;
+	obs_data_t *pendingSaveData = nullptr;
+	std::string pendingSaveFile;
+
+	static void WritePendingSave(void *param);
+
 	QPointer<OBSMissingFiles> missDialog;
 
 	OBSSceneCollectionCache collections;
@@ -801,7 +801,7 @@ static void SaveAudioDevice(const char *name, int channel, obs_data_t *parent, v
 
 	audioSources.push_back(source.Get());
 
-	OBSDataAutoRelease data = obs_save_source(source);
+	OBSDataAutoRelease data = obs_save_source_cached(source);
 
 	obs_data_set_obj(parent, name, data);
 }
@@ -834,7 +834,7 @@ static obs_data_t *GenerateSaveData(obs_data_array_t *sceneOrder, obs_data_array
 	};
 	using FilterAudioSources_t = decltype(FilterAudioSources);
 
-	obs_data_array_t *sourcesArray = obs_save_sources_filtered(
+	obs_data_array_t *sourcesArray = obs_save_sources_cached_filtered(
 		[](void *data, obs_source_t *source) {
 			auto &func = *static_cast<FilterAudioSources_t *>(data);
 			return func(source);
@@ -845,7 +845,7 @@ static obs_data_t *GenerateSaveData(obs_data_array_t *sceneOrder, obs_data_array
 	/* save group sources separately    */
 
 	/* saving separately ensures they won't be loaded in older versions */
-	obs_data_array_t *groupsArray = obs_save_sources_filtered(
+	obs_data_array_t *groupsArray = obs_save_sources_cached_filtered(
 		[](void *, obs_source_t *source) { return obs_source_is_group(source); }, nullptr);
 
 	/* -------------------------------- */
@@ -952,7 +952,46 @@ void OBSBasic::Save(SceneCollection &collection)
 		obs_data_set_obj(saveData, DataKeys::MigrationResolution.data(), resolutionData);
 	}
 
-	const std::string collectionFileName = collection.getFilePathString();
+	/* The source data is either cached by libobs and never modified, or
+	 * was created for this save.  Everything else may still reference
+	 * live data, so copy it before handing it to the save thread. */
+	OBSDataArrayAutoRelease sourcesArray = obs_data_get_array(saveData, "sources");
+	OBSDataArrayAutoRelease groupsArray = obs_data_get_array(saveData, "groups");
+	obs_data_erase(saveData, "sources");
+	obs_data_erase(saveData, "groups");
+
+	obs_data_t *writeData = obs_data_create();
+	obs_data_apply(writeData, saveData);
+	obs_data_set_array(writeData, "sources", sourcesArray);
+	obs_data_set_array(writeData, "groups", groupsArray);
+
+	{
+		std::lock_guard<std::mutex> lock(pendingSaveMutex);
+		obs_data_release(pendingSaveData);
+		pendingSaveData = writeData;
+		pendingSaveFile = collection.getFilePathString();
+	}
+
+	os_task_queue_queue_task(saveQueue, WritePendingSave, this);
+}
+
+void OBSBasic::WritePendingSave(void *param)
+{
+	OBSBasic *main = static_cast<OBSBasic *>(param);
+	OBSDataAutoRelease saveData;
+	std::string collectionFileName;
+
+	{
+		std::lock_guard<std::mutex> lock(main->pendingSaveMutex);
+		saveData = main->pendingSaveData;
+		main->pendingSaveData = nullptr;
+		collectionFileName = std::move(main->pendingSaveFile);
+	}
+
+	/* already written by an earlier task */
+	if (!saveData)
+		return;
+
 	bool success = obs_data_save_json_pretty_safe(saveData, collectionFileName.c_str(), "tmp", "bak");
 
 	if (!success) {
@@ -1454,11 +1493,13 @@ retryScene:
 
 void OBSBasic::SaveProjectNow()
 {
-	if (disableSaving)
-		return;
+	if (!disableSaving) {
+		projectChanged = true;
+		SaveProjectDeferred();
+	}
 
-	projectChanged = true;
-	SaveProjectDeferred();
+	/* callers expect the file to be written when this returns */
+	os_task_queue_wait(saveQueue);
 }
 
 void OBSBasic::SaveProject()
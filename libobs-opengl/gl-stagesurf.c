@@ -15,8 +15,15 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <util/profiler.h>
+
 #include "gl-subsystem.h"
 
+/* waited on in steps, giving up after a second so that a lost context fails
+ * the map instead of blocking the caller forever */
+#define FENCE_WAIT_STEP_NS 1000000
+#define FENCE_WAIT_MAX_STEPS 1000
+
 static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 {
 	GLsizeiptr size;
@@ -68,6 +75,8 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 {
 	if (stagesurf) {
+		if (stagesurf->fence)
+			glDeleteSync(stagesurf->fence);
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -106,6 +115,45 @@ static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
 	return true;
 }
 
+static void insert_fence(struct gs_stage_surface *surf)
+{
+	if (surf->fence)
+		glDeleteSync(surf->fence);
+
+	surf->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
+/* only waits that actually block show up in the profiler */
+static const char *stagesurface_stall_name = "gs_stagesurface_map stall";
+static bool wait_fence(struct gs_stage_surface *surf)
+{
+	if (!surf->fence)
+		return true;
+
+	GLenum result = glClientWaitSync(surf->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		int steps = 0;
+
+		profile_start(stagesurface_stall_name);
+		do {
+			result = glClientWaitSync(surf->fence, 0, FENCE_WAIT_STEP_NS);
+		} while (result == GL_TIMEOUT_EXPIRED && ++steps < FENCE_WAIT_MAX_STEPS);
+		profile_end(stagesurface_stall_name);
+
+		if (result == GL_TIMEOUT_EXPIRED)
+			blog(LOG_ERROR, "wait_fence (GL): timed out waiting for the staging copy");
+	}
+
+	if (result == GL_WAIT_FAILED)
+		gl_success("glClientWaitSync");
+
+	glDeleteSync(surf->fence);
+	surf->fence = NULL;
+
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
 #ifdef __APPLE__
 
 /* Apparently for mac, PBOs won't do an asynchronous transfer unless you use
@@ -138,6 +186,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	insert_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -170,6 +219,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	insert_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -201,6 +252,9 @@ enum gs_color_format gs_stagesurface_get_color_format(const gs_stagesurf_t *stag
 
 bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize)
 {
+	if (!wait_fence(stagesurf))
+		goto fail;
+
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
 		goto fail;
 
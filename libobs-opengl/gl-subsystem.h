@@ -588,6 +588,9 @@ struct gs_stage_surface {
 	GLint gl_internal_format;
 	GLenum gl_type;
 	GLuint pack_buffer;
+
+	/* signaled once the last download into pack_buffer has finished */
+	GLsync fence;
 };
 
 struct gs_zstencil_buffer {
@@ -297,6 +297,29 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+struct gs_pooled_texture {
+	gs_texture_t *tex;
+	uint32_t cx;
+	uint32_t cy;
+	enum gs_color_format format;
+	uint64_t size;
+	uint64_t release_ts;
+};
+
+struct gs_texture_pool {
+	/* least recently released first */
+	DARRAY(struct gs_pooled_texture) idle;
+	uint64_t idle_bytes;
+	uint64_t used_bytes;
+	size_t used;
+	uint64_t hits;
+	uint64_t misses;
+
+	uint64_t max_idle_bytes;
+	uint64_t max_idle_ns;
+	uint64_t trim_ts;
+};
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -332,4 +355,9 @@ struct graphics_subsystem {
 	DARRAY(struct blend_state) blend_state_stack;
 
 	bool linear_srgb;
+
+	struct gs_texture_pool texture_pool;
 };
+
+extern void gs_texture_pool_init(struct gs_texture_pool *pool);
+extern void gs_texture_pool_free(struct gs_texture_pool *pool);
@@ -188,6 +188,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 	graphics->cur_blend_state.op = GS_BLEND_OP_ADD;
 	graphics->exports.device_blend_op(graphics->device, graphics->cur_blend_state.op);
 
+	gs_texture_pool_init(&graphics->texture_pool);
+
 	graphics->exports.device_leave_context(graphics->device);
 
 	gs_init_image_deps();
@@ -251,6 +253,7 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		gs_texture_pool_free(&graphics->texture_pool);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->subregion_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->flipped_sprite_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_buffer);
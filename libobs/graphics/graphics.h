@@ -455,6 +455,25 @@ EXPORT void gs_texrender_reset(gs_texrender_t *texrender);
 EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 EXPORT enum gs_color_format gs_texrender_get_format(const gs_texrender_t *texrender);
 
+/* ---------------------------------------------------
+ * shared render target pool
+ * --------------------------------------------------- */
+
+struct gs_texture_pool_stats {
+	uint64_t used_bytes;
+	uint64_t idle_bytes;
+	size_t used;
+	size_t idle;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+EXPORT gs_texture_t *gs_texture_pool_acquire(uint32_t cx, uint32_t cy, enum gs_color_format format);
+EXPORT void gs_texture_pool_release(gs_texture_t *tex);
+EXPORT void gs_texture_pool_trim(void);
+EXPORT void gs_texture_pool_set_limits(uint64_t max_idle_bytes, uint64_t max_idle_ns);
+EXPORT void gs_texture_pool_get_stats(struct gs_texture_pool_stats *stats);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
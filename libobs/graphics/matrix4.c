@@ -57,31 +57,48 @@ void matrix4_from_axisang(struct matrix4 *dst, const struct axisang *aa)
 	matrix4_from_quat(dst, &q);
 }
 
-void matrix4_mul(struct matrix4 *dst, const struct matrix4 *m1, const struct matrix4 *m2)
+/* each row of the result is a linear combination of the rows of m2 */
+static inline __m128 mul_row(__m128 row, const struct matrix4 *m)
 {
-	struct matrix4 transposed;
-	struct matrix4 out;
+	__m128 out = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), m->x.m);
+	out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), m->y.m));
+	out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), m->z.m));
+	return _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), m->t.m));
+}
 
-	matrix4_transpose(&transposed, m2);
+void matrix4_mul(struct matrix4 *dst, const struct matrix4 *m1, const struct matrix4 *m2)
+{
+	const __m128 x = mul_row(m1->x.m, m2);
+	const __m128 y = mul_row(m1->y.m, m2);
+	const __m128 z = mul_row(m1->z.m, m2);
+	const __m128 t = mul_row(m1->t.m, m2);
+
+	dst->x.m = x;
+	dst->y.m = y;
+	dst->z.m = z;
+	dst->t.m = t;
+}
 
-	out.x.x = vec4_dot(&m1->x, &transposed.x);
-	out.x.y = vec4_dot(&m1->x, &transposed.y);
-	out.x.z = vec4_dot(&m1->x, &transposed.z);
-	out.x.w = vec4_dot(&m1->x, &transposed.t);
-	out.y.x = vec4_dot(&m1->y, &transposed.x);
-	out.y.y = vec4_dot(&m1->y, &transposed.y);
-	out.y.z = vec4_dot(&m1->y, &transposed.z);
-	out.y.w = vec4_dot(&m1->y, &transposed.t);
-	out.z.x = vec4_dot(&m1->z, &transposed.x);
-	out.z.y = vec4_dot(&m1->z, &transposed.y);
-	out.z.z = vec4_dot(&m1->z, &transposed.z);
-	out.z.w = vec4_dot(&m1->z, &transposed.t);
-	out.t.x = vec4_dot(&m1->t, &transposed.x);
-	out.t.y = vec4_dot(&m1->t, &transposed.y);
-	out.t.z = vec4_dot(&m1->t, &transposed.z);
-	out.t.w = vec4_dot(&m1->t, &transposed.t);
-
-	matrix4_copy(dst, &out);
+void matrix4_from_transform_2d(struct matrix4 *dst, const struct vec2 *scale, const struct vec2 *origin, float angle,
+			       const struct vec2 *pos)
+{
+	const float c = cosf(angle);
+	const float s = sinf(angle);
+	struct vec4 rot_x;
+	struct vec4 rot_y;
+
+	vec4_set(&rot_x, c, s, 0.0f, 0.0f);
+	vec4_set(&rot_y, -s, c, 0.0f, 0.0f);
+
+	vec4_mulf(&dst->x, &rot_x, scale->x);
+	vec4_mulf(&dst->y, &rot_y, scale->y);
+	vec4_set(&dst->z, 0.0f, 0.0f, 1.0f, 0.0f);
+	vec4_set(&dst->t, pos->x, pos->y, 0.0f, 1.0f);
+
+	/* the origin is rotated, but not scaled */
+	const __m128 offset =
+		_mm_add_ps(_mm_mul_ps(rot_x.m, _mm_set1_ps(origin->x)), _mm_mul_ps(rot_y.m, _mm_set1_ps(origin->y)));
+	dst->t.m = _mm_sub_ps(dst->t.m, offset);
 }
 
 void matrix4_mul_4x3_only(struct matrix4 *dst, const struct matrix4 *m1, const struct matrix4 *m2)
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "vec2.h"
 #include "vec3.h"
 #include "vec4.h"
 #include "axisang.h"
@@ -59,6 +60,12 @@ EXPORT void matrix4_from_axisang(struct matrix4 *dst, const struct axisang *aa);
 
 EXPORT void matrix4_mul(struct matrix4 *dst, const struct matrix4 *m1, const struct matrix4 *m2);
 
+/* Same as scaling an identity matrix by scale, translating by -origin,
+ * rotating around the z axis by angle (in radians) and translating by pos,
+ * without the intermediate matrix multiplications. */
+EXPORT void matrix4_from_transform_2d(struct matrix4 *dst, const struct vec2 *scale, const struct vec2 *origin,
+				      float angle, const struct vec2 *pos);
+
 EXPORT float matrix4_determinant(const struct matrix4 *m);
 
 EXPORT void matrix4_translate3v(struct matrix4 *dst, const struct matrix4 *m, const struct vec3 *v);
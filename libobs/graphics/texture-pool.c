@@ -0,0 +1,157 @@
+/*
+ *   Render targets are often recreated with the same size and format, for
+ * example by texrenders when a source resizes, or by delay filters when their
+ * settings change.  Released textures are kept in a shared pool for reuse,
+ * and are destroyed once they haven't been used for a while or the idle
+ * textures exceed the memory limit.
+ *
+ *   Trimming only happens once per frame, and the memory limit never applies
+ * to textures released since the previous trim, so that everything released
+ * in a frame can still be acquired again right after, however large.
+ */
+
+#include "../util/platform.h"
+#include "graphics-internal.h"
+
+#define DEFAULT_MAX_IDLE_BYTES (512ULL * 1024 * 1024)
+#define DEFAULT_MAX_IDLE_NS (10ULL * 1000000000ULL)
+
+static inline struct gs_texture_pool *get_pool(const char *f)
+{
+	graphics_t *graphics = gs_get_context();
+	if (!graphics) {
+		blog(LOG_DEBUG, "%s: called while not in a graphics context", f);
+		return NULL;
+	}
+
+	return &graphics->texture_pool;
+}
+
+static inline uint64_t texture_size(uint32_t cx, uint32_t cy, enum gs_color_format format)
+{
+	return (uint64_t)cx * cy * gs_get_format_bpp(format) / 8;
+}
+
+static void destroy_oldest(struct gs_texture_pool *pool)
+{
+	struct gs_pooled_texture *oldest = pool->idle.array;
+
+	pool->idle_bytes -= oldest->size;
+	gs_texture_destroy(oldest->tex);
+	da_erase(pool->idle, 0);
+}
+
+void gs_texture_pool_init(struct gs_texture_pool *pool)
+{
+	pool->max_idle_bytes = DEFAULT_MAX_IDLE_BYTES;
+	pool->max_idle_ns = DEFAULT_MAX_IDLE_NS;
+}
+
+void gs_texture_pool_free(struct gs_texture_pool *pool)
+{
+	if (pool->used)
+		blog(LOG_DEBUG, "gs_texture_pool_free: %zu pooled textures are still in use", pool->used);
+
+	while (pool->idle.num)
+		destroy_oldest(pool);
+	da_free(pool->idle);
+}
+
+gs_texture_t *gs_texture_pool_acquire(uint32_t cx, uint32_t cy, enum gs_color_format format)
+{
+	struct gs_texture_pool *pool = get_pool("gs_texture_pool_acquire");
+	gs_texture_t *tex = NULL;
+
+	if (!pool)
+		return NULL;
+
+	for (size_t i = pool->idle.num; i > 0; i--) {
+		struct gs_pooled_texture *entry = &pool->idle.array[i - 1];
+
+		if (entry->cx == cx && entry->cy == cy && entry->format == format) {
+			tex = entry->tex;
+			pool->idle_bytes -= entry->size;
+			da_erase(pool->idle, i - 1);
+			pool->hits++;
+			break;
+		}
+	}
+
+	if (!tex) {
+		tex = gs_texture_create(cx, cy, format, 1, NULL, GS_RENDER_TARGET);
+		if (!tex)
+			return NULL;
+		pool->misses++;
+	}
+
+	pool->used_bytes += texture_size(cx, cy, format);
+	pool->used++;
+	return tex;
+}
+
+void gs_texture_pool_release(gs_texture_t *tex)
+{
+	struct gs_texture_pool *pool = get_pool("gs_texture_pool_release");
+
+	if (!pool || !tex)
+		return;
+
+	struct gs_pooled_texture *entry = da_push_back_new(pool->idle);
+	entry->tex = tex;
+	entry->cx = gs_texture_get_width(tex);
+	entry->cy = gs_texture_get_height(tex);
+	entry->format = gs_texture_get_color_format(tex);
+	entry->size = texture_size(entry->cx, entry->cy, entry->format);
+	entry->release_ts = os_gettime_ns();
+
+	pool->used_bytes -= entry->size;
+	pool->used--;
+	pool->idle_bytes += entry->size;
+}
+
+void gs_texture_pool_trim(void)
+{
+	struct gs_texture_pool *pool = get_pool("gs_texture_pool_trim");
+	if (!pool)
+		return;
+
+	const uint64_t now = os_gettime_ns();
+
+	while (pool->idle.num && now - pool->idle.array[0].release_ts > pool->max_idle_ns)
+		destroy_oldest(pool);
+	while (pool->idle_bytes > pool->max_idle_bytes && pool->idle.num &&
+	       pool->idle.array[0].release_ts < pool->trim_ts)
+		destroy_oldest(pool);
+
+	pool->trim_ts = now;
+}
+
+void gs_texture_pool_set_limits(uint64_t max_idle_bytes, uint64_t max_idle_ns)
+{
+	struct gs_texture_pool *pool = get_pool("gs_texture_pool_set_limits");
+	if (!pool)
+		return;
+
+	pool->max_idle_bytes = max_idle_bytes;
+	pool->max_idle_ns = max_idle_ns;
+	gs_texture_pool_trim();
+}
+
+void gs_texture_pool_get_stats(struct gs_texture_pool_stats *stats)
+{
+	struct gs_texture_pool *pool = get_pool("gs_texture_pool_get_stats");
+
+	if (!stats)
+		return;
+	if (!pool) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	stats->used_bytes = pool->used_bytes;
+	stats->idle_bytes = pool->idle_bytes;
+	stats->used = pool->used;
+	stats->idle = pool->idle.num;
+	stats->hits = pool->hits;
+	stats->misses = pool->misses;
+}
@@ -19,18 +19,108 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/darray.h"
+#include "../util/dstr.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../obs-data.h"
 
 #include <libavformat/avformat.h>
 #include <libavcodec/version.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+/* Recordings are read and written sequentially in large blocks, which keeps
+ * several parallel jobs on the same disk from degrading into random IO. */
+#define IO_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* OBS writes all codec parameters into MKV/FLV headers, so their streams need
+ * far less analysis than the default 5 seconds. */
+#define FAST_PATH_ANALYZE_DURATION AV_TIME_BASE
+
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	FILE *in_file, *out_file;
+	AVIOContext *in_pb, *out_pb;
+
+	/* Native recording remuxed to MP4/MOV */
+	bool fast_path;
 };
 
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+typedef int (*write_packet_cb)(void *, const uint8_t *, int);
+#else
+typedef int (*write_packet_cb)(void *, uint8_t *, int);
+#endif
+
+static int io_read(void *opaque, uint8_t *buf, int size)
+{
+	size_t ret = fread(buf, 1, size, opaque);
+	if (!ret)
+		return feof((FILE *)opaque) ? AVERROR_EOF : AVERROR(EIO);
+	return (int)ret;
+}
+
+static int io_write(void *opaque, const uint8_t *buf, int size)
+{
+	return fwrite(buf, 1, size, opaque) == (size_t)size ? size : AVERROR(EIO);
+}
+
+static int64_t io_seek(void *opaque, int64_t offset, int whence)
+{
+	if (whence & AVSEEK_SIZE)
+		return os_fgetsize(opaque);
+
+	if (os_fseeki64(opaque, offset, whence & ~AVSEEK_FORCE) != 0)
+		return AVERROR(EIO);
+	return os_ftelli64(opaque);
+}
+
+static bool open_io(FILE **file, AVIOContext **pb, const char *path, bool write)
+{
+	*file = os_fopen(path, write ? "wb" : "rb");
+	if (!*file)
+		return false;
+
+	uint8_t *buffer = av_malloc(IO_BUFFER_SIZE);
+	if (buffer)
+		*pb = avio_alloc_context(buffer, IO_BUFFER_SIZE, write, *file, write ? NULL : io_read,
+					 write ? (write_packet_cb)io_write : NULL, io_seek);
+	if (!*pb) {
+		av_free(buffer);
+		return false;
+	}
+
+	return true;
+}
+
+static void close_io(FILE **file, AVIOContext **pb)
+{
+	if (*pb) {
+		if ((*pb)->write_flag)
+			avio_flush(*pb);
+		av_freep(&(*pb)->buffer);
+		avio_context_free(pb);
+	}
+
+	if (*file) {
+		fclose(*file);
+		*file = NULL;
+	}
+}
+
+static bool is_native_recording(const AVInputFormat *format)
+{
+	return strcmp(format->name, "flv") == 0 || strncmp(format->name, "matroska", 8) == 0;
+}
+
+static bool is_mp4(const AVOutputFormat *format)
+{
+	return format && (strcmp(format->name, "mp4") == 0 || strcmp(format->name, "mov") == 0);
+}
+
 static inline void init_size(media_remux_job_t job, const char *in_filename)
 {
 #ifdef _MSC_VER
@@ -43,28 +133,82 @@ static inline void init_size(media_remux_job_t job, const char *in_filename)
 	job->in_size = st.st_size;
 }
 
-static inline bool init_input(media_remux_job_t job, const char *in_filename)
+/* avformat_find_stream_info() only fails if it can't identify a codec, a short
+ * analysis can still leave parameters unset that the output needs */
+static bool missing_stream_parameters(const AVFormatContext *ctx)
 {
+	for (unsigned i = 0; i < ctx->nb_streams; i++) {
+		const AVCodecParameters *par = ctx->streams[i]->codecpar;
+
+		if (par->codec_id == AV_CODEC_ID_NONE)
+			return true;
+		if (par->codec_type == AVMEDIA_TYPE_VIDEO && (!par->width || !par->height || par->format < 0))
+			return true;
+		if (par->codec_type == AVMEDIA_TYPE_AUDIO &&
+		    (!par->sample_rate || !par->ch_layout.nb_channels || par->format < 0))
+			return true;
+	}
+
+	return false;
+}
+
+static bool open_input(media_remux_job_t job, const char *in_filename)
+{
+	job->ifmt_ctx = avformat_alloc_context();
+	if (!job->ifmt_ctx || !open_io(&job->in_file, &job->in_pb, in_filename, false)) {
+		blog(LOG_ERROR, "media_remux: Could not open input file '%s'", in_filename);
+		return false;
+	}
+
+	job->ifmt_ctx->pb = job->in_pb;
+	job->ifmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
 	int ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Could not open input file '%s'", in_filename);
 		return false;
 	}
 
-	ret = avformat_find_stream_info(job->ifmt_ctx, NULL);
-	if (ret < 0) {
+	return true;
+}
+
+static inline bool init_input(media_remux_job_t job, const char *in_filename, const char *out_filename)
+{
+	if (!open_input(job, in_filename))
+		return false;
+
+	job->fast_path = is_native_recording(job->ifmt_ctx->iformat) &&
+			 is_mp4(av_guess_format(NULL, out_filename, NULL));
+	if (job->fast_path) {
+		job->ifmt_ctx->max_analyze_duration = FAST_PATH_ANALYZE_DURATION;
+
+		if (avformat_find_stream_info(job->ifmt_ctx, NULL) >= 0 && !missing_stream_parameters(job->ifmt_ctx))
+			goto done;
+
+		/* Recordings of other programs or with streams that start late,
+		 * start over with the default analysis */
+		blog(LOG_INFO, "media_remux: Short analysis of '%s' was incomplete, analyzing it in full", in_filename);
+
+		avformat_close_input(&job->ifmt_ctx);
+		close_io(&job->in_file, &job->in_pb);
+		if (!open_input(job, in_filename))
+			return false;
+	}
+
+	if (avformat_find_stream_info(job->ifmt_ctx, NULL) < 0) {
 		blog(LOG_ERROR, "media_remux: Failed to retrieve input stream"
 				" information");
 		return false;
 	}
 
+done:
 #ifndef NDEBUG
 	av_dump_format(job->ifmt_ctx, 0, in_filename, false);
 #endif
 	return true;
 }
 
-static inline bool init_output(media_remux_job_t job, const char *out_filename)
+static inline bool init_output(media_remux_job_t job, const char *out_filename, const char *write_path)
 {
 	int ret;
 
@@ -120,20 +264,24 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 #endif
 
 	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-		ret = avio_open(&job->ofmt_ctx->pb, out_filename, AVIO_FLAG_WRITE);
-		if (ret < 0) {
+		if (!open_io(&job->out_file, &job->out_pb, write_path, true)) {
 			blog(LOG_ERROR,
 			     "media_remux: Failed to open output"
 			     " file '%s'",
-			     out_filename);
+			     write_path);
 			return false;
 		}
+
+		job->ofmt_ctx->pb = job->out_pb;
+		job->ofmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
 	}
 
 	return true;
 }
 
-bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, const char *out_filename)
+/* Writes to write_path, while the output format follows out_filename */
+static bool job_create(media_remux_job_t *job, const char *in_filename, const char *out_filename,
+		       const char *write_path)
 {
 	if (!job)
 		return false;
@@ -151,19 +299,25 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, con
 
 	init_size(*job, in_filename);
 
-	if (!init_input(*job, in_filename))
+	if (!init_input(*job, in_filename, out_filename))
 		goto fail;
 
-	if (!init_output(*job, out_filename))
+	if (!init_output(*job, out_filename, write_path))
 		goto fail;
 
 	return true;
 
 fail:
 	media_remux_job_destroy(*job);
+	*job = NULL;
 	return false;
 }
 
+bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, const char *out_filename)
+{
+	return job_create(job, in_filename, out_filename, out_filename);
+}
+
 static inline void process_packet(AVPacket *pkt, AVStream *in_stream, AVStream *out_stream)
 {
 	pkt->pts = av_rescale_q_rnd(pkt->pts, in_stream->time_base, out_stream->time_base,
@@ -176,6 +330,10 @@ static inline void process_packet(AVPacket *pkt, AVStream *in_stream, AVStream *
 
 static inline int process_packets(media_remux_job_t job, media_remux_progress_callback callback, void *data)
 {
+	/* Native recordings are already interleaved, and the MP4 muxer lays
+	 * out its own chunks, so the interleaving queue can be skipped. */
+	int (*write_frame)(AVFormatContext *, AVPacket *) = job->fast_path ? av_write_frame
+									   : av_interleaved_write_frame;
 	AVPacket pkt;
 
 	int ret, throttle = 0;
@@ -200,7 +358,7 @@ static inline int process_packets(media_remux_job_t job, media_remux_progress_ca
 		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
 			       job->ofmt_ctx->streams[pkt.stream_index]);
 
-		ret = av_interleaved_write_frame(job->ofmt_ctx, &pkt);
+		ret = write_frame(job->ofmt_ctx, &pkt);
 		av_packet_unref(&pkt);
 
 		if (ret < 0) {
@@ -244,6 +402,14 @@ bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callbac
 		success = false;
 	}
 
+	if (job->out_pb) {
+		avio_flush(job->out_pb);
+		if (job->out_pb->error < 0) {
+			blog(LOG_ERROR, "media_remux: Error writing output file: %s", av_err2str(job->out_pb->error));
+			success = false;
+		}
+	}
+
 	if (callback != NULL)
 		callback(data, 100.f);
 
@@ -256,11 +422,382 @@ void media_remux_job_destroy(media_remux_job_t job)
 		return;
 
 	avformat_close_input(&job->ifmt_ctx);
-
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
-		avio_close(job->ofmt_ctx->pb);
+	close_io(&job->in_file, &job->in_pb);
 
 	avformat_free_context(job->ofmt_ctx);
+	close_io(&job->out_file, &job->out_pb);
 
 	bfree(job);
 }
+
+/* ------------------------------------------------------------------------- */
+/* Scheduler                                                                 */
+
+#define DEFAULT_MAX_PARALLEL 4
+
+struct remux_entry {
+	struct media_remux_scheduler *sched;
+	char *in_filename;
+	char *out_filename;
+	int64_t size;
+	int64_t mtime;
+
+	float percent;
+	bool active;
+	bool finished;
+	bool failed;
+	bool skipped;
+};
+
+struct media_remux_scheduler {
+	pthread_mutex_t mutex;
+	DARRAY(struct remux_entry) entries;
+
+	/* Pending entries, largest first */
+	DARRAY(size_t) queue;
+	size_t next;
+
+	size_t max_parallel;
+	DARRAY(pthread_t) threads;
+	bool started;
+	volatile bool cancel;
+	uint64_t start_ts;
+
+	char *journal_path;
+	obs_data_t *journal;
+
+	media_remux_job_finished_callback *callback;
+	void *data;
+};
+
+static int64_t get_mtime(const char *path)
+{
+	struct stat st = {0};
+	if (os_stat(path, &st) != 0)
+		return 0;
+	return (int64_t)st.st_mtime;
+}
+
+static bool journal_has(struct media_remux_scheduler *sched, const struct remux_entry *entry)
+{
+	obs_data_array_t *jobs = obs_data_get_array(sched->journal, "jobs");
+	size_t count = obs_data_array_count(jobs);
+	bool found = false;
+
+	for (size_t i = 0; i < count && !found; i++) {
+		obs_data_t *job = obs_data_array_item(jobs, i);
+
+		found = strcmp(obs_data_get_string(job, "input"), entry->in_filename) == 0 &&
+			strcmp(obs_data_get_string(job, "output"), entry->out_filename) == 0 &&
+			obs_data_get_int(job, "size") == entry->size && obs_data_get_int(job, "mtime") == entry->mtime;
+
+		obs_data_release(job);
+	}
+
+	obs_data_array_release(jobs);
+	return found;
+}
+
+/* Called with the scheduler mutex held */
+static void journal_add(struct media_remux_scheduler *sched, const struct remux_entry *entry)
+{
+	obs_data_array_t *jobs = obs_data_get_array(sched->journal, "jobs");
+	obs_data_t *job = obs_data_create();
+
+	if (!jobs) {
+		jobs = obs_data_array_create();
+		obs_data_set_array(sched->journal, "jobs", jobs);
+	}
+
+	obs_data_set_string(job, "input", entry->in_filename);
+	obs_data_set_string(job, "output", entry->out_filename);
+	obs_data_set_int(job, "size", entry->size);
+	obs_data_set_int(job, "mtime", entry->mtime);
+	obs_data_array_push_back(jobs, job);
+
+	if (!obs_data_save_json_safe(sched->journal, sched->journal_path, "tmp", "bak"))
+		blog(LOG_WARNING, "media_remux: Failed to save journal '%s'", sched->journal_path);
+
+	obs_data_release(job);
+	obs_data_array_release(jobs);
+}
+
+static bool entry_progress(void *data, float percent)
+{
+	struct remux_entry *entry = data;
+	struct media_remux_scheduler *sched = entry->sched;
+
+	pthread_mutex_lock(&sched->mutex);
+	entry->percent = percent;
+	pthread_mutex_unlock(&sched->mutex);
+
+	return !os_atomic_load_bool(&sched->cancel);
+}
+
+static bool run_entry(struct remux_entry *entry)
+{
+	struct media_remux_scheduler *sched = entry->sched;
+	media_remux_job_t job = NULL;
+	struct dstr part = {0};
+	bool success = false;
+
+	dstr_printf(&part, "%s.part", entry->out_filename);
+
+	if (job_create(&job, entry->in_filename, entry->out_filename, part.array)) {
+		success = media_remux_job_process(job, entry_progress, entry);
+		media_remux_job_destroy(job);
+	}
+
+	if (os_atomic_load_bool(&sched->cancel))
+		success = false;
+
+	if (success && os_rename(part.array, entry->out_filename) != 0) {
+		blog(LOG_ERROR, "media_remux: Failed to move '%s' into place", part.array);
+		success = false;
+	}
+
+	if (!success)
+		os_unlink(part.array);
+
+	dstr_free(&part);
+	return success;
+}
+
+static void *scheduler_thread(void *data)
+{
+	struct media_remux_scheduler *sched = data;
+
+	os_set_thread_name("media_remux: worker");
+
+	for (;;) {
+		pthread_mutex_lock(&sched->mutex);
+
+		if (os_atomic_load_bool(&sched->cancel) || sched->next == sched->queue.num) {
+			pthread_mutex_unlock(&sched->mutex);
+			break;
+		}
+
+		size_t idx = sched->queue.array[sched->next++];
+		struct remux_entry *entry = &sched->entries.array[idx];
+		entry->active = true;
+
+		pthread_mutex_unlock(&sched->mutex);
+
+		bool success = run_entry(entry);
+
+		pthread_mutex_lock(&sched->mutex);
+		entry->active = false;
+		entry->finished = true;
+		entry->failed = !success;
+		entry->percent = 100.f;
+		if (success && sched->journal)
+			journal_add(sched, entry);
+		pthread_mutex_unlock(&sched->mutex);
+
+		if (sched->callback)
+			sched->callback(sched->data, idx, success);
+	}
+
+	return NULL;
+}
+
+media_remux_scheduler_t media_remux_scheduler_create(size_t max_parallel, const char *journal_path)
+{
+	struct media_remux_scheduler *sched = bzalloc(sizeof(struct media_remux_scheduler));
+
+	if (pthread_mutex_init(&sched->mutex, NULL) != 0) {
+		bfree(sched);
+		return NULL;
+	}
+
+	/* Remuxing is bound by disk throughput rather than the CPU, so more
+	 * than a few parallel jobs only add seeking. */
+	if (!max_parallel) {
+		int cores = os_get_physical_cores();
+		max_parallel = cores > 1 ? (size_t)cores / 2 : 1;
+		if (max_parallel > DEFAULT_MAX_PARALLEL)
+			max_parallel = DEFAULT_MAX_PARALLEL;
+	}
+	sched->max_parallel = max_parallel;
+
+	if (journal_path && *journal_path) {
+		sched->journal_path = bstrdup(journal_path);
+		sched->journal = obs_data_create_from_json_file_safe(journal_path, "bak");
+		if (!sched->journal)
+			sched->journal = obs_data_create();
+	}
+
+	return sched;
+}
+
+size_t media_remux_scheduler_add_job(media_remux_scheduler_t sched, const char *in_filename,
+				     const char *out_filename)
+{
+	if (!sched || sched->started || !in_filename || !out_filename)
+		return SIZE_MAX;
+
+	struct remux_entry *entry = da_push_back_new(sched->entries);
+	entry->sched = sched;
+	entry->in_filename = bstrdup(in_filename);
+	entry->out_filename = bstrdup(out_filename);
+	entry->size = os_get_file_size(in_filename);
+	entry->mtime = get_mtime(in_filename);
+
+	if (sched->journal && os_file_exists(out_filename) && journal_has(sched, entry)) {
+		entry->skipped = true;
+		entry->finished = true;
+		entry->percent = 100.f;
+	}
+
+	return sched->entries.num - 1;
+}
+
+/* Starting with the largest files keeps one big file from running alone at
+ * the end. */
+static void sort_queue(struct media_remux_scheduler *sched)
+{
+	for (size_t i = 1; i < sched->queue.num; i++) {
+		size_t idx = sched->queue.array[i];
+		int64_t size = sched->entries.array[idx].size;
+		size_t j = i;
+
+		for (; j > 0 && sched->entries.array[sched->queue.array[j - 1]].size < size; j--)
+			sched->queue.array[j] = sched->queue.array[j - 1];
+		sched->queue.array[j] = idx;
+	}
+}
+
+bool media_remux_scheduler_start(media_remux_scheduler_t sched, media_remux_job_finished_callback callback,
+				 void *data)
+{
+	if (!sched || sched->started)
+		return false;
+
+	sched->started = true;
+	sched->callback = callback;
+	sched->data = data;
+	sched->start_ts = os_gettime_ns();
+
+	for (size_t i = 0; i < sched->entries.num; i++) {
+		if (sched->entries.array[i].skipped) {
+			blog(LOG_INFO, "media_remux: Skipping '%s', already remuxed",
+			     sched->entries.array[i].in_filename);
+			if (callback)
+				callback(data, i, true);
+		} else {
+			da_push_back(sched->queue, &i);
+		}
+	}
+
+	sort_queue(sched);
+
+	size_t num_threads = sched->queue.num < sched->max_parallel ? sched->queue.num : sched->max_parallel;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, scheduler_thread, sched) != 0) {
+			blog(LOG_ERROR, "media_remux: Failed to create worker thread");
+			break;
+		}
+		da_push_back(sched->threads, &thread);
+	}
+
+	if (!sched->threads.num && sched->queue.num) {
+		for (size_t i = 0; i < sched->queue.num; i++) {
+			sched->entries.array[sched->queue.array[i]].finished = true;
+			sched->entries.array[sched->queue.array[i]].failed = true;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+void media_remux_scheduler_get_progress(media_remux_scheduler_t sched, struct media_remux_progress *progress)
+{
+	memset(progress, 0, sizeof(*progress));
+	if (!sched)
+		return;
+
+	double done = 0.0;
+
+	pthread_mutex_lock(&sched->mutex);
+
+	for (size_t i = 0; i < sched->entries.num; i++) {
+		const struct remux_entry *entry = &sched->entries.array[i];
+
+		progress->jobs++;
+		progress->jobs_active += entry->active;
+		progress->jobs_finished += entry->finished;
+		progress->jobs_failed += entry->failed;
+		progress->jobs_skipped += entry->skipped;
+
+		if (entry->skipped || entry->size <= 0)
+			continue;
+
+		progress->bytes += (uint64_t)entry->size;
+		done += (double)entry->size * entry->percent / 100.0;
+	}
+
+	pthread_mutex_unlock(&sched->mutex);
+
+	progress->bytes_done = (uint64_t)done;
+
+	if (sched->started) {
+		double seconds = (double)(os_gettime_ns() - sched->start_ts) / 1000000000.0;
+		if (seconds > 0.0)
+			progress->bytes_per_sec = done / seconds;
+	}
+
+	if (progress->bytes)
+		progress->percent = (float)(done * 100.0 / (double)progress->bytes);
+	else if (progress->jobs)
+		progress->percent = (float)progress->jobs_finished * 100.f / (float)progress->jobs;
+}
+
+void media_remux_scheduler_cancel(media_remux_scheduler_t sched)
+{
+	if (sched)
+		os_atomic_set_bool(&sched->cancel, true);
+}
+
+bool media_remux_scheduler_wait(media_remux_scheduler_t sched)
+{
+	if (!sched)
+		return false;
+
+	for (size_t i = 0; i < sched->threads.num; i++)
+		pthread_join(sched->threads.array[i], NULL);
+	da_free(sched->threads);
+
+	bool success = !os_atomic_load_bool(&sched->cancel);
+	for (size_t i = 0; i < sched->entries.num && success; i++)
+		success = sched->entries.array[i].finished && !sched->entries.array[i].failed;
+
+	/* Nothing left to resume */
+	if (success && sched->journal_path)
+		os_unlink(sched->journal_path);
+
+	return success;
+}
+
+void media_remux_scheduler_destroy(media_remux_scheduler_t sched)
+{
+	if (!sched)
+		return;
+
+	media_remux_scheduler_cancel(sched);
+	media_remux_scheduler_wait(sched);
+
+	for (size_t i = 0; i < sched->entries.num; i++) {
+		bfree(sched->entries.array[i].in_filename);
+		bfree(sched->entries.array[i].out_filename);
+	}
+
+	da_free(sched->entries);
+	da_free(sched->queue);
+	obs_data_release(sched->journal);
+	bfree(sched->journal_path);
+	pthread_mutex_destroy(&sched->mutex);
+	bfree(sched);
+}
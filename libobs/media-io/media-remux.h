@@ -24,6 +24,29 @@ typedef struct media_remux_job *media_remux_job_t;
 
 typedef bool(media_remux_progress_callback)(void *data, float percent);
 
+struct media_remux_scheduler;
+typedef struct media_remux_scheduler *media_remux_scheduler_t;
+
+/* Called from the worker threads as jobs finish, and from
+ * media_remux_scheduler_start for jobs that already completed in a previous
+ * run */
+typedef void(media_remux_job_finished_callback)(void *data, size_t job, bool success);
+
+struct media_remux_progress {
+	size_t jobs;
+	size_t jobs_active;
+	size_t jobs_finished; /* includes failed and skipped jobs */
+	size_t jobs_failed;
+	size_t jobs_skipped; /* completed in a previous run */
+
+	/* Input sizes of the jobs that are not skipped */
+	uint64_t bytes;
+	uint64_t bytes_done;
+	double bytes_per_sec;
+
+	float percent;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,6 +55,24 @@ EXPORT bool media_remux_job_create(media_remux_job_t *job, const char *in_filena
 EXPORT bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callback callback, void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
+/* Runs remux jobs on up to max_parallel threads, 0 picks a default suited to
+ * IO bound work.  Outputs are written to "<output>.part" and renamed once
+ * complete.  Completed jobs are recorded in the journal file if one is given,
+ * and skipped when the scheduler is created again with the same journal; the
+ * journal is removed once all jobs succeeded. */
+EXPORT media_remux_scheduler_t media_remux_scheduler_create(size_t max_parallel, const char *journal_path);
+/* Returns the job index, or SIZE_MAX if the job could not be added */
+EXPORT size_t media_remux_scheduler_add_job(media_remux_scheduler_t sched, const char *in_filename,
+					    const char *out_filename);
+EXPORT bool media_remux_scheduler_start(media_remux_scheduler_t sched, media_remux_job_finished_callback callback,
+					void *data);
+EXPORT void media_remux_scheduler_get_progress(media_remux_scheduler_t sched, struct media_remux_progress *progress);
+/* Stops running jobs and skips pending ones */
+EXPORT void media_remux_scheduler_cancel(media_remux_scheduler_t sched);
+/* Waits for all jobs, returns true if every job succeeded */
+EXPORT bool media_remux_scheduler_wait(media_remux_scheduler_t sched);
+EXPORT void media_remux_scheduler_destroy(media_remux_scheduler_t sched);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,12 +32,16 @@
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
-#define MAX_CACHE_SIZE 16
+#define MAX_CACHE_SIZE 128
 
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+	/* number of times the frame was locked for, written by the producer
+	 * before the frame is published */
+	long count;
+	/* number of times the frame still has to be output, 0 when the slot
+	 * belongs to the producer */
+	volatile long remaining;
 };
 
 struct video_input {
@@ -71,7 +75,6 @@ struct video_output {
 	struct video_output_info info;
 
 	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
 
 	os_sem_t *update_semaphore;
@@ -82,10 +85,12 @@ struct video_output {
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
 
-	size_t available_frames;
-	size_t first_added;
-	size_t last_added;
-	struct cached_frame_info cache[MAX_CACHE_SIZE];
+	/* single producer, single consumer ring; each side only moves its own
+	 * index, and slots change hands through their remaining count */
+	size_t write_idx;
+	size_t read_idx;
+	long read_repeats;
+	struct cached_frame_info *cache;
 
 	struct video_output *parent;
 
@@ -125,17 +130,8 @@ static inline bool scale_video_output(struct video_input *input, struct video_da
 
 static inline bool video_output_cur_frame(struct video_output *video)
 {
-	struct cached_frame_info *frame_info;
+	struct cached_frame_info *frame_info = &video->cache[video->read_idx];
 	bool complete;
-	bool skipped;
-
-	/* -------------------------------- */
-
-	pthread_mutex_lock(&video->data_mutex);
-
-	frame_info = &video->cache[video->first_added];
-
-	pthread_mutex_unlock(&video->data_mutex);
 
 	/* -------------------------------- */
 
@@ -163,25 +159,22 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
+	/* repeats past the locked count are frames the producer could not
+	 * store because the cache was full */
+	if (++video->read_repeats > frame_info->count)
+		os_atomic_inc_long(&video->skipped_frames);
 
 	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
 
-	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
+	/* the slot belongs to the producer again once this reaches 0 */
+	complete = os_atomic_dec_long(&frame_info->remaining) == 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
-		os_atomic_inc_long(&video->skipped_frames);
+	if (complete) {
+		video->read_repeats = 0;
+		if (++video->read_idx == video->info.cache_size)
+			video->read_idx = 0;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	return complete;
@@ -225,6 +218,10 @@ static inline void init_cache(struct video_output *video)
 {
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
+	if (!video->info.cache_size)
+		video->info.cache_size = 1;
+
+	video->cache = bzalloc(sizeof(struct cached_frame_info) * video->info.cache_size);
 
 	for (size_t i = 0; i < video->info.cache_size; i++) {
 		struct video_frame *frame;
@@ -232,8 +229,6 @@ static inline void init_cache(struct video_output *video)
 
 		video_frame_init(frame, video->info.format, video->info.width, video->info.height);
 	}
-
-	video->available_frames = video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -250,26 +245,26 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	memcpy(&out->info, info, sizeof(struct video_output_info));
 	out->frame_time = util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
-		goto fail1;
+		goto fail0;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
-		goto fail2;
-	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
-		goto fail3;
+		goto fail1;
 
 	init_cache(out);
 
+	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
+		goto fail2;
+
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
 
-fail3:
-	os_sem_destroy(out->update_semaphore);
 fail2:
-	pthread_mutex_destroy(&out->input_mutex);
+	for (size_t i = 0; i < out->info.cache_size; i++)
+		video_frame_free((struct video_frame *)&out->cache[i]);
+	bfree(out->cache);
+	os_sem_destroy(out->update_semaphore);
 fail1:
-	pthread_mutex_destroy(&out->data_mutex);
+	pthread_mutex_destroy(&out->input_mutex);
 fail0:
 	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
@@ -290,10 +285,10 @@ void video_output_close(video_t *video)
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
+	bfree(video->cache);
 
 	pthread_mutex_unlock(&video->input_mutex);
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
 
 	bfree(video);
@@ -506,57 +501,63 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+/* Adds repeats to the most recently published frame while the consumer is
+ * still outputting it.  Fails if the consumer finished it in the meantime,
+ * in which case the slot after it has been freed as well. */
+static inline bool repeat_last_frame(struct video_output *video, int count)
+{
+	size_t idx = video->write_idx ? video->write_idx - 1 : video->info.cache_size - 1;
+	struct cached_frame_info *cfi = &video->cache[idx];
+	long remaining = os_atomic_load_long(&cfi->remaining);
+
+	while (remaining > 0) {
+		if (os_atomic_compare_exchange_long(&cfi->remaining, &remaining, remaining + count))
+			return true;
+	}
+
+	return false;
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
 
 	video = get_root(video);
+	cfi = &video->cache[video->write_idx];
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
-
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
-
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
-
-		memcpy(frame, &cfi->frame, sizeof(*frame));
-
-		locked = true;
+	/* the cache is full, so the frame is dropped and the last frame
+	 * repeated in its place */
+	while (os_atomic_load_long(&cfi->remaining) > 0) {
+		if (repeat_last_frame(video, count))
+			return false;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
+	cfi->frame.timestamp = timestamp;
+	cfi->count = count;
 
-	return locked;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
 }
 
 void video_output_unlock_frame(video_t *video)
 {
+	struct cached_frame_info *cfi;
+
 	if (!video)
 		return;
 
 	video = get_root(video);
+	cfi = &video->cache[video->write_idx];
 
-	pthread_mutex_lock(&video->data_mutex);
+	os_atomic_set_long(&cfi->remaining, cfi->count);
 
-	video->available_frames--;
-	os_sem_post(video->update_semaphore);
+	if (++video->write_idx == video->info.cache_size)
+		video->write_idx = 0;
 
-	pthread_mutex_unlock(&video->data_mutex);
+	os_sem_post(video->update_semaphore);
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -72,10 +72,52 @@ struct obs_volmeter {
 
 	enum obs_peak_meter_type peak_meter_type;
 	unsigned int update_ms;
-	float prev_samples[MAX_AUDIO_CHANNELS][4];
 
+	struct loudness_gate *loudness_gate;
+	float loudness;
+};
+
+/* 0.1 LU steps from the absolute gate at -70 LUFS up to +30 LUFS */
+#define LOUDNESS_BINS 1000
+#define LOUDNESS_GATE -70.0
+#define LOUDNESS_SUB_BLOCKS 4
+
+/* ITU-R BS.1770 integrated loudness. The K-weighting and the block energies
+ * only depend on the source, so they are shared by its volume meters. */
+struct meter_loudness {
+	size_t channels;
+	double weights[MAX_AUDIO_CHANNELS];
+	double b[2][3];
+	double a[2][3];
+	double z[MAX_AUDIO_CHANNELS][2][2];
+
+	size_t sub_block_frames;
+	size_t cur_frames;
+	double cur_energy;
+	double sub_energy[LOUDNESS_SUB_BLOCKS];
+
+	double bin_energy[LOUDNESS_BINS];
+};
+
+/* Gating is per volume meter so that each one can be enabled and reset on its
+ * own. Block loudness is kept in a histogram, so that memory stays bounded no
+ * matter how long it is measured for. */
+struct loudness_gate {
+	size_t num_sub_blocks;
+	uint32_t histogram[LOUDNESS_BINS];
+};
+
+/* Level analysis of a source, computed once per audio tick and shared by all
+ * volume meters attached to the source. */
+struct obs_source_meter {
+	DARRAY(struct obs_volmeter *) volmeters;
+
+	float prev_samples[MAX_AUDIO_CHANNELS][4];
 	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
+	float sample_peak[MAX_AUDIO_CHANNELS];
+	float true_peak[MAX_AUDIO_CHANNELS];
+
+	struct meter_loudness *loudness;
 };
 
 static float cubic_def_to_db(const float def)
@@ -330,7 +372,7 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 	__m128 work = previous_samples;
 	__m128 peak = previous_samples;
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
-		__m128 new_work = _mm_load_ps(&samples[i]);
+		__m128 new_work = _mm_loadu_ps(&samples[i]);
 		__m128 intrp_samples;
 
 		/* Include the actual sample values in the peak. */
@@ -367,7 +409,7 @@ static float get_sample_peak(__m128 previous_samples, const float *samples, size
 {
 	__m128 peak = previous_samples;
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
-		__m128 new_work = _mm_load_ps(&samples[i]);
+		__m128 new_work = _mm_loadu_ps(&samples[i]);
 		peak = _mm_max_ps(peak, abs_ps(new_work));
 	}
 
@@ -376,122 +418,290 @@ static float get_sample_peak(__m128 previous_samples, const float *samples, size
 	return r;
 }
 
-static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter, int channel_nr, float *samples,
-					       size_t nr_samples)
+static void meter_process_peak_last_samples(struct obs_source_meter *meter, int channel_nr, const float *samples,
+					    size_t nr_samples)
 {
 	/* Take the last 4 samples that need to be used for the next peak
 	 * calculation. If there are less than 4 samples in total the new
 	 * samples shift out the old samples. */
+	float *prev = meter->prev_samples[channel_nr];
 
 	switch (nr_samples) {
 	case 0:
 		break;
 	case 1:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][1];
-		volmeter->prev_samples[channel_nr][1] = volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][2] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[1];
+		prev[1] = prev[2];
+		prev[2] = prev[3];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	case 2:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][1] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[2];
+		prev[1] = prev[3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	case 3:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[3];
+		prev[1] = samples[nr_samples - 3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	default:
-		volmeter->prev_samples[channel_nr][0] = samples[nr_samples - 4];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = samples[nr_samples - 4];
+		prev[1] = samples[nr_samples - 3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 	}
 }
 
-static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
+static void meter_process_peak(struct obs_source_meter *meter, const struct audio_data *data, int nr_channels,
+			       bool sample_peak, bool true_peak)
 {
 	int nr_samples = data->frames;
 	int channel_nr = 0;
 	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
+		const float *samples = (const float *)data->data[plane_nr];
 		if (!samples) {
 			continue;
 		}
-		if (((uintptr_t)samples & 0xf) > 0) {
-			printf("Audio plane %i is not aligned %p skipping "
-			       "peak volume measurement.\n",
-			       plane_nr, samples);
-			volmeter->peak[channel_nr] = 1.0;
-			channel_nr++;
-			continue;
-		}
 
-		/* volmeter->prev_samples may not be aligned to 16 bytes;
+		/* meter->prev_samples may not be aligned to 16 bytes;
 		 * use unaligned load. */
-		__m128 previous_samples = _mm_loadu_ps(volmeter->prev_samples[channel_nr]);
-
-		float peak;
-		switch (volmeter->peak_meter_type) {
-		case TRUE_PEAK_METER:
-			peak = get_true_peak(previous_samples, samples, nr_samples);
-			break;
-
-		case SAMPLE_PEAK_METER:
-		default:
-			peak = get_sample_peak(previous_samples, samples, nr_samples);
-			break;
-		}
+		__m128 previous_samples = _mm_loadu_ps(meter->prev_samples[channel_nr]);
 
-		volmeter_process_peak_last_samples(volmeter, channel_nr, samples, nr_samples);
+		if (true_peak)
+			meter->true_peak[channel_nr] = get_true_peak(previous_samples, samples, nr_samples);
+		if (sample_peak)
+			meter->sample_peak[channel_nr] = get_sample_peak(previous_samples, samples, nr_samples);
 
-		volmeter->peak[channel_nr] = peak;
+		meter_process_peak_last_samples(meter, channel_nr, samples, nr_samples);
 
 		channel_nr++;
 	}
 
 	/* Clear the peak of the channels that have not been handled. */
 	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		volmeter->peak[channel_nr] = 0.0;
+		meter->true_peak[channel_nr] = 0.0;
+		meter->sample_peak[channel_nr] = 0.0;
 	}
 }
 
-static void volmeter_process_magnitude(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
+static void meter_process_magnitude(struct obs_source_meter *meter, const struct audio_data *data, int nr_channels)
 {
 	size_t nr_samples = data->frames;
 
 	int channel_nr = 0;
 	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
+		const float *samples = (const float *)data->data[plane_nr];
 		if (!samples) {
 			continue;
 		}
 
-		float sum = 0.0;
-		for (size_t i = 0; i < nr_samples; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
+		__m128 sum4 = _mm_setzero_ps();
+		size_t i = 0;
+		for (; i + 3 < nr_samples; i += 4) {
+			__m128 v = _mm_loadu_ps(&samples[i]);
+			sum4 = _mm_add_ps(sum4, _mm_mul_ps(v, v));
 		}
-		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
+
+		float sums[4];
+		_mm_storeu_ps(sums, sum4);
+		float sum = sums[0] + sums[1] + sums[2] + sums[3];
+		for (; i < nr_samples; i++)
+			sum += samples[i] * samples[i];
+
+		meter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
 
 		channel_nr++;
 	}
 }
 
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter, const struct audio_data *data)
+/* LFE is not measured, surround channels are weighted by +1.5 dB */
+static double loudness_channel_weight(enum speaker_layout speakers, size_t channel)
 {
-	int nr_channels = get_nr_channels_from_audio_data(data);
+	switch (speakers) {
+	case SPEAKERS_2POINT1:
+		return channel == 2 ? 0.0 : 1.0;
+	case SPEAKERS_4POINT0:
+		return channel == 3 ? 1.41 : 1.0;
+	case SPEAKERS_4POINT1:
+	case SPEAKERS_5POINT1:
+	case SPEAKERS_7POINT1:
+		if (channel == 3)
+			return 0.0;
+		return channel > 3 ? 1.41 : 1.0;
+	default:
+		return 1.0;
+	}
+}
+
+static struct meter_loudness *meter_loudness_create(void)
+{
+	struct obs_audio_info oai;
+	if (!obs_get_audio_info(&oai))
+		return NULL;
+
+	struct meter_loudness *loudness = bzalloc(sizeof(*loudness));
+	const double rate = (double)oai.samples_per_sec;
+
+	loudness->channels = get_audio_channels(oai.speakers);
+	for (size_t i = 0; i < loudness->channels; i++)
+		loudness->weights[i] = loudness_channel_weight(oai.speakers, i);
+
+	/* K-weighting: a high shelf for the acoustic effects of the head,
+	 * then a high pass, both computed for the output sample rate */
+	double f0 = 1681.974450955533;
+	double gain = 3.999843853973347;
+	double q = 0.7071752369554196;
+	double k = tan(M_PI * f0 / rate);
+	double vh = pow(10.0, gain / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+
+	loudness->b[0][0] = (vh + vb * k / q + k * k) / a0;
+	loudness->b[0][1] = 2.0 * (k * k - vh) / a0;
+	loudness->b[0][2] = (vh - vb * k / q + k * k) / a0;
+	loudness->a[0][1] = 2.0 * (k * k - 1.0) / a0;
+	loudness->a[0][2] = (1.0 - k / q + k * k) / a0;
+
+	f0 = 38.13547087602444;
+	q = 0.5003270373238773;
+	k = tan(M_PI * f0 / rate);
+	a0 = 1.0 + k / q + k * k;
+
+	loudness->b[1][0] = 1.0;
+	loudness->b[1][1] = -2.0;
+	loudness->b[1][2] = 1.0;
+	loudness->a[1][1] = 2.0 * (k * k - 1.0) / a0;
+	loudness->a[1][2] = (1.0 - k / q + k * k) / a0;
+
+	/* mean energy of the blocks in each bin */
+	for (size_t i = 0; i < LOUDNESS_BINS; i++) {
+		const double lufs = LOUDNESS_GATE + ((double)i + 0.5) / 10.0;
+		loudness->bin_energy[i] = pow(10.0, (lufs + 0.691) / 10.0);
+	}
 
-	volmeter_process_peak(volmeter, data, nr_channels);
-	volmeter_process_magnitude(volmeter, data, nr_channels);
+	loudness->sub_block_frames = oai.samples_per_sec / 10;
+	return loudness;
 }
 
-static void volmeter_source_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
+static inline double energy_to_loudness(double energy)
+{
+	return -0.691 + 10.0 * log10(energy);
+}
+
+static float meter_loudness_integrated(const struct meter_loudness *loudness, const struct loudness_gate *gate)
+{
+	double energy = 0.0;
+	uint64_t count = 0;
+
+	for (size_t i = 0; i < LOUDNESS_BINS; i++) {
+		energy += loudness->bin_energy[i] * gate->histogram[i];
+		count += gate->histogram[i];
+	}
+
+	if (!count)
+		return -INFINITY;
+
+	/* relative gate, 10 LU below the loudness of the absolute gated
+	 * blocks */
+	const double relative_gate = energy_to_loudness(energy / (double)count) - 10.0;
+	double first = ceil((relative_gate - LOUDNESS_GATE) * 10.0);
+	size_t start = first > 0.0 ? (size_t)first : 0;
+
+	energy = 0.0;
+	count = 0;
+	for (size_t i = start; i < LOUDNESS_BINS; i++) {
+		energy += loudness->bin_energy[i] * gate->histogram[i];
+		count += gate->histogram[i];
+	}
+
+	return count ? (float)energy_to_loudness(energy / (double)count) : -INFINITY;
+}
+
+/* every 100 ms, the last 400 ms form a gating block. A meter only counts the
+ * block once all of it was measured since the meter was enabled or reset. */
+static void meter_loudness_end_sub_block(struct obs_source_meter *meter)
+{
+	struct meter_loudness *loudness = meter->loudness;
+
+	memmove(loudness->sub_energy, loudness->sub_energy + 1, sizeof(double) * (LOUDNESS_SUB_BLOCKS - 1));
+	loudness->sub_energy[LOUDNESS_SUB_BLOCKS - 1] = loudness->cur_energy / (double)loudness->sub_block_frames;
+	loudness->cur_energy = 0.0;
+	loudness->cur_frames = 0;
+
+	double energy = 0.0;
+	for (size_t i = 0; i < LOUDNESS_SUB_BLOCKS; i++)
+		energy += loudness->sub_energy[i];
+	energy /= LOUDNESS_SUB_BLOCKS;
+
+	const double lufs = energy > 0.0 ? energy_to_loudness(energy) : -INFINITY;
+	size_t bin = 0;
+	if (lufs >= LOUDNESS_GATE) {
+		bin = (size_t)((lufs - LOUDNESS_GATE) * 10.0);
+		if (bin >= LOUDNESS_BINS)
+			bin = LOUDNESS_BINS - 1;
+	}
+
+	for (size_t i = 0; i < meter->volmeters.num; i++) {
+		struct obs_volmeter *volmeter = meter->volmeters.array[i];
+
+		pthread_mutex_lock(&volmeter->mutex);
+		struct loudness_gate *gate = volmeter->loudness_gate;
+		if (gate && ++gate->num_sub_blocks >= LOUDNESS_SUB_BLOCKS && lufs >= LOUDNESS_GATE) {
+			gate->histogram[bin]++;
+			volmeter->loudness = meter_loudness_integrated(loudness, gate);
+		}
+		pthread_mutex_unlock(&volmeter->mutex);
+	}
+}
+
+static void meter_loudness_process(struct obs_source_meter *meter, const struct audio_data *data)
+{
+	struct meter_loudness *loudness = meter->loudness;
+	size_t frame = 0;
+
+	while (frame < data->frames) {
+		size_t frames = loudness->sub_block_frames - loudness->cur_frames;
+		if (frames > data->frames - frame)
+			frames = data->frames - frame;
+
+		for (size_t c = 0; c < loudness->channels; c++) {
+			const float *samples = (const float *)data->data[c];
+			if (!samples || loudness->weights[c] == 0.0)
+				continue;
+
+			double(*z)[2] = loudness->z[c];
+			double sum = 0.0;
+
+			for (size_t i = frame; i < frame + frames; i++) {
+				double x = samples[i];
+
+				for (size_t s = 0; s < 2; s++) {
+					const double y = loudness->b[s][0] * x + z[s][0];
+					z[s][0] = loudness->b[s][1] * x - loudness->a[s][1] * y + z[s][1];
+					z[s][1] = loudness->b[s][2] * x - loudness->a[s][2] * y;
+					x = y;
+				}
+
+				sum += x * x;
+			}
+
+			loudness->cur_energy += sum * loudness->weights[c];
+		}
+
+		loudness->cur_frames += frames;
+		frame += frames;
+
+		if (loudness->cur_frames == loudness->sub_block_frames)
+			meter_loudness_end_sub_block(meter);
+	}
+}
+
+static void volmeter_signal_levels(struct obs_volmeter *volmeter, struct obs_source_meter *meter,
+				   obs_source_t *source, bool muted)
 {
-	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
 	float mul;
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
@@ -499,18 +709,18 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source, cons
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	volmeter_process_audio_data(volmeter, data);
+	const float *levels = volmeter->peak_meter_type == TRUE_PEAK_METER ? meter->true_peak : meter->sample_peak;
 
 	// Adjust magnitude/peak based on the volume level set by the user.
 	// And convert to dB.
 	mul = muted && !obs_source_muted(source) ? 0.0f : db_to_mul(volmeter->cur_db);
 	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		magnitude[channel_nr] = mul_to_db(volmeter->magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr] * mul);
+		magnitude[channel_nr] = mul_to_db(meter->magnitude[channel_nr] * mul);
+		peak[channel_nr] = mul_to_db(levels[channel_nr] * mul);
 
 		/* The input-peak is NOT adjusted with volume, so that the user
 		 * can check the input-gain. */
-		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
+		input_peak[channel_nr] = mul_to_db(levels[channel_nr]);
 	}
 
 	pthread_mutex_unlock(&volmeter->mutex);
@@ -518,6 +728,85 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source, cons
 	signal_levels_updated(volmeter, magnitude, peak, input_peak);
 }
 
+/* called with the source's audio_cb_mutex held */
+static void meter_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
+{
+	struct obs_source_meter *meter = vptr;
+	bool sample_peak = false;
+	bool true_peak = false;
+	bool loudness = false;
+
+	for (size_t i = 0; i < meter->volmeters.num; i++) {
+		struct obs_volmeter *volmeter = meter->volmeters.array[i];
+
+		pthread_mutex_lock(&volmeter->mutex);
+		if (volmeter->peak_meter_type == TRUE_PEAK_METER)
+			true_peak = true;
+		else
+			sample_peak = true;
+
+		if (volmeter->loudness_gate)
+			loudness = true;
+		pthread_mutex_unlock(&volmeter->mutex);
+	}
+
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	meter_process_peak(meter, data, nr_channels, sample_peak, true_peak);
+	meter_process_magnitude(meter, data, nr_channels);
+
+	if (loudness) {
+		if (!meter->loudness)
+			meter->loudness = meter_loudness_create();
+		if (meter->loudness)
+			meter_loudness_process(meter, data);
+	} else if (meter->loudness) {
+		bfree(meter->loudness);
+		meter->loudness = NULL;
+	}
+
+	for (size_t i = meter->volmeters.num; i > 0; i--)
+		volmeter_signal_levels(meter->volmeters.array[i - 1], meter, source, muted);
+}
+
+static void meter_subscribe(obs_source_t *source, struct obs_volmeter *volmeter)
+{
+	pthread_mutex_lock(&source->audio_cb_mutex);
+
+	if (!source->meter) {
+		struct audio_cb_info info = {meter_data_received, NULL};
+
+		source->meter = bzalloc(sizeof(struct obs_source_meter));
+		info.param = source->meter;
+		da_push_back(source->audio_cb_list, &info);
+	}
+
+	da_push_back(source->meter->volmeters, &volmeter);
+
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
+static void meter_unsubscribe(obs_source_t *source, struct obs_volmeter *volmeter)
+{
+	pthread_mutex_lock(&source->audio_cb_mutex);
+
+	struct obs_source_meter *meter = source->meter;
+	if (meter) {
+		da_erase_item(meter->volmeters, &volmeter);
+
+		if (!meter->volmeters.num) {
+			struct audio_cb_info info = {meter_data_received, meter};
+			da_erase_item(source->audio_cb_list, &info);
+
+			da_free(meter->volmeters);
+			bfree(meter->loudness);
+			bfree(meter);
+			source->meter = NULL;
+		}
+	}
+
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
 obs_fader_t *obs_fader_create(enum obs_fader_type type)
 {
 	struct obs_fader *fader = bzalloc(sizeof(struct obs_fader));
@@ -742,6 +1031,7 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 		goto fail;
 
 	volmeter->type = type;
+	volmeter->loudness = -INFINITY;
 
 	return volmeter;
 fail:
@@ -759,6 +1049,7 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
 
+	bfree(volmeter->loudness_gate);
 	bfree(volmeter);
 }
 
@@ -775,7 +1066,7 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 	sh = obs_source_get_signal_handler(source);
 	signal_handler_connect(sh, "volume", volmeter_source_volume_changed, volmeter);
 	signal_handler_connect(sh, "destroy", volmeter_source_destroyed, volmeter);
-	obs_source_add_audio_capture_callback(source, volmeter_source_data_received, volmeter);
+	meter_subscribe(source, volmeter);
 	vol = obs_source_get_volume(source);
 
 	pthread_mutex_lock(&volmeter->mutex);
@@ -807,7 +1098,7 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 	sh = obs_source_get_signal_handler(source);
 	signal_handler_disconnect(sh, "volume", volmeter_source_volume_changed, volmeter);
 	signal_handler_disconnect(sh, "destroy", volmeter_source_destroyed, volmeter);
-	obs_source_remove_audio_capture_callback(source, volmeter_source_data_received, volmeter);
+	meter_unsubscribe(source, volmeter);
 }
 
 void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter, enum obs_peak_meter_type peak_meter_type)
@@ -862,6 +1153,49 @@ void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated
 	pthread_mutex_unlock(&volmeter->callback_mutex);
 }
 
+void obs_volmeter_set_loudness_enabled(obs_volmeter_t *volmeter, bool enabled)
+{
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_set_loudness_enabled"))
+		return;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	if (enabled && !volmeter->loudness_gate) {
+		volmeter->loudness_gate = bzalloc(sizeof(struct loudness_gate));
+		volmeter->loudness = -INFINITY;
+	} else if (!enabled && volmeter->loudness_gate) {
+		bfree(volmeter->loudness_gate);
+		volmeter->loudness_gate = NULL;
+		volmeter->loudness = -INFINITY;
+	}
+	pthread_mutex_unlock(&volmeter->mutex);
+}
+
+float obs_volmeter_get_loudness(obs_volmeter_t *volmeter)
+{
+	float loudness;
+
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_get_loudness"))
+		return -INFINITY;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	loudness = volmeter->loudness;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	return loudness;
+}
+
+void obs_volmeter_reset_loudness(obs_volmeter_t *volmeter)
+{
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_reset_loudness"))
+		return;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	if (volmeter->loudness_gate)
+		memset(volmeter->loudness_gate, 0, sizeof(struct loudness_gate));
+	volmeter->loudness = -INFINITY;
+	pthread_mutex_unlock(&volmeter->mutex);
+}
+
 float obs_mul_to_db(float mul)
 {
 	return mul_to_db(mul);
@@ -238,6 +238,29 @@ typedef void (*obs_volmeter_updated_t)(void *param, const float magnitude[MAX_AU
 EXPORT void obs_volmeter_add_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 
+/**
+ * @brief Enable integrated loudness measurement (ITU-R BS.1770 / EBU R128)
+ * @param volmeter pointer to the volume meter object
+ * @param enabled whether loudness is measured
+ *
+ * Loudness is measured on the source's audio before volume and muting,
+ * starting when it is enabled.
+ */
+EXPORT void obs_volmeter_set_loudness_enabled(obs_volmeter_t *volmeter, bool enabled);
+
+/**
+ * @brief Get the integrated loudness measured so far
+ * @param volmeter pointer to the volume meter object
+ * @return loudness in LUFS, or -INFINITY if nothing has been measured
+ */
+EXPORT float obs_volmeter_get_loudness(obs_volmeter_t *volmeter);
+
+/**
+ * @brief Restart the integrated loudness measurement
+ * @param volmeter pointer to the volume meter object
+ */
+EXPORT void obs_volmeter_reset_loudness(obs_volmeter_t *volmeter);
+
 EXPORT float obs_mul_to_db(float mul);
 EXPORT float obs_db_to_mul(float db);
 
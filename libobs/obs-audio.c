@@ -105,6 +105,7 @@ static bool ignore_audio(obs_source_t *source, size_t channels, size_t sample_ra
 		for (size_t ch = 0; ch < channels; ch++)
 			deque_pop_front(&source->audio_input_buf[ch], NULL, drop * sizeof(float));
 
+		source_profiler_audio_dropped(source, drop);
 		source->last_audio_input_buf_size = 0;
 		source->audio_ts += util_mul_div64(drop, 1000000000ULL, sample_rate);
 		blog(LOG_DEBUG, "[src: %s] ts lag after ignoring: %" PRIu64, name, start_ts - source->audio_ts);
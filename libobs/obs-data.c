@@ -27,7 +27,11 @@
 #include "graphics/quat.h"
 #include "obs-data.h"
 
-#include <jansson.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
 
 struct obs_data_item {
 	volatile long ref;
@@ -48,6 +52,9 @@ struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *items;
+
+	/* incremented on every change to the items, see obs_data_get_revision */
+	long revision;
 };
 
 struct obs_data_array {
@@ -302,9 +309,16 @@ static struct obs_data_item *obs_data_item_create(const char *name, const void *
 	return item;
 }
 
+static inline void obs_data_touch(struct obs_data *data)
+{
+	if (data)
+		data->revision++;
+}
+
 static inline void obs_data_item_detach(struct obs_data_item *item)
 {
 	if (item->parent) {
+		obs_data_touch(item->parent);
 		HASH_DEL(item->parent->items, item);
 		item->parent = NULL;
 	}
@@ -440,147 +454,770 @@ static inline void obs_data_item_set_autoselect_data(struct obs_data_item **p_it
 
 /* ------------------------------------------------------------------------- */
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key, json_t *json);
+/* Single pass JSON parser.  Builds obs_data items directly from the text and
+ * otherwise follows the rules of json_loads() with JSON_REJECT_DUPLICATES. */
+
+#define JSON_MAX_DEPTH 2048
+
+struct json_parser {
+	const char *pos;
+	int line;
+	size_t depth;
+
+	/* unescaped strings; an object key stays on the buffer while its
+	 * value is parsed, so always address strings by offset */
+	DARRAY(char) buf;
+	/* offsets of keys bound to null, which leave no item behind to catch
+	 * a duplicate with */
+	DARRAY(size_t) null_keys;
 
-static inline void obs_data_add_json_object_data(obs_data_t *data, json_t *jobj)
+	char error[160];
+};
+
+static struct obs_data_item *get_item(struct obs_data *data, const char *name);
+
+static bool json_error(struct json_parser *p, const char *format, ...)
 {
-	const char *item_key;
-	json_t *jitem;
+	va_list args;
 
-	json_object_foreach (jobj, item_key, jitem) {
-		obs_data_add_json_item(data, item_key, jitem);
+	if (!*p->error) {
+		va_start(args, format);
+		vsnprintf(p->error, sizeof(p->error), format, args);
+		va_end(args);
 	}
+
+	return false;
 }
 
-static inline void obs_data_add_json_object(obs_data_t *data, const char *key, json_t *jobj)
+static inline void json_skip_whitespace(struct json_parser *p)
 {
-	obs_data_t *sub_obj = obs_data_create();
+	for (;;) {
+		char ch = *p->pos;
+		if (ch == '\n')
+			p->line++;
+		else if (ch != ' ' && ch != '\t' && ch != '\r')
+			break;
+		p->pos++;
+	}
+}
 
-	obs_data_add_json_object_data(sub_obj, jobj);
-	obs_data_set_obj(data, key, sub_obj);
-	obs_data_release(sub_obj);
+static inline bool json_expect(struct json_parser *p, const char *token, size_t len)
+{
+	if (strncmp(p->pos, token, len) != 0)
+		return json_error(p, "invalid token");
+
+	p->pos += len;
+	return true;
 }
 
-static void obs_data_add_json_array(obs_data_t *data, const char *key, json_t *jarray)
+/* returns the length of the UTF-8 sequence at str, or 0 if it is invalid */
+static inline size_t utf8_seq_len(const uint8_t *str)
 {
-	obs_data_array_t *array = obs_data_array_create();
-	size_t idx;
-	json_t *jitem;
+	uint8_t ch = str[0];
 
-	json_array_foreach (jarray, idx, jitem) {
-		obs_data_t *item;
+	if (ch < 0x80)
+		return 1;
 
-		if (!json_is_object(jitem))
-			continue;
+	if (ch >= 0xC2 && ch <= 0xDF)
+		return (str[1] & 0xC0) == 0x80 ? 2 : 0;
 
-		item = obs_data_create();
-		obs_data_add_json_object_data(item, jitem);
-		obs_data_array_push_back(array, item);
-		obs_data_release(item);
+	if (ch >= 0xE0 && ch <= 0xEF) {
+		if ((str[1] & 0xC0) != 0x80 || (str[2] & 0xC0) != 0x80)
+			return 0;
+		if (ch == 0xE0 && str[1] < 0xA0) /* overlong */
+			return 0;
+		if (ch == 0xED && str[1] > 0x9F) /* surrogate */
+			return 0;
+		return 3;
 	}
 
-	obs_data_set_array(data, key, array);
-	obs_data_array_release(array);
+	if (ch >= 0xF0 && ch <= 0xF4) {
+		if ((str[1] & 0xC0) != 0x80 || (str[2] & 0xC0) != 0x80 || (str[3] & 0xC0) != 0x80)
+			return 0;
+		if (ch == 0xF0 && str[1] < 0x90) /* overlong */
+			return 0;
+		if (ch == 0xF4 && str[1] > 0x8F) /* above U+10FFFF */
+			return 0;
+		return 4;
+	}
+
+	return 0;
 }
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key, json_t *json)
+static bool json_parse_hex4(struct json_parser *p, uint32_t *val)
 {
-	if (json_is_object(json))
-		obs_data_add_json_object(data, key, json);
-	else if (json_is_array(json))
-		obs_data_add_json_array(data, key, json);
-	else if (json_is_string(json))
-		obs_data_set_string(data, key, json_string_value(json));
-	else if (json_is_integer(json))
-		obs_data_set_int(data, key, json_integer_value(json));
-	else if (json_is_real(json))
-		obs_data_set_double(data, key, json_real_value(json));
-	else if (json_is_true(json))
-		obs_data_set_bool(data, key, true);
-	else if (json_is_false(json))
-		obs_data_set_bool(data, key, false);
+	*val = 0;
+
+	for (size_t i = 0; i < 4; i++) {
+		char ch = *p->pos;
+		uint32_t digit;
+
+		if (ch >= '0' && ch <= '9')
+			digit = ch - '0';
+		else if (ch >= 'a' && ch <= 'f')
+			digit = ch - 'a' + 10;
+		else if (ch >= 'A' && ch <= 'F')
+			digit = ch - 'A' + 10;
+		else
+			return json_error(p, "invalid escape");
+
+		*val = (*val << 4) | digit;
+		p->pos++;
+	}
+
+	return true;
 }
 
-/* ------------------------------------------------------------------------- */
+static bool json_parse_unicode_escape(struct json_parser *p)
+{
+	uint32_t cp;
+	char utf8[4];
+	size_t len;
 
-static inline void set_json_string(json_t *json, const char *name, obs_data_item_t *item)
+	if (!json_parse_hex4(p, &cp))
+		return false;
+
+	if (cp >= 0xD800 && cp <= 0xDBFF) {
+		uint32_t low;
+
+		if (p->pos[0] != '\\' || p->pos[1] != 'u')
+			return json_error(p, "invalid Unicode '\\u%04X'", cp);
+
+		p->pos += 2;
+		if (!json_parse_hex4(p, &low))
+			return false;
+		if (low < 0xDC00 || low > 0xDFFF)
+			return json_error(p, "invalid Unicode '\\u%04X\\u%04X'", cp, low);
+
+		cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+
+	} else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+		return json_error(p, "invalid Unicode '\\u%04X'", cp);
+
+	} else if (cp == 0) {
+		return json_error(p, "\\u0000 is not allowed");
+	}
+
+	if (cp < 0x80) {
+		utf8[0] = (char)cp;
+		len = 1;
+	} else if (cp < 0x800) {
+		utf8[0] = (char)(0xC0 | (cp >> 6));
+		utf8[1] = (char)(0x80 | (cp & 0x3F));
+		len = 2;
+	} else if (cp < 0x10000) {
+		utf8[0] = (char)(0xE0 | (cp >> 12));
+		utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		utf8[2] = (char)(0x80 | (cp & 0x3F));
+		len = 3;
+	} else {
+		utf8[0] = (char)(0xF0 | (cp >> 18));
+		utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+		utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		utf8[3] = (char)(0x80 | (cp & 0x3F));
+		len = 4;
+	}
+
+	da_push_back_array(p->buf, utf8, len);
+	return true;
+}
+
+/* appends the unescaped, null terminated string to the parser buffer and
+ * returns its offset, or (size_t)-1 on failure */
+static size_t json_parse_string(struct json_parser *p)
 {
-	const char *val = obs_data_item_get_string(item);
-	json_object_set_new(json, name, json_string(val));
+	size_t offset = p->buf.num;
+
+	p->pos++; /* opening quote */
+
+	for (;;) {
+		const char *start = p->pos;
+		uint8_t ch;
+
+		/* plain ASCII runs are copied in one go */
+		while ((ch = (uint8_t)*p->pos) >= 0x20 && ch < 0x80 && ch != '"' && ch != '\\')
+			p->pos++;
+
+		if (p->pos != start)
+			da_push_back_array(p->buf, start, p->pos - start);
+
+		if (ch == '"') {
+			p->pos++;
+			break;
+
+		} else if (ch == '\\') {
+			char esc = p->pos[1];
+			char out;
+
+			p->pos += 2;
+			switch (esc) {
+			case '"':
+			case '\\':
+			case '/':
+				out = esc;
+				break;
+			case 'b':
+				out = '\b';
+				break;
+			case 'f':
+				out = '\f';
+				break;
+			case 'n':
+				out = '\n';
+				break;
+			case 'r':
+				out = '\r';
+				break;
+			case 't':
+				out = '\t';
+				break;
+			case 'u':
+				if (!json_parse_unicode_escape(p))
+					return (size_t)-1;
+				continue;
+			default:
+				json_error(p, "invalid escape");
+				return (size_t)-1;
+			}
+
+			da_push_back(p->buf, &out);
+
+		} else if (ch >= 0x80) {
+			size_t len = utf8_seq_len((const uint8_t *)p->pos);
+			if (!len) {
+				json_error(p, "unable to decode byte 0x%x", ch);
+				return (size_t)-1;
+			}
+
+			da_push_back_array(p->buf, p->pos, len);
+			p->pos += len;
+
+		} else if (!ch) {
+			json_error(p, "premature end of input");
+			return (size_t)-1;
+
+		} else {
+			json_error(p, "control character 0x%x", ch);
+			return (size_t)-1;
+		}
+	}
+
+	da_push_back_new(p->buf);
+	return offset;
+}
+
+static inline bool is_digit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+static double json_strtod(struct json_parser *p, const char *str, size_t len)
+{
+	const char *point = localeconv()->decimal_point;
+	size_t offset = p->buf.num;
+	char *copy;
+	double val;
+
+	da_push_back_array(p->buf, str, len);
+	da_push_back_new(p->buf);
+	copy = p->buf.array + offset;
+
+	if (*point != '.') {
+		char *pos = strchr(copy, '.');
+		if (pos)
+			*pos = *point;
+	}
+
+	val = strtod(copy, NULL);
+	da_resize(p->buf, offset);
+	return val;
 }
 
-static inline void set_json_number(json_t *json, const char *name, obs_data_item_t *item)
+static bool json_parse_number(struct json_parser *p, obs_data_t *data, size_t key)
 {
-	enum obs_data_number_type type = obs_data_item_numtype(item);
+	const char *start = p->pos;
+	unsigned long long int_val = 0;
+	bool negative = false;
+	bool overflow = false;
+	bool real = false;
 
-	if (type == OBS_DATA_NUM_INT) {
-		long long val = obs_data_item_get_int(item);
-		json_object_set_new(json, name, json_integer(val));
+	if (*p->pos == '-') {
+		negative = true;
+		p->pos++;
+	}
+
+	if (*p->pos == '0') {
+		p->pos++;
+		if (is_digit(*p->pos))
+			return json_error(p, "invalid token");
+	} else if (is_digit(*p->pos)) {
+		while (is_digit(*p->pos)) {
+			unsigned digit = *p->pos - '0';
+			if (int_val > (ULLONG_MAX - digit) / 10)
+				overflow = true;
+			else
+				int_val = int_val * 10 + digit;
+			p->pos++;
+		}
 	} else {
-		double val = obs_data_item_get_double(item);
-		json_object_set_new(json, name, json_real(val));
+		return json_error(p, "invalid token");
+	}
+
+	if (*p->pos == '.') {
+		p->pos++;
+		if (!is_digit(*p->pos))
+			return json_error(p, "invalid token");
+		while (is_digit(*p->pos))
+			p->pos++;
+		real = true;
+	}
+
+	if (*p->pos == 'e' || *p->pos == 'E') {
+		p->pos++;
+		if (*p->pos == '+' || *p->pos == '-')
+			p->pos++;
+		if (!is_digit(*p->pos))
+			return json_error(p, "invalid token");
+		while (is_digit(*p->pos))
+			p->pos++;
+		real = true;
+	}
+
+	if (real) {
+		double val = json_strtod(p, start, p->pos - start);
+		if (isinf(val))
+			return json_error(p, "real number overflow");
+		if (data)
+			obs_data_set_double(data, p->buf.array + key, val);
+
+	} else if (negative) {
+		if (overflow || int_val > (unsigned long long)LLONG_MAX + 1)
+			return json_error(p, "too big negative integer");
+		if (data)
+			obs_data_set_int(data, p->buf.array + key, (long long)(0 - int_val));
+
+	} else {
+		if (overflow || int_val > LLONG_MAX)
+			return json_error(p, "too big integer");
+		if (data)
+			obs_data_set_int(data, p->buf.array + key, (long long)int_val);
 	}
+
+	return true;
 }
 
-static inline void set_json_bool(json_t *json, const char *name, obs_data_item_t *item)
+static bool json_parse_object(struct json_parser *p, obs_data_t *data);
+static bool json_parse_array(struct json_parser *p, obs_data_array_t *array);
+
+/* parses a value into the item named by the key at the given buffer offset,
+ * or validates and discards it if data is NULL */
+static bool json_parse_value(struct json_parser *p, obs_data_t *data, size_t key)
 {
-	bool val = obs_data_item_get_bool(item);
-	json_object_set_new(json, name, val ? json_true() : json_false());
+	switch (*p->pos) {
+	case '{': {
+		obs_data_t *obj = obs_data_create();
+		bool success = json_parse_object(p, obj);
+		if (success && data)
+			obs_data_set_obj(data, p->buf.array + key, obj);
+		obs_data_release(obj);
+		return success;
+	}
+	case '[': {
+		obs_data_array_t *array = data ? obs_data_array_create() : NULL;
+		bool success = json_parse_array(p, array);
+		if (success && data)
+			obs_data_set_array(data, p->buf.array + key, array);
+		obs_data_array_release(array);
+		return success;
+	}
+	case '"': {
+		size_t str = json_parse_string(p);
+		if (str == (size_t)-1)
+			return false;
+		if (data)
+			obs_data_set_string(data, p->buf.array + key, p->buf.array + str);
+		return true;
+	}
+	case 't':
+		if (!json_expect(p, "true", 4))
+			return false;
+		if (data)
+			obs_data_set_bool(data, p->buf.array + key, true);
+		return true;
+	case 'f':
+		if (!json_expect(p, "false", 5))
+			return false;
+		if (data)
+			obs_data_set_bool(data, p->buf.array + key, false);
+		return true;
+	case 'n':
+		return json_expect(p, "null", 4);
+	case '\0':
+		return json_error(p, "premature end of input");
+	default:
+		return json_parse_number(p, data, key);
+	}
 }
 
-static json_t *obs_data_to_json(obs_data_t *data, bool with_defaults);
+static bool json_is_duplicate_key(struct json_parser *p, obs_data_t *data, size_t null_base, size_t key)
+{
+	const char *name = p->buf.array + key;
+
+	if (get_item(data, name))
+		return true;
+
+	for (size_t i = null_base; i < p->null_keys.num; i++) {
+		if (strcmp(p->buf.array + p->null_keys.array[i], name) == 0)
+			return true;
+	}
+
+	return false;
+}
 
-static inline void set_json_obj(json_t *json, const char *name, obs_data_item_t *item, bool with_defaults)
+static bool json_parse_object(struct json_parser *p, obs_data_t *data)
 {
-	obs_data_t *obj = obs_data_item_get_obj(item);
-	json_object_set_new(json, name, obs_data_to_json(obj, with_defaults));
-	obs_data_release(obj);
+	size_t base = p->buf.num;
+	size_t null_base = p->null_keys.num;
+	bool success = false;
+
+	if (++p->depth > JSON_MAX_DEPTH)
+		return json_error(p, "maximum parsing depth reached");
+
+	p->pos++; /* { */
+	json_skip_whitespace(p);
+
+	if (*p->pos == '}') {
+		p->pos++;
+		p->depth--;
+		return true;
+	}
+
+	for (;;) {
+		size_t top = p->buf.num;
+		size_t key;
+
+		if (*p->pos != '"') {
+			json_error(p, "string or '}' expected");
+			goto fail;
+		}
+
+		key = json_parse_string(p);
+		if (key == (size_t)-1)
+			goto fail;
+		if (json_is_duplicate_key(p, data, null_base, key)) {
+			json_error(p, "duplicate object key");
+			goto fail;
+		}
+
+		json_skip_whitespace(p);
+		if (*p->pos != ':') {
+			json_error(p, "':' expected");
+			goto fail;
+		}
+		p->pos++;
+		json_skip_whitespace(p);
+
+		bool is_null = *p->pos == 'n';
+		if (!json_parse_value(p, data, key))
+			goto fail;
+
+		/* keep null keys on the buffer until the object ends */
+		if (is_null) {
+			da_push_back(p->null_keys, &key);
+			da_resize(p->buf, key + strlen(p->buf.array + key) + 1);
+		} else {
+			da_resize(p->buf, top);
+		}
+
+		json_skip_whitespace(p);
+
+		if (*p->pos == '}')
+			break;
+		if (*p->pos != ',') {
+			json_error(p, "'}' expected");
+			goto fail;
+		}
+
+		p->pos++;
+		json_skip_whitespace(p);
+	}
+
+	p->pos++;
+	p->depth--;
+	success = true;
+
+fail:
+	da_resize(p->buf, base);
+	da_resize(p->null_keys, null_base);
+	return success;
+}
+
+/* only objects can be stored in obs_data arrays, anything else is validated
+ * and skipped */
+static bool json_parse_array(struct json_parser *p, obs_data_array_t *array)
+{
+	if (++p->depth > JSON_MAX_DEPTH)
+		return json_error(p, "maximum parsing depth reached");
+
+	p->pos++; /* [ */
+	json_skip_whitespace(p);
+
+	if (*p->pos == ']') {
+		p->pos++;
+		p->depth--;
+		return true;
+	}
+
+	for (;;) {
+		if (*p->pos == '{') {
+			obs_data_t *obj = obs_data_create();
+			bool success = json_parse_object(p, obj);
+			if (success && array)
+				obs_data_array_push_back(array, obj);
+			obs_data_release(obj);
+			if (!success)
+				return false;
+
+		} else if (!json_parse_value(p, NULL, 0)) {
+			return false;
+		}
+
+		json_skip_whitespace(p);
+
+		if (*p->pos == ']')
+			break;
+		if (*p->pos != ',')
+			return json_error(p, "']' expected");
+
+		p->pos++;
+		json_skip_whitespace(p);
+	}
+
+	p->pos++;
+	p->depth--;
+	return true;
 }
 
-static inline void set_json_array(json_t *json, const char *name, obs_data_item_t *item, bool with_defaults)
+static bool json_parse(struct json_parser *p, obs_data_t *data)
 {
-	json_t *jarray = json_array();
-	obs_data_array_t *array = obs_data_item_get_array(item);
-	size_t count = obs_data_array_count(array);
+	bool success;
+
+	json_skip_whitespace(p);
+
+	/* like jansson, a root array is accepted but its contents can't be
+	 * represented, so the result is an empty object */
+	if (*p->pos == '{')
+		success = json_parse_object(p, data);
+	else if (*p->pos == '[')
+		success = json_parse_array(p, NULL);
+	else
+		return json_error(p, "'[' or '{' expected");
+
+	if (!success)
+		return false;
+
+	json_skip_whitespace(p);
+	if (*p->pos)
+		return json_error(p, "end of file expected");
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Single pass JSON writer.  Output is identical to json_dumps() with
+ * JSON_PRESERVE_ORDER and either JSON_COMPACT or JSON_INDENT(4), including
+ * jansson's habit of dropping strings that are not valid UTF-8 and
+ * non-finite numbers. */
+
+struct json_writer {
+	struct dstr out;
+	bool pretty;
+	bool with_defaults;
+};
+
+static inline void json_write_indent(struct json_writer *w, size_t depth)
+{
+	static const char spaces[] = "                ";
+
+	if (!w->pretty)
+		return;
+
+	dstr_cat_ch(&w->out, '\n');
+
+	for (size_t n = depth * 4; n;) {
+		size_t count = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+		dstr_ncat(&w->out, spaces, count);
+		n -= count;
+	}
+}
+
+/* returns false if the string is not valid UTF-8, in which case the caller
+ * discards the partially written item */
+static bool json_write_string(struct json_writer *w, const char *str)
+{
+	static const char hex[] = "0123456789ABCDEF";
+
+	dstr_cat_ch(&w->out, '"');
+
+	for (;;) {
+		const char *start = str;
+		uint8_t ch;
+
+		while ((ch = (uint8_t)*str) >= 0x20 && ch < 0x80 && ch != '"' && ch != '\\')
+			str++;
+
+		if (str != start)
+			dstr_ncat(&w->out, start, str - start);
+		if (!ch)
+			break;
+
+		if (ch >= 0x80) {
+			size_t len = utf8_seq_len((const uint8_t *)str);
+			if (!len)
+				return false;
+
+			dstr_ncat(&w->out, str, len);
+			str += len;
+			continue;
+		}
+
+		char esc[6] = {'\\', 0};
+		size_t len = 2;
+
+		switch (ch) {
+		case '"':
+		case '\\':
+			esc[1] = (char)ch;
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[ch >> 4];
+			esc[5] = hex[ch & 0xF];
+			len = 6;
+		}
+
+		dstr_ncat(&w->out, esc, len);
+		str++;
+	}
+
+	dstr_cat_ch(&w->out, '"');
+	return true;
+}
+
+static bool json_write_number(struct json_writer *w, obs_data_item_t *item)
+{
+	char num[100];
+
+	if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT) {
+		snprintf(num, sizeof(num), "%lld", obs_data_item_get_int(item));
+	} else {
+		double val = obs_data_item_get_double(item);
+		if (!isfinite(val) || os_dtostr(val, num, sizeof(num)) < 0)
+			return false;
+	}
+
+	dstr_cat(&w->out, num);
+	return true;
+}
+
+static void json_write_obj(struct json_writer *w, obs_data_t *data, size_t depth);
+
+static void json_write_array(struct json_writer *w, obs_data_array_t *array, size_t depth)
+{
+	size_t count = array ? array->objects.num : 0;
+
+	dstr_cat_ch(&w->out, '[');
 
 	for (size_t idx = 0; idx < count; idx++) {
-		obs_data_t *sub_item = obs_data_array_item(array, idx);
-		json_t *jitem = obs_data_to_json(sub_item, with_defaults);
-		json_array_append_new(jarray, jitem);
-		obs_data_release(sub_item);
+		if (idx)
+			dstr_cat_ch(&w->out, ',');
+		json_write_indent(w, depth + 1);
+		json_write_obj(w, array->objects.array[idx], depth + 1);
 	}
 
-	json_object_set_new(json, name, jarray);
-	obs_data_array_release(array);
+	if (count)
+		json_write_indent(w, depth);
+	dstr_cat_ch(&w->out, ']');
 }
 
-static json_t *obs_data_to_json(obs_data_t *data, bool with_defaults)
+static bool json_write_item(struct json_writer *w, obs_data_item_t *item, size_t depth)
 {
-	json_t *json = json_object();
+	switch (item->type) {
+	case OBS_DATA_STRING:
+		return json_write_string(w, obs_data_item_get_string(item));
+	case OBS_DATA_NUMBER:
+		return json_write_number(w, item);
+	case OBS_DATA_BOOLEAN:
+		dstr_cat(&w->out, obs_data_item_get_bool(item) ? "true" : "false");
+		return true;
+	case OBS_DATA_OBJECT:
+		json_write_obj(w, get_item_obj(item), depth);
+		return true;
+	case OBS_DATA_ARRAY:
+		json_write_array(w, get_item_array(item), depth);
+		return true;
+	case OBS_DATA_NULL:
+		break;
+	}
+
+	return false;
+}
 
+static void json_write_obj(struct json_writer *w, obs_data_t *data, size_t depth)
+{
 	obs_data_item_t *item = NULL;
 	obs_data_item_t *temp = NULL;
+	bool empty = true;
 
-	HASH_ITER (hh, data->items, item, temp) {
-		enum obs_data_type type = obs_data_item_gettype(item);
-		const char *name = get_item_name(item);
+	dstr_cat_ch(&w->out, '{');
 
-		if (!with_defaults && !obs_data_item_has_user_value(item))
-			continue;
+	if (data) {
+		HASH_ITER (hh, data->items, item, temp) {
+			size_t item_start = w->out.len;
+
+			if (!w->with_defaults && !obs_data_item_has_user_value(item))
+				continue;
+
+			if (!empty)
+				dstr_cat_ch(&w->out, ',');
+			json_write_indent(w, depth + 1);
+
+			if (!json_write_string(w, get_item_name(item))) {
+				dstr_resize(&w->out, item_start);
+				continue;
+			}
+
+			dstr_ncat(&w->out, ": ", w->pretty ? 2 : 1);
+
+			if (!json_write_item(w, item, depth + 1)) {
+				dstr_resize(&w->out, item_start);
+				continue;
+			}
 
-		if (type == OBS_DATA_STRING)
-			set_json_string(json, name, item);
-		else if (type == OBS_DATA_NUMBER)
-			set_json_number(json, name, item);
-		else if (type == OBS_DATA_BOOLEAN)
-			set_json_bool(json, name, item);
-		else if (type == OBS_DATA_OBJECT)
-			set_json_obj(json, name, item, with_defaults);
-		else if (type == OBS_DATA_ARRAY)
-			set_json_array(json, name, item, with_defaults);
+			empty = false;
+		}
 	}
 
-	return json;
+	if (!empty)
+		json_write_indent(w, depth);
+	dstr_cat_ch(&w->out, '}');
 }
 
 /* ------------------------------------------------------------------------- */
@@ -596,22 +1233,27 @@ obs_data_t *obs_data_create()
 obs_data_t *obs_data_create_from_json(const char *json_string)
 {
 	obs_data_t *data = obs_data_create();
+	struct json_parser parser = {.pos = json_string, .line = 1};
+	bool success;
 
-	json_error_t error;
-	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
-
-	if (root) {
-		obs_data_add_json_object_data(data, root);
-		json_decref(root);
+	if (json_string) {
+		success = json_parse(&parser, data);
 	} else {
+		success = json_error(&parser, "wrong arguments");
+		parser.line = -1;
+	}
+
+	if (!success) {
 		blog(LOG_ERROR,
 		     "obs-data.c: [obs_data_create_from_json] "
 		     "Failed reading json string (%d): %s",
-		     error.line, error.text);
+		     parser.line, parser.error);
 		obs_data_release(data);
 		data = NULL;
 	}
 
+	da_free(parser.buf);
+	da_free(parser.null_keys);
 	return data;
 }
 
@@ -672,8 +1314,7 @@ static inline void obs_data_destroy(struct obs_data *data)
 		obs_data_item_release(&item);
 	}
 
-	/* NOTE: don't use bfree for json text, allocated by json */
-	free(data->json);
+	bfree(data->json);
 	bfree(data);
 }
 
@@ -691,20 +1332,15 @@ static const char *obs_data_get_json_internal(obs_data_t *data, bool pretty, boo
 	if (!data)
 		return NULL;
 
-	size_t flags = JSON_PRESERVE_ORDER;
-
-	if (pretty)
-		flags |= JSON_INDENT(4);
-	else
-		flags |= JSON_COMPACT;
+	struct json_writer writer = {.pretty = pretty, .with_defaults = with_defaults};
 
-	/* NOTE: don't use libobs bfree for json text */
-	free(data->json);
-	data->json = NULL;
+	/* the previous output is a good estimate for the size of this one */
+	if (data->json)
+		dstr_reserve(&writer.out, strlen(data->json) + 1);
 
-	json_t *root = obs_data_to_json(data, with_defaults);
-	data->json = json_dumps(root, flags);
-	json_decref(root);
+	bfree(data->json);
+	json_write_obj(&writer, data, 0);
+	data->json = writer.out.array;
 
 	return data->json;
 }
@@ -734,6 +1370,11 @@ const char *obs_data_get_last_json(obs_data_t *data)
 	return data ? data->json : NULL;
 }
 
+long obs_data_get_revision(obs_data_t *data)
+{
+	return data ? data->revision : 0;
+}
+
 bool obs_data_save_json(obs_data_t *data, const char *file)
 {
 	const char *json = obs_data_get_json(data);
@@ -867,6 +1508,11 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item, co
 {
 	obs_data_item_t *new_item = NULL;
 
+	if (data)
+		obs_data_touch(data);
+	else if (item && *item)
+		obs_data_touch((*item)->parent);
+
 	if ((!item || !*item) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type, default_data, autoselect_data);
 		new_item->parent = data;
@@ -1015,6 +1661,8 @@ static inline void clear_item(struct obs_data_item *item)
 	void *ptr = get_item_data(item);
 	size_t size;
 
+	obs_data_touch(item->parent);
+
 	if (item->data_len) {
 		if (item->type == OBS_DATA_OBJECT) {
 			obs_data_t **obj = item->data_size ? ptr : NULL;
@@ -1439,6 +2087,8 @@ void obs_data_item_unset_user_value(obs_data_item_t *item)
 
 	void *old_non_user_data = get_default_data_ptr(item);
 
+	obs_data_touch(item->parent);
+
 	item_data_release(item);
 	item->data_size = 0;
 	item->data_len = 0;
@@ -1455,6 +2105,8 @@ void obs_data_item_unset_default_value(obs_data_item_t *item)
 
 	void *old_autoselect_data = get_autoselect_data_ptr(item);
 
+	obs_data_touch(item->parent);
+
 	item_default_data_release(item);
 	item->default_size = 0;
 	item->default_len = 0;
@@ -1468,6 +2120,7 @@ void obs_data_item_unset_autoselect_value(obs_data_item_t *item)
 	if (!item || !item->autoselect_size)
 		return;
 
+	obs_data_touch(item->parent);
 	item_autoselect_data_release(item);
 	item->autoselect_size = 0;
 }
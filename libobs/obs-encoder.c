@@ -1399,6 +1399,7 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 		ept->pts = frame->pts;
 		ept->cts = *frame_cts;
 		ept->fer = fer_ts;
+		obs_frame_timing_fill(encoder->media, ept);
 	}
 	send_off_encoder_packet(encoder, success, received, &pkt);
 
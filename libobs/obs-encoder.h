@@ -58,6 +58,10 @@ enum obs_encoder_type {
  * Each frame follows a timeline in the following temporal order:
  *   CTS, FER, FERC, PIR
  *
+ * ACT, FDT and PIA are optional and zero when unknown.  When set, they
+ * fit into that timeline as:
+ *   ACT, CTS, FDT, FER, FERC, PIA, PIR
+ *
  * PTS is the integer-based monotonically increasing value that is used
  * to associate an encoder_packet_time entry with a specific encoder_packet.
  */
@@ -93,6 +97,25 @@ struct encoder_packet_time {
 	 * and packet interleaving.
 	 */
 	uint64_t pir;
+
+	/* ACT (Async Capture Time) is when the oldest async video
+	 * frame newly composited into this frame was received from
+	 * its source via obs_source_output_video(). Zero if no async
+	 * frame was shown for the first time in this frame.
+	 */
+	uint64_t act;
+
+	/* FDT (Frame Download Time) is when the rendered frame was
+	 * copied to system memory for raw (non-texture) encoders.
+	 * Zero for texture-based encoders.
+	 */
+	uint64_t fdt;
+
+	/* PIA (Packet Interleave Arrival) is when the encoded packet
+	 * reached the output's interleaver. PIR - PIA is the time the
+	 * packet waited in the interleave buffer.
+	 */
+	uint64_t pia;
 };
 
 /** Encoder output packet */
@@ -152,6 +152,16 @@ static inline void context_add_hotkey(struct obs_context_data *context, obs_hotk
 	da_push_back(context->hotkeys, &id);
 }
 
+/* hotkeys are saved with their source, so changing them requires saving it again */
+static inline void hotkey_mark_source_dirty(obs_hotkey_t *hotkey)
+{
+	if (hotkey->registerer_type == OBS_HOTKEY_REGISTERER_SOURCE) {
+		obs_weak_source_t *weak = hotkey->registerer;
+		if (weak && weak->source)
+			obs_source_mark_dirty(weak->source);
+	}
+}
+
 static inline obs_hotkey_id obs_hotkey_register_internal(obs_hotkey_registerer_t type, void *registerer,
 							 struct obs_context_data *context, const char *name,
 							 const char *description, obs_hotkey_func func, void *data)
@@ -172,6 +182,7 @@ static inline obs_hotkey_id obs_hotkey_register_internal(obs_hotkey_registerer_t
 	hotkey->pair_partner_id = OBS_INVALID_HOTKEY_PAIR_ID;
 
 	HASH_ADD_HKEY(obs->hotkeys.hotkeys, id, hotkey);
+	hotkey_mark_source_dirty(hotkey);
 
 	if (context) {
 		obs_data_array_t *data = obs_data_get_array(context->hotkey_data, name);
@@ -464,6 +475,8 @@ static inline void create_binding(obs_hotkey_t *hotkey, obs_key_combination_t co
 	binding->key = combo;
 	binding->hotkey_id = hotkey->id;
 	binding->hotkey = hotkey;
+
+	obs->hotkeys.key_entries_dirty = true;
 }
 
 static inline void load_binding(obs_hotkey_t *hotkey, obs_data_t *data)
@@ -512,6 +525,8 @@ void obs_hotkey_load_bindings(obs_hotkey_id id, obs_key_combination_t *combinati
 		for (size_t i = 0; i < num; i++)
 			create_binding(hotkey, combinations[i]);
 
+		hotkey_mark_source_dirty(hotkey);
+
 		if (num || changed)
 			hotkey_signal("hotkey_bindings_changed", hotkey);
 	}
@@ -529,6 +544,7 @@ void obs_hotkey_load(obs_hotkey_id id, obs_data_array_t *data)
 	if (hotkey) {
 		remove_bindings(id);
 		load_bindings(hotkey, data);
+		hotkey_mark_source_dirty(hotkey);
 	}
 	unlock();
 }
@@ -605,10 +621,12 @@ void obs_hotkey_pair_load(obs_hotkey_pair_id id, obs_data_array_t *data0, obs_da
 	if (p1) {
 		remove_bindings(pair->id[0]);
 		load_bindings(p1, data0);
+		hotkey_mark_source_dirty(p1);
 	}
 	if (p2) {
 		remove_bindings(pair->id[1]);
 		load_bindings(p2, data1);
+		hotkey_mark_source_dirty(p2);
 	}
 
 unlock:
@@ -811,6 +829,7 @@ static inline bool remove_bindings(obs_hotkey_id id)
 			release_pressed_binding(binding);
 
 		da_erase(obs->hotkeys.bindings, idx);
+		obs->hotkeys.key_entries_dirty = true;
 		removed = true;
 	}
 
@@ -857,6 +876,7 @@ static inline void unregister_hotkey(obs_hotkey_id id)
 
 	hotkey_signal("hotkey_unregister", hotkey);
 
+	hotkey_mark_source_dirty(hotkey);
 	release_registerer(hotkey);
 
 	if (hotkey->registerer_type == OBS_HOTKEY_REGISTERER_SOURCE)
@@ -958,6 +978,9 @@ void obs_hotkeys_free(void)
 	}
 
 	da_free(obs->hotkeys.bindings);
+	da_free(obs->hotkeys.key_entries);
+	da_free(obs->hotkeys.key_bindings);
+	obs->hotkeys.key_entries_dirty = true;
 
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++) {
 		if (obs->hotkeys.translations[i]) {
@@ -1116,44 +1139,174 @@ void obs_hotkey_enable_background_press(bool enable)
 	unlock();
 }
 
-struct obs_query_hotkeys_helper {
-	uint32_t modifiers;
-	bool no_press;
-	bool strict_modifiers;
-};
+static int cmp_key_binding(const void *a, const void *b)
+{
+	const size_t idx_a = *(const size_t *)a;
+	const size_t idx_b = *(const size_t *)b;
+	const obs_key_t key_a = obs->hotkeys.bindings.array[idx_a].key.key;
+	const obs_key_t key_b = obs->hotkeys.bindings.array[idx_b].key.key;
 
-static inline bool query_hotkey(void *data, size_t idx, obs_hotkey_binding_t *binding)
+	if (key_a != key_b)
+		return key_a < key_b ? -1 : 1;
+
+	/* keep the registration order for bindings of the same key */
+	return idx_a < idx_b ? -1 : (idx_a > idx_b ? 1 : 0);
+}
+
+static void rebuild_key_entries(void)
 {
-	UNUSED_PARAMETER(idx);
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+	const size_t num = hotkeys->bindings.num;
 
-	struct obs_query_hotkeys_helper *param = (struct obs_query_hotkeys_helper *)data;
-	handle_binding(binding, param->modifiers, param->no_press, param->strict_modifiers, NULL);
+	da_resize(hotkeys->key_bindings, num);
+	for (size_t i = 0; i < num; i++)
+		hotkeys->key_bindings.array[i] = i;
 
-	return true;
+	qsort(hotkeys->key_bindings.array, num, sizeof(size_t), cmp_key_binding);
+
+	da_clear(hotkeys->key_entries);
+	for (size_t i = 0; i < num; i++) {
+		size_t idx = hotkeys->key_bindings.array[i];
+		obs_key_t key = hotkeys->bindings.array[idx].key.key;
+		struct obs_hotkey_key_entry *entry = da_end(hotkeys->key_entries);
+
+		if (!entry || entry->key != key) {
+			entry = da_push_back_new(hotkeys->key_entries);
+			entry->key = key;
+			entry->first = i;
+		}
+
+		entry->num++;
+	}
+
+	hotkeys->key_entries_dirty = false;
 }
 
-static inline void query_hotkeys()
+static inline bool binding_state_equal(const obs_hotkey_binding_t *binding, bool pressed, bool modifiers_match)
+{
+	return binding->pressed == pressed && binding->modifiers_match == modifiers_match;
+}
+
+/* handle_binding can need more than one call to settle, e.g. when the key was
+ * pressed before the modifiers, so call it until nothing changes anymore.
+ * After that, it only needs to be called again once the input changes. */
+static inline void update_binding(obs_hotkey_binding_t *binding, uint32_t modifiers, bool no_press,
+				  bool strict_modifiers, bool pressed)
+{
+	for (size_t i = 0; i < 3; i++) {
+		bool was_pressed = binding->pressed;
+		bool modifiers_matched = binding->modifiers_match;
+
+		handle_binding(binding, modifiers, no_press, strict_modifiers, &pressed);
+		if (binding_state_equal(binding, was_pressed, modifiers_matched))
+			break;
+	}
+}
+
+static inline bool is_modifier_key(obs_key_t key)
+{
+	return key == OBS_KEY_SHIFT || key == OBS_KEY_CONTROL || key == OBS_KEY_ALT || key == OBS_KEY_META;
+}
+
+static inline uint32_t modifiers_from_key_state(const bool *key_state)
 {
 	uint32_t modifiers = 0;
-	if (is_pressed(OBS_KEY_SHIFT))
+	if (key_state[OBS_KEY_SHIFT])
 		modifiers |= INTERACT_SHIFT_KEY;
-	if (is_pressed(OBS_KEY_CONTROL))
+	if (key_state[OBS_KEY_CONTROL])
 		modifiers |= INTERACT_CONTROL_KEY;
-	if (is_pressed(OBS_KEY_ALT))
+	if (key_state[OBS_KEY_ALT])
 		modifiers |= INTERACT_ALT_KEY;
-	if (is_pressed(OBS_KEY_META))
+	if (key_state[OBS_KEY_META])
 		modifiers |= INTERACT_COMMAND_KEY;
+	return modifiers;
+}
 
-	struct obs_query_hotkeys_helper param = {
-		modifiers,
-		obs->hotkeys.thread_disable_press,
-		obs->hotkeys.strict_modifiers,
-	};
-	enum_bindings(query_hotkey, &param);
+/* Only bindings of keys that changed are updated, unless the modifiers or
+ * the binding options changed.  When polling, the state of each bound key is
+ * queried once, no matter how many bindings use it. */
+static void update_bindings(bool poll, obs_key_t changed_key)
+{
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+	const bool no_press = hotkeys->thread_disable_press;
+	const bool strict_modifiers = hotkeys->strict_modifiers;
+	bool all = hotkeys->key_entries_dirty;
+
+	if (poll) {
+		hotkeys->key_state[OBS_KEY_SHIFT] = is_pressed(OBS_KEY_SHIFT);
+		hotkeys->key_state[OBS_KEY_CONTROL] = is_pressed(OBS_KEY_CONTROL);
+		hotkeys->key_state[OBS_KEY_ALT] = is_pressed(OBS_KEY_ALT);
+		hotkeys->key_state[OBS_KEY_META] = is_pressed(OBS_KEY_META);
+	}
+
+	const uint32_t modifiers = modifiers_from_key_state(hotkeys->key_state);
+
+	if (hotkeys->key_entries_dirty)
+		rebuild_key_entries();
+
+	if (modifiers != hotkeys->last_modifiers || no_press != hotkeys->last_no_press ||
+	    strict_modifiers != hotkeys->last_strict_modifiers)
+		all = true;
+
+	hotkeys->last_modifiers = modifiers;
+	hotkeys->last_no_press = no_press;
+	hotkeys->last_strict_modifiers = strict_modifiers;
+
+	for (size_t i = 0; i < hotkeys->key_entries.num; i++) {
+		struct obs_hotkey_key_entry *entry = &hotkeys->key_entries.array[i];
+		bool changed = false;
+
+		if (poll && entry->key != OBS_KEY_NONE && !is_modifier_key(entry->key)) {
+			bool pressed = is_pressed(entry->key);
+			changed = pressed != hotkeys->key_state[entry->key];
+			hotkeys->key_state[entry->key] = pressed;
+		} else if (!poll) {
+			changed = entry->key == changed_key;
+		}
+
+		if (!all && !changed)
+			continue;
+
+		const bool pressed = hotkeys->key_state[entry->key];
+		for (size_t j = 0; j < entry->num; j++) {
+			size_t idx = hotkeys->key_bindings.array[entry->first + j];
+			update_binding(&hotkeys->bindings.array[idx], modifiers, no_press, strict_modifiers, pressed);
+
+			/* a callback changed the bindings, the next update
+			 * handles all of them again */
+			if (hotkeys->key_entries_dirty)
+				return;
+		}
+	}
+}
+
+void obs_hotkey_update_key_state(obs_key_t key, bool pressed)
+{
+	if (key <= OBS_KEY_NONE || key >= OBS_KEY_LAST_VALUE)
+		return;
+	if (!lock())
+		return;
+
+	/* hotkeys are being freed */
+	if (!obs->hotkeys.hotkey_thread_initialized) {
+		unlock();
+		return;
+	}
+
+	if (obs->hotkeys.key_state[key] != pressed) {
+		obs->hotkeys.key_state[key] = pressed;
+		update_bindings(false, key);
+	}
+
+	unlock();
 }
 
 #define NBSP "\xC2\xA0"
 
+/* key events reported by platform code are handled as they arrive, polling
+ * keeps running at the full rate so that keys without events aren't delayed */
+#define POLL_INTERVAL_MS 25
+
 void *obs_hotkey_thread(void *arg)
 {
 	UNUSED_PARAMETER(arg);
@@ -1164,12 +1317,14 @@ void *obs_hotkey_thread(void *arg)
 		profile_store_name(obs_get_profiler_name_store(), "obs_hotkey_thread(%g" NBSP "ms)", 25.);
 	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
+	for (;;) {
+		if (os_event_timedwait(obs->hotkeys.stop_event, POLL_INTERVAL_MS) != ETIMEDOUT)
+			break;
 		if (!lock())
 			continue;
 
 		profile_start(hotkey_thread_name);
-		query_hotkeys();
+		update_bindings(true, OBS_KEY_NONE);
 		profile_end(hotkey_thread_name);
 
 		unlock();
@@ -234,6 +234,13 @@ EXPORT void obs_hotkey_inject_event(obs_key_combination_t hotkey, bool pressed);
 
 EXPORT void obs_hotkey_enable_background_press(bool enable);
 
+/**
+ * Updates the pressed state of a physical key and triggers the bindings that
+ * use it.  Called by platform code that receives global key events, which
+ * makes polling unnecessary.
+ */
+EXPORT void obs_hotkey_update_key_state(obs_key_t key, bool pressed);
+
 /* hotkey callback routing (trigger callbacks through e.g. a UI thread) */
 
 typedef void (*obs_hotkey_callback_router_func)(void *data, obs_hotkey_id id, bool pressed);
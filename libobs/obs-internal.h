@@ -46,7 +46,9 @@
 #define HASH_FIND_UUID(head, uuid, out) HASH_FIND(hh_uuid, head, uuid, UUID_STR_LENGTH, out)
 #define HASH_ADD_UUID(head, uuid_field, add) HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
-#define NUM_TEXTURES 2
+/* maximum number of raw frames in flight between staging and mapping */
+#define NUM_TEXTURES 4
+#define DEFAULT_READBACK_DEPTH 2
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
@@ -209,6 +211,13 @@ struct obs_hotkey_binding {
 	obs_hotkey_t *hotkey;
 };
 
+/* bindings using the same key, consecutive in obs_core_hotkeys::key_bindings */
+struct obs_hotkey_key_entry {
+	obs_key_t key;
+	size_t first;
+	size_t num;
+};
+
 struct obs_hotkey_name_map_item;
 void obs_hotkey_name_map_free(void);
 
@@ -296,6 +305,7 @@ struct obs_core_video_mix {
 	struct deque vframe_info_buffer;
 	struct deque vframe_info_buffer_gpu;
 	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	int num_textures;
 	int cur_texture;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
@@ -312,6 +322,16 @@ struct obs_core_video_mix {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	/* mapped raw frames are copied to the video output on this thread
+	 * while the graphics thread renders the next frame */
+	os_sem_t *readback_semaphore;
+	os_event_t *readback_idle;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
+	struct video_data readback_frame;
+	int readback_count;
+
 	video_t *video;
 	struct obs_video_info ovi;
 
@@ -331,6 +351,19 @@ struct obs_core_video_mix {
 
 extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
+extern bool obs_init_video_readback(struct obs_core_video_mix *video);
+extern void obs_free_video_readback(struct obs_core_video_mix *video);
+
+/* Per-frame timestamps recorded on the graphics thread for encoder packet
+ * timing, keyed by video output and frame timestamp. */
+struct obs_frame_timing {
+	video_t *video;
+	uint64_t timestamp;
+	uint64_t act;
+	uint64_t fdt;
+};
+
+#define OBS_FRAME_TIMINGS 128
 
 struct obs_core_video {
 	graphics_t *graphics;
@@ -379,10 +412,25 @@ struct obs_core_video {
 
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
+
+	/* receive time of the oldest async frame newly shown in the mix
+	 * currently being rendered */
+	uint64_t async_capture_ts;
+
+	pthread_mutex_t frame_timings_mutex;
+	struct obs_frame_timing frame_timings[OBS_FRAME_TIMINGS];
+	size_t frame_timings_idx;
+
+	/* applied to video mixes when they are created */
+	uint32_t readback_depth;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
 
+extern void obs_frame_timing_set_capture(video_t *video, uint64_t timestamp, uint64_t act);
+extern void obs_frame_timing_set_download(video_t *video, uint64_t timestamp, uint64_t fdt);
+extern void obs_frame_timing_fill(video_t *video, struct encoder_packet_time *ept);
+
 struct audio_monitor;
 
 struct obs_core_audio {
@@ -418,6 +466,7 @@ struct obs_core_data {
 
 	/* Linked lists */
 	struct obs_source *first_audio_source;
+	struct obs_source *first_tick_source;
 	struct obs_display *first_display;
 	struct obs_output *first_output;
 	struct obs_encoder *first_encoder;
@@ -429,6 +478,7 @@ struct obs_core_data {
 	pthread_mutex_t encoders_mutex;
 	pthread_mutex_t services_mutex;
 	pthread_mutex_t audio_sources_mutex;
+	pthread_mutex_t tick_sources_mutex;
 	pthread_mutex_t draw_callbacks_mutex;
 	pthread_mutex_t canvases_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
@@ -448,6 +498,10 @@ struct obs_core_data {
 	DARRAY(obs_source_t *) sources_to_tick;
 };
 
+/* in obs-video.c; ticks all sources once like the graphics thread does every
+ * frame, only exported for tests that run without video */
+EXPORT void obs_tick_sources(float seconds);
+
 /* user hotkeys */
 struct obs_core_hotkeys {
 	pthread_mutex_t mutex;
@@ -464,6 +518,17 @@ struct obs_core_hotkeys {
 	bool reroute_hotkeys;
 	DARRAY(obs_hotkey_binding_t) bindings;
 
+	/* binding indices grouped by key, rebuilt when bindings change */
+	DARRAY(struct obs_hotkey_key_entry) key_entries;
+	DARRAY(size_t) key_bindings;
+	bool key_entries_dirty;
+
+	/* last known key state, updated by polling or by key events */
+	bool key_state[OBS_KEY_LAST_VALUE];
+	uint32_t last_modifiers;
+	bool last_no_press;
+	bool last_strict_modifiers;
+
 	obs_hotkey_callback_router_func router_func;
 	void *router_func_data;
 
@@ -514,6 +579,7 @@ struct obs_core {
 	struct obs_core_hotkeys hotkeys;
 
 	os_task_queue_t *destruction_task_thread;
+	os_task_pool_t *task_pool;
 
 	obs_task_handler_t ui_task_handler;
 };
@@ -692,6 +758,7 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+	uint64_t received_ts;
 };
 
 enum audio_action_type {
@@ -803,6 +870,11 @@ struct obs_source {
 	bool muted;
 	struct obs_source *next_audio_source;
 	struct obs_source **prev_next_audio_source;
+
+	/* sources that need to be ticked (obs->data.first_tick_source),
+	 * protected by obs->data.tick_sources_mutex */
+	struct obs_source *next_tick_source;
+	struct obs_source **prev_next_tick_source;
 	uint64_t audio_ts;
 	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
@@ -816,6 +888,9 @@ struct obs_source {
 	pthread_mutex_t audio_mutex;
 	pthread_mutex_t audio_cb_mutex;
 	DARRAY(struct audio_cb_info) audio_cb_list;
+	/* level analysis shared by all volume meters, protected by
+	 * audio_cb_mutex */
+	struct obs_source_meter *meter;
 	struct obs_audio_data audio_data;
 	size_t audio_storage_size;
 	uint32_t audio_mixers;
@@ -824,6 +899,7 @@ struct obs_source {
 	int64_t sync_offset;
 	int64_t last_sync_offset;
 	float balance;
+	float balance_gain[2];
 
 	/* async video data */
 	gs_texture_t *async_textures[MAX_AV_PLANES];
@@ -856,6 +932,8 @@ struct obs_source {
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
 	uint64_t async_last_rendered_ts;
+	uint64_t async_received_ts;
+	uint64_t async_received_video_time;
 
 	pthread_mutex_t caption_cb_mutex;
 	DARRAY(struct caption_cb_info) caption_cb_list;
@@ -925,6 +1003,13 @@ struct obs_source {
 	/* color space */
 	gs_texrender_t *color_space_texrender;
 
+	/* per-frame render cache, reset on tick */
+	gs_texrender_t *render_cache;
+	enum gs_color_space render_cache_space;
+	bool render_cache_enabled;
+	volatile long render_cache_hits;
+	volatile long render_cache_misses;
+
 	/* audio monitoring */
 	struct audio_monitor *monitor;
 	enum obs_monitoring_type monitoring_type;
@@ -938,8 +1023,23 @@ struct obs_source {
 
 	/* canvas this source belongs to (only used for scenes) */
 	obs_weak_canvas_t *canvas;
+
+	/* incremental saving (obs_save_source_cached), protected by
+	 * obs->data.sources_mutex except for save_generation */
+	volatile long save_generation;
+	long saved_generation;
+	long saved_settings_rev;
+	long saved_private_rev;
+	obs_data_t *save_cache;
 };
 
+static inline void obs_source_mark_dirty(struct obs_source *source)
+{
+	os_atomic_inc_long(&source->save_generation);
+}
+
+extern long obs_data_get_revision(obs_data_t *data);
+
 extern struct obs_source_info *get_source_info(const char *id);
 extern struct obs_source_info *get_source_info2(const char *unversioned_id, uint32_t ver);
 extern bool obs_source_init_context(struct obs_source *source, obs_data_t *settings, const char *name, const char *uuid,
@@ -1058,6 +1158,9 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source, bool centere
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern void obs_source_wake_tick(obs_source_t *source);
+extern bool obs_source_needs_tick(const obs_source_t *source);
+extern void obs_source_remove_tick(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 
@@ -1145,6 +1248,34 @@ struct keyframe_group_data {
 	enum keyframe_group_track_status seen_on_track[MAX_OUTPUT_VIDEO_ENCODERS];
 };
 
+#define OUTPUT_LATENCY_SAMPLES 512
+
+struct output_latency_frame {
+	size_t track_idx;
+	int64_t pts;
+	uint64_t start;
+	uint64_t pir;
+};
+
+/* Per-output latency breakdown of video packets, see obs-output-latency.c */
+struct output_latency {
+	/* samples are only recorded once the statistics have been queried or
+	 * logging was enabled */
+	volatile bool recording;
+
+	pthread_mutex_t mutex;
+	uint64_t samples[OBS_OUTPUT_LATENCY_STAGE_COUNT][OUTPUT_LATENCY_SAMPLES];
+	size_t num[OBS_OUTPUT_LATENCY_STAGE_COUNT];
+	size_t idx[OBS_OUTPUT_LATENCY_STAGE_COUNT];
+
+	/* set once the output calls obs_output_packet_sent() */
+	bool reports_send;
+	DARRAY(struct output_latency_frame) in_flight;
+
+	uint64_t log_interval_ns;
+	uint64_t last_log_ts;
+};
+
 struct obs_output {
 	struct obs_context_data context;
 	struct obs_output_info info;
@@ -1219,6 +1350,8 @@ struct obs_output {
 	pthread_mutex_t pkt_callbacks_mutex;
 	DARRAY(struct packet_callback) pkt_callbacks;
 
+	struct output_latency latency;
+
 	struct reconnect_callback reconnect_callback;
 
 	bool valid;
@@ -1248,6 +1381,17 @@ static inline void do_output_signal(struct obs_output *output, const char *signa
 }
 
 extern void process_delay(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time);
+
+extern bool output_latency_init(struct output_latency *lat);
+extern void output_latency_free(struct output_latency *lat);
+extern void output_latency_reset(struct output_latency *lat);
+static inline bool output_latency_recording(struct output_latency *lat)
+{
+	return os_atomic_load_bool(&lat->recording);
+}
+
+extern void output_latency_add_packet(struct obs_output *output, const struct encoder_packet *packet,
+				      const struct encoder_packet_time *ept);
 extern void obs_output_cleanup_delay(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
 extern void obs_output_delay_stop(obs_output_t *output);
@@ -1445,6 +1589,15 @@ extern void source_profiler_reset_video(struct obs_video_info *ovi);
 /* Signal that source received an async frame */
 extern void source_profiler_async_frame_received(obs_source_t *source);
 
+/* Get timestamp for start of audio filter processing */
+extern uint64_t source_profiler_audio_filter_start(void);
+/* Submit start timestamp after running the source's audio filters */
+extern void source_profiler_audio_filter_end(obs_source_t *source, uint64_t start);
+/* Submit amount of audio buffered for source at audio tick (in ns) */
+extern void source_profiler_audio_buffered(obs_source_t *source, uint64_t buffered_ns);
+/* Signal that audio frames of source were dropped */
+extern void source_profiler_audio_dropped(obs_source_t *source, size_t frames);
+
 /* Get timestamp for start of tick */
 extern uint64_t source_profiler_source_tick_start(void);
 /* Submit start timestamp for source */
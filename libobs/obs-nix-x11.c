@@ -31,6 +31,12 @@
 #include <X11/XF86keysym.h>
 #include <X11/Sunkeysym.h>
 
+#if defined(XCB_XINPUT_FOUND)
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 void obs_nix_x11_log_info(void)
 {
 	Display *dpy = obs_get_nix_platform_display();
@@ -96,6 +102,15 @@ struct obs_hotkeys_platform {
 	bool pressed[XINPUT_MOUSE_LEN];
 	bool update[XINPUT_MOUSE_LEN];
 	bool button_pressed[XINPUT_MOUSE_LEN];
+
+	/* raw key events are received on a separate connection by a
+	 * listener thread, which reports them to the hotkey core */
+	xcb_connection_t *event_connection;
+	pthread_t event_thread;
+	bool event_thread_active;
+	int stop_pipe[2];
+	obs_key_t code_keys[256];
+	bool keycode_down[256];
 #endif
 };
 
@@ -838,6 +853,206 @@ static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
 	xcb_input_xi_select_events(connection, window, 1, &mask.head);
 	xcb_flush(connection);
 }
+
+static inline void fill_code_keys(obs_hotkeys_platform_t *context)
+{
+	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++) {
+		struct keycode_list *codes = &context->keycodes[i];
+
+		for (size_t j = 0; j < codes->list.num; j++)
+			context->code_keys[codes->list.array[j]] = (obs_key_t)i;
+	}
+
+	if (context->super_l_code)
+		context->code_keys[context->super_l_code] = OBS_KEY_META;
+	if (context->super_r_code)
+		context->code_keys[context->super_r_code] = OBS_KEY_META;
+}
+
+static bool event_key_down(obs_hotkeys_platform_t *context, obs_key_t key)
+{
+	struct keycode_list *codes = &context->keycodes[key];
+
+	if (key == OBS_KEY_META)
+		return context->keycode_down[context->super_l_code] || context->keycode_down[context->super_r_code];
+
+	for (size_t i = 0; i < codes->list.num; i++) {
+		if (context->keycode_down[codes->list.array[i]])
+			return true;
+	}
+
+	return false;
+}
+
+static void handle_raw_key(obs_hotkeys_platform_t *context, uint32_t code, bool down)
+{
+	if (code >= 256 || context->code_keys[code] == OBS_KEY_NONE)
+		return;
+
+	obs_key_t key = context->code_keys[code];
+	context->keycode_down[code] = down;
+	obs_hotkey_update_key_state(key, event_key_down(context, key));
+}
+
+// Mouse 2 for OBS is Right Click and Mouse 3 is Wheel Click.
+// Mouse Wheel axis clicks (xinput detail 4 5 6 7) are ignored.
+static void handle_raw_button(uint32_t detail, bool down)
+{
+	obs_key_t key;
+
+	if (detail == 1)
+		key = OBS_KEY_MOUSE1;
+	else if (detail == 2)
+		key = OBS_KEY_MOUSE3;
+	else if (detail == 3)
+		key = OBS_KEY_MOUSE2;
+	else if (detail >= 8 && detail < XINPUT_MOUSE_LEN)
+		key = (obs_key_t)(OBS_KEY_MOUSE4 + (detail - 8));
+	else
+		return;
+
+	obs_hotkey_update_key_state(key, down);
+}
+
+static void handle_raw_event(obs_hotkeys_platform_t *context, xcb_generic_event_t *ev)
+{
+	if ((ev->response_type & ~0x80) != XCB_GE_GENERIC)
+		return;
+
+	switch (((xcb_ge_event_t *)ev)->event_type) {
+	case XCB_INPUT_RAW_KEY_PRESS:
+		handle_raw_key(context, ((xcb_input_raw_key_press_event_t *)ev)->detail, true);
+		break;
+	case XCB_INPUT_RAW_KEY_RELEASE:
+		handle_raw_key(context, ((xcb_input_raw_key_release_event_t *)ev)->detail, false);
+		break;
+	case XCB_INPUT_RAW_BUTTON_PRESS:
+		handle_raw_button(((xcb_input_raw_button_press_event_t *)ev)->detail, true);
+		break;
+	case XCB_INPUT_RAW_BUTTON_RELEASE:
+		handle_raw_button(((xcb_input_raw_button_release_event_t *)ev)->detail, false);
+		break;
+	default:
+		break;
+	}
+}
+
+static void *key_event_thread(void *data)
+{
+	obs_hotkeys_platform_t *context = data;
+	xcb_connection_t *connection = context->event_connection;
+	struct pollfd fds[2] = {
+		{.fd = xcb_get_file_descriptor(connection), .events = POLLIN},
+		{.fd = context->stop_pipe[0], .events = POLLIN},
+	};
+
+	os_set_thread_name("obs-hotkey-events");
+
+	for (;;) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (fds[1].revents)
+			break;
+
+		xcb_generic_event_t *ev;
+		while ((ev = xcb_poll_for_event(connection))) {
+			handle_raw_event(context, ev);
+			free(ev);
+		}
+
+		if (xcb_connection_has_error(connection)) {
+			blog(LOG_WARNING, "Lost hotkey event connection, falling back to polling");
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static bool select_raw_key_events(xcb_connection_t *connection, xcb_window_t window)
+{
+	xcb_generic_error_t *error = NULL;
+	xcb_input_xi_query_version_reply_t *reply;
+
+	reply = xcb_input_xi_query_version_reply(connection, xcb_input_xi_query_version(connection, 2, 0), &error);
+	bool supported = !error && reply && reply->major_version >= 2;
+
+	free(reply);
+	free(error);
+
+	if (!supported)
+		return false;
+
+	struct {
+		xcb_input_event_mask_t head;
+		xcb_input_xi_event_mask_t mask;
+	} mask;
+	mask.head.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+	mask.head.mask_len = sizeof(mask.mask) / sizeof(uint32_t);
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE;
+
+	error = xcb_request_check(connection, xcb_input_xi_select_events_checked(connection, window, 1, &mask.head));
+	supported = error == NULL;
+	free(error);
+	return supported;
+}
+
+static void start_key_events(struct obs_core_hotkeys *hotkeys)
+{
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+	xcb_connection_t *connection = xcb_connect(DisplayString(context->display), NULL);
+
+	if (xcb_connection_has_error(connection))
+		goto fail;
+
+	xcb_window_t window = root_window(context, connection);
+	if (!window || !select_raw_key_events(connection, window))
+		goto fail;
+	if (pipe(context->stop_pipe) != 0)
+		goto fail;
+
+	fill_code_keys(context);
+	context->event_connection = connection;
+
+	if (pthread_create(&context->event_thread, NULL, key_event_thread, context) != 0) {
+		close(context->stop_pipe[0]);
+		close(context->stop_pipe[1]);
+		context->event_connection = NULL;
+		goto fail;
+	}
+
+	context->event_thread_active = true;
+	blog(LOG_INFO, "Using XInput2 raw key events for hotkeys");
+	return;
+
+fail:
+	blog(LOG_INFO, "XInput2 raw key events unavailable, polling hotkeys");
+	xcb_disconnect(connection);
+}
+
+static void stop_key_events(struct obs_core_hotkeys *hotkeys)
+{
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+	if (!context->event_thread_active)
+		return;
+
+	char stop = 0;
+	if (write(context->stop_pipe[1], &stop, 1) != 1)
+		blog(LOG_WARNING, "Failed to signal hotkey event thread");
+
+	pthread_join(context->event_thread, NULL);
+	close(context->stop_pipe[0]);
+	close(context->stop_pipe[1]);
+	xcb_disconnect(context->event_connection);
+
+	context->event_connection = NULL;
+	context->event_thread_active = false;
+}
 #endif
 
 static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
@@ -855,6 +1070,9 @@ static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 #endif
 	fill_base_keysyms(hotkeys);
 	fill_keycodes(hotkeys);
+#if defined(XCB_XINPUT_FOUND)
+	start_key_events(hotkeys);
+#endif
 	return true;
 }
 
@@ -864,6 +1082,10 @@ static void obs_nix_x11_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	if (!context)
 		return;
 
+#if defined(XCB_XINPUT_FOUND)
+	stop_key_events(hotkeys);
+#endif
+
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		da_free(context->keycodes[i].list);
 
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+
+#include "obs-internal.h"
+
+/* maximum number of video packets waiting for obs_output_packet_sent() */
+#define MAX_IN_FLIGHT 256
+
+static const char *stage_names[OBS_OUTPUT_LATENCY_STAGE_COUNT] = {
+	"capture", "download", "encode queue", "encode", "interleave", "send queue", "send", "total",
+};
+
+bool output_latency_init(struct output_latency *lat)
+{
+	memset(lat, 0, sizeof(*lat));
+	return pthread_mutex_init(&lat->mutex, NULL) == 0;
+}
+
+void output_latency_free(struct output_latency *lat)
+{
+	da_free(lat->in_flight);
+	pthread_mutex_destroy(&lat->mutex);
+}
+
+void output_latency_reset(struct output_latency *lat)
+{
+	pthread_mutex_lock(&lat->mutex);
+	memset(lat->num, 0, sizeof(lat->num));
+	memset(lat->idx, 0, sizeof(lat->idx));
+	da_clear(lat->in_flight);
+	lat->last_log_ts = 0;
+	pthread_mutex_unlock(&lat->mutex);
+}
+
+static inline void push_sample(struct output_latency *lat, enum obs_output_latency_stage stage, uint64_t begin,
+			       uint64_t end)
+{
+	if (!begin || end < begin)
+		return;
+
+	lat->samples[stage][lat->idx[stage]] = end - begin;
+	lat->idx[stage] = (lat->idx[stage] + 1) % OUTPUT_LATENCY_SAMPLES;
+	if (lat->num[stage] < OUTPUT_LATENCY_SAMPLES)
+		lat->num[stage]++;
+}
+
+static int cmp_uint64(const void *a, const void *b)
+{
+	const uint64_t val_a = *(const uint64_t *)a;
+	const uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static void calc_stage_stats(const struct output_latency *lat, enum obs_output_latency_stage stage,
+			     struct obs_output_latency_stage_stats *stats)
+{
+	uint64_t sorted[OUTPUT_LATENCY_SAMPLES];
+	const size_t num = lat->num[stage];
+
+	memset(stats, 0, sizeof(*stats));
+	if (!num)
+		return;
+
+	memcpy(sorted, lat->samples[stage], num * sizeof(uint64_t));
+	qsort(sorted, num, sizeof(uint64_t), cmp_uint64);
+
+	stats->samples = (uint32_t)num;
+	stats->p50 = sorted[(num - 1) * 50 / 100];
+	stats->p95 = sorted[(num - 1) * 95 / 100];
+	stats->p99 = sorted[(num - 1) * 99 / 100];
+	stats->max = sorted[num - 1];
+}
+
+static void log_latency(struct obs_output *output)
+{
+	struct output_latency *lat = &output->latency;
+	struct obs_output_latency_stage_stats stats;
+	struct dstr str = {0};
+
+	dstr_printf(&str, "[output '%s'] latency p50/p95/p99 (ms):", output->context.name);
+
+	for (size_t i = 0; i < OBS_OUTPUT_LATENCY_STAGE_COUNT; i++) {
+		calc_stage_stats(lat, i, &stats);
+		if (!stats.samples)
+			continue;
+
+		dstr_catf(&str, " %s %.1f/%.1f/%.1f,", stage_names[i], stats.p50 / 1000000.0, stats.p95 / 1000000.0,
+			  stats.p99 / 1000000.0);
+	}
+
+	dstr_resize(&str, str.len - 1);
+	blog(LOG_INFO, "%s", str.array);
+	dstr_free(&str);
+}
+
+static inline void check_log_interval(struct obs_output *output, uint64_t now)
+{
+	struct output_latency *lat = &output->latency;
+
+	if (!lat->log_interval_ns)
+		return;
+
+	if (!lat->last_log_ts) {
+		lat->last_log_ts = now;
+	} else if (now - lat->last_log_ts >= lat->log_interval_ns) {
+		lat->last_log_ts = now;
+		log_latency(output);
+	}
+}
+
+void output_latency_add_packet(struct obs_output *output, const struct encoder_packet *packet,
+			       const struct encoder_packet_time *ept)
+{
+	struct output_latency *lat = &output->latency;
+	if (!output_latency_recording(lat))
+		return;
+
+	const uint64_t start = ept->act ? ept->act : ept->cts;
+
+	pthread_mutex_lock(&lat->mutex);
+
+	push_sample(lat, OBS_OUTPUT_LATENCY_CAPTURE, ept->act, ept->cts);
+	push_sample(lat, OBS_OUTPUT_LATENCY_DOWNLOAD, ept->fdt ? ept->cts : 0, ept->fdt);
+	push_sample(lat, OBS_OUTPUT_LATENCY_ENCODE_QUEUE, ept->fer ? ept->cts : 0, ept->fer);
+	push_sample(lat, OBS_OUTPUT_LATENCY_ENCODE, ept->pia ? ept->fer : 0, ept->pia);
+	push_sample(lat, OBS_OUTPUT_LATENCY_INTERLEAVE, ept->pia, ept->pir);
+
+	if (lat->reports_send) {
+		struct output_latency_frame frame = {
+			.track_idx = packet->track_idx,
+			.pts = packet->pts,
+			.start = start,
+			.pir = ept->pir,
+		};
+
+		if (lat->in_flight.num == MAX_IN_FLIGHT)
+			da_erase(lat->in_flight, 0);
+		da_push_back(lat->in_flight, &frame);
+	} else {
+		push_sample(lat, OBS_OUTPUT_LATENCY_TOTAL, start, ept->pir);
+	}
+
+	check_log_interval(output, ept->pir);
+
+	pthread_mutex_unlock(&lat->mutex);
+}
+
+void obs_output_packet_sent(obs_output_t *output, const struct encoder_packet *packet, uint64_t send_start_ts)
+{
+	if (!obs_output_valid(output, "obs_output_packet_sent"))
+		return;
+	if (!obs_ptr_valid(packet, "obs_output_packet_sent"))
+		return;
+	if (packet->type != OBS_ENCODER_VIDEO)
+		return;
+
+	struct output_latency *lat = &output->latency;
+	if (!output_latency_recording(lat))
+		return;
+
+	const uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&lat->mutex);
+
+	/* packets interleaved before the output first reported a send
+	 * have already been accounted for */
+	if (!lat->reports_send) {
+		lat->reports_send = true;
+		pthread_mutex_unlock(&lat->mutex);
+		return;
+	}
+
+	for (size_t i = 0; i < lat->in_flight.num; i++) {
+		struct output_latency_frame *frame = &lat->in_flight.array[i];
+		if (frame->track_idx != packet->track_idx || frame->pts != packet->pts)
+			continue;
+
+		push_sample(lat, OBS_OUTPUT_LATENCY_SEND_QUEUE, frame->pir, send_start_ts);
+		push_sample(lat, OBS_OUTPUT_LATENCY_SEND, send_start_ts, now);
+		push_sample(lat, OBS_OUTPUT_LATENCY_TOTAL, frame->start, now);
+
+		/* anything older was dropped by the output */
+		da_erase_range(lat->in_flight, 0, i + 1);
+		break;
+	}
+
+	pthread_mutex_unlock(&lat->mutex);
+}
+
+bool obs_output_get_latency_stats(obs_output_t *output, struct obs_output_latency_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_latency_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_output_get_latency_stats"))
+		return false;
+
+	struct output_latency *lat = &output->latency;
+	bool has_samples = false;
+
+	os_atomic_store_bool(&lat->recording, true);
+
+	pthread_mutex_lock(&lat->mutex);
+	for (size_t i = 0; i < OBS_OUTPUT_LATENCY_STAGE_COUNT; i++) {
+		calc_stage_stats(lat, i, &stats->stages[i]);
+		has_samples = has_samples || stats->stages[i].samples;
+	}
+	pthread_mutex_unlock(&lat->mutex);
+
+	return has_samples;
+}
+
+void obs_output_set_latency_log_interval(obs_output_t *output, uint32_t seconds)
+{
+	if (!obs_output_valid(output, "obs_output_set_latency_log_interval"))
+		return;
+
+	if (seconds)
+		os_atomic_store_bool(&output->latency.recording, true);
+
+	pthread_mutex_lock(&output->latency.mutex);
+	output->latency.log_interval_ns = (uint64_t)seconds * 1000000000ULL;
+	output->latency.last_log_ts = 0;
+	pthread_mutex_unlock(&output->latency.mutex);
+}
@@ -179,6 +179,8 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 		goto fail;
 	if (pthread_mutex_init(&output->pkt_callbacks_mutex, NULL) != 0)
 		goto fail;
+	if (!output_latency_init(&output->latency))
+		goto fail;
 	if (os_event_init(&output->stopping_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
@@ -306,6 +308,7 @@ void obs_output_destroy(obs_output_t *output)
 		pthread_mutex_destroy(&output->interleaved_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
 		pthread_mutex_destroy(&output->pkt_callbacks_mutex);
+		output_latency_free(&output->latency);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		deque_free(&output->delay_data);
@@ -1725,6 +1728,12 @@ static inline void send_interleaved(struct obs_output *output)
 	}
 	pthread_mutex_unlock(&output->pkt_callbacks_mutex);
 
+	if (found_ept && output_latency_recording(&output->latency)) {
+		if (!ept_local.pir)
+			ept_local.pir = os_gettime_ns();
+		output_latency_add_packet(output, &out, &ept_local);
+	}
+
 	output->info.encoded_packet(output->context.data, &out);
 	obs_encoder_packet_release(&out);
 }
@@ -2196,6 +2205,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	if (packet_time) {
 		output_packet_time = da_push_back_new(output->encoder_packet_times[packet->track_idx]);
 		*output_packet_time = *packet_time;
+		output_packet_time->pia = os_gettime_ns();
 	}
 
 	if (was_started)
@@ -2235,12 +2245,17 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 static void default_encoded_callback(void *param, struct encoder_packet *packet,
 				     struct encoder_packet_time *packet_time)
 {
-	UNUSED_PARAMETER(packet_time);
 	struct obs_output *output = param;
 
 	if (data_active(output)) {
 		packet->track_idx = get_encoder_index(output, packet);
 
+		if (packet_time && packet->type == OBS_ENCODER_VIDEO && output_latency_recording(&output->latency)) {
+			struct encoder_packet_time ept = *packet_time;
+			ept.pia = ept.pir = os_gettime_ns();
+			output_latency_add_packet(output, packet, &ept);
+		}
+
 		output->info.encoded_packet(output->context.data, packet);
 
 		if (packet->type == OBS_ENCODER_VIDEO)
@@ -2403,6 +2418,7 @@ static void reset_packet_data(obs_output_t *output)
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
 		output->audio_offsets[i] = 0;
 
+	output_latency_reset(&output->latency);
 	free_packets(output);
 }
 
@@ -173,6 +173,11 @@ static void *scene_create(obs_data_t *settings, struct obs_source *source)
 				"mutex");
 		goto fail;
 	}
+	if (pthread_mutex_init(&scene->transform_queue_mutex, NULL) != 0) {
+		blog(LOG_ERROR, "scene_create: Couldn't initialize transform "
+				"queue mutex");
+		goto fail;
+	}
 
 	scene->absolute_coordinates = obs_data_get_bool(obs->data.private_data, "AbsoluteCoordinates");
 
@@ -235,6 +240,11 @@ static void scene_destroy(void *data)
 
 	remove_all_items(scene);
 
+	for (size_t i = 0; i < scene->transform_queue.num; i++)
+		obs_sceneitem_release(scene->transform_queue.array[i].item);
+	da_free(scene->transform_queue);
+
+	pthread_mutex_destroy(&scene->transform_queue_mutex);
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
 	da_free(scene->mix_sources);
@@ -655,11 +665,7 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&origin, item->align, (int)cx, (int)cy);
 
-	matrix4_identity(&item->draw_transform);
-	matrix4_scale3f(&item->draw_transform, &item->draw_transform, scale.x, scale.y, 1.0f);
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform, -origin.x, -origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->draw_transform, &item->draw_transform, 0.0f, 0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform, position.x, position.y, 0.0f);
+	matrix4_from_transform_2d(&item->draw_transform, &scale, &origin, RAD(item->rot), &position);
 
 #ifdef DEBUG_TRANSFORM
 	blog(LOG_DEBUG, "Transform updated for \"%s\":", obs_source_get_name(item->source));
@@ -684,11 +690,7 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&base_origin, item->align, (int)scale.x, (int)scale.y);
 
-	matrix4_identity(&item->box_transform);
-	matrix4_scale3f(&item->box_transform, &item->box_transform, scale.x, scale.y, 1.0f);
-	matrix4_translate3f(&item->box_transform, &item->box_transform, -base_origin.x, -base_origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->box_transform, &item->box_transform, 0.0f, 0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->box_transform, &item->box_transform, position.x, position.y, 0.0f);
+	matrix4_from_transform_2d(&item->box_transform, &scale, &base_origin, RAD(item->rot), &position);
 
 #ifdef DEBUG_TRANSFORM
 	log_matrix(&item->draw_transform, "box_transform");
@@ -1005,6 +1007,37 @@ static void scene_video_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+static inline void scene_item_set_info_internal(obs_sceneitem_t *item, const struct obs_transform_info *info);
+static void set_crop_internal(obs_sceneitem_t *item, const struct obs_sceneitem_crop *crop);
+
+/* assumes video lock, the references of the queued items are released along
+ * with the removed items */
+static void apply_queued_transforms(obs_scene_t *scene, obs_scene_item_ptr_array_t *remove_items)
+{
+	pthread_mutex_lock(&scene->transform_queue_mutex);
+
+	for (size_t i = 0; i < scene->transform_queue.num; i++) {
+		struct queued_transform *queued = &scene->transform_queue.array[i];
+		struct obs_scene_item *item = queued->item;
+
+		/* the item may have been removed or moved to a group since */
+		if (item->parent == scene && !item->removed) {
+			scene_item_set_info_internal(item, &queued->info);
+			item->crop_to_bounds = queued->info.crop_to_bounds;
+			if (queued->set_crop)
+				set_crop_internal(item, &queued->crop);
+
+			os_atomic_set_bool(&item->update_transform, true);
+		}
+
+		da_push_back(*remove_items, &item);
+	}
+
+	da_resize(scene->transform_queue, 0);
+
+	pthread_mutex_unlock(&scene->transform_queue_mutex);
+}
+
 /* assumes video lock */
 static void update_transforms_and_prune_sources(obs_scene_t *scene, obs_scene_item_ptr_array_t *remove_items,
 						obs_sceneitem_t *group_sceneitem, bool scene_size_changed)
@@ -1012,6 +1045,8 @@ static void update_transforms_and_prune_sources(obs_scene_t *scene, obs_scene_it
 	struct obs_scene_item *item = scene->first_item;
 	bool rebuild_group = group_sceneitem && os_atomic_load_bool(&group_sceneitem->update_group_resize);
 
+	apply_queued_transforms(scene, remove_items);
+
 	while (item) {
 		if (obs_source_removed(item->source)) {
 			struct obs_scene_item *del_item = item;
@@ -3298,12 +3333,8 @@ static inline bool crop_equal(const struct obs_sceneitem_crop *crop1, const stru
 	       crop1->bottom == crop2->bottom;
 }
 
-void obs_sceneitem_set_crop(obs_sceneitem_t *item, const struct obs_sceneitem_crop *crop)
+static void set_crop_internal(obs_sceneitem_t *item, const struct obs_sceneitem_crop *crop)
 {
-	if (!obs_ptr_valid(item, "obs_sceneitem_set_crop"))
-		return;
-	if (!obs_ptr_valid(crop, "obs_sceneitem_set_crop"))
-		return;
 	if (crop_equal(crop, &item->crop))
 		return;
 
@@ -3321,6 +3352,16 @@ void obs_sceneitem_set_crop(obs_sceneitem_t *item, const struct obs_sceneitem_cr
 	os_atomic_set_bool(&item->update_transform, true);
 }
 
+void obs_sceneitem_set_crop(obs_sceneitem_t *item, const struct obs_sceneitem_crop *crop)
+{
+	if (!obs_ptr_valid(item, "obs_sceneitem_set_crop"))
+		return;
+	if (!obs_ptr_valid(crop, "obs_sceneitem_set_crop"))
+		return;
+
+	set_crop_internal(item, crop);
+}
+
 void obs_sceneitem_get_crop(const obs_sceneitem_t *item, struct obs_sceneitem_crop *crop)
 {
 	if (!obs_ptr_valid(item, "obs_sceneitem_get_crop"))
@@ -3391,6 +3432,44 @@ void obs_sceneitem_defer_update_end(obs_sceneitem_t *item)
 		do_update_transform(item);
 }
 
+void obs_sceneitem_queue_transform(obs_sceneitem_t *item, const struct obs_transform_info *info,
+				   const struct obs_sceneitem_crop *crop)
+{
+	if (!obs_ptr_valid(item, "obs_sceneitem_queue_transform"))
+		return;
+	if (!obs_ptr_valid(info, "obs_sceneitem_queue_transform"))
+		return;
+
+	obs_scene_t *scene = item->parent;
+	if (!scene || item->removed)
+		return;
+
+	pthread_mutex_lock(&scene->transform_queue_mutex);
+
+	struct queued_transform *queued = NULL;
+	for (size_t i = 0; i < scene->transform_queue.num; i++) {
+		if (scene->transform_queue.array[i].item == item) {
+			queued = &scene->transform_queue.array[i];
+			break;
+		}
+	}
+
+	/* only the latest transform of an item is applied */
+	if (!queued) {
+		queued = da_push_back_new(scene->transform_queue);
+		queued->item = item;
+		obs_sceneitem_addref(item);
+	}
+
+	queued->info = *info;
+	if (crop) {
+		queued->crop = *crop;
+		queued->set_crop = true;
+	}
+
+	pthread_mutex_unlock(&scene->transform_queue_mutex);
+}
+
 void obs_sceneitem_defer_group_resize_begin(obs_sceneitem_t *item)
 {
 	if (!obs_ptr_valid(item, "obs_sceneitem_defer_group_resize_begin"))
@@ -96,6 +96,13 @@ struct obs_scene_item {
 	struct obs_scene_item *next;
 };
 
+struct queued_transform {
+	struct obs_scene_item *item;
+	struct obs_transform_info info;
+	struct obs_sceneitem_crop crop;
+	bool set_crop;
+};
+
 struct scene_source_mix {
 	obs_source_t *source;
 	obs_source_t *transition;
@@ -123,5 +130,10 @@ struct obs_scene {
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
 
+	/* transforms queued by obs_sceneitem_queue_transform, applied when
+	 * the scene is rendered */
+	pthread_mutex_t transform_queue_mutex;
+	DARRAY(struct queued_transform) transform_queue;
+
 	DARRAY(struct scene_source_mix) mix_sources;
 };
@@ -445,6 +445,8 @@ void obs_source_set_deinterlace_mode(obs_source_t *source, enum obs_deinterlace_
 	if (source->deinterlace_mode == mode)
 		return;
 
+	obs_source_mark_dirty(source);
+
 	if (source->deinterlace_mode == OBS_DEINTERLACE_MODE_DISABLE) {
 		enable_deinterlacing(source, mode);
 	} else if (mode == OBS_DEINTERLACE_MODE_DISABLE) {
@@ -469,6 +471,7 @@ void obs_source_set_deinterlace_field_order(obs_source_t *source, enum obs_deint
 		return;
 
 	source->deinterlace_top_first = field_order == OBS_DEINTERLACE_FIELD_ORDER_TOP;
+	obs_source_mark_dirty(source);
 }
 
 enum obs_deinterlace_field_order obs_source_get_deinterlace_field_order(const obs_source_t *source)
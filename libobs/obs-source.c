@@ -24,6 +24,7 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
+#include "util/sse-intrin.h"
 #include "callback/calldata.h"
 #include "graphics/matrix3.h"
 #include "graphics/vec3.h"
@@ -171,13 +172,21 @@ static inline bool requires_canvas(const struct obs_source *source)
 
 extern char *find_libobs_data_file(const char *file);
 
+/* sine law panning gains, computed once instead of per sample */
+static inline void set_balance(struct obs_source *source, float balance)
+{
+	source->balance = balance;
+	source->balance_gain[0] = sinf((1.0f - balance) * (M_PI / 2.0f));
+	source->balance_gain[1] = sinf(balance * (M_PI / 2.0f));
+}
+
 /* internal initialization */
 static bool obs_source_init(struct obs_source *source)
 {
 	source->user_volume = 1.0f;
 	source->volume = 1.0f;
 	source->sync_offset = 0;
-	source->balance = 0.5f;
+	set_balance(source, 0.5f);
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
@@ -246,6 +255,10 @@ static void obs_source_init_finalize(struct obs_source *source, obs_canvas_t *ca
 		}
 	}
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex, &obs->data.sources);
+
+	/* ticked at least once, which removes it again if it turns out to
+	 * be idle */
+	obs_source_wake_tick(source);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id, obs_hotkey_t *key, bool pressed)
@@ -632,6 +645,10 @@ void obs_source_destroy(struct obs_source *source)
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 
+	pthread_mutex_lock(&obs->data.tick_sources_mutex);
+	obs_source_remove_tick(source);
+	pthread_mutex_unlock(&obs->data.tick_sources_mutex);
+
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
 
@@ -693,6 +710,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		gs_texrender_destroy(source->filter_texrender);
 	if (source->color_space_texrender)
 		gs_texrender_destroy(source->color_space_texrender);
+	if (source->render_cache)
+		gs_texrender_destroy(source->render_cache);
 	gs_leave_context();
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
@@ -724,6 +743,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->async_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
+	obs_data_release(source->save_cache);
 	obs_context_data_free(&source->context);
 
 	if (source->owns_info_id) {
@@ -960,18 +980,29 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	if (!obs_source_valid(source, "obs_source_update"))
 		return;
 
+	obs_source_mark_dirty(source);
+
 	if (settings) {
 		obs_data_apply(source->context.settings, settings);
 	}
 
 	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
 		os_atomic_inc_long(&source->defer_update_count);
+		obs_source_wake_tick(source);
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data, source->context.settings);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
 
+void obs_source_set_dirty(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_set_dirty"))
+		return;
+
+	obs_source_mark_dirty(source);
+}
+
 void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings)
 {
 	if (!obs_source_valid(source, "obs_source_reset_settings"))
@@ -1050,6 +1081,24 @@ void obs_source_send_key_click(obs_source_t *source, const struct obs_key_event
 	}
 }
 
+uint64_t obs_source_get_memory_usage(obs_source_t *source)
+{
+	if (!data_valid(source, "obs_source_get_memory_usage"))
+		return 0;
+
+	uint64_t usage = source->info.get_memory_usage ? source->info.get_memory_usage(source->context.data) : 0;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		struct obs_source *filter = source->filters.array[i];
+		if (filter->info.get_memory_usage && filter->context.data)
+			usage += filter->info.get_memory_usage(filter->context.data);
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return usage;
+}
+
 bool obs_source_get_texcoords_centered(obs_source_t *source)
 {
 	return source->texcoords_centered;
@@ -1091,6 +1140,7 @@ static void hide_source(obs_source_t *source)
 static void activate_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->activate_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1099,6 +1149,7 @@ static void activate_tree(obs_source_t *parent, obs_source_t *child, void *param
 static void deactivate_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_dec_long(&child->activate_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1107,6 +1158,7 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child, void *par
 static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->show_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1115,6 +1167,7 @@ static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 static void hide_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_dec_long(&child->show_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1132,6 +1185,8 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		os_atomic_inc_long(&source->activate_refs);
 		obs_source_enum_active_tree(source, activate_tree, NULL);
 	}
+
+	obs_source_wake_tick(source);
 }
 
 void obs_source_deactivate(obs_source_t *source, enum view_type type)
@@ -1150,6 +1205,8 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 			obs_source_enum_active_tree(source, deactivate_tree, NULL);
 		}
 	}
+
+	obs_source_wake_tick(source);
 }
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time);
@@ -1246,6 +1303,60 @@ static void async_tick(obs_source_t *source)
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
+void obs_source_wake_tick(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+
+	if (!source->prev_next_tick_source && !destroying(source)) {
+		source->next_tick_source = data->first_tick_source;
+		source->prev_next_tick_source = &data->first_tick_source;
+		if (data->first_tick_source)
+			data->first_tick_source->prev_next_tick_source = &source->next_tick_source;
+		data->first_tick_source = source;
+	}
+
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+}
+
+/* must be called with tick_sources_mutex locked */
+void obs_source_remove_tick(obs_source_t *source)
+{
+	if (!source->prev_next_tick_source)
+		return;
+
+	*source->prev_next_tick_source = source->next_tick_source;
+	if (source->next_tick_source)
+		source->next_tick_source->prev_next_tick_source = source->prev_next_tick_source;
+
+	source->next_tick_source = NULL;
+	source->prev_next_tick_source = NULL;
+}
+
+bool obs_source_needs_tick(const obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	/* visible sources are rendered and profiled every frame, so they are
+	 * kept in the set until they are hidden again */
+	const bool shown = os_atomic_load_long(&source->show_refs) > 0 ||
+			   os_atomic_load_long(&source->activate_refs) > 0 || source->showing || source->active;
+
+	if (source->info.video_tick && (shown || (flags & OBS_SOURCE_TICK_WHILE_SHOWING) == 0))
+		return true;
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	if ((flags & (OBS_SOURCE_ASYNC | OBS_SOURCE_CONTROLLABLE_MEDIA)) != 0)
+		return true;
+	if (source->filter_texrender || source->render_cache)
+		return true;
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return true;
+
+	return shown;
+}
+
 void obs_source_video_tick(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
@@ -1268,6 +1379,8 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	/* reset the filter render texture information once every frame */
 	if (source->filter_texrender)
 		gs_texrender_reset(source->filter_texrender);
+	if (source->render_cache)
+		gs_texrender_reset(source->render_cache);
 
 	/* call show/hide if the reference changed */
 	now_showing = !!source->show_refs;
@@ -1416,8 +1529,10 @@ static void source_output_audio_place(obs_source_t *source, const struct audio_d
 #endif
 
 	/* do not allow the circular buffers to become too big */
-	if ((buf_placement + size) > MAX_BUF_SIZE)
+	if ((buf_placement + size) > MAX_BUF_SIZE) {
+		source_profiler_audio_dropped(source, in->frames);
 		return;
+	}
 
 	for (size_t i = 0; i < channels; i++) {
 		deque_place(&source->audio_input_buf[i], buf_placement, in->data[i], size);
@@ -1435,8 +1550,10 @@ static inline void source_output_audio_push_back(obs_source_t *source, const str
 	size_t size = in->frames * sizeof(float);
 
 	/* do not allow the circular buffers to become too big */
-	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE)
+	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE) {
+		source_profiler_audio_dropped(source, in->frames);
 		return;
+	}
 
 	for (size_t i = 0; i < channels; i++)
 		deque_push_back(&source->audio_input_buf[i], in->data[i], size);
@@ -2403,6 +2520,23 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source, struct obs_sour
 	}
 }
 
+static uint64_t get_async_frame_received_ts(obs_source_t *source, const struct obs_source_frame *frame)
+{
+	uint64_t ts = 0;
+
+	pthread_mutex_lock(&source->async_mutex);
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (af->frame == frame) {
+			ts = af->received_ts;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+
+	return ts;
+}
+
 static void obs_source_update_async_video(obs_source_t *source)
 {
 	if (!source->async_rendered) {
@@ -2412,6 +2546,9 @@ static void obs_source_update_async_video(obs_source_t *source)
 		if (frame) {
 			check_to_swap_bgrx_bgra(source, frame);
 
+			source->async_received_ts = get_async_frame_received_ts(source, frame);
+			source->async_received_video_time = obs->video.video_time;
+
 			if (!source->async_decoupled || !source->async_unbuffered) {
 				source->timing_adjust = obs->video.video_time - frame->timestamp;
 				source->timing_set = true;
@@ -2795,6 +2932,18 @@ static const char *get_type_format(enum obs_source_type type)
 }
 #endif
 
+/* Tracks the oldest async frame that is shown for the first time in the
+ * frame currently being rendered, for encoder packet timing. */
+static inline void update_async_capture_ts(const obs_source_t *source)
+{
+	const uint64_t ts = source->async_received_ts;
+
+	if (!ts || source->async_received_video_time != obs->video.video_time)
+		return;
+	if (!obs->video.async_capture_ts || ts < obs->video.async_capture_ts)
+		obs->video.async_capture_ts = ts;
+}
+
 static inline void render_video(obs_source_t *source)
 {
 	if (source->info.type != OBS_SOURCE_TYPE_FILTER && (source->info.output_flags & OBS_SOURCE_VIDEO) == 0) {
@@ -2808,6 +2957,7 @@ static inline void render_video(obs_source_t *source)
 		if (deinterlacing_enabled(source))
 			deinterlace_update_async_video(source);
 		obs_source_update_async_video(source);
+		update_async_capture_ts(source);
 	}
 
 	if (!source->context.data || !source->enabled) {
@@ -2837,6 +2987,80 @@ static inline void render_video(obs_source_t *source)
 	GS_DEBUG_MARKER_END();
 }
 
+static inline void render_filter_tex(gs_texture_t *tex, gs_effect_t *effect, uint32_t width, uint32_t height,
+				     const char *tech_name);
+
+static inline bool render_cache_usable(const obs_source_t *source)
+{
+	return source->render_cache_enabled && !source->rendering_filter && !source->filter_parent &&
+	       (source->info.output_flags & OBS_SOURCE_VIDEO) != 0 && source->context.data && source->enabled;
+}
+
+/* Renders the final output of the source once per frame and draws that for
+ * every other reference in the same frame.  The texture holds premultiplied
+ * alpha, so it is drawn as if the source had been rendered with the default
+ * blend state.  Like every texrender, its target comes from the texture pool,
+ * so toggling the cache or resizing the source reuses idle targets. */
+static void render_video_cached(obs_source_t *source)
+{
+	const enum gs_color_space space = gs_get_color_space();
+	const enum gs_color_format format = gs_get_format_from_space(space);
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+
+	if (!cx || !cy) {
+		render_video(source);
+		return;
+	}
+
+	if (source->render_cache && gs_texrender_get_format(source->render_cache) != format) {
+		gs_texrender_destroy(source->render_cache);
+		source->render_cache = NULL;
+	}
+
+	if (!source->render_cache) {
+		source->render_cache = gs_texrender_create(format, GS_ZS_NONE);
+		obs_source_wake_tick(source);
+	}
+
+	bool hit = true;
+
+	if (gs_texrender_begin_with_color_space(source->render_cache, cx, cy, space)) {
+		gs_blend_state_push();
+		gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+		struct vec4 clear_color;
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		render_video(source);
+
+		gs_blend_state_pop();
+		gs_texrender_end(source->render_cache);
+
+		source->render_cache_space = space;
+		hit = false;
+
+	} else if (source->render_cache_space != space) {
+		/* already cached for another color space this frame */
+		os_atomic_inc_long(&source->render_cache_misses);
+		render_video(source);
+		return;
+	}
+
+	os_atomic_inc_long(hit ? &source->render_cache_hits : &source->render_cache_misses);
+
+	gs_texture_t *tex = gs_texrender_get_texture(source->render_cache);
+	if (!tex || gs_texture_get_width(tex) != cx || gs_texture_get_height(tex) != cy)
+		return;
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+	render_filter_tex(tex, obs->video.default_effect, cx, cy, "Draw");
+	gs_blend_state_pop();
+}
+
 void obs_source_video_render(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_video_render"))
@@ -2844,7 +3068,16 @@ void obs_source_video_render(obs_source_t *source)
 
 	source = obs_source_get_ref(source);
 	if (source) {
-		render_video(source);
+		if (render_cache_usable(source)) {
+			render_video_cached(source);
+		} else {
+			if (source->render_cache && !source->render_cache_enabled) {
+				gs_texrender_destroy(source->render_cache);
+				source->render_cache = NULL;
+			}
+
+			render_video(source);
+		}
 		obs_source_release(source);
 	}
 }
@@ -3000,6 +3233,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_mark_dirty(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3037,6 +3272,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_mark_dirty(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3162,8 +3399,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter, enu
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_mark_dirty(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 int obs_source_filter_get_index(obs_source_t *source, obs_source_t *filter)
@@ -3207,8 +3446,10 @@ void obs_source_filter_set_index(obs_source_t *source, obs_source_t *filter, siz
 	success = set_filter_index(source, filter, index);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_mark_dirty(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -3425,6 +3666,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 			new_frame->format = format;
 			af->used = true;
 			af->unused_count = 0;
+			af->received_ts = os_gettime_ns();
 			break;
 		}
 	}
@@ -3438,6 +3680,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.received_ts = os_gettime_ns();
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -3807,115 +4050,136 @@ static inline void reset_resampler(obs_source_t *source, const struct obs_source
 		blog(LOG_ERROR, "creation of resampler failed");
 }
 
-static void copy_audio_data(obs_source_t *source, const uint8_t *const data[], uint32_t frames, uint64_t ts)
+static void ensure_audio_storage(obs_source_t *source, size_t planes, size_t size)
 {
-	size_t planes = audio_output_get_planes(obs->audio.audio);
-	size_t blocksize = audio_output_get_block_size(obs->audio.audio);
-	size_t size = (size_t)frames * blocksize;
-	bool resize = source->audio_storage_size < size;
-
-	source->audio_data.frames = frames;
-	source->audio_data.timestamp = ts;
+	if (source->audio_storage_size >= size)
+		return;
 
 	for (size_t i = 0; i < planes; i++) {
-		/* ensure audio storage capacity */
-		if (resize) {
-			bfree(source->audio_data.data[i]);
-			source->audio_data.data[i] = bmalloc(size);
-		}
-
-		memcpy(source->audio_data.data[i], data[i], size);
+		bfree(source->audio_data.data[i]);
+		source->audio_data.data[i] = bmalloc(size);
 	}
 
-	if (resize)
-		source->audio_storage_size = size;
+	source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
-static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
+static void scale_plane(float *out, const float *in, float gain, uint32_t frames)
 {
-	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
-	float **data = (float **)source->audio_data.data;
+	const __m128 gain_v = _mm_set1_ps(gain);
+	uint32_t frame = 0;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
+	for (; frame + 4 <= frames; frame += 4)
+		_mm_storeu_ps(out + frame, _mm_mul_ps(_mm_loadu_ps(in + frame), gain_v));
+	for (; frame < frames; frame++)
+		out[frame] = in[frame] * gain;
+}
 
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
+static void mix_planes(float *out, const float *const *in, const float *gains, size_t channels, uint32_t frames)
+{
+	uint32_t frame = 0;
+
+	for (; frame + 4 <= frames; frame += 4) {
+		__m128 sum = _mm_mul_ps(_mm_loadu_ps(in[0] + frame), _mm_set1_ps(gains[0]));
+		for (size_t channel = 1; channel < channels; channel++) {
+			__m128 v = _mm_loadu_ps(in[channel] + frame);
+			sum = _mm_add_ps(sum, _mm_mul_ps(v, _mm_set1_ps(gains[channel])));
+		}
+		_mm_storeu_ps(out + frame, sum);
+	}
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
+	for (; frame < frames; frame++) {
+		float sum = in[0][frame] * gains[0];
+		for (size_t channel = 1; channel < channels; channel++)
+			sum += in[channel][frame] * gains[channel];
+		out[frame] = sum;
 	}
 }
 
-static void process_audio_balancing(struct obs_source *source, uint32_t frames, float balance,
-				    enum obs_balance_type type)
+/* copies the planes into the source's audio buffers in a single pass, with
+ * the stereo balance and the mono downmix applied along the way */
+static void ingest_audio_data(obs_source_t *source, const uint8_t *const data[], uint32_t frames, uint64_t ts,
+			      bool balance, bool mono)
 {
-	float **data = (float **)source->audio_data.data;
+	size_t planes = audio_output_get_planes(obs->audio.audio);
+	size_t size = (size_t)frames * audio_output_get_block_size(obs->audio.audio);
+	const float *const *in = (const float *const *)data;
+	float **out = (float **)source->audio_data.data;
+	float gains[MAX_AUDIO_CHANNELS];
 
-	switch (type) {
-	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sinf((1.0f - balance) * (M_PI / 2.0f));
-			data[1][frame] = data[1][frame] * sinf(balance * (M_PI / 2.0f));
-		}
-		break;
-	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
-		break;
-	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
-		break;
-	default:
-		break;
+	ensure_audio_storage(source, planes, size);
+
+	source->audio_data.frames = frames;
+	source->audio_data.timestamp = ts;
+
+	for (size_t i = 0; i < planes; i++)
+		gains[i] = balance && i < 2 ? source->balance_gain[i] : 1.0f;
+
+	if (mono) {
+		for (size_t i = 0; i < planes; i++)
+			gains[i] /= (float)planes;
+
+		mix_planes(out[0], in, gains, planes, frames);
+		for (size_t i = 1; i < planes; i++)
+			memcpy(out[i], out[0], size);
+		return;
+	}
+
+	for (size_t i = 0; i < planes; i++) {
+		if (gains[i] == 1.0f)
+			memcpy(out[i], in[i], size);
+		else
+			scale_plane(out[i], in[i], gains[i], frames);
 	}
 }
 
-/* resamples/remixes new audio to the designated main audio output format */
-static void process_audio(obs_source_t *source, const struct obs_source_audio *audio)
+/* resamples/remixes new audio to the designated main audio output format.
+ * Audio that already is in that format, and needs no further processing,
+ * is returned in passthrough without being copied, if passthrough is set. */
+static struct obs_audio_data *process_audio(obs_source_t *source, const struct obs_source_audio *audio,
+					    struct obs_audio_data *passthrough)
 {
 	uint32_t frames = audio->frames;
-	bool mono_output;
+	const uint8_t *const *data = audio->data;
+	uint8_t *output[MAX_AV_PLANES];
 
 	if (source->sample_info.samples_per_sec != audio->samples_per_sec ||
 	    source->sample_info.format != audio->format || source->sample_info.speakers != audio->speakers)
 		reset_resampler(source, audio);
 
 	if (source->audio_failed)
-		return;
+		return &source->audio_data;
 
 	if (source->resampler) {
-		uint8_t *output[MAX_AV_PLANES];
-
 		memset(output, 0, sizeof(output));
 
 		audio_resampler_resample(source->resampler, output, &frames, &source->resample_offset, audio->data,
 					 audio->frames);
-
-		copy_audio_data(source, (const uint8_t *const *)output, frames, audio->timestamp);
-	} else {
-		copy_audio_data(source, audio->data, audio->frames, audio->timestamp);
+		data = (const uint8_t *const *)output;
 	}
 
-	mono_output = audio_output_get_channels(obs->audio.audio) == 1;
+	const bool mono_output = audio_output_get_channels(obs->audio.audio) == 1;
+	const bool balance = !mono_output && source->sample_info.speakers == SPEAKERS_STEREO &&
+			     (source->balance > 0.51f || source->balance < 0.49f);
+	const bool mono = !mono_output && (source->flags & OBS_SOURCE_FLAG_FORCE_MONO) != 0;
 
-	if (!mono_output && source->sample_info.speakers == SPEAKERS_STEREO &&
-	    (source->balance > 0.51f || source->balance < 0.49f)) {
-		process_audio_balancing(source, frames, source->balance, OBS_BALANCE_TYPE_SINE_LAW);
+	if (passthrough && !source->resampler && !balance && !mono) {
+		for (size_t i = 0; i < MAX_AV_PLANES; i++)
+			passthrough->data[i] = (uint8_t *)audio->data[i];
+
+		passthrough->frames = frames;
+		passthrough->timestamp = audio->timestamp;
+		return passthrough;
 	}
 
-	if (!mono_output && (source->flags & OBS_SOURCE_FLAG_FORCE_MONO) != 0)
-		downmix_to_mono_planar(source, frames);
+	ingest_audio_data(source, data, frames, audio->timestamp, balance, mono);
+	return &source->audio_data;
+}
+
+static struct obs_audio_data *ingest_passthrough(obs_source_t *source, struct obs_audio_data *passthrough)
+{
+	ingest_audio_data(source, (const uint8_t *const *)passthrough->data, passthrough->frames,
+			  passthrough->timestamp, false, false);
+	return &source->audio_data;
 }
 
 void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio_in)
@@ -3937,10 +4201,24 @@ void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio
 	for (size_t i = channels; i < MAX_AUDIO_CHANNELS; i++)
 		audio.data[i] = NULL;
 
-	process_audio(source, &audio);
+	/* filters may modify the audio in place, so only unfiltered audio
+	 * can be passed on without a copy.  the filter count is checked again
+	 * once filter_mutex is held, in case a filter was added meanwhile */
+	struct obs_audio_data passthrough;
+	struct obs_audio_data *input = process_audio(source, &audio, source->filters.num ? NULL : &passthrough);
 
 	pthread_mutex_lock(&source->filter_mutex);
-	output = filter_async_audio(source, &source->audio_data);
+
+	if (source->filters.num && input == &passthrough)
+		input = ingest_passthrough(source, input);
+
+	if (source->filters.num) {
+		const uint64_t filter_start = source_profiler_audio_filter_start();
+		output = filter_async_audio(source, input);
+		source_profiler_audio_filter_end(source, filter_start);
+	} else {
+		output = input;
+	}
 
 	if (output) {
 		struct audio_data data;
@@ -4143,6 +4421,8 @@ void obs_source_set_name(obs_source_t *source, const char *name)
 	if (!obs_source_valid(source, "obs_source_set_name"))
 		return;
 
+	obs_source_mark_dirty(source);
+
 	if (!name || !*name || !source->context.name || strcmp(name, source->context.name) != 0) {
 		if (requires_canvas(source)) {
 			obs_canvas_rename_source(source, name);
@@ -4293,6 +4573,7 @@ bool obs_source_process_filter_begin_with_color_space(obs_source_t *filter, enum
 
 	if (!filter->filter_texrender) {
 		filter->filter_texrender = gs_texrender_create(format, GS_ZS_NONE);
+		obs_source_wake_tick(filter);
 	}
 
 	if (gs_texrender_begin_with_color_space(filter->filter_texrender, cx, cy, space)) {
@@ -4412,6 +4693,8 @@ void obs_source_set_volume(obs_source_t *source, float volume)
 		struct calldata data;
 		uint8_t stack[128];
 
+		obs_source_mark_dirty(source);
+
 		calldata_init_fixed(&data, stack, sizeof(stack));
 		calldata_set_ptr(&data, "source", source);
 		calldata_set_float(&data, "volume", volume);
@@ -4441,6 +4724,8 @@ void obs_source_set_sync_offset(obs_source_t *source, int64_t offset)
 		struct calldata data;
 		uint8_t stack[128];
 
+		obs_source_mark_dirty(source);
+
 		calldata_init_fixed(&data, stack, sizeof(stack));
 		calldata_set_ptr(&data, "source", source);
 		calldata_set_int(&data, "offset", offset);
@@ -4688,6 +4973,7 @@ void obs_source_set_flags(obs_source_t *source, uint32_t flags)
 
 	if (flags != source->flags) {
 		source->flags = flags;
+		obs_source_mark_dirty(source);
 		signal_flags_updated(source);
 	}
 }
@@ -4718,6 +5004,8 @@ void obs_source_set_audio_mixers(obs_source_t *source, uint32_t mixers)
 	if (source->audio_mixers == mixers)
 		return;
 
+	obs_source_mark_dirty(source);
+
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
 	calldata_set_int(&data, "mixers", mixers);
@@ -4906,6 +5194,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	obs_source_mark_dirty(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -4929,6 +5218,7 @@ void obs_source_set_muted(obs_source_t *source, bool muted)
 		return;
 
 	source->user_muted = muted;
+	obs_source_mark_dirty(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -4990,6 +5280,7 @@ void obs_source_enable_push_to_mute(obs_source_t *source, bool enabled)
 		     enabled ? "enabled" : "disabled");
 
 	source->push_to_mute_enabled = enabled;
+	obs_source_mark_dirty(source);
 
 	if (changed)
 		source_signal_push_to_changed(source, "push_to_mute_changed", enabled);
@@ -5016,6 +5307,7 @@ void obs_source_set_push_to_mute_delay(obs_source_t *source, uint64_t delay)
 
 	pthread_mutex_lock(&source->audio_mutex);
 	source->push_to_mute_delay = delay;
+	obs_source_mark_dirty(source);
 
 	source_signal_push_to_delay(source, "push_to_mute_delay", delay);
 	pthread_mutex_unlock(&source->audio_mutex);
@@ -5046,6 +5338,7 @@ void obs_source_enable_push_to_talk(obs_source_t *source, bool enabled)
 		     enabled ? "enabled" : "disabled");
 
 	source->push_to_talk_enabled = enabled;
+	obs_source_mark_dirty(source);
 
 	if (changed)
 		source_signal_push_to_changed(source, "push_to_talk_changed", enabled);
@@ -5072,6 +5365,7 @@ void obs_source_set_push_to_talk_delay(obs_source_t *source, uint64_t delay)
 
 	pthread_mutex_lock(&source->audio_mutex);
 	source->push_to_talk_delay = delay;
+	obs_source_mark_dirty(source);
 
 	source_signal_push_to_delay(source, "push_to_talk_delay", delay);
 	pthread_mutex_unlock(&source->audio_mutex);
@@ -5298,12 +5592,15 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 					     size_t size)
 {
 	bool audio_submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
+	size_t buffered;
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
-	if (source->audio_input_buf[0].size < size) {
+	buffered = source->audio_input_buf[0].size;
+	if (buffered < size) {
 		source->audio_pending = true;
 		pthread_mutex_unlock(&source->audio_buf_mutex);
+		source_profiler_audio_buffered(source, conv_frames_to_time(sample_rate, buffered / sizeof(float)));
 		return;
 	}
 
@@ -5312,6 +5609,8 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
+	source_profiler_audio_buffered(source, conv_frames_to_time(sample_rate, buffered / sizeof(float)));
+
 	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
 
@@ -5457,6 +5756,8 @@ void obs_source_set_monitoring_type(obs_source_t *source, enum obs_monitoring_ty
 	if (source->monitoring_type == type)
 		return;
 
+	obs_source_mark_dirty(source);
+
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
 	calldata_set_int(&data, "type", type);
@@ -5497,6 +5798,32 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 	return obs_source_valid(source, "obs_source_async_unbuffered") ? source->async_unbuffered : false;
 }
 
+void obs_source_set_render_cache(obs_source_t *source, bool enabled)
+{
+	if (!obs_source_valid(source, "obs_source_set_render_cache"))
+		return;
+
+	source->render_cache_enabled = enabled;
+	obs_source_wake_tick(source);
+}
+
+bool obs_source_render_cache_enabled(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_render_cache_enabled") ? source->render_cache_enabled : false;
+}
+
+void obs_source_get_render_cache_stats(const obs_source_t *source, uint64_t *hits, uint64_t *misses)
+{
+	if (!obs_source_valid(source, "obs_source_get_render_cache_stats")) {
+		*hits = 0;
+		*misses = 0;
+		return;
+	}
+
+	*hits = (uint64_t)os_atomic_load_long(&source->render_cache_hits);
+	*misses = (uint64_t)os_atomic_load_long(&source->render_cache_misses);
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -5552,13 +5879,15 @@ void obs_source_set_balance_value(obs_source_t *source, float balance)
 		struct calldata data;
 		uint8_t stack[128];
 
+		obs_source_mark_dirty(source);
+
 		calldata_init_fixed(&data, stack, sizeof(stack));
 		calldata_set_ptr(&data, "source", source);
 		calldata_set_float(&data, "balance", balance);
 
 		signal_handler_signal(source->context.signals, "audio_balance", &data);
 
-		source->balance = (float)calldata_float(&data, "balance");
+		set_balance(source, (float)calldata_float(&data, "balance"));
 	}
 }
 
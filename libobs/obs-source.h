@@ -208,6 +208,13 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_REQUIRES_CANVAS (1 << 17)
 
+/**
+ * Source type's video_tick only has work to do while the source is showing,
+ * so it is not called while the source is hidden (except once right after
+ * it was hidden)
+ */
+#define OBS_SOURCE_TICK_WHILE_SHOWING (1 << 18)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
@@ -551,6 +558,15 @@ struct obs_source_info {
 	 * @param  source  Source that the filter is being added to
 	 */
 	void (*filter_add)(void *data, obs_source_t *source);
+
+	/**
+	 * Gets the memory held by buffered data, such as delayed frames.
+	 * Can be called from any thread.
+	 *
+	 * @param  data  Source data
+	 * @return       The memory usage in bytes
+	 */
+	uint64_t (*get_memory_usage)(void *data);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info, size_t size);
@@ -29,18 +29,10 @@
 #include <windows.h>
 #endif
 
-static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
+static void tick_all_sources(float seconds)
 {
 	struct obs_core_data *data = &obs->data;
 	struct obs_source *source;
-	uint64_t delta_time;
-	float seconds;
-
-	if (!last_time)
-		last_time = cur_time - obs->video.video_frame_interval_ns;
-
-	delta_time = cur_time - last_time;
-	seconds = (float)((double)delta_time / 1000000000.0);
 
 	/* ------------------------------------- */
 	/* call tick callbacks                   */
@@ -60,32 +52,73 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 
 	da_clear(data->sources_to_tick);
 
-	pthread_mutex_lock(&data->sources_mutex);
+	pthread_mutex_lock(&data->tick_sources_mutex);
 
-	source = data->sources;
+	source = data->first_tick_source;
 	while (source) {
 		obs_source_t *s = obs_source_get_ref(source);
 		if (s)
 			da_push_back(data->sources_to_tick, &s);
-		source = (struct obs_source *)source->context.hh_uuid.next;
+		source = source->next_tick_source;
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	pthread_mutex_unlock(&data->tick_sources_mutex);
 
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
 		obs_source_t *s = data->sources_to_tick.array[i];
+
 		const uint64_t start = source_profiler_source_tick_start();
 		obs_source_video_tick(s, seconds);
 		source_profiler_source_tick_end(s, start);
-		obs_source_release(s);
 	}
 
+	/* ------------------------------------- */
+	/* remove sources that became idle       */
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+		if (!obs_source_needs_tick(s))
+			obs_source_remove_tick(s);
+	}
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_release(data->sources_to_tick.array[i]);
+}
+
+static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
+{
+	uint64_t delta_time;
+	float seconds;
+
+	if (!last_time)
+		last_time = cur_time - obs->video.video_frame_interval_ns;
+
+	delta_time = cur_time - last_time;
+	seconds = (float)((double)delta_time / 1000000000.0);
+
+	tick_all_sources(seconds);
 	return cur_time;
 }
 
+void obs_tick_sources(float seconds)
+{
+	if (!obs)
+		return;
+
+	if (obs->video.thread_initialized) {
+		blog(LOG_WARNING, "obs_tick_sources: sources are already "
+				  "ticked by the graphics thread");
+		return;
+	}
+
+	tick_all_sources(seconds);
+}
+
 /* in obs-display.c */
 extern void render_display(struct obs_display *display);
 
@@ -121,8 +154,17 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
+static inline void wait_readback(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized)
+		os_event_wait(video->readback_idle);
+}
+
 static inline void unmap_last_surface(struct obs_core_video_mix *video)
 {
+	/* the readback thread may still be copying from the surfaces */
+	wait_readback(video);
+
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
 		if (video->mapped_surfaces[c]) {
 			gs_stagesurface_unmap(video->mapped_surfaces[c]);
@@ -791,9 +833,145 @@ static inline void output_video_data(struct obs_core_video_mix *video, struct vi
 		}
 
 		video_output_unlock_frame(video->video);
+		obs_frame_timing_set_download(video->video, input_frame->timestamp, os_gettime_ns());
 	}
 }
 
+#define NBSP "\xC2\xA0"
+
+static void *readback_thread(void *data)
+{
+	struct obs_core_video_mix *video = data;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("obs video readback thread");
+	const char *readback_thread_name = profile_store_name(
+		obs_get_profiler_name_store(), "obs_video_readback_thread(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(readback_thread_name, interval);
+
+	while (os_sem_wait(video->readback_semaphore) == 0) {
+		if (os_atomic_load_bool(&video->readback_stop))
+			break;
+
+		profile_start(readback_thread_name);
+		output_video_data(video, &video->readback_frame, video->readback_count);
+		profile_end(readback_thread_name);
+
+		profile_reenable_thread();
+
+		os_event_signal(video->readback_idle);
+	}
+
+	return NULL;
+}
+
+bool obs_init_video_readback(struct obs_core_video_mix *video)
+{
+	if (os_sem_init(&video->readback_semaphore, 0) != 0)
+		return false;
+	if (os_event_init(&video->readback_idle, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+
+	os_event_signal(video->readback_idle);
+	video->readback_stop = false;
+
+	if (pthread_create(&video->readback_thread, NULL, readback_thread, video) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+void obs_free_video_readback(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized) {
+		/* the pending frame is still copied before the thread exits */
+		wait_readback(video);
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_semaphore);
+		pthread_join(video->readback_thread, NULL);
+		video->readback_thread_initialized = false;
+	}
+
+	if (video->readback_semaphore) {
+		os_sem_destroy(video->readback_semaphore);
+		video->readback_semaphore = NULL;
+	}
+	if (video->readback_idle) {
+		os_event_destroy(video->readback_idle);
+		video->readback_idle = NULL;
+	}
+}
+
+/* hands the mapped frame to the readback thread, the surfaces stay mapped
+ * until it has been copied to the video output */
+static inline void queue_readback(struct obs_core_video_mix *video, struct video_data *frame, int count)
+{
+	if (!video->readback_thread_initialized) {
+		output_video_data(video, frame, count);
+		return;
+	}
+
+	wait_readback(video);
+
+	video->readback_frame = *frame;
+	video->readback_count = count;
+
+	os_event_reset(video->readback_idle);
+	os_sem_post(video->readback_semaphore);
+}
+
+static struct obs_frame_timing *find_frame_timing(video_t *video, uint64_t timestamp)
+{
+	for (size_t i = 0; i < OBS_FRAME_TIMINGS; i++) {
+		struct obs_frame_timing *timing = &obs->video.frame_timings[i];
+		if (timing->video == video && timing->timestamp == timestamp)
+			return timing;
+	}
+
+	return NULL;
+}
+
+static struct obs_frame_timing *get_frame_timing(video_t *video, uint64_t timestamp)
+{
+	struct obs_frame_timing *timing = find_frame_timing(video, timestamp);
+	if (timing)
+		return timing;
+
+	timing = &obs->video.frame_timings[obs->video.frame_timings_idx];
+	obs->video.frame_timings_idx = (obs->video.frame_timings_idx + 1) % OBS_FRAME_TIMINGS;
+
+	memset(timing, 0, sizeof(*timing));
+	timing->video = video;
+	timing->timestamp = timestamp;
+	return timing;
+}
+
+void obs_frame_timing_set_capture(video_t *video, uint64_t timestamp, uint64_t act)
+{
+	pthread_mutex_lock(&obs->video.frame_timings_mutex);
+	get_frame_timing(video, timestamp)->act = act;
+	pthread_mutex_unlock(&obs->video.frame_timings_mutex);
+}
+
+void obs_frame_timing_set_download(video_t *video, uint64_t timestamp, uint64_t fdt)
+{
+	pthread_mutex_lock(&obs->video.frame_timings_mutex);
+	get_frame_timing(video, timestamp)->fdt = fdt;
+	pthread_mutex_unlock(&obs->video.frame_timings_mutex);
+}
+
+void obs_frame_timing_fill(video_t *video, struct encoder_packet_time *ept)
+{
+	pthread_mutex_lock(&obs->video.frame_timings_mutex);
+	struct obs_frame_timing *timing = find_frame_timing(video, ept->cts);
+	if (timing) {
+		ept->act = timing->act;
+		ept->fdt = timing->fdt;
+	}
+	pthread_mutex_unlock(&obs->video.frame_timings_mutex);
+}
+
 void add_ready_encoder_group(obs_encoder_t *encoder)
 {
 	obs_weak_encoder_t *weak = obs_encoder_get_weak_encoder(encoder);
@@ -871,7 +1049,8 @@ static inline void output_frame(struct obs_core_video_mix *video)
 	const bool gpu_active = video->gpu_was_active;
 
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
+	/* the oldest staged frame, which is staged again next frame */
+	int prev_texture = (cur_texture + 1) % video->num_textures;
 	struct video_data frame;
 	bool frame_ready = 0;
 
@@ -882,7 +1061,10 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO, output_frame_render_video_name);
+	obs->video.async_capture_ts = 0;
 	render_video(video, raw_active, gpu_active, cur_texture);
+	if (obs->video.async_capture_ts && (raw_active || gpu_active))
+		obs_frame_timing_set_capture(video->video, obs->video.video_time, obs->video.async_capture_ts);
 	GS_DEBUG_MARKER_END();
 	profile_end(output_frame_render_video_name);
 
@@ -905,11 +1087,11 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		queue_readback(video, &frame, vframe_info.count);
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->num_textures)
 		video->cur_texture = 0;
 }
 
@@ -931,8 +1113,6 @@ static inline void output_frames(void)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
@@ -1106,6 +1286,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	gs_texture_pool_trim();
 	gs_leave_context();
 
 	profile_start(tick_sources_name);
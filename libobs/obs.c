@@ -370,7 +370,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < (size_t)video->num_textures; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] = gs_stagesurface_create_nv12(info->width, info->height);
@@ -623,6 +623,7 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
 	video->gpu_conversion = ovi->gpu_conversion;
+	video->num_textures = obs->video.readback_depth ? (int)obs->video.readback_depth : DEFAULT_READBACK_DEPTH;
 	video->gpu_was_active = false;
 	video->raw_was_active = false;
 	video->was_active = false;
@@ -652,6 +653,10 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 
 	gs_leave_context();
 
+	/* started last so a failed mix never leaves a thread behind */
+	if (!obs_init_video_readback(video))
+		blog(LOG_WARNING, "Failed to create video readback thread, copying frames on the graphics thread");
+
 	return OBS_VIDEO_SUCCESS;
 }
 
@@ -698,6 +703,8 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	if (pthread_mutex_init(&video->mixes_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->frame_timings_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
 
 	/* Reset main canvas mix first so it remains first in the rendering order. */
 	if (!obs_canvas_reset_video_internal(obs->data.main_canvas, ovi))
@@ -795,6 +802,8 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
+	obs_free_video_readback(video);
+
 	if (video->video) {
 		video_output_close(video->video);
 		video->video = NULL;
@@ -837,6 +846,11 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.mixes_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
 
+	pthread_mutex_destroy(&obs->video.frame_timings_mutex);
+	pthread_mutex_init_value(&obs->video.frame_timings_mutex);
+	memset(obs->video.frame_timings, 0, sizeof(obs->video.frame_timings));
+	obs->video.frame_timings_idx = 0;
+
 	for (size_t i = 0; i < obs->video.ready_encoder_groups.num; i++) {
 		obs_weak_encoder_release(obs->video.ready_encoder_groups.array[i]);
 	}
@@ -954,6 +968,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->audio_sources_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->tick_sources_mutex, NULL) != 0)
+		goto fail;
 	if (pthread_mutex_init_recursive(&data->displays_mutex) != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->outputs_mutex) != 0)
@@ -1038,6 +1054,7 @@ static void obs_free_data(void)
 
 	pthread_mutex_destroy(&data->sources_mutex);
 	pthread_mutex_destroy(&data->audio_sources_mutex);
+	pthread_mutex_destroy(&data->tick_sources_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
 	pthread_mutex_destroy(&data->outputs_mutex);
 	pthread_mutex_destroy(&data->encoders_mutex);
@@ -1128,10 +1145,12 @@ static inline bool obs_init_hotkeys(void)
 	hotkeys->sceneitem_show = bstrdup("Show '%1'");
 	hotkeys->sceneitem_hide = bstrdup("Hide '%1'");
 
-	if (!obs_hotkeys_platform_init(hotkeys))
+	if (pthread_mutex_init_recursive(&hotkeys->mutex) != 0)
 		return false;
 
-	if (pthread_mutex_init_recursive(&hotkeys->mutex) != 0)
+	/* platform code may report key events right away */
+	hotkeys->key_entries_dirty = true;
+	if (!obs_hotkeys_platform_init(hotkeys))
 		goto fail;
 
 	if (os_event_init(&hotkeys->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
@@ -1156,7 +1175,11 @@ static inline void stop_hotkeys(void)
 	if (hotkeys->hotkey_thread_initialized) {
 		os_event_signal(hotkeys->stop_event);
 		pthread_join(hotkeys->hotkey_thread, &thread_ret);
+
+		/* stops platform key events from touching the bindings */
+		pthread_mutex_lock(&hotkeys->mutex);
 		hotkeys->hotkey_thread_initialized = false;
+		pthread_mutex_unlock(&hotkeys->mutex);
 	}
 
 	os_event_destroy(hotkeys->stop_event);
@@ -1198,6 +1221,17 @@ const struct obs_source_info audio_line_info = {
 
 extern void log_system_info(void);
 
+#define MAX_TASK_POOL_THREADS 8
+
+/* leaves a core for the video, audio and UI threads */
+static size_t get_task_pool_threads(void)
+{
+	int threads = os_get_logical_cores() - 1;
+	if (threads > MAX_TASK_POOL_THREADS)
+		threads = MAX_TASK_POOL_THREADS;
+	return threads < 2 ? 2 : (size_t)threads;
+}
+
 static bool obs_init(const char *locale, const char *module_config_path, profiler_name_store_t *store)
 {
 	obs = bzalloc(sizeof(struct obs_core));
@@ -1207,6 +1241,7 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
+	pthread_mutex_init_value(&obs->video.frame_timings_mutex);
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -1233,6 +1268,10 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	if (!obs->destruction_task_thread)
 		return false;
 
+	obs->task_pool = os_task_pool_create(get_task_pool_threads());
+	if (!obs->task_pool)
+		return false;
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1359,6 +1398,7 @@ void obs_shutdown(void)
 	struct obs_module *module;
 
 	obs_wait_for_destroy_queue();
+	os_task_pool_wait(obs->task_pool);
 
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *item = &obs->source_types.array[i];
@@ -1404,6 +1444,7 @@ void obs_shutdown(void)
 	obs_free_data();
 	obs_free_audio();
 	obs_free_video();
+	os_task_pool_destroy(obs->task_pool);
 	os_task_queue_destroy(obs->destruction_task_thread);
 	obs_free_hotkeys();
 	obs_free_graphics();
@@ -2494,7 +2535,91 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	return source_data;
 }
 
-obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb, void *data_)
+/* Sources with a save callback or transition state can change without libobs
+ * noticing, so they are always saved again */
+static inline bool save_cache_supported(const obs_source_t *source)
+{
+	return !source->info.save && source->info.type != OBS_SOURCE_TYPE_TRANSITION;
+}
+
+static inline bool save_stamp_valid(obs_source_t *source)
+{
+	return save_cache_supported(source) &&
+	       source->saved_generation == os_atomic_load_long(&source->save_generation) &&
+	       source->saved_settings_rev == obs_data_get_revision(source->context.settings) &&
+	       source->saved_private_rev == obs_data_get_revision(source->private_settings);
+}
+
+static inline void save_stamp(obs_source_t *source)
+{
+	source->saved_generation = os_atomic_load_long(&source->save_generation);
+	source->saved_settings_rev = obs_data_get_revision(source->context.settings);
+	source->saved_private_rev = obs_data_get_revision(source->private_settings);
+}
+
+static bool save_cache_valid(obs_source_t *source)
+{
+	bool valid;
+
+	if (!source->save_cache || !save_stamp_valid(source))
+		return false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	valid = true;
+	for (size_t i = 0; valid && i < source->filters.num; i++)
+		valid = save_stamp_valid(source->filters.array[i]);
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return valid;
+}
+
+/* must be called with sources_mutex locked */
+static obs_data_t *save_source_cached(obs_source_t *source)
+{
+	if (save_cache_valid(source)) {
+		obs_data_addref(source->save_cache);
+		return source->save_cache;
+	}
+
+	/* stamp before saving so that changes made while saving are picked
+	 * up by the next save */
+	save_stamp(source);
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++)
+		save_stamp(source->filters.array[i]);
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	/* the saved data references the live settings objects, a copy is
+	 * needed to make it safe to use from other threads */
+	obs_data_t *source_data = obs_save_source(source);
+	obs_data_t *copy = obs_data_create();
+	obs_data_apply(copy, source_data);
+	obs_data_release(source_data);
+
+	obs_data_release(source->save_cache);
+	source->save_cache = NULL;
+
+	if (save_cache_supported(source)) {
+		obs_data_addref(copy);
+		source->save_cache = copy;
+	}
+
+	return copy;
+}
+
+obs_data_t *obs_save_source_cached(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_save_source_cached"))
+		return NULL;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+	obs_data_t *source_data = save_source_cached(source);
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+
+	return source_data;
+}
+
+static obs_data_array_t *save_sources_filtered(obs_save_source_filter_cb cb, void *data_, bool cached)
 {
 	struct obs_core_data *data = &obs->data;
 	obs_data_array_t *array;
@@ -2509,7 +2634,7 @@ obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb, void *
 	while (source) {
 		if ((source->info.type != OBS_SOURCE_TYPE_FILTER) != 0 && !source->removed && !source->temp_removed &&
 		    !source->context.private && cb(data_, source)) {
-			obs_data_t *source_data = obs_save_source(source);
+			obs_data_t *source_data = cached ? save_source_cached(source) : obs_save_source(source);
 
 			obs_data_array_push_back(array, source_data);
 			obs_data_release(source_data);
@@ -2523,6 +2648,16 @@ obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb, void *
 	return array;
 }
 
+obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb, void *data)
+{
+	return save_sources_filtered(cb, data, false);
+}
+
+obs_data_array_t *obs_save_sources_cached_filtered(obs_save_source_filter_cb cb, void *data)
+{
+	return save_sources_filtered(cb, data, true);
+}
+
 static bool save_source_filter(void *data, obs_source_t *source)
 {
 	UNUSED_PARAMETER(data);
@@ -2961,6 +3096,27 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+void obs_set_video_readback_depth(uint32_t frames)
+{
+	if (!obs)
+		return;
+
+	if (frames < DEFAULT_READBACK_DEPTH)
+		frames = DEFAULT_READBACK_DEPTH;
+	else if (frames > NUM_TEXTURES)
+		frames = NUM_TEXTURES;
+
+	obs->video.readback_depth = frames;
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	if (!obs || !obs->video.readback_depth)
+		return DEFAULT_READBACK_DEPTH;
+
+	return obs->video.readback_depth;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param)
 {
 	struct tick_callback data = {tick, param};
@@ -3244,6 +3400,8 @@ bool obs_in_task_thread(enum obs_task_type type)
 		return is_ui_thread;
 	else if (type == OBS_TASK_DESTROY)
 		return os_task_queue_inside(obs->destruction_task_thread);
+	else if (type == OBS_TASK_BACKGROUND)
+		return os_task_pool_inside(obs->task_pool);
 
 	assert(false);
 	return false;
@@ -3259,7 +3417,11 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param, bool
 					"there's no UI task handler!");
 		}
 	} else {
-		if (obs_in_task_thread(type)) {
+		/* a pool worker queueing more background work without waiting
+		 * must not run it inline, or it would lose its parallelism */
+		const bool queue_background = type == OBS_TASK_BACKGROUND && !wait;
+
+		if (!queue_background && obs_in_task_thread(type)) {
 			task(param);
 
 		} else if (wait) {
@@ -3292,10 +3454,34 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param, bool
 		} else if (type == OBS_TASK_DESTROY) {
 			os_task_t os_task = (os_task_t)task;
 			os_task_queue_queue_task(obs->destruction_task_thread, os_task, param);
+
+		} else if (type == OBS_TASK_BACKGROUND) {
+			obs_queue_background_task(OS_TASK_PRIORITY_NORMAL, task, param);
 		}
 	}
 }
 
+uint64_t obs_queue_background_task(enum os_task_priority priority, obs_task_t task, void *param)
+{
+	if (!obs_ptr_valid(task, "obs_queue_background_task"))
+		return 0;
+
+	return os_task_pool_queue_task(obs->task_pool, priority, (os_task_t)task, param);
+}
+
+bool obs_cancel_background_task(uint64_t id)
+{
+	return os_task_pool_cancel(obs->task_pool, id);
+}
+
+void obs_get_background_task_stats(struct os_task_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_get_background_task_stats"))
+		return;
+
+	os_task_pool_get_stats(obs->task_pool, stats);
+}
+
 bool obs_wait_for_destroy_queue(void)
 {
 	struct task_wait_info info = {0};
@@ -21,6 +21,7 @@
 #include "util/bmem.h"
 #include "util/profiler.h"
 #include "util/text-lookup.h"
+#include "util/task.h"
 #include "graphics/graphics.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
@@ -799,6 +800,17 @@ EXPORT obs_data_array_t *obs_save_sources(void);
 typedef bool (*obs_save_source_filter_cb)(void *data, obs_source_t *source);
 EXPORT obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb, void *data);
 
+/**
+ * Saves a source to settings data, reusing the data of the previous call if
+ * the source has not changed since.  The returned data does not reference any
+ * live settings, so it can be serialized on another thread, but it may be
+ * shared and must not be modified.
+ */
+EXPORT obs_data_t *obs_save_source_cached(obs_source_t *source);
+
+/** Same as obs_save_sources_filtered, using obs_save_source_cached */
+EXPORT obs_data_array_t *obs_save_sources_cached_filtered(obs_save_source_filter_cb cb, void *data);
+
 /** Reset source UUIDs. NOTE: this function is only to be used by the UI and
  *  will be removed in a future version! */
 EXPORT void obs_reset_source_uuids(void);
@@ -829,6 +841,15 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/**
+ * Sets the number of raw output frames in flight between being staged on the
+ * GPU and being mapped for download, from 2 to 4.  Deeper readback avoids
+ * stalling the graphics thread on slow GPU downloads at the cost of latency.
+ * Takes effect on the next video reset.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t frames);
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds), void *param);
 
@@ -871,11 +892,18 @@ enum obs_task_type {
 	OBS_TASK_GRAPHICS,
 	OBS_TASK_AUDIO,
 	OBS_TASK_DESTROY,
+	OBS_TASK_BACKGROUND,
 };
 
 EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param, bool wait);
 EXPORT bool obs_in_task_thread(enum obs_task_type type);
 
+/** Queues CPU-bound work on the background task pool, returns an id for
+ * obs_cancel_background_task or 0 on failure */
+EXPORT uint64_t obs_queue_background_task(enum os_task_priority priority, obs_task_t task, void *param);
+EXPORT bool obs_cancel_background_task(uint64_t id);
+EXPORT void obs_get_background_task_stats(struct os_task_pool_stats *stats);
+
 EXPORT bool obs_wait_for_destroy_queue(void);
 
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
@@ -1066,6 +1094,9 @@ EXPORT uint32_t obs_source_get_height(obs_source_t *source);
 EXPORT enum gs_color_space obs_source_get_color_space(obs_source_t *source, size_t count,
 						      const enum gs_color_space *preferred_spaces);
 
+/** Gets the memory in bytes held by buffered data of a source and its filters */
+EXPORT uint64_t obs_source_get_memory_usage(obs_source_t *source);
+
 /** Hints whether or not the source will blend texels */
 EXPORT bool obs_source_get_texcoords_centered(obs_source_t *source);
 
@@ -1110,6 +1141,12 @@ EXPORT const char *obs_source_get_name(const obs_source_t *source);
 /** Sets the name of a source */
 EXPORT void obs_source_set_name(obs_source_t *source, const char *name);
 
+/**
+ * Marks a source as changed so that obs_save_source_cached saves it again.
+ * Only needed after modifying nested objects of the source settings in place.
+ */
+EXPORT void obs_source_set_dirty(obs_source_t *source);
+
 /** Gets the UUID of a source */
 EXPORT const char *obs_source_get_uuid(const obs_source_t *source);
 
@@ -1478,6 +1515,19 @@ EXPORT void obs_source_get_audio_mix(const obs_source_t *source, struct obs_sour
 EXPORT void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+/**
+ * Renders the source at most once per frame and draws the result for every
+ * other use of the source in the same frame (scene items, canvases, views).
+ * Useful for sources or nested scenes with expensive filters that are shown
+ * in several places.  Disabled by default.
+ */
+EXPORT void obs_source_set_render_cache(obs_source_t *source, bool enabled);
+EXPORT bool obs_source_render_cache_enabled(const obs_source_t *source);
+
+/** Gets how often the source was drawn from its render cache (hits) and how
+ * often it had to be rendered while the cache was enabled (misses) */
+EXPORT void obs_source_get_render_cache_stats(const obs_source_t *source, uint64_t *hits, uint64_t *misses);
+
 /** Used to decouple audio from video so that audio doesn't attempt to sync up
  * with video.  I.E. Audio acts independently.  Only works when in unbuffered
  * mode. */
@@ -1759,6 +1809,15 @@ EXPORT void obs_sceneitem_force_update_transform(obs_sceneitem_t *item);
 EXPORT void obs_sceneitem_defer_update_begin(obs_sceneitem_t *item);
 EXPORT void obs_sceneitem_defer_update_end(obs_sceneitem_t *item);
 
+/**
+ * Queues a transform (and optionally a crop) for the scene item without
+ * locking the scene.  Queued transforms are applied the next time the scene
+ * is rendered, once per frame, and only the latest transform queued for an
+ * item is used.  Meant for automation that moves many items per second.
+ */
+EXPORT void obs_sceneitem_queue_transform(obs_sceneitem_t *item, const struct obs_transform_info *info,
+					  const struct obs_sceneitem_crop *crop);
+
 /** Gets private front-end settings data.  This data is saved/loaded
  * automatically.  Returns an incremented reference. */
 EXPORT obs_data_t *obs_sceneitem_get_private_settings(obs_sceneitem_t *item);
@@ -2097,6 +2156,41 @@ EXPORT void obs_output_remove_packet_callback(obs_output_t *output,
 								struct encoder_packet_time *pkt_time, void *param),
 					      void *param);
 
+/* Latency stages of video packets, derived from encoder_packet_time and
+ * obs_output_packet_sent().  All values are in nanoseconds. */
+enum obs_output_latency_stage {
+	OBS_OUTPUT_LATENCY_CAPTURE,      /* async frame received -> composition (ACT -> CTS) */
+	OBS_OUTPUT_LATENCY_DOWNLOAD,     /* composition -> copied to system memory (CTS -> FDT) */
+	OBS_OUTPUT_LATENCY_ENCODE_QUEUE, /* composition -> encode request (CTS -> FER) */
+	OBS_OUTPUT_LATENCY_ENCODE,       /* encode request -> packet reaches output (FER -> PIA) */
+	OBS_OUTPUT_LATENCY_INTERLEAVE,   /* packet waiting in the interleaver (PIA -> PIR) */
+	OBS_OUTPUT_LATENCY_SEND_QUEUE,   /* packet waiting in the output's send queue */
+	OBS_OUTPUT_LATENCY_SEND,         /* packet write/send until completion */
+	OBS_OUTPUT_LATENCY_TOTAL,        /* ACT (or CTS) -> send completion (or PIR) */
+	OBS_OUTPUT_LATENCY_STAGE_COUNT,
+};
+
+struct obs_output_latency_stage_stats {
+	uint32_t samples;
+	uint64_t p50;
+	uint64_t p95;
+	uint64_t p99;
+	uint64_t max;
+};
+
+struct obs_output_latency_stats {
+	struct obs_output_latency_stage_stats stages[OBS_OUTPUT_LATENCY_STAGE_COUNT];
+};
+
+/* Gets percentiles of the most recent video packet latencies of the output.
+ * Samples are only recorded from the first call on, so this returns false
+ * until packets have been recorded. */
+EXPORT bool obs_output_get_latency_stats(obs_output_t *output, struct obs_output_latency_stats *stats);
+
+/* Periodically logs the latency percentiles of the output (0 disables),
+ * recording starts when it is first enabled */
+EXPORT void obs_output_set_latency_log_interval(obs_output_t *output, uint32_t seconds);
+
 /* Sets a callback to be called when the output checks if it should attempt to reconnect.
  * If the callback returns false, the output will not attempt to reconnect. */
 EXPORT void obs_output_set_reconnect_callback(obs_output_t *output,
@@ -2108,6 +2202,14 @@ EXPORT void obs_output_set_reconnect_callback(obs_output_t *output,
 
 EXPORT void *obs_output_get_type_data(obs_output_t *output);
 
+/**
+ * Reports that a video packet has been written to the network or file,
+ * for the send queue and send stages of the output's latency statistics.
+ * send_start_ts is the os_gettime_ns() value of when the write started.
+ */
+EXPORT void obs_output_packet_sent(obs_output_t *output, const struct encoder_packet *packet,
+				   uint64_t send_start_ts);
+
 /** Gets the video conversion info.  Used only for raw output */
 EXPORT const struct video_scale_info *obs_output_get_video_conversion(obs_output_t *output);
 
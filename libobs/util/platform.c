@@ -21,6 +21,11 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <locale.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "c99defs.h"
 #include "platform.h"
 #include "bmem.h"
@@ -258,7 +263,16 @@ bool os_quick_write_mbs_file(const char *path, const char *str, size_t len)
 	return true;
 }
 
-bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker)
+static inline void sync_file(FILE *f)
+{
+#ifdef _WIN32
+	_commit(_fileno(f));
+#else
+	fsync(fileno(f));
+#endif
+}
+
+static bool write_utf8_file(const char *path, const char *str, size_t len, bool marker, bool sync)
 {
 	FILE *f = os_fopen(path, "wb");
 	if (!f)
@@ -278,11 +292,18 @@ bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, boo
 		}
 	}
 	fflush(f);
+	if (sync)
+		sync_file(f);
 	fclose(f);
 
 	return true;
 }
 
+bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker)
+{
+	return write_utf8_file(path, str, len, marker, false);
+}
+
 bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len, bool marker, const char *temp_ext,
 				   const char *backup_ext)
 {
@@ -301,7 +322,8 @@ bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len
 		dstr_cat(&temp_path, ".");
 	dstr_cat(&temp_path, temp_ext);
 
-	if (!os_quick_write_utf8_file(temp_path.array, str, len, marker)) {
+	/* the data has to be on disk before it replaces the original file */
+	if (!write_utf8_file(temp_path.array, str, len, marker, true)) {
 		blog(LOG_ERROR,
 		     "os_quick_write_utf8_file_safe: failed to "
 		     "write to %s",
@@ -603,7 +625,8 @@ int os_dtostr(double value, char *dst, size_t size)
 			end++;
 
 		if (end != start) {
-			memmove(start, end, length - (size_t)(end - dst));
+			/* include the null terminator */
+			memmove(start, end, length - (size_t)(end - dst) + 1);
 			length -= (size_t)(end - start);
 		}
 	}
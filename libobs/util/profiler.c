@@ -80,10 +80,26 @@ struct profile_entry {
 
 typedef struct profile_root_entry profile_root_entry;
 struct profile_root_entry {
-	pthread_mutex_t *mutex;
 	const char *name;
 	profile_entry *entry;
-	profile_call *prev_call;
+};
+
+typedef struct profile_thread_root profile_thread_root;
+struct profile_thread_root {
+	const char *name;
+	profile_entry entry;
+	uint64_t prev_start_time;
+};
+
+/* Finished root calls are merged into a table owned by the calling thread, so
+ * profile_end never contends with other threads.  The per-thread tables are
+ * folded into the global root entries whenever a snapshot is created. */
+typedef struct profile_thread_data profile_thread_data;
+struct profile_thread_data {
+	pthread_mutex_t mutex;
+	DARRAY(profile_thread_root) roots;
+	bool exited;
+	bool detached;
 };
 
 static inline uint64_t diff_ns_to_usec(uint64_t prev, uint64_t next)
@@ -222,17 +238,17 @@ static profile_entry *get_child(profile_entry *parent, const char *name)
 	return init_entry(da_push_back_new(parent->children), name);
 }
 
-static void merge_call(profile_entry *entry, profile_call *call, profile_call *prev_call)
+static void merge_call(profile_entry *entry, profile_call *call, uint64_t prev_start_time)
 {
 	const size_t num = call->children.num;
 	for (size_t i = 0; i < num; i++) {
 		profile_call *child = &call->children.array[i];
-		merge_call(get_child(entry, child->name), child, NULL);
+		merge_call(get_child(entry, child->name), child, 0);
 	}
 
-	if (entry->expected_time_between_calls != 0 && prev_call) {
+	if (entry->expected_time_between_calls != 0 && prev_start_time) {
 		migrate_old_entries(&entry->times_between_calls, true);
-		uint64_t usec = diff_ns_to_usec(prev_call->start_time, call->start_time);
+		uint64_t usec = diff_ns_to_usec(prev_start_time, call->start_time);
 		add_hashmap_entry(&entry->times_between_calls, usec, 1);
 	}
 
@@ -248,24 +264,76 @@ static void merge_call(profile_entry *entry, profile_call *call, profile_call *p
 #endif
 }
 
+static void clear_hashmap(profile_times_table *map)
+{
+	bfree(map->old_entries);
+	map->old_entries = NULL;
+	map->old_start_index = 0;
+	map->old_occupied = 0;
+
+	map->occupied = 0;
+	map->max_probe_count = 0;
+	memset(map->entries, 0, sizeof(profile_times_table_entry) * map->size);
+}
+
+static void fold_hashmap(profile_times_table *dst, profile_times_table *src)
+{
+	migrate_old_entries(src, false);
+
+	for (size_t i = 0; i < src->size; i++) {
+		profile_times_table_entry *entry = &src->entries[i];
+		if (!entry->probes)
+			continue;
+
+		migrate_old_entries(dst, true);
+		add_hashmap_entry(dst, entry->entry.time_delta, entry->entry.count);
+	}
+
+	clear_hashmap(src);
+}
+
+static void fold_entry(profile_entry *dst, profile_entry *src)
+{
+	const size_t num = src->children.num;
+	for (size_t i = 0; i < num; i++) {
+		profile_entry *child = &src->children.array[i];
+		fold_entry(get_child(dst, child->name), child);
+	}
+
+	fold_hashmap(&dst->times, &src->times);
+#ifdef TRACK_OVERHEAD
+	fold_hashmap(&dst->overhead, &src->overhead);
+#endif
+
+	if (dst->expected_time_between_calls)
+		fold_hashmap(&dst->times_between_calls, &src->times_between_calls);
+	else
+		clear_hashmap(&src->times_between_calls);
+}
+
 static bool enabled = false;
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
+static DARRAY(profile_thread_data *) thread_datas;
+
+static pthread_once_t thread_data_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_data_key;
 
 static THREAD_LOCAL profile_call *thread_context = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
+static THREAD_LOCAL profile_thread_data *thread_data = NULL;
 
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
-	enabled = true;
+	os_atomic_store_bool(&enabled, true);
 	pthread_mutex_unlock(&root_mutex);
 }
 
 void profiler_stop(void)
 {
 	pthread_mutex_lock(&root_mutex);
-	enabled = false;
+	os_atomic_store_bool(&enabled, false);
 	pthread_mutex_unlock(&root_mutex);
 }
 
@@ -304,9 +372,6 @@ static profile_root_entry *get_root_entry(const char *name)
 
 	if (!r_entry) {
 		r_entry = da_push_back_new(root_entries);
-		r_entry->mutex = bmalloc(sizeof(pthread_mutex_t));
-		pthread_mutex_init(r_entry->mutex, NULL);
-
 		r_entry->name = name;
 		r_entry->entry = bzalloc(sizeof(profile_entry));
 		init_entry(r_entry->entry, name);
@@ -320,39 +385,192 @@ void profile_register_root(const char *name, uint64_t expected_time_between_call
 	if (!lock_root())
 		return;
 
-	get_root_entry(name)->entry->expected_time_between_calls = (expected_time_between_calls + 500) / 1000;
+	const uint64_t expected = (expected_time_between_calls + 500) / 1000;
+	get_root_entry(name)->entry->expected_time_between_calls = expected;
+
+	/* Roots that threads have already started merging into */
+	for (size_t i = 0; i < thread_datas.num; i++) {
+		profile_thread_data *td = thread_datas.array[i];
+
+		pthread_mutex_lock(&td->mutex);
+		for (size_t j = 0; j < td->roots.num; j++) {
+			if (td->roots.array[j].name == name)
+				td->roots.array[j].entry.expected_time_between_calls = expected;
+		}
+		pthread_mutex_unlock(&td->mutex);
+	}
+
 	pthread_mutex_unlock(&root_mutex);
 }
 
 static void free_call_context(profile_call *context);
+static void free_profile_entry(profile_entry *entry);
 
-static void merge_context(profile_call *context)
+static void free_thread_roots(profile_thread_data *td)
 {
-	pthread_mutex_t *mutex = NULL;
-	profile_entry *entry = NULL;
-	profile_call *prev_call = NULL;
+	for (size_t i = 0; i < td->roots.num; i++)
+		free_profile_entry(&td->roots.array[i].entry);
 
-	if (!lock_root()) {
-		free_call_context(context);
-		return;
+	da_free(td->roots);
+}
+
+static void free_thread_data(profile_thread_data *td)
+{
+	free_thread_roots(td);
+	pthread_mutex_destroy(&td->mutex);
+	bfree(td);
+}
+
+/* Runs on thread exit.  The collector still owns the table unless the
+ * profiler has already been freed, in which case nobody else references it
+ * anymore. */
+static void thread_data_exit(void *data)
+{
+	profile_thread_data *td = data;
+	bool detached;
+
+	pthread_mutex_lock(&td->mutex);
+	td->exited = true;
+	detached = td->detached;
+	pthread_mutex_unlock(&td->mutex);
+
+	if (detached)
+		free_thread_data(td);
+}
+
+static void init_thread_data_key(void)
+{
+	pthread_key_create(&thread_data_key, thread_data_exit);
+}
+
+static profile_thread_data *get_thread_data(void)
+{
+	if (thread_data)
+		return thread_data;
+
+	pthread_once(&thread_data_key_once, init_thread_data_key);
+
+	profile_thread_data *td = bzalloc(sizeof(profile_thread_data));
+	pthread_mutex_init(&td->mutex, NULL);
+
+	pthread_mutex_lock(&root_mutex);
+	da_push_back(thread_datas, &td);
+	pthread_mutex_unlock(&root_mutex);
+
+	pthread_setspecific(thread_data_key, td);
+	thread_data = td;
+	return td;
+}
+
+/* Requires td->mutex */
+static profile_thread_root *find_thread_root(profile_thread_data *td, const char *name)
+{
+	for (size_t i = 0; i < td->roots.num; i++) {
+		if (td->roots.array[i].name == name)
+			return &td->roots.array[i];
 	}
 
-	profile_root_entry *r_entry = get_root_entry(context->name);
+	return NULL;
+}
+
+/* Returns with td->mutex locked.  root_mutex is held while the root is added
+ * so profile_register_root can't miss it, and is always taken before a
+ * thread's mutex. */
+static profile_thread_root *add_thread_root(profile_thread_data *td, const char *name)
+{
+	uint64_t expected = 0;
 
-	mutex = r_entry->mutex;
-	entry = r_entry->entry;
-	prev_call = r_entry->prev_call;
+	pthread_mutex_lock(&root_mutex);
+	if (enabled)
+		expected = get_root_entry(name)->entry->expected_time_between_calls;
+	pthread_mutex_lock(&td->mutex);
+	pthread_mutex_unlock(&root_mutex);
 
-	r_entry->prev_call = context;
+	if (td->detached)
+		return NULL;
 
-	pthread_mutex_lock(mutex);
+	profile_thread_root *root = da_push_back_new(td->roots);
+	root->name = name;
+	init_entry(&root->entry, name);
+	root->entry.expected_time_between_calls = expected;
+	return root;
+}
+
+/* Tables of threads that outlived profiler_free are detached from the freed
+ * profiler, they join the next one once it has been started again */
+static void reattach_thread_data(profile_thread_data *td)
+{
+	pthread_mutex_lock(&root_mutex);
+	pthread_mutex_lock(&td->mutex);
+	if (td->detached && enabled) {
+		td->detached = false;
+		da_push_back(thread_datas, &td);
+	}
+	pthread_mutex_unlock(&td->mutex);
 	pthread_mutex_unlock(&root_mutex);
+}
 
-	merge_call(entry, context, prev_call);
+/* Requires root_mutex and td->mutex */
+static void fold_thread_data(profile_thread_data *td)
+{
+	for (size_t i = 0; i < td->roots.num; i++) {
+		profile_thread_root *root = &td->roots.array[i];
+		fold_entry(get_root_entry(root->name)->entry, &root->entry);
+	}
+}
 
-	pthread_mutex_unlock(mutex);
+/* Requires root_mutex */
+static void fold_threads(void)
+{
+	for (size_t i = 0; i < thread_datas.num;) {
+		profile_thread_data *td = thread_datas.array[i];
+		bool exited;
+
+		pthread_mutex_lock(&td->mutex);
+		fold_thread_data(td);
+		exited = td->exited;
+		pthread_mutex_unlock(&td->mutex);
+
+		if (exited) {
+			da_erase(thread_datas, i);
+			free_thread_data(td);
+		} else {
+			i++;
+		}
+	}
+}
+
+static void merge_context(profile_call *context)
+{
+	if (!os_atomic_load_bool(&enabled)) {
+		thread_enabled = false;
+		free_call_context(context);
+		return;
+	}
+
+	profile_thread_data *td = get_thread_data();
 
-	free_call_context(prev_call);
+	/* Only contended while a snapshot folds this thread's table */
+	pthread_mutex_lock(&td->mutex);
+	if (td->detached) {
+		pthread_mutex_unlock(&td->mutex);
+		reattach_thread_data(td);
+		pthread_mutex_lock(&td->mutex);
+	}
+
+	profile_thread_root *root = find_thread_root(td, context->name);
+	if (!root && !td->detached) {
+		pthread_mutex_unlock(&td->mutex);
+		root = add_thread_root(td, context->name);
+	}
+
+	if (root) {
+		merge_call(&root->entry, context, root->prev_start_time);
+		root->prev_start_time = context->start_time;
+	}
+	pthread_mutex_unlock(&td->mutex);
+
+	free_call_context(context);
 }
 
 void profile_start(const char *name)
@@ -767,31 +985,40 @@ static void free_profile_entry(profile_entry *entry)
 void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
+	DARRAY(profile_thread_data *) old_thread_datas = {0};
 
 	pthread_mutex_lock(&root_mutex);
-	enabled = false;
+	os_atomic_store_bool(&enabled, false);
 	da_move(old_root_entries, root_entries);
+	da_move(old_thread_datas, thread_datas);
 	pthread_mutex_unlock(&root_mutex);
 
-	for (size_t i = 0; i < old_root_entries.num; i++) {
-		profile_root_entry *entry = &old_root_entries.array[i];
+	for (size_t i = 0; i < old_thread_datas.num; i++) {
+		profile_thread_data *td = old_thread_datas.array[i];
+		bool exited;
 
-		pthread_mutex_lock(entry->mutex);
-		pthread_mutex_unlock(entry->mutex);
+		pthread_mutex_lock(&td->mutex);
+		exited = td->exited;
+		if (!exited) {
+			/* the owning thread frees the table itself on exit */
+			free_thread_roots(td);
+			td->detached = true;
+		}
+		pthread_mutex_unlock(&td->mutex);
 
-		pthread_mutex_destroy(entry->mutex);
-		bfree(entry->mutex);
-		entry->mutex = NULL;
+		if (exited)
+			free_thread_data(td);
+	}
 
-		free_call_context(entry->prev_call);
+	for (size_t i = 0; i < old_root_entries.num; i++) {
+		profile_root_entry *entry = &old_root_entries.array[i];
 
 		free_profile_entry(entry->entry);
 		bfree(entry->entry);
 	}
 
+	da_free(old_thread_datas);
 	da_free(old_root_entries);
-
-	pthread_mutex_destroy(&root_mutex);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -888,12 +1115,11 @@ profiler_snapshot_t *profile_snapshot_create(void)
 	profiler_snapshot_t *snap = bzalloc(sizeof(profiler_snapshot_t));
 
 	pthread_mutex_lock(&root_mutex);
+	fold_threads();
+
 	da_reserve(snap->roots, root_entries.num);
-	for (size_t i = 0; i < root_entries.num; i++) {
-		pthread_mutex_lock(root_entries.array[i].mutex);
+	for (size_t i = 0; i < root_entries.num; i++)
 		add_entry_to_snapshot(root_entries.array[i].entry, da_push_back_new(snap->roots));
-		pthread_mutex_unlock(root_entries.array[i].mutex);
-	}
 	pthread_mutex_unlock(&root_mutex);
 
 	for (size_t i = 0; i < snap->roots.num; i++)
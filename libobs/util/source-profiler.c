@@ -69,6 +69,15 @@ struct profiler_entry {
 	struct ucirclebuf async_frame_ts;
 	/* Timestamps of last N async frames rendered */
 	struct ucirclebuf async_rendered_ts;
+	/* Audio values are submitted from the audio thread and source output
+	 * threads while only holding the read lock */
+	pthread_mutex_t audio_mutex;
+	/* Time spent in audio filters for last N audio packets */
+	struct ucirclebuf audio_filter;
+	/* Amount of buffered audio at last N audio ticks, in ns */
+	struct ucirclebuf audio_buffered;
+	/* Number of audio frames dropped since profiling started */
+	uint64_t audio_dropped;
 
 	UT_hash_handle hh;
 };
@@ -174,6 +183,9 @@ static struct profiler_entry *entry_create(const uintptr_t key)
 	ucirclebuf_init(&ent->render_gpu_sum, profiler_samples);
 	ucirclebuf_init(&ent->async_frame_ts, profiler_samples);
 	ucirclebuf_init(&ent->async_rendered_ts, profiler_samples);
+	ucirclebuf_init(&ent->audio_filter, profiler_samples);
+	ucirclebuf_init(&ent->audio_buffered, profiler_samples);
+	pthread_mutex_init(&ent->audio_mutex, NULL);
 	return ent;
 }
 
@@ -186,6 +198,9 @@ static void entry_destroy(struct profiler_entry *entry)
 	ucirclebuf_free(&entry->render_gpu_sum);
 	ucirclebuf_free(&entry->async_frame_ts);
 	ucirclebuf_free(&entry->async_rendered_ts);
+	ucirclebuf_free(&entry->audio_filter);
+	ucirclebuf_free(&entry->audio_buffered);
+	pthread_mutex_destroy(&entry->audio_mutex);
 	bfree(entry);
 }
 
@@ -412,6 +427,70 @@ void source_profiler_async_frame_received(obs_source_t *source)
 	pthread_rwlock_unlock(&hm_rwlock);
 }
 
+uint64_t source_profiler_audio_filter_start(void)
+{
+	if (!enabled)
+		return 0;
+
+	return os_gettime_ns();
+}
+
+void source_profiler_audio_filter_end(obs_source_t *source, uint64_t start)
+{
+	if (!enabled || !start)
+		return;
+
+	const uint64_t delta = os_gettime_ns() - start;
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent) {
+		pthread_mutex_lock(&ent->audio_mutex);
+		ucirclebuf_push(&ent->audio_filter, delta);
+		pthread_mutex_unlock(&ent->audio_mutex);
+	}
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
+void source_profiler_audio_buffered(obs_source_t *source, uint64_t buffered_ns)
+{
+	if (!enabled)
+		return;
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent) {
+		pthread_mutex_lock(&ent->audio_mutex);
+		ucirclebuf_push(&ent->audio_buffered, buffered_ns);
+		pthread_mutex_unlock(&ent->audio_mutex);
+	}
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
+void source_profiler_audio_dropped(obs_source_t *source, size_t frames)
+{
+	if (!enabled)
+		return;
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent) {
+		pthread_mutex_lock(&ent->audio_mutex);
+		ent->audio_dropped += frames;
+		pthread_mutex_unlock(&ent->audio_mutex);
+	}
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
 uint64_t source_profiler_source_tick_start(void)
 {
 	if (!enabled)
@@ -487,7 +566,7 @@ static void task_delete_source(void *key)
 		source_samples_destroy(smp);
 	}
 
-	pthread_rwlock_rdlock(&hm_rwlock);
+	pthread_rwlock_wrlock(&hm_rwlock);
 	struct profiler_entry *ent = NULL;
 	HASH_FIND_PTR(hm_entries, &key, ent);
 	if (ent) {
@@ -560,6 +639,31 @@ static inline void calculate_render(struct profiler_entry *ent, struct profiler_
 	}
 }
 
+static inline void calculate_avg_max(const struct ucirclebuf *samples, uint64_t *avg, uint64_t *max)
+{
+	uint64_t sum = 0;
+
+	for (size_t idx = 0; idx < samples->num; idx++) {
+		const uint64_t val = samples->array[idx];
+		if (val > *max)
+			*max = val;
+
+		sum += val;
+	}
+
+	if (samples->num)
+		*avg = sum / samples->num;
+}
+
+static inline void calculate_audio(struct profiler_entry *ent, struct profiler_audio_result *result)
+{
+	pthread_mutex_lock(&ent->audio_mutex);
+	calculate_avg_max(&ent->audio_filter, &result->filter_avg, &result->filter_max);
+	calculate_avg_max(&ent->audio_buffered, &result->buffered_avg, &result->buffered_max);
+	result->dropped = ent->audio_dropped;
+	pthread_mutex_unlock(&ent->audio_mutex);
+}
+
 static inline void calculate_fps(const struct ucirclebuf *frames, double *avg, uint64_t *best, uint64_t *worst)
 {
 	uint64_t deltas = 0, delta_sum = 0, best_delta = 0, worst_delta = 0;
@@ -619,6 +723,25 @@ bool source_profiler_fill_result(obs_source_t *source, struct profiler_result *r
 	return !!ent;
 }
 
+bool source_profiler_fill_audio_result(obs_source_t *source, struct profiler_audio_result *result)
+{
+	if (!enabled || !result)
+		return false;
+
+	memset(result, 0, sizeof(struct profiler_audio_result));
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent = NULL;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		calculate_audio(ent, result);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+
+	return !!ent;
+}
+
 profiler_result_t *source_profiler_get_result(obs_source_t *source)
 {
 	profiler_result_t *ret = bmalloc(sizeof(profiler_result_t));
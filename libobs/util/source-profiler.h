@@ -51,6 +51,19 @@ typedef struct profiler_result {
 	uint64_t async_rendered_worst;
 } profiler_result_t;
 
+typedef struct profiler_audio_result {
+	/* Average and max time spent in audio filters per packet in ns */
+	uint64_t filter_avg;
+	uint64_t filter_max;
+
+	/* Average and max amount of audio buffered for the source in ns */
+	uint64_t buffered_avg;
+	uint64_t buffered_max;
+
+	/* Number of audio frames dropped since profiling was enabled */
+	uint64_t dropped;
+} profiler_audio_result_t;
+
 /* Enable/disable profiler (applied on next frame) */
 EXPORT void source_profiler_enable(bool enable);
 /* Enable/disable GPU profiling (applied on next frame) */
@@ -60,6 +73,8 @@ EXPORT void source_profiler_gpu_enable(bool enable);
 EXPORT profiler_result_t *source_profiler_get_result(obs_source_t *source);
 /* Update existing profiler results object for source */
 EXPORT bool source_profiler_fill_result(obs_source_t *source, profiler_result_t *result);
+/* Update existing audio profiler results object for source */
+EXPORT bool source_profiler_fill_audio_result(obs_source_t *source, profiler_audio_result_t *result);
 
 #ifdef __cplusplus
 }
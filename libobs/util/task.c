@@ -2,6 +2,7 @@
 #include "bmem.h"
 #include "threading.h"
 #include "deque.h"
+#include "platform.h"
 
 struct os_task_queue {
 	pthread_t thread;
@@ -162,3 +163,376 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+/* task pool                                                                 */
+
+/* ids carry the index of the worker that owns the task in their top bits */
+#define WORKER_ID_SHIFT 48
+
+struct pool_task {
+	os_task_t task;
+	void *param;
+	uint64_t id;
+	uint64_t queued_ts;
+};
+
+struct pool_worker {
+	struct os_task_pool *pool;
+	pthread_t thread;
+	size_t idx;
+
+	pthread_mutex_t mutex;
+	struct deque tasks[OS_TASK_PRIORITY_COUNT];
+	uint64_t next_id;
+
+	uint64_t completed;
+	uint64_t canceled;
+	uint64_t stolen;
+	uint64_t wait_ns;
+	uint64_t max_wait_ns;
+	uint64_t run_ns;
+};
+
+struct os_task_pool {
+	struct pool_worker *workers;
+	size_t num_workers;
+	size_t num_threads;
+
+	os_sem_t *sem;
+	volatile bool stop;
+
+	/* set while nothing is queued or running, checked and changed under
+	 * idle_mutex so that it is never left set behind a new task */
+	pthread_mutex_t idle_mutex;
+	os_event_t *idle_event;
+
+	volatile long next_worker;
+	volatile long queued[OS_TASK_PRIORITY_COUNT];
+	volatile long running;
+};
+
+static THREAD_LOCAL struct pool_worker *cur_worker = NULL;
+
+static inline bool tasks_pending(struct os_task_pool *pool)
+{
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++) {
+		if (os_atomic_load_long(&pool->queued[i]) > 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void signal_if_idle(struct os_task_pool *pool)
+{
+	pthread_mutex_lock(&pool->idle_mutex);
+	if (!tasks_pending(pool) && os_atomic_load_long(&pool->running) == 0)
+		os_event_signal(pool->idle_event);
+	pthread_mutex_unlock(&pool->idle_mutex);
+}
+
+/* canceled tasks stay in the queue with a NULL task and are skipped here */
+static bool pop_task(struct pool_worker *owner, size_t priority, struct pool_task *pt)
+{
+	struct os_task_pool *pool = owner->pool;
+	struct deque *tasks = &owner->tasks[priority];
+	bool found = false;
+
+	pthread_mutex_lock(&owner->mutex);
+	while (!found && tasks->size) {
+		deque_pop_front(tasks, pt, sizeof(*pt));
+		found = pt->task != NULL;
+	}
+
+	/* counted as running before it stops being queued, so that waiting
+	 * never sees an idle pool in between */
+	if (found) {
+		os_atomic_inc_long(&pool->running);
+		os_atomic_dec_long(&pool->queued[priority]);
+	}
+	pthread_mutex_unlock(&owner->mutex);
+
+	return found;
+}
+
+static bool find_task(struct pool_worker *worker, struct pool_task *pt, bool *stolen)
+{
+	struct os_task_pool *pool = worker->pool;
+
+	for (size_t priority = 0; priority < OS_TASK_PRIORITY_COUNT; priority++) {
+		if (os_atomic_load_long(&pool->queued[priority]) <= 0)
+			continue;
+
+		for (size_t i = 0; i < pool->num_workers; i++) {
+			struct pool_worker *owner = &pool->workers[(worker->idx + i) % pool->num_workers];
+
+			if (pop_task(owner, priority, pt)) {
+				*stolen = i != 0;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static void *task_pool_thread(void *param)
+{
+	struct pool_worker *worker = param;
+	struct os_task_pool *pool = worker->pool;
+
+	cur_worker = worker;
+	os_set_thread_name("task pool worker");
+
+	while (os_sem_wait(pool->sem) == 0) {
+		struct pool_task pt;
+		bool stolen = false;
+		bool found;
+
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		/* another worker may have taken the task we woke up for while a
+		 * newer one was queued behind our scan.  pass the wakeup on so
+		 * that the newer one isn't left without a worker, nothing left
+		 * means it was canceled. */
+		found = find_task(worker, &pt, &stolen);
+		if (!found) {
+			if (tasks_pending(pool))
+				os_sem_post(pool->sem);
+			continue;
+		}
+
+		const uint64_t start = os_gettime_ns();
+		pt.task(pt.param);
+		const uint64_t end = os_gettime_ns();
+
+		const uint64_t wait_ns = start - pt.queued_ts;
+
+		pthread_mutex_lock(&worker->mutex);
+		worker->completed++;
+		worker->stolen += stolen ? 1 : 0;
+		worker->wait_ns += wait_ns;
+		worker->run_ns += end - start;
+		if (wait_ns > worker->max_wait_ns)
+			worker->max_wait_ns = wait_ns;
+		pthread_mutex_unlock(&worker->mutex);
+
+		if (os_atomic_dec_long(&pool->running) == 0)
+			signal_if_idle(pool);
+	}
+
+	return NULL;
+}
+
+static void stop_workers(struct os_task_pool *pool)
+{
+	os_atomic_set_bool(&pool->stop, true);
+
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->sem);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->workers[i].thread, NULL);
+}
+
+static void free_pool(struct os_task_pool *pool)
+{
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+
+		for (size_t j = 0; j < OS_TASK_PRIORITY_COUNT; j++)
+			deque_free(&worker->tasks[j]);
+		pthread_mutex_destroy(&worker->mutex);
+	}
+
+	if (pool->idle_event)
+		os_event_destroy(pool->idle_event);
+	pthread_mutex_destroy(&pool->idle_mutex);
+	if (pool->sem)
+		os_sem_destroy(pool->sem);
+	bfree(pool->workers);
+	bfree(pool);
+}
+
+os_task_pool_t *os_task_pool_create(size_t threads)
+{
+	struct os_task_pool *pool = bzalloc(sizeof(*pool));
+
+	if (!threads)
+		threads = 1;
+
+	pool->workers = bzalloc(sizeof(struct pool_worker) * threads);
+	pthread_mutex_init_value(&pool->idle_mutex);
+
+	if (os_sem_init(&pool->sem, 0) != 0)
+		goto fail;
+	if (pthread_mutex_init(&pool->idle_mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&pool->idle_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	os_event_signal(pool->idle_event);
+
+	for (; pool->num_workers < threads; pool->num_workers++) {
+		struct pool_worker *worker = &pool->workers[pool->num_workers];
+
+		if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+			goto fail;
+
+		worker->pool = pool;
+		worker->idx = pool->num_workers;
+	}
+
+	for (; pool->num_threads < threads; pool->num_threads++) {
+		struct pool_worker *worker = &pool->workers[pool->num_threads];
+
+		if (pthread_create(&worker->thread, NULL, task_pool_thread, worker) != 0) {
+			stop_workers(pool);
+			goto fail;
+		}
+	}
+
+	return pool;
+
+fail:
+	free_pool(pool);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_task_pool_wait(pool);
+	stop_workers(pool);
+	free_pool(pool);
+}
+
+uint64_t os_task_pool_queue_task(os_task_pool_t *pool, enum os_task_priority priority, os_task_t task, void *param)
+{
+	struct pool_worker *worker;
+
+	if (!pool || !task || priority >= OS_TASK_PRIORITY_COUNT)
+		return 0;
+
+	/* tasks queued from inside the pool stay with the worker that queued
+	 * them, others are spread over all workers */
+	if (cur_worker && cur_worker->pool == pool) {
+		worker = cur_worker;
+	} else {
+		unsigned long idx = (unsigned long)os_atomic_inc_long(&pool->next_worker);
+		worker = &pool->workers[idx % pool->num_workers];
+	}
+
+	struct pool_task pt = {
+		.task = task,
+		.param = param,
+		.queued_ts = os_gettime_ns(),
+	};
+
+	/* a worker that finishes the task before the event is reset can only
+	 * signal idle after the reset */
+	pthread_mutex_lock(&pool->idle_mutex);
+	pthread_mutex_lock(&worker->mutex);
+	pt.id = ((uint64_t)(worker->idx + 1) << WORKER_ID_SHIFT) | ++worker->next_id;
+	deque_push_back(&worker->tasks[priority], &pt, sizeof(pt));
+	os_atomic_inc_long(&pool->queued[priority]);
+	pthread_mutex_unlock(&worker->mutex);
+	os_event_reset(pool->idle_event);
+	pthread_mutex_unlock(&pool->idle_mutex);
+
+	os_sem_post(pool->sem);
+	return pt.id;
+}
+
+bool os_task_pool_cancel(os_task_pool_t *pool, uint64_t id)
+{
+	if (!pool)
+		return false;
+
+	const size_t idx = (size_t)(id >> WORKER_ID_SHIFT);
+	if (!idx || idx > pool->num_workers)
+		return false;
+
+	struct pool_worker *worker = &pool->workers[idx - 1];
+	bool canceled = false;
+
+	pthread_mutex_lock(&worker->mutex);
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT && !canceled; i++) {
+		struct deque *tasks = &worker->tasks[i];
+
+		for (size_t pos = 0; pos < tasks->size; pos += sizeof(struct pool_task)) {
+			struct pool_task *pt = deque_data(tasks, pos);
+			if (pt->id != id || !pt->task)
+				continue;
+
+			pt->task = NULL;
+			os_atomic_dec_long(&pool->queued[i]);
+			worker->canceled++;
+			canceled = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (canceled)
+		signal_if_idle(pool);
+
+	return canceled;
+}
+
+bool os_task_pool_wait(os_task_pool_t *pool)
+{
+	if (!pool || os_task_pool_inside(pool))
+		return false;
+
+	while (tasks_pending(pool) || os_atomic_load_long(&pool->running) > 0)
+		os_event_wait(pool->idle_event);
+
+	return true;
+}
+
+bool os_task_pool_inside(os_task_pool_t *pool)
+{
+	return pool && cur_worker && cur_worker->pool == pool;
+}
+
+void os_task_pool_get_stats(os_task_pool_t *pool, struct os_task_pool_stats *stats)
+{
+	uint64_t wait_ns = 0;
+	uint64_t run_ns = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!pool)
+		return;
+
+	stats->threads = pool->num_threads;
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++) {
+		long queued = os_atomic_load_long(&pool->queued[i]);
+		stats->queued[i] = queued > 0 ? (size_t)queued : 0;
+	}
+
+	long running = os_atomic_load_long(&pool->running);
+	stats->running = running > 0 ? (size_t)running : 0;
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+
+		pthread_mutex_lock(&worker->mutex);
+		stats->completed += worker->completed;
+		stats->canceled += worker->canceled;
+		stats->stolen += worker->stolen;
+		wait_ns += worker->wait_ns;
+		run_ns += worker->run_ns;
+		if (worker->max_wait_ns > stats->max_wait_ns)
+			stats->max_wait_ns = worker->max_wait_ns;
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	if (stats->completed) {
+		stats->avg_wait_ns = wait_ns / stats->completed;
+		stats->avg_run_ns = run_ns / stats->completed;
+	}
+}
@@ -17,6 +17,52 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* ------------------------------------------------------------------------- */
+/* Task pool: multiple worker threads, each with its own queue per priority.
+ * Idle workers steal tasks from the queues of busy workers, higher priority
+ * tasks always run first.  Tasks may run in any order within a priority. */
+
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+enum os_task_priority {
+	OS_TASK_PRIORITY_HIGH,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_COUNT,
+};
+
+struct os_task_pool_stats {
+	size_t threads;
+	size_t queued[OS_TASK_PRIORITY_COUNT];
+	size_t running;
+
+	uint64_t completed;
+	uint64_t canceled;
+	uint64_t stolen;
+
+	/* time between queueing and the start of a task */
+	uint64_t avg_wait_ns;
+	uint64_t max_wait_ns;
+	uint64_t avg_run_ns;
+};
+
+EXPORT os_task_pool_t *os_task_pool_create(size_t threads);
+EXPORT void os_task_pool_destroy(os_task_pool_t *pool);
+
+/** Returns an id for os_task_pool_cancel, or 0 on failure */
+EXPORT uint64_t os_task_pool_queue_task(os_task_pool_t *pool, enum os_task_priority priority, os_task_t task,
+					void *param);
+
+/** Removes a task that has not started yet.  If this returns true the task
+ * will never run, and any resources held by its param are the caller's. */
+EXPORT bool os_task_pool_cancel(os_task_pool_t *pool, uint64_t id);
+
+/** Waits until all queued tasks have finished.  Fails from inside the pool. */
+EXPORT bool os_task_pool_wait(os_task_pool_t *pool);
+EXPORT bool os_task_pool_inside(os_task_pool_t *pool);
+EXPORT void os_task_pool_get_stats(os_task_pool_t *pool, struct os_task_pool_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -152,8 +152,9 @@ int os_event_signal(os_event_t *event)
 {
 	int code = 0;
 
+	/* a manual event releases every waiter, like it does on Windows */
 	pthread_mutex_lock(&event->mutex);
-	code = pthread_cond_signal(&event->cond);
+	code = event->manual ? pthread_cond_broadcast(&event->cond) : pthread_cond_signal(&event->cond);
 	event->signalled = true;
 	pthread_mutex_unlock(&event->mutex);
 
@@ -4,7 +4,6 @@
 #include <util/platform.h>
 #include <util/darray.h>
 #include <util/dstr.h>
-#include <util/task.h>
 
 #include <inttypes.h>
 
@@ -124,7 +123,6 @@ struct slideshow {
 	obs_source_t *source;
 
 	struct slideshow_data data;
-	os_task_queue_t *queue;
 	obs_source_t *transition;
 	uint32_t cx;
 	uint32_t cy;
@@ -294,7 +292,7 @@ static void decode_image(void *data)
 }
 
 /* creates source from a file path. only used in get_new_source(). */
-static inline obs_source_t *create_source_from_file(struct slideshow *ss, const char *file, bool now)
+static inline obs_source_t *create_source_from_file(const char *file, bool now)
 {
 	obs_data_t *settings = obs_data_create();
 	obs_source_t *source;
@@ -306,7 +304,7 @@ static inline obs_source_t *create_source_from_file(struct slideshow *ss, const
 
 	obs_data_release(settings);
 
-	os_task_queue_queue_task(ss->queue, decode_image, obs_source_get_weak_source(source));
+	obs_queue_task(OBS_TASK_BACKGROUND, decode_image, obs_source_get_weak_source(source), false);
 
 	return source;
 }
@@ -365,7 +363,7 @@ static struct source_data get_new_source(struct slideshow *ss, struct active_sli
 
 	sd.path = ssd->files.array[slide_idx].path;
 	sd.slide_idx = slide_idx;
-	sd.source = create_source_from_file(ss, sd.path, false);
+	sd.source = create_source_from_file(sd.path, false);
 	return sd;
 }
 
@@ -769,7 +767,6 @@ static void ss_destroy(void *data)
 {
 	struct slideshow *ss = data;
 
-	os_task_queue_destroy(ss->queue);
 	obs_source_release(ss->transition);
 	free_slideshow_data(&ss->data);
 	bfree(ss);
@@ -786,8 +783,6 @@ static void *ss_create(obs_data_t *settings, obs_source_t *source)
 	ss->data.paused = false;
 	ss->data.stop = false;
 
-	ss->queue = os_task_queue_create();
-
 	ss->play_pause_hotkey = obs_hotkey_register_source(
 		source, "SlideShow.PlayPause", obs_module_text("SlideShow.PlayPause"), play_pause_hotkey, ss);
 
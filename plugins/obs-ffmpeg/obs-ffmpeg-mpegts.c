@@ -682,25 +682,12 @@ static uint64_t get_packet_sys_dts(struct ffmpeg_output *output, AVPacket *packe
 
 static int mpegts_process_packet(struct ffmpeg_output *output)
 {
-	AVPacket *packet = NULL;
+	AVPacket *packet = ffmpeg_pop_packet(output);
 	int ret = 0;
 
-	pthread_mutex_lock(&output->write_mutex);
-	if (output->packets.num) {
-		packet = output->packets.array[0];
-		da_erase(output->packets, 0);
-	}
-	pthread_mutex_unlock(&output->write_mutex);
-
 	if (!packet)
 		return 0;
 
-	//blog(LOG_DEBUG,
-	//     "size = %d, flags = %lX, stream = %d, "
-	//     "packets queued: %lu",
-	//     packet->size, packet->flags, packet->stream_index,
-	//     output->packets.num);
-
 	if (stopping(output)) {
 		uint64_t sys_ts = get_packet_sys_dts(output, packet);
 		if (sys_ts >= output->stop_ts) {
@@ -709,9 +696,7 @@ static int mpegts_process_packet(struct ffmpeg_output *output)
 		}
 	}
 	output->total_bytes += packet->size;
-	uint8_t *buf = packet->data;
 	ret = av_interleaved_write_frame(output->ff_data.output, packet);
-	av_freep(&buf);
 
 	if (ret < 0) {
 		ffmpeg_mpegts_log_error(LOG_WARNING, &output->ff_data, "process_packet: Error writing packet: %s",
@@ -1012,13 +997,7 @@ static void ffmpeg_mpegts_deactivate(struct ffmpeg_output *output)
 		output->write_thread_active = false;
 	}
 
-	pthread_mutex_lock(&output->write_mutex);
-
-	for (size_t i = 0; i < output->packets.num; i++)
-		av_packet_free(output->packets.array + i);
-	da_free(output->packets);
-
-	pthread_mutex_unlock(&output->write_mutex);
+	ffmpeg_free_packets(output);
 }
 
 static uint64_t ffmpeg_mpegts_total_bytes(void *data)
@@ -1055,11 +1034,13 @@ void mpegts_write_packet(struct ffmpeg_output *stream, struct encoder_packet *en
 
 	packet = av_packet_alloc();
 
-	packet->data = av_memdup(encpacket->data, (int)encpacket->size);
-	if (packet->data == NULL) {
+	/* refcounted packets are passed on by libavformat without a copy */
+	packet->buf = ffmpeg_encoder_packet_buffer(encpacket);
+	if (packet->buf == NULL) {
 		error("Couldn't allocate packet data");
 		goto fail;
 	}
+	packet->data = packet->buf->data;
 	packet->size = (int)encpacket->size;
 	packet->stream_index = avstream->id;
 	packet->pts = rescale_ts2(avstream, codec_time_base, encpacket->pts);
@@ -1068,10 +1049,7 @@ void mpegts_write_packet(struct ffmpeg_output *stream, struct encoder_packet *en
 	if (encpacket->keyframe)
 		packet->flags = AV_PKT_FLAG_KEY;
 
-	pthread_mutex_lock(&stream->write_mutex);
-	da_push_back(stream->packets, &packet);
-	pthread_mutex_unlock(&stream->write_mutex);
-	os_sem_post(stream->write_sem);
+	ffmpeg_push_packet(stream, packet);
 	return;
 fail:
 	av_packet_free(&packet);
@@ -491,6 +491,33 @@ void ffmpeg_data_free(struct ffmpeg_data *data)
 	memset(data, 0, sizeof(struct ffmpeg_data));
 }
 
+static void release_encoder_packet(void *opaque, uint8_t *data)
+{
+	struct encoder_packet *packet = opaque;
+
+	obs_encoder_packet_release(packet);
+	bfree(packet);
+	UNUSED_PARAMETER(data);
+}
+
+/* Wraps the payload of an encoder packet without copying it.  The packet
+ * stays referenced until FFmpeg releases the last reference to the buffer. */
+AVBufferRef *ffmpeg_encoder_packet_buffer(struct encoder_packet *packet)
+{
+	struct encoder_packet *ref = bmalloc(sizeof(*ref));
+	AVBufferRef *buf;
+
+	obs_encoder_packet_ref(ref, packet);
+
+	buf = av_buffer_create(ref->data, ref->size, release_encoder_packet, ref, AV_BUFFER_FLAG_READONLY);
+	if (!buf) {
+		obs_encoder_packet_release(ref);
+		bfree(ref);
+	}
+
+	return buf;
+}
+
 static inline const char *safe_str(const char *s)
 {
 	if (s == NULL)
@@ -702,11 +729,8 @@ static void receive_video(void *param, struct video_data *frame)
 		packet->dts = rescale_ts(packet->dts, context, data->video->time_base);
 		packet->duration = (int)av_rescale_q(packet->duration, context->time_base, data->video->time_base);
 
-		pthread_mutex_lock(&output->write_mutex);
-		da_push_back(output->packets, &packet);
+		ffmpeg_push_packet(output, packet);
 		packet = NULL;
-		pthread_mutex_unlock(&output->write_mutex);
-		os_sem_post(output->write_sem);
 	} else {
 		ret = 0;
 	}
@@ -774,11 +798,7 @@ static void encode_audio(struct ffmpeg_output *output, int idx, struct AVCodecCo
 		(int)av_rescale_q(packet->duration, context->time_base, data->audio_infos[idx].stream->time_base);
 	packet->stream_index = data->audio_infos[idx].stream->index;
 
-	pthread_mutex_lock(&output->write_mutex);
-	da_push_back(output->packets, &packet);
-	pthread_mutex_unlock(&output->write_mutex);
-	os_sem_post(output->write_sem);
-
+	ffmpeg_push_packet(output, packet);
 	return;
 fail:
 	av_packet_free(&packet);
@@ -858,24 +878,12 @@ static uint64_t get_packet_sys_dts(struct ffmpeg_output *output, AVPacket *packe
 
 static int process_packet(struct ffmpeg_output *output)
 {
-	AVPacket *packet = NULL;
+	AVPacket *packet = ffmpeg_pop_packet(output);
 	int ret = 0;
 
-	pthread_mutex_lock(&output->write_mutex);
-	if (output->packets.num) {
-		packet = output->packets.array[0];
-		da_erase(output->packets, 0);
-	}
-	pthread_mutex_unlock(&output->write_mutex);
-
 	if (!packet)
 		return 0;
 
-	/*blog(LOG_DEBUG, "size = %d, flags = %lX, stream = %d, "
-			"packets queued: %lu",
-			packet.size, packet.flags,
-			packet.stream_index, output->packets.num);*/
-
 	if (stopping(output)) {
 		uint64_t sys_ts = get_packet_sys_dts(output, packet);
 		if (sys_ts >= output->stop_ts) {
@@ -1134,13 +1142,7 @@ static void ffmpeg_deactivate(struct ffmpeg_output *output)
 		output->write_thread_active = false;
 	}
 
-	pthread_mutex_lock(&output->write_mutex);
-
-	for (size_t i = 0; i < output->packets.num; i++)
-		av_packet_free(output->packets.array + i);
-	da_free(output->packets);
-
-	pthread_mutex_unlock(&output->write_mutex);
+	ffmpeg_free_packets(output);
 
 	ffmpeg_data_free(&output->ff_data);
 }
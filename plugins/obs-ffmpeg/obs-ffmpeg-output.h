@@ -108,7 +108,8 @@ struct ffmpeg_output {
 	os_sem_t *write_sem;
 	os_event_t *stop_event;
 
-	DARRAY(AVPacket *) packets;
+	/* AVPacket pointers waiting for the write thread */
+	struct deque packets;
 #ifdef NEW_MPEGTS_OUTPUT
 	/* used for SRT & RIST */
 	URLContext *h;
@@ -118,3 +119,38 @@ struct ffmpeg_output {
 };
 bool ffmpeg_data_init(struct ffmpeg_data *data, struct ffmpeg_cfg *config);
 void ffmpeg_data_free(struct ffmpeg_data *data);
+
+AVBufferRef *ffmpeg_encoder_packet_buffer(struct encoder_packet *packet);
+
+static inline void ffmpeg_push_packet(struct ffmpeg_output *output, AVPacket *packet)
+{
+	pthread_mutex_lock(&output->write_mutex);
+	deque_push_back(&output->packets, &packet, sizeof(packet));
+	pthread_mutex_unlock(&output->write_mutex);
+	os_sem_post(output->write_sem);
+}
+
+static inline AVPacket *ffmpeg_pop_packet(struct ffmpeg_output *output)
+{
+	AVPacket *packet = NULL;
+
+	pthread_mutex_lock(&output->write_mutex);
+	if (output->packets.size)
+		deque_pop_front(&output->packets, &packet, sizeof(packet));
+	pthread_mutex_unlock(&output->write_mutex);
+
+	return packet;
+}
+
+static inline void ffmpeg_free_packets(struct ffmpeg_output *output)
+{
+	AVPacket *packet;
+
+	pthread_mutex_lock(&output->write_mutex);
+	while (output->packets.size) {
+		deque_pop_front(&output->packets, &packet, sizeof(packet));
+		av_packet_free(&packet);
+	}
+	deque_free(&output->packets);
+	pthread_mutex_unlock(&output->write_mutex);
+}
@@ -1,7 +1,12 @@
 #include <obs-module.h>
+#include <media-io/video-frame.h>
+#include <util/darray.h>
 #include <util/deque.h>
+#include <util/threading.h>
 #include <util/util_uint64.h>
 
+#include "plane-codec.h"
+
 /* NOTE: Delaying audio shouldn't be necessary because the audio subsystem will
  * automatically sync audio to video frames */
 /* #define DELAY_AUDIO */
@@ -15,8 +20,37 @@
 #endif
 
 #define SETTING_DELAY_MS "delay_ms"
+#define SETTING_COMPRESS "compress"
+#define SETTING_MEMORY_BUDGET "memory_budget_mb"
 
 #define TEXT_DELAY_MS obs_module_text("DelayMs")
+#define TEXT_COMPRESS obs_module_text("CompressFrames")
+#define TEXT_MEMORY_BUDGET obs_module_text("MemoryBudget")
+
+/* rows of a plane that are coded together, strips are coded in parallel */
+#define STRIP_ROWS 32
+#define MAX_HELPERS 16
+
+/* a delayed frame in compressed form, followed by num_strips + 1 strip
+ * offsets and the strip data */
+struct packed_frame {
+	struct obs_source_frame info;
+	int shift;
+	size_t num_strips; /* 0 if dropped to stay within the memory budget */
+	size_t alloc_size;
+};
+
+struct strip_job {
+	uint8_t *pixels;
+	size_t linesize;
+	size_t width;
+	size_t rows;
+	size_t step;
+	size_t sample_size;
+	uint8_t *data;
+	size_t size;
+	bool failed;
+};
 
 struct async_delay_data {
 	obs_source_t *context;
@@ -24,6 +58,29 @@ struct async_delay_data {
 	/* contains struct obs_source_frame* */
 	struct deque video_frames;
 
+	/* contains struct packed_frame* */
+	struct deque packed_frames;
+
+	/* guards the frame queues and memory_usage */
+	pthread_mutex_t mutex;
+	uint64_t memory_usage;
+
+	bool compress;
+	bool compressing;
+	struct obs_source_frame last_frame;
+	uint64_t memory_budget;
+	int shift;
+	uint64_t shift_ts;
+
+	DARRAY(struct strip_job) jobs;
+	uint8_t *scratch;
+	size_t scratch_size;
+	bool decoding;
+	int job_shift;
+	volatile long next_job;
+	volatile long active_helpers;
+	os_event_t *jobs_done;
+
 #ifdef DELAY_AUDIO
 	/* stores the audio data */
 	struct deque audio_frames;
@@ -46,14 +103,48 @@ static const char *async_delay_filter_name(void *unused)
 	return obs_module_text("AsyncDelayFilter");
 }
 
+static size_t frame_data_size(const struct obs_source_frame *frame)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	size_t size = 0;
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		size += (size_t)frame->linesize[i] * heights[i];
+	return size;
+}
+
+/* the parent's async mutex can be held while filtering, so frames are
+ * released after the queues have been taken out of the filter */
 static void free_video_data(struct async_delay_data *filter, obs_source_t *parent)
 {
-	while (filter->video_frames.size) {
+	struct deque frames;
+	struct deque packed_frames;
+
+	pthread_mutex_lock(&filter->mutex);
+	frames = filter->video_frames;
+	packed_frames = filter->packed_frames;
+	memset(&filter->video_frames, 0, sizeof(filter->video_frames));
+	memset(&filter->packed_frames, 0, sizeof(filter->packed_frames));
+	filter->memory_usage = 0;
+	pthread_mutex_unlock(&filter->mutex);
+
+	while (frames.size) {
 		struct obs_source_frame *frame;
 
-		deque_pop_front(&filter->video_frames, &frame, sizeof(struct obs_source_frame *));
+		deque_pop_front(&frames, &frame, sizeof(struct obs_source_frame *));
 		obs_source_release_frame(parent, frame);
 	}
+
+	while (packed_frames.size) {
+		struct packed_frame *packed;
+
+		deque_pop_front(&packed_frames, &packed, sizeof(struct packed_frame *));
+		bfree(packed);
+	}
+
+	deque_free(&frames);
+	deque_free(&packed_frames);
 }
 
 #ifdef DELAY_AUDIO
@@ -79,13 +170,16 @@ static void async_delay_filter_update(void *data, obs_data_t *settings)
 {
 	struct async_delay_data *filter = data;
 	uint64_t new_interval = (uint64_t)obs_data_get_int(settings, SETTING_DELAY_MS) * MSEC_TO_NSEC;
+	bool compress = obs_data_get_bool(settings, SETTING_COMPRESS);
 
-	if (new_interval < filter->interval)
+	if (new_interval < filter->interval || compress != filter->compress)
 		free_video_data(filter, obs_filter_get_parent(filter->context));
 
 	filter->reset_audio = true;
 	filter->reset_video = true;
 	filter->interval = new_interval;
+	filter->compress = compress;
+	filter->memory_budget = (uint64_t)obs_data_get_int(settings, SETTING_MEMORY_BUDGET) * 1024 * 1024;
 	filter->video_delay_reached = false;
 	filter->audio_delay_reached = false;
 }
@@ -96,6 +190,8 @@ static void *async_delay_filter_create(obs_data_t *settings, obs_source_t *conte
 	struct obs_audio_info oai;
 
 	filter->context = context;
+	pthread_mutex_init(&filter->mutex, NULL);
+	os_event_init(&filter->jobs_done, OS_EVENT_TYPE_AUTO);
 	async_delay_filter_update(filter, settings);
 
 	obs_get_audio_info(&oai);
@@ -108,7 +204,19 @@ static void async_delay_filter_destroy(void *data)
 {
 	struct async_delay_data *filter = data;
 
+	while (filter->packed_frames.size) {
+		struct packed_frame *packed;
+
+		deque_pop_front(&filter->packed_frames, &packed, sizeof(struct packed_frame *));
+		bfree(packed);
+	}
+
 	deque_free(&filter->video_frames);
+	deque_free(&filter->packed_frames);
+	pthread_mutex_destroy(&filter->mutex);
+	os_event_destroy(filter->jobs_done);
+	da_free(filter->jobs);
+	bfree(filter->scratch);
 #ifdef DELAY_AUDIO
 	free_audio_packet(&filter->audio_output);
 	deque_free(&filter->audio_frames);
@@ -116,6 +224,15 @@ static void async_delay_filter_destroy(void *data)
 	bfree(data);
 }
 
+static bool compress_changed(obs_properties_t *props, obs_property_t *p, obs_data_t *settings)
+{
+	obs_property_t *budget = obs_properties_get(props, SETTING_MEMORY_BUDGET);
+	obs_property_set_visible(budget, obs_data_get_bool(settings, SETTING_COMPRESS));
+
+	UNUSED_PARAMETER(p);
+	return true;
+}
+
 static obs_properties_t *async_delay_filter_properties(void *data)
 {
 	obs_properties_t *props = obs_properties_create();
@@ -123,10 +240,33 @@ static obs_properties_t *async_delay_filter_properties(void *data)
 	obs_property_t *p = obs_properties_add_int(props, SETTING_DELAY_MS, TEXT_DELAY_MS, 0, 20000, 1);
 	obs_property_int_set_suffix(p, " ms");
 
+	p = obs_properties_add_bool(props, SETTING_COMPRESS, TEXT_COMPRESS);
+	obs_property_set_modified_callback(p, compress_changed);
+
+	p = obs_properties_add_int(props, SETTING_MEMORY_BUDGET, TEXT_MEMORY_BUDGET, 64, 65536, 64);
+	obs_property_int_set_suffix(p, " MB");
+
 	UNUSED_PARAMETER(data);
 	return props;
 }
 
+static void async_delay_filter_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, SETTING_MEMORY_BUDGET, 2048);
+}
+
+static uint64_t async_delay_filter_memory_usage(void *data)
+{
+	struct async_delay_data *filter = data;
+	uint64_t usage;
+
+	pthread_mutex_lock(&filter->mutex);
+	usage = filter->memory_usage;
+	pthread_mutex_unlock(&filter->mutex);
+
+	return usage;
+}
+
 static void async_delay_filter_remove(void *data, obs_source_t *parent)
 {
 	struct async_delay_data *filter = data;
@@ -146,6 +286,358 @@ static inline bool is_timestamp_jump(uint64_t ts, uint64_t prev_ts)
 	return ts < prev_ts || (ts - prev_ts) > SEC_TO_NSEC;
 }
 
+/* -------------------------------------------------------- */
+/* compressed frames                                        */
+
+/* distance in bytes between neighbouring samples of a component */
+static size_t plane_step(enum video_format format, size_t plane)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+		return plane ? 2 : 1;
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+		return plane ? 4 : 2;
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_I210:
+	case VIDEO_FORMAT_I412:
+	case VIDEO_FORMAT_YA2L:
+		return 2;
+	case VIDEO_FORMAT_BGR3:
+		return 3;
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_AYUV:
+	case VIDEO_FORMAT_V210:
+	case VIDEO_FORMAT_R10L:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+/* bytes per little-endian sample whose low bits can be dropped, 0 where the
+ * low bits are padding (P010, P216, P416) or samples span bytes (V210, R10L) */
+static size_t plane_sample_size(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_I210:
+	case VIDEO_FORMAT_I412:
+	case VIDEO_FORMAT_YA2L:
+		return 2;
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+	case VIDEO_FORMAT_V210:
+	case VIDEO_FORMAT_R10L:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+static inline uint32_t *packed_offsets(struct packed_frame *packed)
+{
+	return (uint32_t *)(packed + 1);
+}
+
+static inline uint8_t *packed_data(struct packed_frame *packed)
+{
+	return (uint8_t *)(packed_offsets(packed) + packed->num_strips + 1);
+}
+
+static bool same_layout(const struct obs_source_frame *a, const struct obs_source_frame *b)
+{
+	if (a->format != b->format || a->width != b->width || a->height != b->height)
+		return false;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (a->linesize[i] != b->linesize[i])
+			return false;
+	}
+	return true;
+}
+
+static void copy_frame_properties(struct obs_source_frame *dst, const struct obs_source_frame *src)
+{
+	dst->timestamp = src->timestamp;
+	memcpy(dst->color_matrix, src->color_matrix, sizeof(dst->color_matrix));
+	dst->full_range = src->full_range;
+	dst->max_luminance = src->max_luminance;
+	memcpy(dst->color_range_min, src->color_range_min, sizeof(dst->color_range_min));
+	memcpy(dst->color_range_max, src->color_range_max, sizeof(dst->color_range_max));
+	dst->flip = src->flip;
+	dst->flags = src->flags;
+	dst->trc = src->trc;
+}
+
+static void setup_strips(struct async_delay_data *filter, struct obs_source_frame *frame)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+	da_resize(filter->jobs, 0);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (!frame->data[i])
+			continue;
+
+		for (size_t row = 0; row < heights[i]; row += STRIP_ROWS) {
+			struct strip_job *job = da_push_back_new(filter->jobs);
+			job->pixels = frame->data[i] + row * frame->linesize[i];
+			job->linesize = frame->linesize[i];
+			job->width = frame->linesize[i];
+			job->rows = heights[i] - row < STRIP_ROWS ? heights[i] - row : STRIP_ROWS;
+			job->step = plane_step(frame->format, i);
+			job->sample_size = plane_sample_size(frame->format);
+			if (!job->sample_size)
+				job->sample_size = 1;
+		}
+	}
+}
+
+static void run_strips(struct async_delay_data *filter)
+{
+	for (;;) {
+		const size_t i = (size_t)os_atomic_inc_long(&filter->next_job) - 1;
+		if (i >= filter->jobs.num)
+			break;
+
+		struct strip_job *job = &filter->jobs.array[i];
+		if (filter->decoding)
+			job->failed = !plane_decode(job->pixels, job->linesize, job->data, job->size, job->width,
+						    job->rows, job->step, job->sample_size, filter->job_shift);
+		else
+			job->size = plane_encode(job->data, job->pixels, job->linesize, job->width, job->rows,
+						 job->step, job->sample_size, filter->job_shift);
+	}
+}
+
+static void strip_task(void *param)
+{
+	struct async_delay_data *filter = param;
+
+	run_strips(filter);
+	if (os_atomic_dec_long(&filter->active_helpers) == 0)
+		os_event_signal(filter->jobs_done);
+}
+
+/* codes the strips on the background task pool while the calling thread
+ * helps out, helpers that haven't started yet are cancelled at the end */
+static void code_strips(struct async_delay_data *filter, bool decoding, int shift)
+{
+	struct os_task_pool_stats stats = {0};
+	uint64_t ids[MAX_HELPERS] = {0};
+	size_t helpers;
+
+	obs_get_background_task_stats(&stats);
+	helpers = stats.threads < MAX_HELPERS ? stats.threads : MAX_HELPERS;
+	if (helpers >= filter->jobs.num)
+		helpers = filter->jobs.num ? filter->jobs.num - 1 : 0;
+
+	filter->decoding = decoding;
+	filter->job_shift = shift;
+	os_atomic_set_long(&filter->next_job, 0);
+	os_atomic_set_long(&filter->active_helpers, (long)helpers + 1);
+
+	for (size_t i = 0; i < helpers; i++) {
+		ids[i] = obs_queue_background_task(OS_TASK_PRIORITY_HIGH, strip_task, filter);
+		if (!ids[i])
+			os_atomic_dec_long(&filter->active_helpers);
+	}
+
+	run_strips(filter);
+
+	for (size_t i = 0; i < helpers; i++) {
+		if (ids[i] && obs_cancel_background_task(ids[i]))
+			os_atomic_dec_long(&filter->active_helpers);
+	}
+
+	if (os_atomic_dec_long(&filter->active_helpers) != 0)
+		os_event_wait(filter->jobs_done);
+}
+
+/* drops precision of new frames when the frames of a full delay would exceed
+ * the memory budget, and restores it when there is room again */
+static void update_precision(struct async_delay_data *filter, enum video_format format, uint64_t ts)
+{
+	const int max_shift = plane_sample_size(format) ? PLANE_CODEC_MAX_SHIFT : 0;
+	struct packed_frame *oldest;
+	uint64_t oldest_ts = ts;
+	uint64_t usage;
+
+	if (filter->shift > max_shift)
+		filter->shift = max_shift;
+
+	if (ts - filter->shift_ts < SEC_TO_NSEC)
+		return;
+
+	pthread_mutex_lock(&filter->mutex);
+	usage = filter->memory_usage;
+	if (filter->packed_frames.size) {
+		deque_peek_front(&filter->packed_frames, &oldest, sizeof(struct packed_frame *));
+		oldest_ts = oldest->info.timestamp;
+	}
+	pthread_mutex_unlock(&filter->mutex);
+
+	if (ts <= oldest_ts)
+		return;
+
+	const uint64_t projected = util_mul_div64(usage, filter->interval, ts - oldest_ts);
+	const uint64_t budget = filter->memory_budget;
+
+	if (projected > budget - budget / 8 && filter->shift < max_shift)
+		filter->shift++;
+	else if (projected < budget / 2 && filter->shift > 0)
+		filter->shift--;
+	else
+		return;
+
+	filter->shift_ts = ts;
+	blog(LOG_DEBUG, "[async delay: '%s'] %d bits of precision dropped to stay within %d MB",
+	     obs_source_get_name(filter->context), filter->shift, (int)(budget / (1024 * 1024)));
+}
+
+static struct packed_frame *pack_frame(struct async_delay_data *filter, struct obs_source_frame *frame)
+{
+	struct packed_frame *packed;
+	size_t bound = 0;
+	size_t total = 0;
+	size_t alloc_size;
+	uint64_t usage;
+
+	update_precision(filter, frame->format, frame->timestamp);
+	setup_strips(filter, frame);
+
+	for (size_t i = 0; i < filter->jobs.num; i++)
+		bound += plane_encode_bound(filter->jobs.array[i].width, filter->jobs.array[i].rows);
+
+	if (filter->scratch_size < bound) {
+		bfree(filter->scratch);
+		filter->scratch = bmalloc(bound);
+		filter->scratch_size = bound;
+	}
+
+	bound = 0;
+	for (size_t i = 0; i < filter->jobs.num; i++) {
+		struct strip_job *job = &filter->jobs.array[i];
+		job->data = filter->scratch + bound;
+		bound += plane_encode_bound(job->width, job->rows);
+	}
+
+	code_strips(filter, false, filter->shift);
+
+	for (size_t i = 0; i < filter->jobs.num; i++)
+		total += filter->jobs.array[i].size;
+
+	alloc_size = sizeof(*packed) + (filter->jobs.num + 1) * sizeof(uint32_t) + total;
+
+	pthread_mutex_lock(&filter->mutex);
+	usage = filter->memory_usage;
+	pthread_mutex_unlock(&filter->mutex);
+
+	if (usage + alloc_size > filter->memory_budget) {
+		packed = bzalloc(sizeof(*packed));
+		packed->info.timestamp = frame->timestamp;
+		packed->alloc_size = sizeof(*packed);
+		return packed;
+	}
+
+	packed = bmalloc(alloc_size);
+	packed->info = *frame;
+	memset(packed->info.data, 0, sizeof(packed->info.data));
+	packed->shift = filter->shift;
+	packed->num_strips = filter->jobs.num;
+	packed->alloc_size = alloc_size;
+
+	uint32_t *offsets = packed_offsets(packed);
+	uint8_t *data = packed_data(packed);
+
+	offsets[0] = 0;
+	for (size_t i = 0; i < filter->jobs.num; i++) {
+		const struct strip_job *job = &filter->jobs.array[i];
+		memcpy(data + offsets[i], job->data, job->size);
+		offsets[i + 1] = offsets[i] + (uint32_t)job->size;
+	}
+
+	return packed;
+}
+
+static bool unpack_frame(struct async_delay_data *filter, struct packed_frame *packed,
+			 struct obs_source_frame *frame)
+{
+	if (!packed->num_strips || !same_layout(&packed->info, frame))
+		return false;
+
+	setup_strips(filter, frame);
+	if (filter->jobs.num != packed->num_strips)
+		return false;
+
+	const uint32_t *offsets = packed_offsets(packed);
+	uint8_t *data = packed_data(packed);
+
+	for (size_t i = 0; i < filter->jobs.num; i++) {
+		struct strip_job *job = &filter->jobs.array[i];
+		job->data = data + offsets[i];
+		job->size = offsets[i + 1] - offsets[i];
+		job->failed = false;
+	}
+
+	code_strips(filter, true, packed->shift);
+
+	for (size_t i = 0; i < filter->jobs.num; i++) {
+		if (filter->jobs.array[i].failed)
+			return false;
+	}
+
+	copy_frame_properties(frame, &packed->info);
+	return true;
+}
+
+/* stores the frame compressed and decodes the delayed frame over it, so no
+ * raw frames are held back from the parent */
+static struct obs_source_frame *delay_packed_video(struct async_delay_data *filter, obs_source_t *parent,
+						   struct obs_source_frame *frame)
+{
+	struct packed_frame *packed = pack_frame(filter, frame);
+	struct packed_frame *output;
+	uint64_t cur_interval;
+
+	pthread_mutex_lock(&filter->mutex);
+	deque_push_back(&filter->packed_frames, &packed, sizeof(struct packed_frame *));
+	deque_peek_front(&filter->packed_frames, &output, sizeof(struct packed_frame *));
+	filter->memory_usage += packed->alloc_size;
+
+	cur_interval = frame->timestamp - output->info.timestamp;
+	if (!filter->video_delay_reached && cur_interval < filter->interval) {
+		pthread_mutex_unlock(&filter->mutex);
+		obs_source_release_frame(parent, frame);
+		return NULL;
+	}
+
+	deque_pop_front(&filter->packed_frames, NULL, sizeof(struct packed_frame *));
+	filter->memory_usage -= output->alloc_size;
+	pthread_mutex_unlock(&filter->mutex);
+
+	filter->video_delay_reached = true;
+
+	const bool success = unpack_frame(filter, output, frame);
+	bfree(output);
+
+	if (!success) {
+		obs_source_release_frame(parent, frame);
+		return NULL;
+	}
+
+	return frame;
+}
+
 static struct obs_source_frame *async_delay_filter_video(void *data, struct obs_source_frame *frame)
 {
 	struct async_delay_data *filter = data;
@@ -153,22 +645,35 @@ static struct obs_source_frame *async_delay_filter_video(void *data, struct obs_
 	struct obs_source_frame *output;
 	uint64_t cur_interval;
 
-	if (filter->reset_video || is_timestamp_jump(frame->timestamp, filter->last_video_ts)) {
+	if (filter->reset_video || is_timestamp_jump(frame->timestamp, filter->last_video_ts) ||
+	    (filter->compressing && filter->packed_frames.size && !same_layout(frame, &filter->last_frame))) {
 		free_video_data(filter, parent);
 		filter->video_delay_reached = false;
 		filter->reset_video = false;
+		filter->compressing = filter->compress;
 	}
 
 	filter->last_video_ts = frame->timestamp;
 
+	if (filter->compressing) {
+		filter->last_frame = *frame;
+		return delay_packed_video(filter, parent, frame);
+	}
+
+	pthread_mutex_lock(&filter->mutex);
 	deque_push_back(&filter->video_frames, &frame, sizeof(struct obs_source_frame *));
 	deque_peek_front(&filter->video_frames, &output, sizeof(struct obs_source_frame *));
+	filter->memory_usage += frame_data_size(frame);
 
 	cur_interval = frame->timestamp - output->timestamp;
-	if (!filter->video_delay_reached && cur_interval < filter->interval)
+	if (!filter->video_delay_reached && cur_interval < filter->interval) {
+		pthread_mutex_unlock(&filter->mutex);
 		return NULL;
+	}
 
 	deque_pop_front(&filter->video_frames, NULL, sizeof(struct obs_source_frame *));
+	filter->memory_usage -= frame_data_size(output);
+	pthread_mutex_unlock(&filter->mutex);
 
 	if (!filter->video_delay_reached)
 		filter->video_delay_reached = true;
@@ -230,10 +735,12 @@ struct obs_source_info async_delay_filter = {
 	.create = async_delay_filter_create,
 	.destroy = async_delay_filter_destroy,
 	.update = async_delay_filter_update,
+	.get_defaults = async_delay_filter_defaults,
 	.get_properties = async_delay_filter_properties,
 	.filter_video = async_delay_filter_video,
 #ifdef DELAY_AUDIO
 	.filter_audio = async_delay_filter_audio,
 #endif
 	.filter_remove = async_delay_filter_remove,
+	.get_memory_usage = async_delay_filter_memory_usage,
 };
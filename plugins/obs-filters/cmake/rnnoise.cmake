@@ -39,6 +39,9 @@ if(ENABLE_RNNOISE)
 
       target_compile_definitions(obs-rnnoise PUBLIC COMPILE_OPUS)
 
+      # util/sse-intrin.h for the vectorized kernels
+      target_link_libraries(obs-rnnoise PRIVATE OBS::libobs)
+
       target_compile_options(obs-rnnoise PRIVATE -Wno-newline-eof -Wno-error=null-dereference)
 
       set_target_properties(obs-rnnoise PROPERTIES FOLDER plugins/obs-filters/rnnoise POSITION_INDEPENDENT_CODE TRUE)
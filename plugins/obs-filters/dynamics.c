@@ -0,0 +1,336 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <media-io/audio-io.h>
+#include <util/sse-intrin.h>
+
+#include "dynamics.h"
+
+/* -------------------------------------------------------- */
+/* dB conversion                                            */
+
+/* 20 * log10(x) = (20 / ln(10)) * (ln(m) + e * ln(2)) with m in [sqrt(0.5), sqrt(2)).
+ * ln(m) = 2 * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172 */
+static inline __m128 mul_to_db_ps(__m128 x)
+{
+	const __m128i mant_mask = _mm_set1_epi32(0x007fffff);
+	const __m128i one_bits = _mm_set1_epi32(0x3f800000);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 sqrt2 = _mm_set1_ps(1.41421356f);
+
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mant_mask), one_bits));
+
+	__m128 big = _mm_cmpge_ps(m, sqrt2);
+	m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+	e = _mm_sub_epi32(e, _mm_castps_si128(big));
+
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_set1_ps(1.0f / 9.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 7.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 5.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+
+	__m128 ln = _mm_mul_ps(_mm_mul_ps(t, p), _mm_set1_ps(2.0f));
+	ln = _mm_add_ps(ln, _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(0.693147181f)));
+	__m128 db = _mm_mul_ps(ln, _mm_set1_ps(8.68588964f));
+
+	/* zero, denormals and NaN are silence */
+	__m128 valid = _mm_cmpge_ps(x, _mm_set1_ps(FLT_MIN));
+	return _mm_or_ps(_mm_and_ps(valid, db), _mm_andnot_ps(valid, _mm_set1_ps(-INFINITY)));
+}
+
+/* 10^(db / 20) = 2^n * e^r with r = y - n * ln(2), |r| <= ln(2) / 2 */
+static inline __m128 db_to_mul_ps(__m128 db)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 y = _mm_mul_ps(db, _mm_set1_ps(0.115129255f));
+	__m128 n = _mm_mul_ps(y, _mm_set1_ps(1.44269504f));
+	__m128 valid = _mm_cmpge_ps(n, _mm_set1_ps(-126.0f));
+	n = _mm_max_ps(_mm_min_ps(n, _mm_set1_ps(127.0f)), _mm_set1_ps(-126.0f));
+
+	__m128i ni = _mm_cvtps_epi32(n);
+	n = _mm_cvtepi32_ps(ni);
+	__m128 r = _mm_sub_ps(y, _mm_mul_ps(n, _mm_set1_ps(0.693145752f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(1.42860677e-6f)));
+
+	__m128 p = _mm_set1_ps(1.0f / 720.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.0f / 120.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.0f / 24.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.0f / 6.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(0.5f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), one);
+	p = _mm_add_ps(_mm_mul_ps(p, r), one);
+
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(ni, _mm_set1_epi32(127)), 23));
+	return _mm_and_ps(valid, _mm_mul_ps(p, scale));
+}
+
+static inline __m128 load_partial(const float *src, size_t count)
+{
+	float tmp[4] = {0};
+	memcpy(tmp, src, count * sizeof(float));
+	return _mm_loadu_ps(tmp);
+}
+
+static inline void store_partial(float *dst, __m128 val, size_t count)
+{
+	float tmp[4];
+	_mm_storeu_ps(tmp, val);
+	memcpy(dst, tmp, count * sizeof(float));
+}
+
+void dynamics_mul_to_db(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, mul_to_db_ps(_mm_loadu_ps(src + i)));
+	if (i < count)
+		store_partial(dst + i, mul_to_db_ps(load_partial(src + i, count - i)), count - i);
+}
+
+void dynamics_db_to_mul(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, db_to_mul_ps(_mm_loadu_ps(src + i)));
+	if (i < count)
+		store_partial(dst + i, db_to_mul_ps(load_partial(src + i, count - i)), count - i);
+}
+
+/* -------------------------------------------------------- */
+/* gain                                                     */
+
+static inline __m128 compress_gain_ps(__m128 env, __m128 threshold, __m128 slope, __m128 output_gain)
+{
+	/* the minimum returns 0 for NaN (slope 0 with silence) */
+	__m128 gain = _mm_mul_ps(slope, _mm_sub_ps(threshold, mul_to_db_ps(env)));
+	return _mm_mul_ps(db_to_mul_ps(_mm_min_ps(gain, _mm_setzero_ps())), output_gain);
+}
+
+void dynamics_compress_gain(float *dst, const float *env, size_t frames, float threshold, float slope,
+			    float output_gain)
+{
+	const __m128 thresh = _mm_set1_ps(threshold);
+	const __m128 slp = _mm_set1_ps(slope);
+	const __m128 out = _mm_set1_ps(output_gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(dst + i, compress_gain_ps(_mm_loadu_ps(env + i), thresh, slp, out));
+	if (i < frames)
+		store_partial(dst + i, compress_gain_ps(load_partial(env + i, frames - i), thresh, slp, out),
+			      frames - i);
+}
+
+void dynamics_apply_gain(float *const *samples, size_t channels, const float *gain, size_t frames)
+{
+	for (size_t c = 0; c < channels; c++) {
+		float *data = samples[c];
+		size_t i = 0;
+
+		if (!data)
+			continue;
+
+		for (; i + 4 <= frames; i += 4)
+			_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), _mm_loadu_ps(gain + i)));
+		for (; i < frames; i++)
+			data[i] *= gain[i];
+	}
+}
+
+void dynamics_apply_db_gain(float *samples, const float *gain_db, size_t frames, float max_db, float output_gain)
+{
+	const __m128 max = _mm_set1_ps(max_db);
+	const __m128 out = _mm_set1_ps(output_gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 gain = _mm_mul_ps(db_to_mul_ps(_mm_min_ps(_mm_loadu_ps(gain_db + i), max)), out);
+		_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+	}
+	if (i < frames) {
+		const size_t n = frames - i;
+		__m128 gain = _mm_mul_ps(db_to_mul_ps(_mm_min_ps(load_partial(gain_db + i, n), max)), out);
+		store_partial(samples + i, _mm_mul_ps(load_partial(samples + i, n), gain), n);
+	}
+}
+
+/* -------------------------------------------------------- */
+/* detectors                                                */
+
+void dynamics_peak(float *dst, float *const *samples, size_t channels, size_t frames)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 level = _mm_setzero_ps();
+		for (size_t c = 0; c < channels; c++) {
+			if (samples[c])
+				level = _mm_max_ps(level, _mm_andnot_ps(sign, _mm_loadu_ps(samples[c] + i)));
+		}
+		_mm_storeu_ps(dst + i, level);
+	}
+
+	for (; i < frames; i++) {
+		float level = 0.0f;
+		for (size_t c = 0; c < channels; c++) {
+			if (samples[c])
+				level = fmaxf(level, fabsf(samples[c][i]));
+		}
+		dst[i] = level;
+	}
+}
+
+/* The recursive followers can't be vectorized over time, so each vector
+ * lane follows one channel.  Blocks of 4 samples from 4 channels are
+ * transposed so that every vector holds one instant of all 4 channels. */
+
+struct channel_group {
+	float *data[4];
+	size_t idx[4];
+};
+
+static size_t get_channel_groups(struct channel_group *groups, float *const *samples, size_t channels)
+{
+	size_t idx[MAX_AUDIO_CHANNELS];
+	size_t count = 0;
+
+	for (size_t c = 0; c < channels && c < MAX_AUDIO_CHANNELS; c++) {
+		if (samples[c])
+			idx[count++] = c;
+	}
+
+	/* unused lanes repeat the last channel, which doesn't change the result */
+	for (size_t g = 0; g * 4 < count; g++) {
+		for (size_t k = 0; k < 4; k++) {
+			const size_t c = idx[g * 4 + k < count ? g * 4 + k : count - 1];
+			groups[g].data[k] = samples[c];
+			groups[g].idx[k] = c;
+		}
+	}
+
+	return (count + 3) / 4;
+}
+
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void envelope_group(float *dst, const struct channel_group *group, size_t frames, float env0,
+			   float attack_gain, float release_gain)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 attack = _mm_set1_ps(attack_gain);
+	const __m128 release = _mm_set1_ps(release_gain);
+	__m128 env = _mm_set1_ps(env0);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 x0 = _mm_loadu_ps(group->data[0] + i);
+		__m128 x1 = _mm_loadu_ps(group->data[1] + i);
+		__m128 x2 = _mm_loadu_ps(group->data[2] + i);
+		__m128 x3 = _mm_loadu_ps(group->data[3] + i);
+		_MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+
+		__m128 in[4] = {x0, x1, x2, x3};
+		__m128 out[4];
+
+		for (size_t k = 0; k < 4; k++) {
+			const __m128 env_in = _mm_andnot_ps(sign, in[k]);
+			const __m128 gain = select_ps(_mm_cmplt_ps(env, env_in), attack, release);
+			env = _mm_add_ps(env_in, _mm_mul_ps(gain, _mm_sub_ps(env, env_in)));
+			out[k] = env;
+		}
+
+		_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+		__m128 level = _mm_max_ps(_mm_max_ps(out[0], out[1]), _mm_max_ps(out[2], out[3]));
+		_mm_storeu_ps(dst + i, _mm_max_ps(_mm_loadu_ps(dst + i), level));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, env);
+
+	for (; i < frames; i++) {
+		for (size_t k = 0; k < 4; k++) {
+			const float env_in = fabsf(group->data[k][i]);
+			const float gain = lanes[k] < env_in ? attack_gain : release_gain;
+			lanes[k] = env_in + gain * (lanes[k] - env_in);
+			dst[i] = fmaxf(dst[i], lanes[k]);
+		}
+	}
+}
+
+void dynamics_envelope(float *dst, float *const *samples, size_t channels, size_t frames, float *env,
+		       float attack_gain, float release_gain)
+{
+	struct channel_group groups[MAX_AUDIO_CHANNELS / 4];
+	const size_t num_groups = get_channel_groups(groups, samples, channels);
+
+	memset(dst, 0, frames * sizeof(float));
+	for (size_t g = 0; g < num_groups; g++)
+		envelope_group(dst, &groups[g], frames, *env, attack_gain, release_gain);
+
+	if (frames)
+		*env = dst[frames - 1];
+}
+
+static void rms_group(float *const *dst, const struct channel_group *group, size_t frames, float *state, float coef)
+{
+	const __m128 a = _mm_set1_ps(coef);
+	const __m128 b = _mm_set1_ps(1.0f - coef);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 avg = _mm_setr_ps(state[group->idx[0]], state[group->idx[1]], state[group->idx[2]],
+				 state[group->idx[3]]);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 x0 = _mm_loadu_ps(group->data[0] + i);
+		__m128 x1 = _mm_loadu_ps(group->data[1] + i);
+		__m128 x2 = _mm_loadu_ps(group->data[2] + i);
+		__m128 x3 = _mm_loadu_ps(group->data[3] + i);
+		_MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+
+		__m128 in[4] = {x0, x1, x2, x3};
+		__m128 out[4];
+
+		for (size_t k = 0; k < 4; k++) {
+			avg = _mm_add_ps(_mm_mul_ps(a, avg), _mm_mul_ps(b, _mm_mul_ps(in[k], in[k])));
+			out[k] = _mm_sqrt_ps(_mm_max_ps(avg, zero));
+		}
+
+		_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+		for (size_t k = 0; k < 4; k++)
+			_mm_storeu_ps(dst[group->idx[k]] + i, out[k]);
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, avg);
+
+	for (; i < frames; i++) {
+		for (size_t k = 0; k < 4; k++) {
+			const float x = group->data[k][i];
+			lanes[k] = coef * lanes[k] + (1.0f - coef) * (x * x);
+			dst[group->idx[k]][i] = sqrtf(fmaxf(lanes[k], 0.0f));
+		}
+	}
+
+	for (size_t k = 0; k < 4; k++)
+		state[group->idx[k]] = lanes[k];
+}
+
+void dynamics_rms(float *const *dst, float *const *samples, size_t channels, size_t frames, float *state, float coef)
+{
+	struct channel_group groups[MAX_AUDIO_CHANNELS / 4];
+	const size_t num_groups = get_channel_groups(groups, samples, channels);
+
+	for (size_t g = 0; g < num_groups; g++)
+		rms_group(dst, &groups[g], frames, state, coef);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+
+/* Shared block kernels of the compressor, limiter, expander and noise gate.
+ *
+ * Channel arrays may contain NULL entries, which are skipped.  Envelope
+ * followers run the channels in parallel, so their results match the
+ * per-channel scalar loops exactly.  The dB conversions are polynomial
+ * approximations within 5e-5 dB and 1e-6 relative error, values below
+ * FLT_MIN are treated as silence. */
+
+/* Samples per block when a caller processes audio in fixed-size chunks */
+#define DYNAMICS_BLOCK 256
+
+/* dst[i] = max over channels of |samples[c][i]| */
+void dynamics_peak(float *dst, float *const *samples, size_t channels, size_t frames);
+
+/* Peak envelope follower started from *env for every channel, dst[i] is the
+ * maximum envelope of all channels.  *env is set to the last value. */
+void dynamics_envelope(float *dst, float *const *samples, size_t channels, size_t frames, float *env,
+		       float attack_gain, float release_gain);
+
+/* RMS follower per channel: state[c] = coef * state[c] + (1 - coef) * x^2,
+ * dst[c][i] = sqrt(state[c]). */
+void dynamics_rms(float *const *dst, float *const *samples, size_t channels, size_t frames, float *state, float coef);
+
+void dynamics_mul_to_db(float *dst, const float *src, size_t count);
+void dynamics_db_to_mul(float *dst, const float *src, size_t count);
+
+/* dst[i] = db_to_mul(min(0, slope * (threshold - mul_to_db(env[i])))) * output_gain */
+void dynamics_compress_gain(float *dst, const float *env, size_t frames, float threshold, float slope,
+			    float output_gain);
+
+/* samples[c][i] *= gain[i] */
+void dynamics_apply_gain(float *const *samples, size_t channels, const float *gain, size_t frames);
+
+/* samples[i] *= db_to_mul(min(gain_db[i], max_db)) * output_gain */
+void dynamics_apply_db_gain(float *samples, const float *gain_db, size_t frames, float max_db, float output_gain);
@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -87,13 +89,9 @@ struct expander_data {
 	int detector;
 	float runave[MAX_AUDIO_CHANNELS];
 	bool is_gate;
-	float *runaverage[MAX_AUDIO_CHANNELS];
-	size_t runaverage_len;
 	float *gain_db[MAX_AUDIO_CHANNELS];
 	size_t gain_db_len;
 	float gain_db_buf[MAX_AUDIO_CHANNELS];
-	float *env_in;
-	size_t env_in_len;
 	bool is_upwcomp;
 	float knee;
 };
@@ -113,19 +111,6 @@ static void resize_env_buffer(struct expander_data *cd, size_t len)
 		cd->envelope_buf[i] = brealloc(cd->envelope_buf[i], cd->envelope_buf_len * sizeof(float));
 }
 
-static void resize_runaverage_buffer(struct expander_data *cd, size_t len)
-{
-	cd->runaverage_len = len;
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
-		cd->runaverage[i] = brealloc(cd->runaverage[i], cd->runaverage_len * sizeof(float));
-}
-
-static void resize_env_in_buffer(struct expander_data *cd, size_t len)
-{
-	cd->env_in_len = len;
-	cd->env_in = brealloc(cd->env_in, cd->env_in_len * sizeof(float));
-}
-
 static void resize_gain_db_buffer(struct expander_data *cd, size_t len)
 {
 	cd->gain_db_len = len;
@@ -222,10 +207,6 @@ static void expander_update(void *data, obs_data_t *s)
 	size_t sample_len = sample_rate * DEFAULT_AUDIO_BUF_MS / MS_IN_S;
 	if (cd->envelope_buf_len == 0)
 		resize_env_buffer(cd, sample_len);
-	if (cd->runaverage_len == 0)
-		resize_runaverage_buffer(cd, sample_len);
-	if (cd->env_in_len == 0)
-		resize_env_in_buffer(cd, sample_len);
 	if (cd->gain_db_len == 0)
 		resize_gain_db_buffer(cd, sample_len);
 }
@@ -264,10 +245,8 @@ static void expander_destroy(void *data)
 
 	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		bfree(cd->envelope_buf[i]);
-		bfree(cd->runaverage[i]);
 		bfree(cd->gain_db[i]);
 	}
-	bfree(cd->env_in);
 	bfree(cd);
 }
 
@@ -276,58 +255,43 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 {
 	if (cd->envelope_buf_len < num_samples)
 		resize_env_buffer(cd, num_samples);
-	if (cd->runaverage_len < num_samples)
-		resize_runaverage_buffer(cd, num_samples);
-	if (cd->env_in_len < num_samples)
-		resize_env_in_buffer(cd, num_samples);
 
 	// 10 ms RMS window
 	const float rmscoef = exp2f(-100.0f / cd->sample_rate);
 
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		memset(cd->envelope_buf[i], 0, num_samples * sizeof(cd->envelope_buf[i][0]));
-		memset(cd->runaverage[i], 0, num_samples * sizeof(cd->runaverage[i][0]));
-	}
-	memset(cd->env_in, 0, num_samples * sizeof(cd->env_in[0]));
 
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
+	if (cd->detector == RMS_DETECT) {
+		dynamics_rms(cd->envelope_buf, samples, cd->num_channels, num_samples, cd->runave, rmscoef);
+	} else if (cd->detector == PEAK_DETECT) {
+		for (size_t chan = 0; chan < cd->num_channels; ++chan) {
+			if (!samples[chan])
+				continue;
+
+			float *envelope_buf = cd->envelope_buf[chan];
+			for (uint32_t i = 0; i < num_samples; ++i)
+				envelope_buf[i] = fabsf(samples[chan][i]);
 
-		float *envelope_buf = cd->envelope_buf[chan];
-		float *runave = cd->runaverage[chan];
-		float *env_in = cd->env_in;
-
-		if (cd->detector == RMS_DETECT) {
-			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * powf(samples[chan][0], 2.0f);
-			env_in[0] = sqrtf(fmaxf(runave[0], 0));
-			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * powf(samples[chan][i], 2.0f);
-				env_in[i] = sqrtf(runave[i]);
-			}
-		} else if (cd->detector == PEAK_DETECT) {
-			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
-				env_in[i] = fabsf(samples[chan][i]);
-			}
+			const float last = samples[chan][num_samples - 1];
+			cd->runave[chan] = last * last;
 		}
+	}
 
-		cd->runave[chan] = runave[num_samples - 1];
-		for (uint32_t i = 0; i < num_samples; ++i)
-			envelope_buf[i] = fmaxf(envelope_buf[i], env_in[i]);
-		cd->envelope[chan] = cd->envelope_buf[chan][num_samples - 1];
+	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
+		if (samples[chan])
+			cd->envelope[chan] = cd->envelope_buf[chan][num_samples - 1];
 	}
 }
 
-static inline void process_sample(size_t idx, float *samples, float *env_buf, float *gain_db, bool is_upwcomp,
+static inline void process_sample(size_t idx, const float *env_db_buf, float *gain_db, bool is_upwcomp,
 				  float channel_gain, float threshold, float slope, float attack_gain,
-				  float inv_attack_gain, float release_gain, float inv_release_gain, float output_gain,
-				  float knee)
+				  float inv_attack_gain, float release_gain, float inv_release_gain, float knee)
 {
 	/* --------------------------------- */
 	/* gain stage of expansion           */
 
-	float env_db = mul_to_db(env_buf[idx]);
+	float env_db = env_db_buf[idx];
 	float diff = threshold - env_db;
 
 	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
@@ -360,17 +324,6 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 		gain_db[idx] = attack_gain * prev_gain + inv_attack_gain * gain;
 	else
 		gain_db[idx] = release_gain * prev_gain + inv_release_gain * gain;
-
-	/* --------------------------------- */
-	/* output                            */
-
-	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
-	} else {
-		gain = db_to_mul(gain_db[idx]);
-	}
-
-	samples[idx] *= gain * output_gain;
 }
 
 // gain stage and ballistics in dB domain
@@ -386,6 +339,9 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 	const bool is_upwcomp = cd->is_upwcomp;
 	const float knee = cd->knee;
 
+	/* the expander only attenuates */
+	const float max_gain_db = is_upwcomp ? INFINITY : 0.0f;
+
 	if (cd->gain_db_len < num_samples)
 		resize_gain_db_buffer(cd, num_samples);
 
@@ -394,15 +350,23 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
 		float *channel_samples = samples[chan];
-		float *env_buf = cd->envelope_buf[chan];
+		float *env_db = cd->envelope_buf[chan];
 		float *gain_db = cd->gain_db[chan];
 		float channel_gain = cd->gain_db_buf[chan];
 
+		if (!channel_samples)
+			continue;
+
+		/* the envelope isn't needed anymore, so it's converted in place */
+		dynamics_mul_to_db(env_db, env_db, num_samples);
+
 		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope,
-				       attack_gain, inv_attack_gain, release_gain, inv_release_gain, output_gain, knee);
+			process_sample(i, env_db, gain_db, is_upwcomp, channel_gain, threshold, slope, attack_gain,
+				       inv_attack_gain, release_gain, inv_release_gain, knee);
 		}
 		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
+
+		dynamics_apply_db_gain(channel_samples, gain_db, num_samples, max_gain_db, output_gain);
 	}
 }
 
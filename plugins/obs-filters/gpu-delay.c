@@ -135,11 +135,9 @@ static void gpu_delay_filter_update(void *data, obs_data_t *s)
 
 	f->delay_ns = (uint64_t)obs_data_get_int(s, S_DELAY_MS) * 1000000ULL;
 
-	/* full reset */
-	f->cx = 0;
-	f->cy = 0;
+	/* the next tick resizes the ring to the new delay, keeping the frames
+	 * it already holds */
 	f->interval_ns = 0;
-	free_textures(f);
 }
 
 static obs_properties_t *gpu_delay_filter_properties(void *data)
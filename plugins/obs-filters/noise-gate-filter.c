@@ -2,6 +2,8 @@
 #include <obs-module.h>
 #include <math.h>
 
+#include "dynamics.h"
+
 #define do_log(level, format, ...) \
 	blog(level, "[noise gate: '%s'] " format, obs_source_get_name(ng->context), ##__VA_ARGS__)
 
@@ -121,33 +123,44 @@ static struct obs_audio_data *noise_gate_filter_audio(void *data, struct obs_aud
 	const float hold_time = ng->hold_time;
 	const size_t channels = ng->channels;
 
-	for (size_t i = 0; i < audio->frames; i++) {
-		float cur_level = fabsf(adata[0][i]);
-		for (size_t j = 0; j < channels; j++) {
-			cur_level = fmaxf(cur_level, fabsf(adata[j][i]));
-		}
+	float level[DYNAMICS_BLOCK];
+	float gain[DYNAMICS_BLOCK];
+	float *block[MAX_AUDIO_CHANNELS];
 
-		if (cur_level > open_threshold && !ng->is_open) {
-			ng->is_open = true;
-		}
-		if (ng->level < close_threshold && ng->is_open) {
-			ng->held_time = 0.0f;
-			ng->is_open = false;
-		}
+	for (size_t start = 0; start < audio->frames; start += DYNAMICS_BLOCK) {
+		const size_t frames = audio->frames - start < DYNAMICS_BLOCK ? audio->frames - start : DYNAMICS_BLOCK;
+
+		for (size_t c = 0; c < channels; c++)
+			block[c] = adata[c] ? adata[c] + start : NULL;
+
+		dynamics_peak(level, block, channels, frames);
 
-		ng->level = fmaxf(ng->level, cur_level) - decay_rate;
+		for (size_t i = 0; i < frames; i++) {
+			const float cur_level = level[i];
 
-		if (ng->is_open) {
-			ng->attenuation = fminf(1.0f, ng->attenuation + attack_rate);
-		} else {
-			ng->held_time += sample_rate_i;
-			if (ng->held_time > hold_time) {
-				ng->attenuation = fmaxf(0.0f, ng->attenuation - release_rate);
+			if (cur_level > open_threshold && !ng->is_open) {
+				ng->is_open = true;
 			}
+			if (ng->level < close_threshold && ng->is_open) {
+				ng->held_time = 0.0f;
+				ng->is_open = false;
+			}
+
+			ng->level = fmaxf(ng->level, cur_level) - decay_rate;
+
+			if (ng->is_open) {
+				ng->attenuation = fminf(1.0f, ng->attenuation + attack_rate);
+			} else {
+				ng->held_time += sample_rate_i;
+				if (ng->held_time > hold_time) {
+					ng->attenuation = fmaxf(0.0f, ng->attenuation - release_rate);
+				}
+			}
+
+			gain[i] = ng->attenuation;
 		}
 
-		for (size_t c = 0; c < channels; c++)
-			adata[c][i] *= ng->attenuation;
+		dynamics_apply_gain(block, channels, gain, frames);
 	}
 
 	return audio;
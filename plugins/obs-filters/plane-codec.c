@@ -0,0 +1,265 @@
+#include <string.h>
+
+#include <util/sse-intrin.h>
+
+#include "plane-codec.h"
+
+#define GROUP_SIZE 16
+#define CHUNK_SIZE 4096
+
+/* -------------------------------------------------------- */
+/* bit packing: a width byte, then two runs of 8 values of  */
+/* that many bits                                            */
+
+static inline uint8_t *pack_group(uint8_t *dst, const uint8_t *codes)
+{
+	uint64_t lo, hi;
+	memcpy(&lo, codes, 8);
+	memcpy(&hi, codes + 8, 8);
+
+	uint64_t bits = lo | hi;
+	bits |= bits >> 32;
+	bits |= bits >> 16;
+	bits |= bits >> 8;
+
+	uint8_t width = 0;
+	while (width < 8 && ((uint8_t)bits >> width))
+		width++;
+
+	*dst++ = width;
+	if (!width)
+		return dst;
+
+	for (size_t half = 0; half < GROUP_SIZE; half += 8) {
+		uint64_t acc = 0;
+		for (size_t i = 0; i < 8; i++)
+			acc |= (uint64_t)codes[half + i] << (i * width);
+		for (size_t b = 0; b < width; b++)
+			*dst++ = (uint8_t)(acc >> (b * 8));
+	}
+	return dst;
+}
+
+static inline const uint8_t *unpack_group(uint8_t *codes, const uint8_t *src, const uint8_t *end)
+{
+	if (src == end)
+		return NULL;
+
+	const uint8_t width = *src++;
+	if (width > 8 || (size_t)(end - src) < (size_t)width * 2)
+		return NULL;
+
+	if (!width) {
+		memset(codes, 0, GROUP_SIZE);
+		return src;
+	}
+
+	const uint64_t mask = (1 << width) - 1;
+	for (size_t half = 0; half < GROUP_SIZE; half += 8) {
+		uint64_t acc = 0;
+		for (size_t b = 0; b < width; b++)
+			acc |= (uint64_t)src[b] << (b * 8);
+		for (size_t i = 0; i < 8; i++)
+			codes[half + i] = (uint8_t)((acc >> (i * width)) & mask);
+		src += width;
+	}
+	return src;
+}
+
+struct unpacker {
+	const uint8_t *src;
+	const uint8_t *end;
+	uint8_t group[GROUP_SIZE];
+	size_t pos;
+};
+
+/* copies the next count codes to dst */
+static bool unpack(struct unpacker *u, uint8_t *dst, size_t count)
+{
+	while (count) {
+		if (u->pos == GROUP_SIZE && count >= GROUP_SIZE) {
+			u->src = unpack_group(dst, u->src, u->end);
+			if (!u->src)
+				return false;
+			dst += GROUP_SIZE;
+			count -= GROUP_SIZE;
+			continue;
+		}
+
+		if (u->pos == GROUP_SIZE) {
+			u->src = unpack_group(u->group, u->src, u->end);
+			if (!u->src)
+				return false;
+			u->pos = 0;
+		}
+
+		size_t n = GROUP_SIZE - u->pos;
+		if (n > count)
+			n = count;
+		memcpy(dst, u->group + u->pos, n);
+		u->pos += n;
+		dst += n;
+		count -= n;
+	}
+	return true;
+}
+
+/* -------------------------------------------------------- */
+/* prediction: the first row of a call from the byte step   */
+/* to the left, the other rows from the row above           */
+
+static inline uint8_t zigzag(uint8_t value, uint8_t prediction)
+{
+	const uint8_t diff = (uint8_t)(value - prediction);
+	return (uint8_t)((diff << 1) ^ (diff & 0x80 ? 0xff : 0));
+}
+
+static inline uint8_t unzigzag(uint8_t code, uint8_t prediction)
+{
+	const uint8_t diff = (uint8_t)((code >> 1) ^ (code & 1 ? 0xff : 0));
+	return (uint8_t)(prediction + diff);
+}
+
+/* the shift of byte x, only the low byte of a sample loses precision */
+static inline int byte_shift(size_t x, size_t sample_size, int shift)
+{
+	return x & (sample_size - 1) ? 0 : shift;
+}
+
+/* bytes of the lanes set in lanes are shifted, the others are kept */
+static inline __m128i quantize_epu8(__m128i v, int shift, __m128i lanes, __m128i mask)
+{
+	return _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, shift), mask), _mm_andnot_si128(lanes, v));
+}
+
+/* lanes of the low bytes of samples, for a vector starting at byte x */
+static inline __m128i sample_lanes(size_t x, size_t sample_size)
+{
+	if (sample_size == 1)
+		return _mm_set1_epi8((char)0xff);
+	return _mm_set1_epi16(x & 1 ? (short)0xff00 : 0x00ff);
+}
+
+/* codes of row[x] predicted from ref[x], for x in [begin, end) */
+static void predict(uint8_t *codes, const uint8_t *row, const uint8_t *ref, size_t begin, size_t end,
+		    size_t sample_size, int shift)
+{
+	const __m128i lanes = sample_lanes(begin, sample_size);
+	const __m128i mask = _mm_and_si128(_mm_set1_epi8((char)(0xff >> shift)), lanes);
+	const __m128i zero = _mm_setzero_si128();
+	size_t x = begin;
+
+	for (; x + 16 <= end; x += 16) {
+		__m128i v = quantize_epu8(_mm_loadu_si128((const __m128i *)(row + x)), shift, lanes, mask);
+		__m128i p = quantize_epu8(_mm_loadu_si128((const __m128i *)(ref + x)), shift, lanes, mask);
+		__m128i d = _mm_sub_epi8(v, p);
+		__m128i z = _mm_xor_si128(_mm_add_epi8(d, d), _mm_cmpgt_epi8(zero, d));
+		_mm_storeu_si128((__m128i *)(codes + x - begin), z);
+	}
+	for (; x < end; x++) {
+		const int s = byte_shift(x, sample_size, shift);
+		codes[x - begin] = zigzag(row[x] >> s, ref[x] >> s);
+	}
+}
+
+/* row[x] = the value of the code in row[x] predicted from ref[x], for x in [0, width) */
+static void reconstruct(uint8_t *row, const uint8_t *ref, size_t width, size_t sample_size, int shift)
+{
+	const uint8_t round = shift ? (uint8_t)(1 << (shift - 1)) : 0;
+	const __m128i lanes = sample_lanes(0, sample_size);
+	const __m128i mask = _mm_and_si128(_mm_set1_epi8((char)(0xff >> shift)), lanes);
+	const __m128i high_mask = _mm_and_si128(_mm_set1_epi8((char)(0xff << shift)), lanes);
+	const __m128i round_bits = _mm_and_si128(_mm_set1_epi8((char)round), lanes);
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i seven_bits = _mm_set1_epi8(0x7f);
+	size_t x = 0;
+
+	for (; x + 16 <= width; x += 16) {
+		__m128i z = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i p = quantize_epu8(_mm_loadu_si128((const __m128i *)(ref + x)), shift, lanes, mask);
+		__m128i sign = _mm_cmpeq_epi8(_mm_and_si128(z, one), one);
+		__m128i d = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), seven_bits), sign);
+		__m128i v = _mm_add_epi8(p, d);
+		v = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, shift), high_mask), round_bits),
+				 _mm_andnot_si128(lanes, v));
+		_mm_storeu_si128((__m128i *)(row + x), v);
+	}
+	for (; x < width; x++) {
+		const int s = byte_shift(x, sample_size, shift);
+		row[x] = (uint8_t)((unzigzag(row[x], ref[x] >> s) << s) | (s ? round : 0));
+	}
+}
+
+/* -------------------------------------------------------- */
+
+size_t plane_encode_bound(size_t width, size_t rows)
+{
+	const size_t groups = (width * rows + GROUP_SIZE - 1) / GROUP_SIZE;
+	return groups * (GROUP_SIZE + 1);
+}
+
+size_t plane_encode(uint8_t *dst, const uint8_t *src, size_t linesize, size_t width, size_t rows, size_t step,
+		    size_t sample_size, int shift)
+{
+	uint8_t codes[CHUNK_SIZE + GROUP_SIZE];
+	uint8_t *out = dst;
+	size_t count = 0;
+
+	for (size_t y = 0; y < rows; y++) {
+		const uint8_t *row = src + y * linesize;
+		const uint8_t *ref = y ? row - linesize : row - step;
+		size_t x = 0;
+
+		if (!y) {
+			for (; x < step && x < width; x++)
+				codes[count++] = zigzag(row[x] >> byte_shift(x, sample_size, shift), 0);
+		}
+
+		while (x < width) {
+			const size_t end = x + CHUNK_SIZE - count < width ? x + CHUNK_SIZE - count : width;
+			predict(codes + count, row, ref, x, end, sample_size, shift);
+			count += end - x;
+			x = end;
+
+			size_t packed = 0;
+			for (; packed + GROUP_SIZE <= count; packed += GROUP_SIZE)
+				out = pack_group(out, codes + packed);
+			memmove(codes, codes + packed, count - packed);
+			count -= packed;
+		}
+	}
+
+	if (count) {
+		memset(codes + count, 0, GROUP_SIZE - count);
+		out = pack_group(out, codes);
+	}
+
+	return (size_t)(out - dst);
+}
+
+bool plane_decode(uint8_t *dst, size_t linesize, const uint8_t *src, size_t size, size_t width, size_t rows,
+		  size_t step, size_t sample_size, int shift)
+{
+	struct unpacker u = {.src = src, .end = src + size, .pos = GROUP_SIZE};
+	const uint8_t round = shift ? (uint8_t)(1 << (shift - 1)) : 0;
+
+	for (size_t y = 0; y < rows; y++) {
+		uint8_t *row = dst + y * linesize;
+
+		if (!unpack(&u, row, width))
+			return false;
+
+		if (y) {
+			reconstruct(row, row - linesize, width, sample_size, shift);
+			continue;
+		}
+
+		for (size_t x = 0; x < width; x++) {
+			const int s = byte_shift(x, sample_size, shift);
+			const uint8_t pred = x < step ? 0 : row[x - step] >> s;
+			row[x] = (uint8_t)((unzigzag(row[x], pred) << s) | (s ? round : 0));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Fast intra codec for the rows of a video plane, used to keep delayed frames
+ * compact.  Bytes are predicted from the row above, or on the first row from
+ * the byte step bytes to the left, and the residuals are bit packed in groups
+ * of 16.  Rows are only predicted from rows of the same call, so strips of a
+ * plane can be coded independently on different threads.
+ *
+ * With a shift above 0 the low bits of every sample are dropped before coding,
+ * and decoding restores them to the middle of the dropped range.  Samples are
+ * 1 byte, or 2 bytes little-endian with the value in the low bits, and step
+ * has to be a multiple of the sample size. */
+
+#define PLANE_CODEC_MAX_SHIFT 3
+
+/* Largest encoded size of rows x width bytes */
+size_t plane_encode_bound(size_t width, size_t rows);
+
+/* Encodes rows of width bytes to dst, returns the encoded size */
+size_t plane_encode(uint8_t *dst, const uint8_t *src, size_t linesize, size_t width, size_t rows, size_t step,
+		    size_t sample_size, int shift);
+
+/* Decodes size bytes of src to rows of width bytes, fails on truncated data */
+bool plane_decode(uint8_t *dst, size_t linesize, const uint8_t *src, size_t size, size_t width, size_t rows,
+		  size_t step, size_t sample_size, int shift);
@@ -38,6 +38,37 @@
 #include "_kiss_fft_guts.h"
 #define CUSTOM_MODES
 
+#ifndef FIXED_POINT
+#include <util/sse-intrin.h>
+
+/* Two complex values per vector.  The butterflies below keep the operation
+   order of the scalar macros, so their results are identical. */
+
+static OPUS_INLINE __m128 cpx_load2(const kiss_twiddle_cpx *a, const kiss_twiddle_cpx *b)
+{
+   __m128 x = _mm_setzero_ps();
+   x = _mm_loadl_pi(x, (const __m64 *)a);
+   return _mm_loadh_pi(x, (const __m64 *)b);
+}
+
+/* (a.r*b.r - a.i*b.i, a.r*b.i + a.i*b.r) */
+static OPUS_INLINE __m128 cpx_mul2(__m128 a, __m128 b)
+{
+   const __m128 neg_r = _mm_castsi128_ps(_mm_setr_epi32((int)0x80000000, 0, (int)0x80000000, 0));
+   __m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+   __m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+   __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+   return _mm_add_ps(_mm_mul_ps(a, br), _mm_xor_ps(_mm_mul_ps(as, bi), neg_r));
+}
+
+/* (x.i, -x.r) */
+static OPUS_INLINE __m128 cpx_rot2(__m128 x)
+{
+   const __m128 neg_i = _mm_castsi128_ps(_mm_setr_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+   return _mm_xor_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)), neg_i);
+}
+#endif
+
 /* The guts header contains all the multiplication and addition macros that are defined for
    complex numbers.  It also delares the kf_ internal functions.
 */
@@ -112,6 +143,22 @@ static void kf_bfly4(
    if (m==1)
    {
       /* Degenerate case where all the twiddles are 1. */
+#ifndef FIXED_POINT
+      const __m128 neg_i = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, (int)0x80000000));
+      for (i=0;i<N;i++)
+      {
+         __m128 lo = _mm_loadu_ps((const float *)Fout);
+         __m128 hi = _mm_loadu_ps((const float *)(Fout + 2));
+         __m128 sum = _mm_add_ps(lo, hi);
+         __m128 diff = _mm_sub_ps(lo, hi);
+         /* a = (Fout[0] + Fout[2], scratch0), b = (scratch1, rotated Fout[1] - Fout[3]) */
+         __m128 a = _mm_movelh_ps(sum, diff);
+         __m128 b = _mm_xor_ps(_mm_shuffle_ps(sum, diff, _MM_SHUFFLE(2, 3, 3, 2)), neg_i);
+         _mm_storeu_ps((float *)Fout, _mm_add_ps(a, b));
+         _mm_storeu_ps((float *)(Fout + 2), _mm_sub_ps(a, b));
+         Fout+=4;
+      }
+#else
       for (i=0;i<N;i++)
       {
          kiss_fft_cpx scratch0, scratch1;
@@ -129,6 +176,7 @@ static void kf_bfly4(
          Fout[3].i = ADD32_ovflw(scratch0.i, scratch1.r);
          Fout+=4;
       }
+#endif
    } else {
       int j;
       kiss_fft_cpx scratch[6];
@@ -140,8 +188,30 @@ static void kf_bfly4(
       {
          Fout = Fout_beg + i*mm;
          tw3 = tw2 = tw1 = st->twiddles;
+         j = 0;
+#ifndef FIXED_POINT
+         for (;j+2<=m;j+=2)
+         {
+            __m128 f0 = _mm_loadu_ps((const float *)Fout);
+            __m128 s0 = cpx_mul2(_mm_loadu_ps((const float *)(Fout + m)), cpx_load2(tw1, tw1 + fstride));
+            __m128 s1 = cpx_mul2(_mm_loadu_ps((const float *)(Fout + m2)), cpx_load2(tw2, tw2 + fstride*2));
+            __m128 s2 = cpx_mul2(_mm_loadu_ps((const float *)(Fout + m3)), cpx_load2(tw3, tw3 + fstride*3));
+            __m128 s5 = _mm_sub_ps(f0, s1);
+            __m128 s3 = _mm_add_ps(s0, s2);
+            __m128 s4 = cpx_rot2(_mm_sub_ps(s0, s2));
+            f0 = _mm_add_ps(f0, s1);
+            _mm_storeu_ps((float *)(Fout + m2), _mm_sub_ps(f0, s3));
+            _mm_storeu_ps((float *)Fout, _mm_add_ps(f0, s3));
+            _mm_storeu_ps((float *)(Fout + m), _mm_add_ps(s5, s4));
+            _mm_storeu_ps((float *)(Fout + m3), _mm_sub_ps(s5, s4));
+            tw1 += fstride*2;
+            tw2 += fstride*4;
+            tw3 += fstride*6;
+            Fout += 2;
+         }
+#endif
          /* m is guaranteed to be a multiple of 4. */
-         for (j=0;j<m;j++)
+         for (;j<m;j++)
          {
             C_MUL(scratch[0],Fout[m] , *tw1 );
             C_MUL(scratch[1],Fout[m2] , *tw2 );
@@ -37,6 +37,8 @@
 #include "rnn.h"
 #include "rnn_data.h"
 #include <stdio.h>
+#include <string.h>
+#include <util/sse-intrin.h>
 
 static OPUS_INLINE float tansig_approx(float x)
 {
@@ -76,7 +78,7 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+void compute_dense_c(const DenseLayer *layer, float *output, const float *input)
 {
    int i, j;
    int N, M;
@@ -106,7 +108,7 @@ static void compute_dense(const DenseLayer *layer, float *output, const float *i
    }
 }
 
-static void compute_gru(const GRULayer *gru, float *state, const float *input)
+void compute_gru_c(const GRULayer *gru, float *state, const float *input)
 {
    int i, j;
    int N, M;
@@ -155,6 +157,129 @@ static void compute_gru(const GRULayer *gru, float *state, const float *input)
       state[i] = h[i];
 }
 
+/* The vectorized kernels compute four neurons at a time.  The weights are
+   stored neuron-major within each input row, so every row contributes one
+   contiguous load per four neurons, and each lane accumulates its terms in
+   the same order as the scalar loops above. */
+
+static OPUS_INLINE __m128 load_weights(const rnn_weight *w)
+{
+   int packed;
+   __m128i x;
+   memcpy(&packed, w, sizeof(packed));
+   x = _mm_cvtsi32_si128(packed);
+   x = _mm_unpacklo_epi8(x, x);
+   x = _mm_unpacklo_epi16(x, x);
+   return _mm_cvtepi32_ps(_mm_srai_epi32(x, 24));
+}
+
+static void init_sums(float *sum, const rnn_weight *bias, int N)
+{
+   int i;
+   for (i=0;i<N;i++)
+      sum[i] = bias[i];
+}
+
+/* sum[i] += w[j*stride + i]*x[j] (*gate[j]) for all i < N, j < M */
+static void accumulate(float *sum, const rnn_weight *w, int stride, const float *x, const float *gate, int M, int N)
+{
+   int i, j;
+   for (i=0;i+8<=N;i+=8)
+   {
+      __m128 acc0 = _mm_loadu_ps(&sum[i]);
+      __m128 acc1 = _mm_loadu_ps(&sum[i + 4]);
+      for (j=0;j<M;j++)
+      {
+         const rnn_weight *row = &w[j*stride + i];
+         __m128 xj = _mm_set1_ps(x[j]);
+         __m128 t0 = _mm_mul_ps(load_weights(row), xj);
+         __m128 t1 = _mm_mul_ps(load_weights(row + 4), xj);
+         if (gate)
+         {
+            __m128 gj = _mm_set1_ps(gate[j]);
+            t0 = _mm_mul_ps(t0, gj);
+            t1 = _mm_mul_ps(t1, gj);
+         }
+         acc0 = _mm_add_ps(acc0, t0);
+         acc1 = _mm_add_ps(acc1, t1);
+      }
+      _mm_storeu_ps(&sum[i], acc0);
+      _mm_storeu_ps(&sum[i + 4], acc1);
+   }
+   for (;i+4<=N;i+=4)
+   {
+      __m128 acc = _mm_loadu_ps(&sum[i]);
+      for (j=0;j<M;j++)
+      {
+         __m128 t = _mm_mul_ps(load_weights(&w[j*stride + i]), _mm_set1_ps(x[j]));
+         if (gate)
+            t = _mm_mul_ps(t, _mm_set1_ps(gate[j]));
+         acc = _mm_add_ps(acc, t);
+      }
+      _mm_storeu_ps(&sum[i], acc);
+   }
+   for (;i<N;i++)
+   {
+      float s = sum[i];
+      for (j=0;j<M;j++)
+      {
+         if (gate)
+            s += w[j*stride + i]*x[j]*gate[j];
+         else
+            s += w[j*stride + i]*x[j];
+      }
+      sum[i] = s;
+   }
+}
+
+static float activate(int activation, float x)
+{
+   if (activation == ACTIVATION_SIGMOID) return sigmoid_approx(x);
+   else if (activation == ACTIVATION_TANH) return tansig_approx(x);
+   else if (activation == ACTIVATION_RELU) return relu(x);
+   *(int*)0=0;
+   return 0;
+}
+
+void compute_dense(const DenseLayer *layer, float *output, const float *input)
+{
+   int i;
+   int N = layer->nb_neurons;
+   init_sums(output, layer->bias, N);
+   accumulate(output, layer->input_weights, N, input, NULL, layer->nb_inputs, N);
+   for (i=0;i<N;i++)
+      output[i] = activate(layer->activation, WEIGHTS_SCALE*output[i]);
+}
+
+void compute_gru(const GRULayer *gru, float *state, const float *input)
+{
+   int i;
+   int N, M;
+   int stride;
+   float zr[2*MAX_NEURONS];
+   float h[MAX_NEURONS];
+   M = gru->nb_inputs;
+   N = gru->nb_neurons;
+   stride = 3*N;
+   /* The update and reset gates are adjacent in every row, so compute
+      them together. */
+   init_sums(zr, gru->bias, 2*N);
+   accumulate(zr, gru->input_weights, stride, input, NULL, M, 2*N);
+   accumulate(zr, gru->recurrent_weights, stride, state, NULL, N, 2*N);
+   for (i=0;i<2*N;i++)
+      zr[i] = sigmoid_approx(WEIGHTS_SCALE*zr[i]);
+   init_sums(h, &gru->bias[2*N], N);
+   accumulate(h, &gru->input_weights[2*N], stride, input, NULL, M, N);
+   accumulate(h, &gru->recurrent_weights[2*N], stride, state, &zr[N], N, N);
+   for (i=0;i<N;i++)
+   {
+      float z = zr[i];
+      h[i] = z*state[i] + (1-z)*activate(gru->activation, WEIGHTS_SCALE*h[i]);
+   }
+   for (i=0;i<N;i++)
+      state[i] = h[i];
+}
+
 #define INPUT_SIZE 42
 
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input) {
@@ -60,6 +60,13 @@ typedef struct {
 
 typedef struct RNNState RNNState;
 
+/* Scalar reference kernels, compute_dense() and compute_gru() are the
+   vectorized versions used by compute_rnn(). */
+void compute_dense_c(const DenseLayer *layer, float *output, const float *input);
+void compute_gru_c(const GRULayer *gru, float *state, const float *input);
+void compute_dense(const DenseLayer *layer, float *output, const float *input);
+void compute_gru(const GRULayer *gru, float *state, const float *input);
+
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input);
 
 #endif /* _MLP_H_ */
@@ -0,0 +1,423 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "mp4-mux.h"
+#include "hls-playlist.h"
+#include "hls-upload.h"
+
+#include <inttypes.h>
+
+#include <obs-module.h>
+#include <util/array-serializer.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define do_log(level, format, ...) \
+	blog(level, "[hls output: '%s'] " format, obs_output_get_name(out->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define MIN_PART_MS 100
+/* Consecutive failed writes before the output gives up */
+#define MAX_UPLOAD_ERRORS 5
+
+/* Low-latency HLS output.  mp4-mux writes CMAF fragments of at most one part
+ * duration to a memory buffer, each of which is published as a partial
+ * segment as soon as it is complete.  Parts are collected into full segments
+ * that close on keyframes. */
+
+struct sent_packet {
+	size_t track_idx;
+	int64_t pts;
+};
+
+/* Video packets of a part, reported as sent once its upload has finished */
+struct part_packets {
+	obs_weak_output_t *output;
+	DARRAY(struct sent_packet) packets;
+};
+
+struct hls_output {
+	obs_output_t *output;
+
+	volatile bool active;
+	volatile bool stopping;
+	uint64_t stop_ts;
+	uint64_t total_bytes;
+
+	pthread_mutex_t mutex;
+
+	struct mp4_mux *muxer;
+	struct serializer serializer;
+	struct array_output_data data;
+
+	struct hls_upload *upload;
+	struct hls_playlist playlist;
+	struct dstr playlist_name;
+	struct dstr playlist_text;
+	struct dstr name;
+
+	/* Parts of the segment in progress */
+	DARRAY(uint8_t) segment;
+
+	/* Video packets submitted to the muxer that aren't part of a written
+	 * fragment yet, in decode order */
+	DARRAY(struct sent_packet) pending;
+};
+
+static inline bool stopping(struct hls_output *out)
+{
+	return os_atomic_load_bool(&out->stopping);
+}
+
+static inline bool active(struct hls_output *out)
+{
+	return os_atomic_load_bool(&out->active);
+}
+
+static const char *hls_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("HLSOutput");
+}
+
+static void *hls_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct hls_output *out = bzalloc(sizeof(struct hls_output));
+	out->output = output;
+	pthread_mutex_init(&out->mutex, NULL);
+
+	UNUSED_PARAMETER(settings);
+	return out;
+}
+
+static void hls_output_destroy(void *data)
+{
+	struct hls_output *out = data;
+
+	pthread_mutex_destroy(&out->mutex);
+	dstr_free(&out->playlist_name);
+	bfree(out);
+}
+
+static void put_copy(struct hls_output *out, const char *name, const uint8_t *data, size_t size)
+{
+	hls_upload_put(out->upload, name, bmemdup(data, size), size);
+}
+
+static void write_playlist(struct hls_output *out)
+{
+	hls_playlist_write(&out->playlist, &out->playlist_text);
+	put_copy(out, out->playlist_name.array, (uint8_t *)out->playlist_text.array, out->playlist_text.len);
+}
+
+static void write_segment(struct hls_output *out, uint64_t sequence)
+{
+	/* The upload takes over the buffer */
+	hls_segment_name(&out->name, sequence);
+	hls_upload_put(out->upload, out->name.array, out->segment.array, out->segment.num);
+	da_init(out->segment);
+}
+
+static void part_uploaded(void *param, bool success, uint64_t start_ts)
+{
+	struct part_packets *part = param;
+	obs_output_t *output = obs_weak_output_get_output(part->output);
+
+	if (output && success) {
+		for (size_t i = 0; i < part->packets.num; i++) {
+			struct encoder_packet packet = {
+				.type = OBS_ENCODER_VIDEO,
+				.track_idx = part->packets.array[i].track_idx,
+				.pts = part->packets.array[i].pts,
+			};
+			obs_output_packet_sent(output, &packet, start_ts);
+		}
+	}
+
+	obs_output_release(output);
+	obs_weak_output_release(part->output);
+	da_free(part->packets);
+	bfree(part);
+}
+
+static void write_part(struct hls_output *out, const struct hls_update *update, const uint8_t *data, size_t size,
+		       size_t video_samples)
+{
+	hls_part_name(&out->name, update->segment, update->part);
+
+	if (video_samples > out->pending.num)
+		video_samples = out->pending.num;
+	if (!video_samples) {
+		put_copy(out, out->name.array, data, size);
+		return;
+	}
+
+	struct part_packets *part = bzalloc(sizeof(struct part_packets));
+	part->output = obs_output_get_weak_output(out->output);
+	da_push_back_array(part->packets, out->pending.array, video_samples);
+	da_erase_range(out->pending, 0, video_samples);
+
+	hls_upload_put_notify(out->upload, out->name.array, bmemdup(data, size), size, part_uploaded, part);
+}
+
+static void remove_expired(struct hls_output *out, const struct hls_update *update)
+{
+	if (update->parts_expired) {
+		for (uint32_t i = 0; i < update->parts_expired_count; i++) {
+			hls_part_name(&out->name, update->parts_expired_segment, i);
+			hls_upload_delete(out->upload, out->name.array);
+		}
+	}
+
+	if (update->segment_expired) {
+		hls_segment_name(&out->name, update->segment_expired_sequence);
+		hls_upload_delete(out->upload, out->name.array);
+	}
+}
+
+static void fragment_written(void *param, const struct mp4_fragment_info *info)
+{
+	struct hls_output *out = param;
+	const uint8_t *data = out->data.bytes.array;
+	size_t size = out->data.bytes.num;
+	struct hls_update update;
+
+	if (info->init_size) {
+		put_copy(out, HLS_INIT_NAME, data, info->init_size);
+		data += info->init_size;
+		size -= info->init_size;
+	}
+
+	/* Fragments without samples only occur when flushing */
+	if (info->duration_usec) {
+		hls_playlist_add_part(&out->playlist, info->duration_usec, info->independent, &update);
+
+		if (update.closed)
+			write_segment(out, update.closed_segment);
+
+		write_part(out, &update, data, size, info->video_samples);
+		da_push_back_array(out->segment, data, size);
+
+		write_playlist(out);
+		remove_expired(out, &update);
+	}
+
+	array_output_serializer_reset(&out->data);
+}
+
+static bool hls_output_start(void *data)
+{
+	struct hls_output *out = data;
+
+	if (!obs_output_can_begin_data_capture(out->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(out->output, 0))
+		return false;
+
+	os_atomic_set_bool(&out->stopping, false);
+
+	obs_data_t *settings = obs_output_get_settings(out->output);
+	const char *path = obs_data_get_string(settings, "path");
+	int64_t segment_ms = obs_data_get_int(settings, "segment_duration") * 1000;
+	int64_t part_ms = obs_data_get_int(settings, "part_duration");
+	size_t window = (size_t)obs_data_get_int(settings, "window");
+
+	dstr_copy(&out->playlist_name, obs_data_get_string(settings, "playlist_name"));
+	obs_data_release(settings);
+
+	if (part_ms < MIN_PART_MS)
+		part_ms = MIN_PART_MS;
+	if (segment_ms < part_ms)
+		segment_ms = part_ms;
+
+	/* Segments can only close on keyframes, so the target duration that is
+	 * fixed from the segment duration has to cover the keyframe interval */
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(out->output);
+	obs_data_t *vsettings = obs_encoder_get_settings(vencoder);
+	int64_t keyint_ms = obs_data_get_int(vsettings, "keyint_sec") * 1000;
+	obs_data_release(vsettings);
+
+	if (keyint_ms > segment_ms) {
+		warn("Keyframe interval of %" PRId64 " ms is longer than the segment duration, using it as the "
+		     "segment duration",
+		     keyint_ms);
+		segment_ms = keyint_ms;
+	} else if (!keyint_ms) {
+		warn("The video encoder uses an automatic keyframe interval, segments exceed the target duration "
+		     "unless there is a keyframe at least every %" PRId64 " ms",
+		     segment_ms);
+	}
+
+	if (!path || !*path) {
+		warn("No output path or URL specified");
+		return false;
+	}
+
+	out->upload = hls_upload_create(path);
+	if (!out->upload) {
+		warn("Unable to open HLS target '%s'", path);
+		return false;
+	}
+
+	hls_playlist_init(&out->playlist, segment_ms * 1000, part_ms * 1000, window);
+	array_output_serializer_init(&out->serializer, &out->data);
+
+	out->muxer = mp4_mux_create(out->output, &out->serializer, MP4_CMAF | MP4_USE_NEGATIVE_CTS);
+	mp4_mux_set_part_duration(out->muxer, part_ms * 1000);
+	mp4_mux_set_fragment_callback(out->muxer, fragment_written, out);
+
+	out->total_bytes = 0;
+	os_atomic_set_bool(&out->active, true);
+	obs_output_begin_data_capture(out->output, 0);
+
+	info("Writing LL-HLS to '%s' (segments: %" PRId64 " ms, parts: %" PRId64 " ms)", path, segment_ms,
+	     part_ms);
+	return true;
+}
+
+static void hls_output_stop(void *data, uint64_t ts)
+{
+	struct hls_output *out = data;
+	out->stop_ts = ts / 1000;
+	os_atomic_set_bool(&out->stopping, true);
+}
+
+static void hls_upload_destroy_task(void *ptr)
+{
+	/* Waits for the remaining uploads */
+	hls_upload_destroy(ptr);
+}
+
+static void hls_output_actual_stop(struct hls_output *out, int code)
+{
+	uint64_t sequence;
+
+	os_atomic_set_bool(&out->active, false);
+
+	mp4_mux_finalise(out->muxer);
+	mp4_mux_destroy(out->muxer);
+	out->muxer = NULL;
+
+	if (hls_playlist_end(&out->playlist, &sequence))
+		write_segment(out, sequence);
+	write_playlist(out);
+
+	if (code) {
+		obs_output_signal_stop(out->output, code);
+	} else {
+		obs_output_end_data_capture(out->output);
+	}
+
+	hls_playlist_free(&out->playlist);
+	array_output_serializer_free(&out->data);
+	da_free(out->segment);
+	da_free(out->pending);
+	dstr_free(&out->playlist_text);
+	dstr_free(&out->name);
+
+	obs_queue_task(OBS_TASK_DESTROY, hls_upload_destroy_task, out->upload, false);
+	out->upload = NULL;
+
+	info("HLS output stopped");
+}
+
+static void hls_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct hls_output *out = data;
+
+	pthread_mutex_lock(&out->mutex);
+
+	if (!active(out))
+		goto unlock;
+
+	if (!packet) {
+		hls_output_actual_stop(out, OBS_OUTPUT_ENCODE_ERROR);
+		goto unlock;
+	}
+
+	if (stopping(out)) {
+		if (packet->sys_dts_usec >= (int64_t)out->stop_ts) {
+			hls_output_actual_stop(out, 0);
+			goto unlock;
+		}
+	}
+
+	out->total_bytes += packet->size;
+
+	/* Only reported as sent once the part it ends up in has been
+	 * uploaded, a packet is never part of the fragment that its own
+	 * submission completes */
+	if (mp4_mux_submit_packet(out->muxer, packet) && packet->type == OBS_ENCODER_VIDEO) {
+		struct sent_packet *sent = da_push_back_new(out->pending);
+		sent->track_idx = packet->track_idx;
+		sent->pts = packet->pts;
+	}
+
+	if (hls_upload_errors(out->upload) >= MAX_UPLOAD_ERRORS) {
+		warn("Too many failed writes, stopping");
+		hls_output_actual_stop(out, OBS_OUTPUT_ERROR);
+	}
+
+unlock:
+	pthread_mutex_unlock(&out->mutex);
+}
+
+static void hls_output_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "playlist_name", "index.m3u8");
+	obs_data_set_default_int(settings, "segment_duration", 4);
+	obs_data_set_default_int(settings, "part_duration", 1000);
+	obs_data_set_default_int(settings, "window", 6);
+}
+
+static obs_properties_t *hls_output_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_text(props, "path", obs_module_text("HLSOutput.Path"), OBS_TEXT_DEFAULT);
+	obs_properties_add_text(props, "playlist_name", obs_module_text("HLSOutput.PlaylistName"),
+				OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "segment_duration", obs_module_text("HLSOutput.SegmentDuration"), 1, 30, 1);
+	obs_properties_add_int(props, "part_duration", obs_module_text("HLSOutput.PartDuration"), MIN_PART_MS,
+			       5000, 50);
+	obs_properties_add_int(props, "window", obs_module_text("HLSOutput.Window"), 0, 100, 1);
+	return props;
+}
+
+static uint64_t hls_output_total_bytes(void *data)
+{
+	struct hls_output *out = data;
+	return out->total_bytes;
+}
+
+struct obs_output_info hls_output_info = {
+	.id = "hls_cmaf_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.encoded_video_codecs = "h264;hevc;av1",
+	.encoded_audio_codecs = "aac",
+	.get_name = hls_output_name,
+	.create = hls_output_create,
+	.destroy = hls_output_destroy,
+	.start = hls_output_start,
+	.stop = hls_output_stop,
+	.encoded_packet = hls_output_packet,
+	.get_defaults = hls_output_defaults,
+	.get_properties = hls_output_properties,
+	.get_total_bytes = hls_output_total_bytes,
+};
@@ -0,0 +1,179 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "hls-playlist.h"
+
+#include <inttypes.h>
+
+#define NUM_PART_COUNTS (HLS_PART_SEGMENTS * 2 + 1)
+
+void hls_playlist_init(struct hls_playlist *pl, int64_t segment_usec, int64_t part_usec, size_t window)
+{
+	memset(pl, 0, sizeof(*pl));
+	pl->segment_usec = segment_usec;
+	pl->part_usec = part_usec;
+	pl->window = window;
+	pl->target_duration = (uint32_t)((segment_usec + 999999) / 1000000);
+}
+
+void hls_playlist_free(struct hls_playlist *pl)
+{
+	for (size_t i = 0; i < pl->segments.num; i++)
+		da_free(pl->segments.array[i].parts);
+	da_free(pl->segments);
+}
+
+static void close_segment(struct hls_playlist *pl, struct hls_update *update)
+{
+	struct hls_segment *seg = da_end(pl->segments);
+	uint64_t sequence = seg->sequence;
+
+	pl->open = false;
+	update->closed = true;
+	update->closed_segment = sequence;
+
+	if (pl->segments.num > HLS_PART_SEGMENTS)
+		da_free(pl->segments.array[pl->segments.num - 1 - HLS_PART_SEGMENTS].parts);
+
+	/* Keep part files around for as long as they were listed, so clients
+	 * with an older playlist can still load them. */
+	if (sequence >= HLS_PART_SEGMENTS * 2) {
+		uint64_t expired = sequence - HLS_PART_SEGMENTS * 2;
+
+		update->parts_expired = true;
+		update->parts_expired_segment = expired;
+		update->parts_expired_count = pl->part_counts[expired % NUM_PART_COUNTS];
+	}
+
+	if (!pl->window || pl->segments.num <= pl->window)
+		return;
+
+	da_free(pl->segments.array[0].parts);
+	da_erase(pl->segments, 0);
+
+	/* The same goes for segments leaving the window */
+	uint64_t first = pl->segments.array[0].sequence;
+	if (first >= pl->window + 1) {
+		update->segment_expired = true;
+		update->segment_expired_sequence = first - 1 - pl->window;
+	}
+}
+
+void hls_playlist_add_part(struct hls_playlist *pl, int64_t duration_usec, bool independent,
+			   struct hls_update *update)
+{
+	struct hls_segment *seg = pl->open ? da_end(pl->segments) : NULL;
+
+	memset(update, 0, sizeof(*update));
+
+	/* Part durations are rounded, allow half a part of slack */
+	if (seg && independent && seg->duration_usec >= pl->segment_usec - pl->part_usec / 2) {
+		close_segment(pl, update);
+		seg = NULL;
+	}
+
+	if (!seg) {
+		seg = da_push_back_new(pl->segments);
+		seg->sequence = pl->next_sequence++;
+		pl->part_counts[seg->sequence % NUM_PART_COUNTS] = 0;
+		pl->open = true;
+	}
+
+	struct hls_part *part = da_push_back_new(seg->parts);
+	part->duration_usec = duration_usec;
+	part->independent = independent;
+	seg->duration_usec += duration_usec;
+
+	update->segment = seg->sequence;
+	update->part = pl->part_counts[seg->sequence % NUM_PART_COUNTS]++;
+}
+
+bool hls_playlist_end(struct hls_playlist *pl, uint64_t *closed_segment)
+{
+	struct hls_update update = {0};
+
+	if (pl->open)
+		close_segment(pl, &update);
+
+	pl->ended = true;
+	*closed_segment = update.closed_segment;
+	return update.closed;
+}
+
+/* Formatted by hand to stay independent of the locale's decimal separator */
+static void cat_seconds(struct dstr *out, int64_t usec)
+{
+	int64_t val = (usec + 5) / 10;
+	dstr_catf(out, "%" PRId64 ".%05d", val / 100000, (int)(val % 100000));
+}
+
+void hls_playlist_write(const struct hls_playlist *pl, struct dstr *out)
+{
+	struct dstr name = {0};
+
+	dstr_copy(out, "#EXTM3U\n#EXT-X-VERSION:6\n");
+	dstr_catf(out, "#EXT-X-TARGETDURATION:%" PRIu32 "\n", pl->target_duration);
+	dstr_cat(out, "#EXT-X-PART-INF:PART-TARGET=");
+	cat_seconds(out, pl->part_usec);
+	dstr_cat(out, "\n#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=");
+	cat_seconds(out, pl->part_usec * 3);
+	dstr_catf(out, "\n#EXT-X-MEDIA-SEQUENCE:%" PRIu64 "\n",
+		  pl->segments.num ? pl->segments.array[0].sequence : pl->next_sequence);
+	if (!pl->window)
+		dstr_cat(out, "#EXT-X-PLAYLIST-TYPE:EVENT\n");
+	dstr_cat(out, "#EXT-X-INDEPENDENT-SEGMENTS\n#EXT-X-MAP:URI=\"" HLS_INIT_NAME "\"\n");
+
+	for (size_t i = 0; i < pl->segments.num; i++) {
+		const struct hls_segment *seg = &pl->segments.array[i];
+		bool complete = !pl->open || i + 1 < pl->segments.num;
+
+		for (size_t j = 0; j < seg->parts.num; j++) {
+			const struct hls_part *part = &seg->parts.array[j];
+
+			hls_part_name(&name, seg->sequence, (uint32_t)j);
+			dstr_cat(out, "#EXT-X-PART:DURATION=");
+			cat_seconds(out, part->duration_usec);
+			dstr_catf(out, ",URI=\"%s\"%s\n", name.array, part->independent ? ",INDEPENDENT=YES" : "");
+		}
+
+		if (complete) {
+			hls_segment_name(&name, seg->sequence);
+			dstr_cat(out, "#EXTINF:");
+			cat_seconds(out, seg->duration_usec);
+			dstr_catf(out, ",\n%s\n", name.array);
+		}
+	}
+
+	if (pl->ended) {
+		dstr_cat(out, "#EXT-X-ENDLIST\n");
+	} else if (pl->open) {
+		const struct hls_segment *seg = da_end(pl->segments);
+
+		hls_part_name(&name, seg->sequence, pl->part_counts[seg->sequence % NUM_PART_COUNTS]);
+		dstr_catf(out, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\"\n", name.array);
+	}
+
+	dstr_free(&name);
+}
+
+void hls_segment_name(struct dstr *name, uint64_t segment)
+{
+	dstr_printf(name, "seg%" PRIu64 ".m4s", segment);
+}
+
+void hls_part_name(struct dstr *name, uint64_t segment, uint32_t part)
+{
+	dstr_printf(name, "seg%" PRIu64 ".%" PRIu32 ".m4s", segment, part);
+}
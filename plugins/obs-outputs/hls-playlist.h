@@ -0,0 +1,79 @@
+#pragma once
+
+#include <util/darray.h>
+#include <util/dstr.h>
+
+/* Low-latency HLS media playlist for a single CMAF rendition.  Partial
+ * segments are listed for the segment in progress and the last
+ * HLS_PART_SEGMENTS completed ones, complete segments for the sliding window
+ * (or all of them when the window is 0). */
+
+#define HLS_PART_SEGMENTS 3
+#define HLS_INIT_NAME "init.mp4"
+
+struct hls_part {
+	int64_t duration_usec;
+	bool independent;
+};
+
+struct hls_segment {
+	uint64_t sequence;
+	int64_t duration_usec;
+	/* Cleared once the parts are no longer listed */
+	DARRAY(struct hls_part) parts;
+};
+
+struct hls_playlist {
+	int64_t segment_usec;
+	int64_t part_usec;
+	size_t window;
+
+	/* The last segment is in progress unless the playlist has ended */
+	DARRAY(struct hls_segment) segments;
+	uint64_t next_sequence;
+	bool open;
+	bool ended;
+
+	/* Fixed for the whole stream, clients don't expect it to change.  It is
+	 * only exceeded by segments if keyframes are further apart than the
+	 * segment duration. */
+	uint32_t target_duration;
+	/* Part counts of recent segments, indexed by sequence */
+	uint32_t part_counts[HLS_PART_SEGMENTS * 2 + 1];
+};
+
+struct hls_update {
+	/* Name of the new part is hls_part_name(segment, part) */
+	uint64_t segment;
+	uint32_t part;
+
+	/* The previous segment was completed */
+	bool closed;
+	uint64_t closed_segment;
+
+	/* Part files of this segment are no longer referenced */
+	bool parts_expired;
+	uint64_t parts_expired_segment;
+	uint32_t parts_expired_count;
+
+	/* This segment has been out of the window for a whole window */
+	bool segment_expired;
+	uint64_t segment_expired_sequence;
+};
+
+void hls_playlist_init(struct hls_playlist *pl, int64_t segment_usec, int64_t part_usec, size_t window);
+void hls_playlist_free(struct hls_playlist *pl);
+
+/* Adds a part to the segment in progress.  An independent part completes the
+ * segment in progress first if it has reached the segment duration. */
+void hls_playlist_add_part(struct hls_playlist *pl, int64_t duration_usec, bool independent,
+			   struct hls_update *update);
+
+/* Completes the segment in progress and marks the playlist as ended, returns
+ * true with its sequence number if there was one */
+bool hls_playlist_end(struct hls_playlist *pl, uint64_t *closed_segment);
+
+void hls_playlist_write(const struct hls_playlist *pl, struct dstr *out);
+
+void hls_segment_name(struct dstr *name, uint64_t segment);
+void hls_part_name(struct dstr *name, uint64_t segment, uint32_t part);
@@ -0,0 +1,275 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "hls-upload.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <curl/curl.h>
+
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/task.h>
+#include <util/threading.h>
+
+#define HTTP_TIMEOUT_SEC 10L
+
+struct hls_upload {
+	struct dstr target;
+	bool http;
+
+	/* Only used on the task queue thread */
+	CURL *curl;
+	struct dstr path;
+
+	os_task_queue_t *queue;
+	volatile long errors;
+};
+
+struct upload_job {
+	struct hls_upload *up;
+	char *name;
+	uint8_t *data;
+	size_t size;
+	bool remove;
+
+	hls_upload_done_t done;
+	void *done_param;
+};
+
+struct read_ctx {
+	const uint8_t *data;
+	size_t size;
+};
+
+static size_t read_cb(char *buffer, size_t size, size_t nitems, void *param)
+{
+	struct read_ctx *ctx = param;
+	size_t len = size * nitems;
+
+	if (len > ctx->size)
+		len = ctx->size;
+
+	memcpy(buffer, ctx->data, len);
+	ctx->data += len;
+	ctx->size -= len;
+	return len;
+}
+
+static size_t discard_cb(char *data, size_t size, size_t nmemb, void *param)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(param);
+	return size * nmemb;
+}
+
+static const char *content_type(const char *name)
+{
+	const char *ext = strrchr(name, '.');
+
+	if (ext && strcmp(ext, ".m3u8") == 0)
+		return "Content-Type: application/vnd.apple.mpegurl";
+	if (ext && strcmp(ext, ".m4s") == 0)
+		return "Content-Type: video/iso.segment";
+	return "Content-Type: video/mp4";
+}
+
+static bool http_request(struct hls_upload *up, struct upload_job *job)
+{
+	struct curl_slist *headers = NULL;
+	struct read_ctx ctx = {job->data, job->size};
+	long code = 0;
+
+	dstr_copy_dstr(&up->path, &up->target);
+	dstr_cat(&up->path, job->name);
+
+	/* Resetting the handle keeps its connection alive for the next request */
+	curl_easy_reset(up->curl);
+	curl_easy_setopt(up->curl, CURLOPT_URL, up->path.array);
+	curl_easy_setopt(up->curl, CURLOPT_TIMEOUT, HTTP_TIMEOUT_SEC);
+	curl_easy_setopt(up->curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(up->curl, CURLOPT_WRITEFUNCTION, discard_cb);
+
+	if (job->remove) {
+		curl_easy_setopt(up->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+	} else {
+		/* Waiting for "100 Continue" would add a round trip per file */
+		headers = curl_slist_append(headers, "Expect:");
+		headers = curl_slist_append(headers, content_type(job->name));
+
+		curl_easy_setopt(up->curl, CURLOPT_UPLOAD, 1L);
+		curl_easy_setopt(up->curl, CURLOPT_READFUNCTION, read_cb);
+		curl_easy_setopt(up->curl, CURLOPT_READDATA, &ctx);
+		curl_easy_setopt(up->curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)job->size);
+		curl_easy_setopt(up->curl, CURLOPT_HTTPHEADER, headers);
+	}
+
+	CURLcode res = curl_easy_perform(up->curl);
+	if (res == CURLE_OK)
+		curl_easy_getinfo(up->curl, CURLINFO_RESPONSE_CODE, &code);
+
+	curl_slist_free_all(headers);
+
+	if (res != CURLE_OK) {
+		blog(LOG_WARNING, "[hls upload] %s '%s' failed: %s", job->remove ? "DELETE" : "PUT", job->name,
+		     curl_easy_strerror(res));
+		return false;
+	}
+
+	/* Files that are already gone don't need to be deleted */
+	if (code >= 200 && code < 300)
+		return true;
+	if (job->remove && code == 404)
+		return true;
+
+	blog(LOG_WARNING, "[hls upload] %s '%s' failed with HTTP status %ld", job->remove ? "DELETE" : "PUT",
+	     job->name, code);
+	return false;
+}
+
+static bool file_request(struct hls_upload *up, struct upload_job *job)
+{
+	dstr_copy_dstr(&up->path, &up->target);
+	dstr_cat(&up->path, job->name);
+
+	if (job->remove) {
+		os_unlink(up->path.array);
+		return true;
+	}
+
+	/* Write to a temporary file first so the web server in front of the
+	 * directory never serves partial files. */
+	struct dstr tmp = {0};
+	dstr_printf(&tmp, "%s.tmp", up->path.array);
+
+	FILE *f = os_fopen(tmp.array, "wb");
+	bool success = f && fwrite(job->data, 1, job->size, f) == job->size;
+
+	if (f && fclose(f) != 0)
+		success = false;
+	if (success)
+		success = os_rename(tmp.array, up->path.array) == 0;
+	if (!success) {
+		blog(LOG_WARNING, "[hls upload] Failed to write '%s'", up->path.array);
+		os_unlink(tmp.array);
+	}
+
+	dstr_free(&tmp);
+	return success;
+}
+
+static void upload_task(void *param)
+{
+	struct upload_job *job = param;
+	struct hls_upload *up = job->up;
+	uint64_t start_ts = os_gettime_ns();
+
+	bool success = up->http ? http_request(up, job) : file_request(up, job);
+
+	if (success)
+		os_atomic_set_long(&up->errors, 0);
+	else
+		os_atomic_inc_long(&up->errors);
+
+	if (job->done)
+		job->done(job->done_param, success, start_ts);
+
+	bfree(job->name);
+	bfree(job->data);
+	bfree(job);
+}
+
+struct hls_upload *hls_upload_create(const char *target)
+{
+	struct hls_upload *up = bzalloc(sizeof(struct hls_upload));
+
+	dstr_copy(&up->target, target);
+	dstr_replace(&up->target, "\\", "/");
+	if (dstr_end(&up->target) != '/')
+		dstr_cat_ch(&up->target, '/');
+
+	up->http = astrcmpi_n(target, "http://", 7) == 0 || astrcmpi_n(target, "https://", 8) == 0;
+
+	if (up->http) {
+		up->curl = curl_easy_init();
+		if (!up->curl)
+			goto fail;
+	} else if (os_mkdirs(up->target.array) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "[hls upload] Failed to create directory '%s'", up->target.array);
+		goto fail;
+	}
+
+	up->queue = os_task_queue_create();
+	if (!up->queue)
+		goto fail;
+
+	return up;
+
+fail:
+	hls_upload_destroy(up);
+	return NULL;
+}
+
+void hls_upload_destroy(struct hls_upload *up)
+{
+	if (!up)
+		return;
+
+	os_task_queue_destroy(up->queue);
+	if (up->curl)
+		curl_easy_cleanup(up->curl);
+	dstr_free(&up->target);
+	dstr_free(&up->path);
+	bfree(up);
+}
+
+static void queue_job(struct hls_upload *up, const char *name, uint8_t *data, size_t size, bool remove,
+		      hls_upload_done_t done, void *done_param)
+{
+	struct upload_job *job = bmalloc(sizeof(struct upload_job));
+	job->up = up;
+	job->name = bstrdup(name);
+	job->data = data;
+	job->size = size;
+	job->remove = remove;
+	job->done = done;
+	job->done_param = done_param;
+
+	os_task_queue_queue_task(up->queue, upload_task, job);
+}
+
+void hls_upload_put(struct hls_upload *up, const char *name, uint8_t *data, size_t size)
+{
+	queue_job(up, name, data, size, false, NULL, NULL);
+}
+
+void hls_upload_put_notify(struct hls_upload *up, const char *name, uint8_t *data, size_t size,
+			   hls_upload_done_t done, void *param)
+{
+	queue_job(up, name, data, size, false, done, param);
+}
+
+void hls_upload_delete(struct hls_upload *up, const char *name)
+{
+	queue_job(up, name, NULL, 0, true, NULL, NULL);
+}
+
+long hls_upload_errors(struct hls_upload *up)
+{
+	return os_atomic_load_long(&up->errors);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Writes files of an HLS stream on a worker thread, in the order they were
+ * queued, either to a local directory or with HTTP PUT/DELETE requests below
+ * an http:// or https:// base URL. */
+
+struct hls_upload;
+
+/* Called on the upload thread once a put has finished, start_ts is the
+ * os_gettime_ns() value of when the write started */
+typedef void (*hls_upload_done_t)(void *param, bool success, uint64_t start_ts);
+
+struct hls_upload *hls_upload_create(const char *target);
+/* Finishes all queued requests before returning */
+void hls_upload_destroy(struct hls_upload *up);
+
+/* Takes ownership of data, which must have been allocated with bmalloc */
+void hls_upload_put(struct hls_upload *up, const char *name, uint8_t *data, size_t size);
+void hls_upload_put_notify(struct hls_upload *up, const char *name, uint8_t *data, size_t size,
+			   hls_upload_done_t done, void *param);
+void hls_upload_delete(struct hls_upload *up, const char *name);
+
+/* Number of requests that failed in a row, reset by the next success */
+long hls_upload_errors(struct hls_upload *up);
@@ -1991,7 +1991,14 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 	struct serializer *s = mux->serializer;
 	int64_t start = serializer_get_pos(s);
 
-	uint32_t flags = BASE_DATA_OFFSET_PRESENT | DEFAULT_SAMPLE_FLAGS_PRESENT;
+	uint32_t flags = DEFAULT_SAMPLE_FLAGS_PRESENT;
+
+	/* CMAF fragments are delivered as separate files, so offsets have to
+	 * be relative to the moof rather than the start of the file. */
+	if (mux->mode == CMAF)
+		flags |= DEFAULT_BASE_IS_MOOF;
+	else
+		flags |= BASE_DATA_OFFSET_PRESENT;
 
 	/* Add default size/duration if all samples match. */
 	bool durations_match = true;
@@ -2023,7 +2030,8 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 	write_fullbox(s, 0, "tfhd", 0, flags);
 
 	s_wb32(s, track->track_id); // track_ID
-	s_wb64(s, moof_start);      // base_data_offset
+	if (flags & BASE_DATA_OFFSET_PRESENT)
+		s_wb64(s, moof_start); // base_data_offset
 
 	// default_sample_duration
 	if (durations_match) {
@@ -2112,8 +2120,13 @@ static size_t mp4_write_trun(struct mp4_mux *mux, struct mp4_track *track, uint3
 	if (track->sample_size)
 		return write_box_size(s, start);
 
-	if (track->type == TRACK_VIDEO)
-		s_wb32(s, SAMPLE_FLAG_DEPENDS_NO); // first_sample_flags
+	/* Fragments usually start on a keyframe, but CMAF parts may not. */
+	if (track->type == TRACK_VIDEO) {
+		if (track->fragment_samples.array[0].keyframe)
+			s_wb32(s, SAMPLE_FLAG_DEPENDS_NO); // first_sample_flags
+		else
+			s_wb32(s, SAMPLE_FLAG_DEPENDS_YES | SAMPLE_FLAG_IS_NON_SYNC);
+	}
 
 	for (size_t idx = 0; idx < sample_count; idx++) {
 		struct fragment_sample *smp = &track->fragment_samples.array[idx];
@@ -2276,6 +2289,7 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 		smp->size = size;
 		smp->offset = offset;
 		smp->duration = duration;
+		smp->keyframe = track->type != TRACK_VIDEO || pkt->keyframe;
 
 		*mdat_size += size;
 
@@ -2357,16 +2371,49 @@ static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
 	da_clear(track->fragment_samples);
 }
 
+static void get_fragment_info(struct mp4_mux *mux, struct mp4_fragment_info *info)
+{
+	struct mp4_track *track = NULL;
+
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *tmp = &mux->tracks.array[i];
+		if (!tmp->fragment_samples.num)
+			continue;
+		if (!track || (tmp->type == TRACK_VIDEO && track->type != TRACK_VIDEO))
+			track = tmp;
+	}
+
+	if (!track)
+		return;
+
+	uint64_t duration = 0;
+	for (size_t i = 0; i < track->fragment_samples.num; i++)
+		duration += track->fragment_samples.array[i].duration;
+
+	uint64_t den = track->timebase_den;
+	uint64_t num = track->timebase_num * 1000000ULL;
+
+	info->start_usec = (int64_t)util_mul_div64(track->duration - duration, num, den);
+	info->duration_usec = (int64_t)util_mul_div64(duration, num, den);
+	info->independent = track->fragment_samples.array[0].keyframe;
+	if (track->type == TRACK_VIDEO)
+		info->video_samples = track->fragment_samples.num;
+}
+
 static void mp4_flush_fragment(struct mp4_mux *mux)
 {
 	struct serializer *s = mux->serializer;
+	struct mp4_fragment_info frag_info = {0};
+	int64_t frag_start = serializer_get_pos(s);
 
 	// Write file header if not already done
 	if (!mux->fragments_written) {
 		mp4_write_ftyp(mux, true);
 		/* Placeholder to write mdat header during soft-remux */
-		mux->placeholder_offset = serializer_get_pos(s);
-		mp4_write_free(mux);
+		if (mux->mode != CMAF) {
+			mux->placeholder_offset = serializer_get_pos(s);
+			mp4_write_free(mux);
+		}
 	}
 
 	// Array output as temporary buffer to avoid sending seeks to disk
@@ -2380,6 +2427,8 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 		mp4_write_moov(mux, true);
 		s_write(s, aod.bytes.array, aod.bytes.num);
 		array_output_serializer_reset(&aod);
+
+		frag_info.init_size = (size_t)(serializer_get_pos(s) - frag_start);
 	}
 
 	mux->fragments_written++;
@@ -2404,6 +2453,8 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 		process_packets(mux, mux->chapter_track, &mdat_size);
 	}
 
+	get_fragment_info(mux, &frag_info);
+
 	// write moof once to get size
 	int64_t moof_start = serializer_get_pos(s);
 	size_t moof_size = mp4_write_moof(mux, 0, moof_start);
@@ -2439,7 +2490,14 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 	if (!mux->next_frag_pts && mux->chapter_track)
 		write_packets(mux, mux->chapter_track);
 
-	mux->next_frag_pts = 0;
+	/* A keyframe that arrived while a part boundary was pending starts
+	 * the next fragment. */
+	mux->last_frag_pts = mux->next_frag_pts;
+	mux->next_frag_pts = mux->next_key_pts;
+	mux->next_key_pts = 0;
+
+	if (mux->fragment_cb)
+		mux->fragment_cb(mux->fragment_param, &frag_info);
 }
 
 /* ========================================================================== */
@@ -2590,6 +2648,7 @@ struct mp4_mux *mp4_mux_create(obs_output_t *output, struct serializer *serializ
 	mux->output = output;
 	mux->serializer = serializer;
 	mux->flags = flags;
+	mux->mode = flags & MP4_CMAF ? CMAF : MP4;
 	/* Timestamp is based on 1904 rather than 1970. */
 	mux->creation_time = time(NULL) + 0x7C25B080;
 
@@ -2659,9 +2718,20 @@ bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 		else if (track->codec == CODEC_AV1)
 			obs_parse_av1_packet(&parsed_packet, pkt);
 
+		int64_t pts_usec = packet_pts_usec(&parsed_packet);
+
 		/* Set fragmentation PTS if packet is keyframe and PTS > 0 */
 		if (parsed_packet.keyframe && parsed_packet.pts > 0) {
-			mux->next_frag_pts = packet_pts_usec(&parsed_packet);
+			if (mux->mode == CMAF && mux->next_frag_pts)
+				mux->next_key_pts = pts_usec;
+			else
+				mux->next_frag_pts = pts_usec;
+		} else if (mux->mode == CMAF && mux->part_duration && !mux->next_frag_pts) {
+			/* Cut a part if this frame would take it past the
+			 * part duration. */
+			int64_t frame_usec = util_mul_div64(1000000, track->timebase_num, track->timebase_den);
+			if (pts_usec + frame_usec - mux->last_frag_pts > mux->part_duration)
+				mux->next_frag_pts = pts_usec;
 		}
 	}
 
@@ -2705,6 +2775,9 @@ bool mp4_mux_finalise(struct mp4_mux *mux)
 
 	info("Number of fragments: %u", mux->fragments_written);
 
+	if (mux->mode == CMAF)
+		return true;
+
 	if (mux->flags & MP4_SKIP_FINALISATION) {
 		warn("Skipping MP4 finalization!");
 		return true;
@@ -2753,3 +2826,14 @@ bool mp4_mux_finalise(struct mp4_mux *mux)
 	info("Final mdat size: %zu KiB", data_size / 1024);
 	return true;
 }
+
+void mp4_mux_set_fragment_callback(struct mp4_mux *mux, mp4_fragment_cb callback, void *param)
+{
+	mux->fragment_cb = callback;
+	mux->fragment_param = param;
+}
+
+void mp4_mux_set_part_duration(struct mp4_mux *mux, int64_t duration_usec)
+{
+	mux->part_duration = duration_usec;
+}
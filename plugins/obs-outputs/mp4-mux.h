@@ -31,10 +31,36 @@ enum mp4_mux_flags {
 	MP4_SKIP_FINALISATION = 1 << 2,
 	/* Use negative CTS instead of edit lists */
 	MP4_USE_NEGATIVE_CTS = 1 << 3,
+	/* Write self-contained CMAF fragments for segmented delivery, there is
+	 * no placeholder for the final mdat and the file is never finalised */
+	MP4_CMAF = 1 << 4,
 };
 
+struct mp4_fragment_info {
+	/* Decode time and duration of the fragment on the first video track,
+	 * or the first audio track if there is no video */
+	int64_t start_usec;
+	int64_t duration_usec;
+	/* Fragment starts with a keyframe */
+	bool independent;
+	/* Number of samples on that track if it is a video track, these are
+	 * the oldest packets submitted on it that weren't written yet */
+	size_t video_samples;
+	/* Size of the ftyp and moov boxes written ahead of the first fragment,
+	 * 0 for all later fragments */
+	size_t init_size;
+};
+
+/* Called after a fragment has been written to the serializer */
+typedef void (*mp4_fragment_cb)(void *param, const struct mp4_fragment_info *info);
+
 struct mp4_mux *mp4_mux_create(obs_output_t *output, struct serializer *serializer, enum mp4_mux_flags flags);
 void mp4_mux_destroy(struct mp4_mux *mux);
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt);
 bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name);
 bool mp4_mux_finalise(struct mp4_mux *mux);
+
+void mp4_mux_set_fragment_callback(struct mp4_mux *mux, mp4_fragment_cb callback, void *param);
+/* With MP4_CMAF, also start a new fragment once the current one would exceed
+ * the duration, even without a keyframe */
+void mp4_mux_set_part_duration(struct mp4_mux *mux, int64_t duration_usec);
@@ -568,7 +568,9 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 	if (packet->type == OBS_ENCODER_VIDEO && packet->track_idx == 0)
 		out->last_dts_usec = packet->dts_usec - out->start_time;
 
+	uint64_t send_start_ts = os_gettime_ns();
 	submit_packet(out, packet);
+	obs_output_packet_sent(out->output, packet, send_start_ts);
 
 	if (serializer_get_pos(&out->serializer) == -1)
 		mp4_output_actual_stop(out, OBS_OUTPUT_ERROR);
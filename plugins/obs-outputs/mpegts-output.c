@@ -0,0 +1,257 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdio.h>
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "ts-mux.h"
+
+#define do_log(level, format, ...) \
+	blog(level, "[mpegts output: '%s'] " format, obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+struct mpegts_output {
+	obs_output_t *output;
+	struct dstr path;
+	FILE *file;
+	struct ts_mux *mux;
+	volatile bool active;
+	volatile bool stopping;
+	uint64_t stop_ts;
+	uint64_t total_bytes;
+	bool write_error;
+
+	pthread_mutex_t mutex;
+};
+
+static inline bool stopping(struct mpegts_output *stream)
+{
+	return os_atomic_load_bool(&stream->stopping);
+}
+
+static inline bool active(struct mpegts_output *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static const char *mpegts_output_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("MpegTSOutput");
+}
+
+static void mpegts_output_destroy(void *data)
+{
+	struct mpegts_output *stream = data;
+
+	pthread_mutex_destroy(&stream->mutex);
+	dstr_free(&stream->path);
+	bfree(stream);
+}
+
+static void *mpegts_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct mpegts_output *stream = bzalloc(sizeof(struct mpegts_output));
+	stream->output = output;
+	pthread_mutex_init(&stream->mutex, NULL);
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+}
+
+static void write_datagram(void *param, const uint8_t *data, size_t size)
+{
+	struct mpegts_output *stream = param;
+
+	if (stream->write_error)
+		return;
+
+	if (fwrite(data, 1, size, stream->file) != size) {
+		stream->write_error = true;
+		return;
+	}
+	stream->total_bytes += size;
+}
+
+/* the encoder extra data is only complete once the encoders have produced
+ * their first packet, so the muxer is set up on the first packet */
+static bool create_mux(struct mpegts_output *stream)
+{
+	struct ts_mux_track video = {0};
+	struct ts_mux_track audio[TS_MAX_AUDIO_TRACKS] = {0};
+	size_t num_audio = 0;
+
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	if (vencoder) {
+		video.codec = obs_encoder_get_codec(vencoder);
+		obs_encoder_get_extra_data(vencoder, (uint8_t **)&video.header, &video.header_size);
+	}
+
+	for (; num_audio < TS_MAX_AUDIO_TRACKS; num_audio++) {
+		obs_encoder_t *aencoder = obs_output_get_audio_encoder(stream->output, num_audio);
+		if (!aencoder)
+			break;
+
+		struct ts_mux_track *track = &audio[num_audio];
+		track->codec = obs_encoder_get_codec(aencoder);
+		track->channels = (uint32_t)audio_output_get_channels(obs_encoder_audio(aencoder));
+		obs_encoder_get_extra_data(aencoder, (uint8_t **)&track->header, &track->header_size);
+	}
+
+	stream->mux = ts_mux_create(vencoder ? &video : NULL, audio, num_audio, write_datagram, stream);
+	return stream->mux != NULL;
+}
+
+static bool mpegts_output_start(void *data)
+{
+	struct mpegts_output *stream = data;
+	obs_data_t *settings;
+	const char *path;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	stream->total_bytes = 0;
+	stream->write_error = false;
+	os_atomic_set_bool(&stream->stopping, false);
+
+	/* get path */
+	settings = obs_output_get_settings(stream->output);
+	path = obs_data_get_string(settings, "path");
+	dstr_copy(&stream->path, path);
+	obs_data_release(settings);
+
+	stream->file = os_fopen(stream->path.array, "wb");
+	if (!stream->file) {
+		warn("Unable to open MPEG-TS file '%s'", stream->path.array);
+		return false;
+	}
+
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	info("Writing MPEG-TS file '%s'...", stream->path.array);
+	return true;
+}
+
+static void mpegts_output_stop(void *data, uint64_t ts)
+{
+	struct mpegts_output *stream = data;
+	stream->stop_ts = ts / 1000;
+	os_atomic_set_bool(&stream->stopping, true);
+}
+
+static void mpegts_output_actual_stop(struct mpegts_output *stream, int code)
+{
+	os_atomic_set_bool(&stream->active, false);
+
+	if (stream->mux) {
+		ts_mux_flush(stream->mux);
+		ts_mux_destroy(stream->mux);
+		stream->mux = NULL;
+	}
+	if (stream->file) {
+		fclose(stream->file);
+		stream->file = NULL;
+	}
+	if (code) {
+		obs_output_signal_stop(stream->output, code);
+	} else {
+		obs_output_end_data_capture(stream->output);
+	}
+
+	info("MPEG-TS file output complete");
+}
+
+static void mpegts_output_data(void *data, struct encoder_packet *packet)
+{
+	struct mpegts_output *stream = data;
+
+	pthread_mutex_lock(&stream->mutex);
+
+	if (!active(stream))
+		goto unlock;
+
+	if (!packet) {
+		mpegts_output_actual_stop(stream, OBS_OUTPUT_ENCODE_ERROR);
+		goto unlock;
+	}
+
+	if (stopping(stream)) {
+		if (packet->sys_dts_usec >= (int64_t)stream->stop_ts) {
+			mpegts_output_actual_stop(stream, 0);
+			goto unlock;
+		}
+	}
+
+	if (!stream->mux && !create_mux(stream)) {
+		warn("Unable to set up the MPEG-TS muxer for the output's encoders");
+		mpegts_output_actual_stop(stream, OBS_OUTPUT_UNSUPPORTED);
+		goto unlock;
+	}
+
+	ts_mux_write_packet(stream->mux, packet);
+
+	if (stream->write_error) {
+		warn("Failed to write to MPEG-TS file '%s'", stream->path.array);
+		mpegts_output_actual_stop(stream, OBS_OUTPUT_ERROR);
+	}
+
+unlock:
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static uint64_t mpegts_output_total_bytes(void *data)
+{
+	struct mpegts_output *stream = data;
+	return stream->total_bytes;
+}
+
+static obs_properties_t *mpegts_output_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_text(props, "path", obs_module_text("MpegTSOutput.FilePath"), OBS_TEXT_DEFAULT);
+	return props;
+}
+
+struct obs_output_info mpegts_output_info = {
+	.id = "mpegts_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK,
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc;av1",
+#else
+	.encoded_video_codecs = "h264;av1",
+#endif
+	.encoded_audio_codecs = "aac;opus",
+	.get_name = mpegts_output_getname,
+	.create = mpegts_output_create,
+	.destroy = mpegts_output_destroy,
+	.start = mpegts_output_start,
+	.stop = mpegts_output_stop,
+	.encoded_packet = mpegts_output_data,
+	.get_total_bytes = mpegts_output_total_bytes,
+	.get_properties = mpegts_output_properties,
+};
@@ -666,6 +666,7 @@ static void *send_thread(void *data)
 			dbr_frame.size = packet.size;
 		}
 
+		uint64_t send_start_ts = os_gettime_ns();
 		int sent;
 		if (packet.type == OBS_ENCODER_VIDEO &&
 		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
@@ -682,6 +683,8 @@ static void *send_thread(void *data)
 			break;
 		}
 
+		obs_output_packet_sent(stream->output, &packet, send_start_ts);
+
 		if (stream->dbr_enabled) {
 			dbr_frame.send_end = os_gettime_ns();
 
@@ -0,0 +1,825 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "ts-mux.h"
+#include "rtmp-av1.h"
+
+#include <obs-avc.h>
+#include <obs-hevc.h>
+#include <obs-nal.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+
+/* MPEG-2 transport stream packetiser (ISO/IEC 13818-1) for a single program.
+ * Packets are written straight into a datagram buffer, the only allocation
+ * after creation is a scratch buffer that grows to the largest AV1 frame or
+ * Opus packet. */
+
+#define do_log(level, format, ...) blog(level, "[ts mux] " format, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+
+#define TS_SYNC_BYTE 0x47
+#define TS_HEADER_SIZE 4
+#define TS_PAYLOAD_SIZE (TS_PACKET_SIZE - TS_HEADER_SIZE)
+
+#define PAT_PID 0x0000
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x0100
+#define AUDIO_PID 0x0101
+#define PROGRAM_NUMBER 1
+#define TRANSPORT_STREAM_ID 1
+
+#define STREAM_TYPE_AAC_ADTS 0x0f
+#define STREAM_TYPE_H264 0x1b
+#define STREAM_TYPE_HEVC 0x24
+#define STREAM_TYPE_PRIVATE 0x06
+
+#define STREAM_ID_AUDIO 0xc0
+#define STREAM_ID_VIDEO 0xe0
+#define STREAM_ID_PRIVATE_1 0xbd
+
+#define CLOCK_RATE 90000
+/* keeps the first timestamps of streams with B-frames positive */
+#define CLOCK_OFFSET CLOCK_RATE
+/* how far the PCR runs ahead of the decode timestamps, the default of FFmpeg */
+#define MUX_DELAY (CLOCK_RATE * 7 / 10)
+/* the PCR can only be sampled when a packet arrives, so it's written at half
+ * the 40 ms spacing DVB asks for */
+#define PCR_INTERVAL (CLOCK_RATE * 20 / 1000)
+#define PSI_INTERVAL (CLOCK_RATE / 10)
+#define TIMESTAMP_MASK ((1LL << 33) - 1)
+
+/* 7350 Hz, higher indices are reserved or need an explicit rate */
+#define ADTS_MAX_RATE_INDEX 12
+
+#define AV1_OBU_SEQUENCE_HEADER 1
+#define AV1_OBU_TEMPORAL_DELIMITER 2
+
+#define MAX_DESCRIPTORS_SIZE 16
+#define MAX_CHUNKS 5
+
+enum ts_codec {
+	TS_CODEC_H264,
+	TS_CODEC_HEVC,
+	TS_CODEC_AV1,
+	TS_CODEC_AAC,
+	TS_CODEC_OPUS,
+};
+
+struct ts_stream {
+	enum ts_codec codec;
+	uint16_t pid;
+	uint8_t stream_type;
+	uint8_t stream_id;
+	uint8_t cc;
+
+	uint8_t descriptors[MAX_DESCRIPTORS_SIZE];
+	size_t descriptors_size;
+
+	/* parameter sets, or for AV1 the sequence header OBU, repeated on
+	 * keyframes that don't carry their own */
+	uint8_t *header;
+	size_t header_size;
+
+	/* AAC */
+	uint8_t adts_profile;
+	uint8_t adts_rate_index;
+	uint8_t adts_channels;
+};
+
+struct ts_chunk {
+	const uint8_t *data;
+	size_t size;
+};
+
+struct ts_mux {
+	struct ts_stream video;
+	bool has_video;
+	struct ts_stream audio[TS_MAX_AUDIO_TRACKS];
+	size_t num_audio;
+	struct ts_stream *pcr_stream;
+
+	uint8_t pat_cc;
+	uint8_t pmt_cc;
+	bool started;
+	int64_t last_pcr;
+	int64_t last_psi;
+
+	ts_mux_write_t write;
+	void *param;
+
+	uint8_t datagram[TS_DATAGRAM_SIZE];
+	size_t datagram_size;
+
+	DARRAY(uint8_t) scratch;
+};
+
+/* ------------------------------------------------------------------------- */
+/* Stream setup                                                              */
+
+static bool init_aac(struct ts_stream *stream, const struct ts_mux_track *track)
+{
+	/* AudioSpecificConfig: object type (5), sampling frequency index (4),
+	 * channel configuration (4) */
+	if (!track->header || track->header_size < 2) {
+		warn("AAC track without an AudioSpecificConfig");
+		return false;
+	}
+
+	const uint8_t *asc = track->header;
+	const uint8_t object_type = asc[0] >> 3;
+	const uint8_t rate_index = (uint8_t)(((asc[0] & 0x07) << 1) | (asc[1] >> 7));
+	const uint8_t channels = (asc[1] >> 3) & 0x0f;
+
+	if (!object_type || object_type > 4 || rate_index > ADTS_MAX_RATE_INDEX || !channels || channels > 7) {
+		warn("AAC configuration can't be carried in ADTS");
+		return false;
+	}
+
+	stream->adts_profile = object_type - 1;
+	stream->adts_rate_index = rate_index;
+	stream->adts_channels = channels;
+	return true;
+}
+
+static bool init_opus(struct ts_stream *stream, const struct ts_mux_track *track)
+{
+	if (!track->channels || track->channels > 8) {
+		warn("Opus track with %u channels", track->channels);
+		return false;
+	}
+
+	static const uint8_t registration[] = {0x05, 4, 'O', 'p', 'u', 's'};
+	memcpy(stream->descriptors, registration, sizeof(registration));
+
+	/* extension descriptor with the Opus channel configuration code */
+	uint8_t *ext = stream->descriptors + sizeof(registration);
+	ext[0] = 0x7f;
+	ext[1] = 2;
+	ext[2] = 0x80;
+	ext[3] = (uint8_t)track->channels;
+	stream->descriptors_size = sizeof(registration) + 4;
+	return true;
+}
+
+static bool init_av1(struct ts_stream *stream, const struct ts_mux_track *track)
+{
+	uint8_t *av1c = NULL;
+	size_t size = 0;
+
+	if (track->header && track->header_size)
+		size = obs_parse_av1_header(&av1c, track->header, track->header_size);
+	if (size < 4) {
+		warn("AV1 track without a sequence header");
+		bfree(av1c);
+		return false;
+	}
+
+	static const uint8_t registration[] = {0x05, 4, 'A', 'V', '0', '1'};
+	memcpy(stream->descriptors, registration, sizeof(registration));
+
+	/* AV1 video descriptor: the first three bytes of the configuration
+	 * record, then no HDR/WCG indication */
+	uint8_t *desc = stream->descriptors + sizeof(registration);
+	desc[0] = 0x80;
+	desc[1] = 4;
+	memcpy(desc + 2, av1c, 3);
+	desc[5] = 0xc0;
+	stream->descriptors_size = sizeof(registration) + 6;
+
+	/* the configOBUs that follow the record hold the sequence header */
+	if (size > 4) {
+		stream->header_size = size - 4;
+		stream->header = bmemdup(av1c + 4, stream->header_size);
+	}
+	bfree(av1c);
+	return true;
+}
+
+static bool init_stream(struct ts_stream *stream, const struct ts_mux_track *track, uint16_t pid, bool video)
+{
+	const char *codec = track->codec ? track->codec : "";
+
+	stream->pid = pid;
+
+	if (video && strcmp(codec, "h264") == 0) {
+		stream->codec = TS_CODEC_H264;
+		stream->stream_type = STREAM_TYPE_H264;
+		stream->stream_id = STREAM_ID_VIDEO;
+	} else if (video && strcmp(codec, "hevc") == 0) {
+		stream->codec = TS_CODEC_HEVC;
+		stream->stream_type = STREAM_TYPE_HEVC;
+		stream->stream_id = STREAM_ID_VIDEO;
+	} else if (video && strcmp(codec, "av1") == 0) {
+		stream->codec = TS_CODEC_AV1;
+		stream->stream_type = STREAM_TYPE_PRIVATE;
+		stream->stream_id = STREAM_ID_PRIVATE_1;
+		return init_av1(stream, track);
+	} else if (!video && strcmp(codec, "aac") == 0) {
+		stream->codec = TS_CODEC_AAC;
+		stream->stream_type = STREAM_TYPE_AAC_ADTS;
+		stream->stream_id = STREAM_ID_AUDIO;
+		return init_aac(stream, track);
+	} else if (!video && strcmp(codec, "opus") == 0) {
+		stream->codec = TS_CODEC_OPUS;
+		stream->stream_type = STREAM_TYPE_PRIVATE;
+		stream->stream_id = STREAM_ID_PRIVATE_1;
+		return init_opus(stream, track);
+	} else {
+		warn("Unsupported %s codec '%s'", video ? "video" : "audio", codec);
+		return false;
+	}
+
+	if (track->header && track->header_size) {
+		stream->header = bmemdup(track->header, track->header_size);
+		stream->header_size = track->header_size;
+	}
+	return true;
+}
+
+struct ts_mux *ts_mux_create(const struct ts_mux_track *video, const struct ts_mux_track *audio, size_t num_audio,
+			     ts_mux_write_t write, void *param)
+{
+	if ((!video && !num_audio) || num_audio > TS_MAX_AUDIO_TRACKS || !write)
+		return NULL;
+
+	struct ts_mux *mux = bzalloc(sizeof(struct ts_mux));
+	mux->write = write;
+	mux->param = param;
+
+	if (video) {
+		mux->has_video = true;
+		if (!init_stream(&mux->video, video, VIDEO_PID, true))
+			goto fail;
+	}
+
+	for (size_t i = 0; i < num_audio; i++) {
+		mux->num_audio++;
+		if (!init_stream(&mux->audio[i], &audio[i], (uint16_t)(AUDIO_PID + i), false))
+			goto fail;
+	}
+
+	mux->pcr_stream = video ? &mux->video : &mux->audio[0];
+	return mux;
+
+fail:
+	ts_mux_destroy(mux);
+	return NULL;
+}
+
+void ts_mux_destroy(struct ts_mux *mux)
+{
+	if (!mux)
+		return;
+
+	bfree(mux->video.header);
+	for (size_t i = 0; i < mux->num_audio; i++)
+		bfree(mux->audio[i].header);
+	da_free(mux->scratch);
+	bfree(mux);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Transport packets                                                         */
+
+static inline uint8_t *begin_packet(struct ts_mux *mux)
+{
+	return mux->datagram + mux->datagram_size;
+}
+
+static inline void end_packet(struct ts_mux *mux)
+{
+	mux->datagram_size += TS_PACKET_SIZE;
+	if (mux->datagram_size == TS_DATAGRAM_SIZE) {
+		mux->write(mux->param, mux->datagram, TS_DATAGRAM_SIZE);
+		mux->datagram_size = 0;
+	}
+}
+
+void ts_mux_flush(struct ts_mux *mux)
+{
+	if (mux->datagram_size) {
+		mux->write(mux->param, mux->datagram, mux->datagram_size);
+		mux->datagram_size = 0;
+	}
+}
+
+static inline void write_header(uint8_t *p, uint16_t pid, bool start, uint8_t adaptation_control, uint8_t cc)
+{
+	p[0] = TS_SYNC_BYTE;
+	p[1] = (uint8_t)((start ? 0x40 : 0) | (pid >> 8));
+	p[2] = (uint8_t)pid;
+	p[3] = (uint8_t)(adaptation_control << 4 | (cc & 0x0f));
+}
+
+/* 33 bit base at 90 kHz, the 27 MHz extension is always 0 */
+static inline void write_pcr(uint8_t *p, int64_t pcr)
+{
+	p[0] = (uint8_t)(pcr >> 25);
+	p[1] = (uint8_t)(pcr >> 17);
+	p[2] = (uint8_t)(pcr >> 9);
+	p[3] = (uint8_t)(pcr >> 1);
+	p[4] = (uint8_t)((pcr & 1) << 7 | 0x7e);
+	p[5] = 0;
+}
+
+static void write_pcr_packet(struct ts_mux *mux, int64_t pcr)
+{
+	uint8_t *p = begin_packet(mux);
+
+	/* adaptation field only, so the continuity counter stays */
+	write_header(p, mux->pcr_stream->pid, false, 2, (uint8_t)(mux->pcr_stream->cc - 1));
+	p[4] = TS_PACKET_SIZE - TS_HEADER_SIZE - 1;
+	p[5] = 0x10;
+	write_pcr(p + 6, pcr);
+	memset(p + 12, 0xff, TS_PACKET_SIZE - 12);
+
+	mux->last_pcr = pcr;
+	end_packet(mux);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Program specific information                                              */
+
+static uint32_t crc32_mpeg(const uint8_t *data, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+
+	for (size_t i = 0; i < size; i++) {
+		crc ^= (uint32_t)data[i] << 24;
+		for (int bit = 0; bit < 8; bit++)
+			crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+static void write_section(struct ts_mux *mux, uint16_t pid, uint8_t *cc, const uint8_t *section, size_t size)
+{
+	uint8_t *p = begin_packet(mux);
+
+	write_header(p, pid, true, 1, (*cc)++);
+	p[4] = 0; /* pointer_field */
+	memcpy(p + 5, section, size);
+	memset(p + 5 + size, 0xff, TS_PACKET_SIZE - 5 - size);
+
+	end_packet(mux);
+}
+
+/* table header and CRC around size bytes of section data at data + 8 */
+static size_t finish_section(uint8_t *data, uint8_t table_id, uint16_t id, size_t size)
+{
+	const size_t section_length = 5 + size + 4;
+
+	data[0] = table_id;
+	data[1] = (uint8_t)(0xb0 | (section_length >> 8));
+	data[2] = (uint8_t)section_length;
+	data[3] = (uint8_t)(id >> 8);
+	data[4] = (uint8_t)id;
+	data[5] = 0xc1; /* version 0, current */
+	data[6] = 0;    /* section_number */
+	data[7] = 0;    /* last_section_number */
+
+	const uint32_t crc = crc32_mpeg(data, 8 + size);
+	uint8_t *p = data + 8 + size;
+	p[0] = (uint8_t)(crc >> 24);
+	p[1] = (uint8_t)(crc >> 16);
+	p[2] = (uint8_t)(crc >> 8);
+	p[3] = (uint8_t)crc;
+	return 8 + size + 4;
+}
+
+static size_t write_pmt_stream(uint8_t *p, const struct ts_stream *stream)
+{
+	p[0] = stream->stream_type;
+	p[1] = (uint8_t)(0xe0 | (stream->pid >> 8));
+	p[2] = (uint8_t)stream->pid;
+	p[3] = (uint8_t)(0xf0 | (stream->descriptors_size >> 8));
+	p[4] = (uint8_t)stream->descriptors_size;
+	memcpy(p + 5, stream->descriptors, stream->descriptors_size);
+	return 5 + stream->descriptors_size;
+}
+
+static void write_psi(struct ts_mux *mux)
+{
+	uint8_t section[TS_PAYLOAD_SIZE - 1];
+	size_t size;
+
+	section[8] = (uint8_t)(PROGRAM_NUMBER >> 8);
+	section[9] = (uint8_t)PROGRAM_NUMBER;
+	section[10] = (uint8_t)(0xe0 | (PMT_PID >> 8));
+	section[11] = (uint8_t)PMT_PID;
+	size = finish_section(section, 0x00, TRANSPORT_STREAM_ID, 4);
+	write_section(mux, PAT_PID, &mux->pat_cc, section, size);
+
+	uint8_t *p = section + 8;
+	p[0] = (uint8_t)(0xe0 | (mux->pcr_stream->pid >> 8));
+	p[1] = (uint8_t)mux->pcr_stream->pid;
+	p[2] = 0xf0; /* no program descriptors */
+	p[3] = 0;
+	p += 4;
+
+	if (mux->has_video)
+		p += write_pmt_stream(p, &mux->video);
+	for (size_t i = 0; i < mux->num_audio; i++)
+		p += write_pmt_stream(p, &mux->audio[i]);
+
+	size = finish_section(section, 0x02, PROGRAM_NUMBER, (size_t)(p - section - 8));
+	write_section(mux, PMT_PID, &mux->pmt_cc, section, size);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Packetised elementary streams                                             */
+
+static inline void write_timestamp(uint8_t *p, uint8_t prefix, int64_t ts)
+{
+	ts &= TIMESTAMP_MASK;
+	p[0] = (uint8_t)(prefix << 4 | ((ts >> 29) & 0x0e) | 1);
+	p[1] = (uint8_t)(ts >> 22);
+	p[2] = (uint8_t)(((ts >> 14) & 0xfe) | 1);
+	p[3] = (uint8_t)(ts >> 7);
+	p[4] = (uint8_t)(((ts << 1) & 0xfe) | 1);
+}
+
+static size_t write_pes_header(uint8_t *p, const struct ts_stream *stream, size_t payload_size, int64_t pts,
+			       int64_t dts)
+{
+	const bool has_dts = dts != pts;
+	const size_t header_data_size = has_dts ? 10 : 5;
+	size_t length = 3 + header_data_size + payload_size;
+
+	/* unbounded length is only allowed for video */
+	if (length > 0xffff)
+		length = 0;
+
+	p[0] = 0;
+	p[1] = 0;
+	p[2] = 1;
+	p[3] = stream->stream_id;
+	p[4] = (uint8_t)(length >> 8);
+	p[5] = (uint8_t)length;
+	p[6] = 0x84; /* data_alignment_indicator */
+	p[7] = has_dts ? 0xc0 : 0x80;
+	p[8] = (uint8_t)header_data_size;
+	write_timestamp(p + 9, has_dts ? 3 : 2, pts);
+	if (has_dts)
+		write_timestamp(p + 14, 1, dts);
+	return 9 + header_data_size;
+}
+
+/* splits the chunks over as many packets as needed, the first packet carries
+ * the PCR if pcr >= 0 */
+static void write_pes(struct ts_mux *mux, struct ts_stream *stream, const struct ts_chunk *chunks, size_t num_chunks,
+		      int64_t pcr, bool random_access)
+{
+	size_t remaining = 0;
+	for (size_t i = 0; i < num_chunks; i++)
+		remaining += chunks[i].size;
+
+	size_t chunk = 0;
+	size_t offset = 0;
+	bool first = true;
+
+	while (remaining) {
+		uint8_t *p = begin_packet(mux);
+		const bool has_pcr = first && pcr >= 0;
+		const uint8_t flags = (has_pcr ? 0x10 : 0) | (first && random_access ? 0x40 : 0);
+
+		/* length byte, flags and the PCR, plus stuffing on the last packet */
+		size_t af_size = flags ? 2 + (has_pcr ? 6 : 0) : 0;
+		size_t payload = TS_PAYLOAD_SIZE - af_size;
+		if (remaining < payload) {
+			af_size += payload - remaining;
+			payload = remaining;
+		}
+
+		write_header(p, stream->pid, first, af_size ? 3 : 1, stream->cc++);
+
+		uint8_t *out = p + TS_HEADER_SIZE;
+		if (af_size) {
+			out[0] = (uint8_t)(af_size - 1);
+			if (af_size > 1) {
+				out[1] = flags;
+				if (has_pcr)
+					write_pcr(out + 2, pcr);
+				const size_t used = 2 + (has_pcr ? 6 : 0);
+				memset(out + used, 0xff, af_size - used);
+			}
+			out += af_size;
+		}
+
+		for (size_t left = payload; left;) {
+			size_t n = chunks[chunk].size - offset;
+			if (n > left)
+				n = left;
+			memcpy(out, chunks[chunk].data + offset, n);
+			out += n;
+			offset += n;
+			left -= n;
+			if (offset == chunks[chunk].size) {
+				chunk++;
+				offset = 0;
+			}
+		}
+
+		if (has_pcr)
+			mux->last_pcr = pcr;
+		remaining -= payload;
+		first = false;
+		end_packet(mux);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* Codec specific framing                                                    */
+
+static inline int nal_type(enum ts_codec codec, const uint8_t *nal)
+{
+	return codec == TS_CODEC_H264 ? nal[0] & 0x1f : (nal[0] >> 1) & 0x3f;
+}
+
+/* whether the packet starts with an access unit delimiter, and whether it
+ * carries its own parameter sets */
+static void scan_nals(enum ts_codec codec, const uint8_t *data, size_t size, bool *has_aud, bool *has_params)
+{
+	const int aud = codec == TS_CODEC_H264 ? OBS_NAL_AUD : OBS_HEVC_NAL_AUD;
+	const int params = codec == TS_CODEC_H264 ? OBS_NAL_SPS : OBS_HEVC_NAL_VPS;
+	const uint8_t *end = data + size;
+	const uint8_t *nal = obs_nal_find_startcode(data, end);
+	bool first = true;
+
+	*has_aud = false;
+	*has_params = false;
+
+	while (nal < end) {
+		while (nal < end && !*nal)
+			nal++;
+		if (++nal >= end)
+			break;
+
+		const int type = nal_type(codec, nal);
+		if (first && type == aud)
+			*has_aud = true;
+		if (type == params)
+			*has_params = true;
+
+		first = false;
+		nal = obs_nal_find_startcode(nal, end);
+	}
+}
+
+static size_t frame_nal(const struct ts_stream *stream, const struct encoder_packet *packet, struct ts_chunk *chunks)
+{
+	static const uint8_t h264_aud[] = {0, 0, 0, 1, 0x09, 0xf0};
+	static const uint8_t hevc_aud[] = {0, 0, 0, 1, 0x46, 0x01, 0x50};
+	bool has_aud, has_params;
+	size_t num = 0;
+
+	scan_nals(stream->codec, packet->data, packet->size, &has_aud, &has_params);
+
+	if (!has_aud) {
+		if (stream->codec == TS_CODEC_H264)
+			chunks[num++] = (struct ts_chunk){h264_aud, sizeof(h264_aud)};
+		else
+			chunks[num++] = (struct ts_chunk){hevc_aud, sizeof(hevc_aud)};
+	}
+	if (packet->keyframe && !has_params && stream->header_size)
+		chunks[num++] = (struct ts_chunk){stream->header, stream->header_size};
+
+	chunks[num++] = (struct ts_chunk){packet->data, packet->size};
+	return num;
+}
+
+static inline uint64_t read_leb128(const uint8_t **p, const uint8_t *end)
+{
+	uint64_t value = 0;
+
+	for (int i = 0; i < 8 && *p < end; i++) {
+		const uint8_t byte = *(*p)++;
+		value |= (uint64_t)(byte & 0x7f) << (i * 7);
+		if (!(byte & 0x80))
+			break;
+	}
+	return value;
+}
+
+/* OBU boundaries in low overhead bitstream format, returns false at the end
+ * or on truncated data */
+static bool next_obu(const uint8_t **p, const uint8_t *end, const uint8_t **obu, size_t *obu_size, int *type)
+{
+	const uint8_t *start = *p;
+	if (start >= end)
+		return false;
+
+	const uint8_t header = start[0];
+	const uint8_t *data = start + 1 + ((header & 0x04) ? 1 : 0);
+	if (data > end)
+		return false;
+
+	size_t size;
+	if (header & 0x02) {
+		size = (size_t)read_leb128(&data, end);
+		if (size > (size_t)(end - data))
+			return false;
+	} else {
+		size = (size_t)(end - data);
+	}
+
+	*obu = start;
+	*obu_size = (size_t)(data - start) + size;
+	*type = (header >> 3) & 0x0f;
+	*p = data + size;
+	return true;
+}
+
+/* start code and emulation prevention for one OBU */
+static void append_obu(struct ts_mux *mux, const uint8_t *obu, size_t size)
+{
+	static const uint8_t start_code[] = {0, 0, 1};
+	int zeros = 0;
+
+	da_push_back_array(mux->scratch, start_code, sizeof(start_code));
+	da_reserve(mux->scratch, mux->scratch.num + size + size / 2 + 1);
+
+	for (size_t i = 0; i < size; i++) {
+		const uint8_t byte = obu[i];
+		if (zeros >= 2 && byte <= 3) {
+			mux->scratch.array[mux->scratch.num++] = 3;
+			zeros = 0;
+		}
+		mux->scratch.array[mux->scratch.num++] = byte;
+		zeros = byte ? 0 : zeros + 1;
+	}
+	if (zeros)
+		mux->scratch.array[mux->scratch.num++] = 3;
+}
+
+static size_t frame_av1(struct ts_mux *mux, const struct ts_stream *stream, const struct encoder_packet *packet,
+			struct ts_chunk *chunks)
+{
+	static const uint8_t temporal_delimiter[] = {AV1_OBU_TEMPORAL_DELIMITER << 3 | 0x02, 0};
+	const uint8_t *end = packet->data + packet->size;
+	const uint8_t *p = packet->data;
+	const uint8_t *obu;
+	size_t obu_size;
+	bool has_td = false, has_seq = false;
+	int type;
+
+	for (bool first = true; next_obu(&p, end, &obu, &obu_size, &type); first = false) {
+		if (first && type == AV1_OBU_TEMPORAL_DELIMITER)
+			has_td = true;
+		if (type == AV1_OBU_SEQUENCE_HEADER)
+			has_seq = true;
+	}
+
+	da_resize(mux->scratch, 0);
+	if (!has_td)
+		append_obu(mux, temporal_delimiter, sizeof(temporal_delimiter));
+
+	if (packet->keyframe && !has_seq && stream->header_size) {
+		const uint8_t *h = stream->header;
+		while (next_obu(&h, stream->header + stream->header_size, &obu, &obu_size, &type)) {
+			if (type == AV1_OBU_SEQUENCE_HEADER)
+				append_obu(mux, obu, obu_size);
+		}
+	}
+
+	for (p = packet->data; next_obu(&p, end, &obu, &obu_size, &type);)
+		append_obu(mux, obu, obu_size);
+
+	chunks[0] = (struct ts_chunk){mux->scratch.array, mux->scratch.num};
+	return 1;
+}
+
+static size_t frame_aac(const struct ts_stream *stream, const struct encoder_packet *packet, uint8_t *adts,
+			struct ts_chunk *chunks)
+{
+	size_t num = 0;
+
+	if (packet->size < 2 || packet->data[0] != 0xff || (packet->data[1] & 0xf0) != 0xf0) {
+		const size_t frame_length = 7 + packet->size;
+
+		adts[0] = 0xff;
+		adts[1] = 0xf1; /* MPEG-4, no CRC */
+		adts[2] = (uint8_t)(stream->adts_profile << 6 | stream->adts_rate_index << 2 |
+				    stream->adts_channels >> 2);
+		adts[3] = (uint8_t)((stream->adts_channels & 3) << 6 | ((frame_length >> 11) & 3));
+		adts[4] = (uint8_t)(frame_length >> 3);
+		adts[5] = (uint8_t)((frame_length & 7) << 5 | 0x1f);
+		adts[6] = 0xfc; /* buffer fullness 0x7ff, one raw data block */
+		chunks[num++] = (struct ts_chunk){adts, 7};
+	}
+
+	chunks[num++] = (struct ts_chunk){packet->data, packet->size};
+	return num;
+}
+
+static size_t frame_opus(struct ts_mux *mux, const struct encoder_packet *packet, struct ts_chunk *chunks)
+{
+	/* control header with the access unit size in 255 byte runs */
+	da_resize(mux->scratch, 2 + packet->size / 255 + 1);
+	uint8_t *p = mux->scratch.array;
+
+	*p++ = 0x7f;
+	*p++ = 0xe0;
+	for (size_t size = packet->size;; size -= 255) {
+		if (size < 255) {
+			*p++ = (uint8_t)size;
+			break;
+		}
+		*p++ = 0xff;
+	}
+
+	chunks[0] = (struct ts_chunk){mux->scratch.array, mux->scratch.num};
+	chunks[1] = (struct ts_chunk){packet->data, packet->size};
+	return 2;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline int64_t to_clock(int64_t ts, const struct encoder_packet *packet)
+{
+	return ts * CLOCK_RATE * packet->timebase_num / packet->timebase_den;
+}
+
+bool ts_mux_write_packet(struct ts_mux *mux, const struct encoder_packet *packet)
+{
+	struct ts_stream *stream;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (!mux->has_video)
+			return false;
+		stream = &mux->video;
+	} else {
+		if (packet->track_idx >= mux->num_audio)
+			return false;
+		stream = &mux->audio[packet->track_idx];
+	}
+
+	if (!packet->size || !packet->timebase_den)
+		return false;
+
+	struct ts_chunk chunks[MAX_CHUNKS];
+	uint8_t pes_header[19];
+	uint8_t adts[7];
+	size_t num = 1;
+
+	switch (stream->codec) {
+	case TS_CODEC_H264:
+	case TS_CODEC_HEVC:
+		num += frame_nal(stream, packet, chunks + 1);
+		break;
+	case TS_CODEC_AV1:
+		num += frame_av1(mux, stream, packet, chunks + 1);
+		break;
+	case TS_CODEC_AAC:
+		num += frame_aac(stream, packet, adts, chunks + 1);
+		break;
+	case TS_CODEC_OPUS:
+		num += frame_opus(mux, packet, chunks + 1);
+		break;
+	}
+
+	size_t payload_size = 0;
+	for (size_t i = 1; i < num; i++)
+		payload_size += chunks[i].size;
+
+	const int64_t dts = to_clock(packet->dts, packet) + CLOCK_OFFSET;
+	const int64_t pts = to_clock(packet->pts, packet) + CLOCK_OFFSET;
+	chunks[0].data = pes_header;
+	chunks[0].size = write_pes_header(pes_header, stream, payload_size, pts + MUX_DELAY, dts + MUX_DELAY);
+
+	/* the PCR follows the decode timestamps, but never goes back */
+	int64_t clock = dts;
+	if (mux->started && clock < mux->last_pcr)
+		clock = mux->last_pcr;
+
+	const bool keyframe = packet->keyframe && stream == &mux->video;
+	if (!mux->started || keyframe || clock - mux->last_psi >= PSI_INTERVAL) {
+		write_psi(mux);
+		mux->last_psi = clock;
+	}
+
+	if (stream == mux->pcr_stream) {
+		write_pes(mux, stream, chunks, num, clock, packet->keyframe);
+	} else {
+		if (!mux->started || clock - mux->last_pcr >= PCR_INTERVAL)
+			write_pcr_packet(mux, clock);
+		write_pes(mux, stream, chunks, num, -1, packet->keyframe);
+	}
+
+	mux->started = true;
+	return true;
+}
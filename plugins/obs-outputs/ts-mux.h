@@ -0,0 +1,32 @@
+#pragma once
+
+#include <obs.h>
+
+#define TS_PACKET_SIZE 188
+#define TS_DATAGRAM_PACKETS 7
+#define TS_DATAGRAM_SIZE (TS_PACKET_SIZE * TS_DATAGRAM_PACKETS)
+#define TS_MAX_AUDIO_TRACKS MAX_OUTPUT_AUDIO_ENCODERS
+
+struct ts_mux;
+
+struct ts_mux_track {
+	/* "h264", "hevc" or "av1" for video, "aac" or "opus" for audio */
+	const char *codec;
+	/* encoder extra data */
+	const uint8_t *header;
+	size_t header_size;
+	/* audio only */
+	uint32_t channels;
+};
+
+/* Called with whole datagrams of TS_DATAGRAM_SIZE bytes, except for the last
+ * one written by ts_mux_flush */
+typedef void (*ts_mux_write_t)(void *param, const uint8_t *data, size_t size);
+
+/* Either video or audio tracks can be omitted.  Audio packets select their
+ * track with track_idx. */
+struct ts_mux *ts_mux_create(const struct ts_mux_track *video, const struct ts_mux_track *audio, size_t num_audio,
+			     ts_mux_write_t write, void *param);
+void ts_mux_destroy(struct ts_mux *mux);
+bool ts_mux_write_packet(struct ts_mux *mux, const struct encoder_packet *packet);
+void ts_mux_flush(struct ts_mux *mux);
@@ -26,6 +26,20 @@ const uint8_t video_payload_type = 96;
 // ~3 seconds of 8.5 Megabit video
 const int video_nack_buffer_size = 4000;
 
+static void get_send_stats_proc(void *data, calldata_t *cd)
+{
+	WHIPSendStats stats = static_cast<WHIPOutput *>(data)->GetSendStats();
+
+	calldata_set_int(cd, "queue_depth", (long long)stats.queue_depth);
+	calldata_set_int(cd, "max_queue_depth", (long long)stats.max_queue_depth);
+	calldata_set_int(cd, "queued_bytes", (long long)stats.queued_bytes);
+	calldata_set_int(cd, "dropped_packets", (long long)stats.dropped_packets);
+	calldata_set_int(cd, "avg_pacing_delay_us", (long long)(stats.avg_pacing_delay_ns / 1000));
+	calldata_set_int(cd, "max_pacing_delay_us", (long long)(stats.max_pacing_delay_ns / 1000));
+	calldata_set_int(cd, "avg_queue_wait_us", (long long)(stats.avg_queue_wait_ns / 1000));
+	calldata_set_int(cd, "max_queue_wait_us", (long long)(stats.max_queue_wait_ns / 1000));
+}
+
 WHIPOutput::WHIPOutput(obs_data_t *, obs_output_t *output)
 	: output(output),
 	  endpoint_url(),
@@ -38,12 +52,22 @@ WHIPOutput::WHIPOutput(obs_data_t *, obs_output_t *output)
 	  peer_connection(nullptr),
 	  audio_track(nullptr),
 	  video_track(nullptr),
+	  video_bitrate_bps(0),
+	  send_queue([this](struct encoder_packet *packet, uint64_t send_start_ts) {
+		  SendPacket(packet, send_start_ts);
+	  }),
 	  total_bytes_sent(0),
 	  connect_time_ms(0),
 	  start_time_ns(0),
 	  last_audio_timestamp(0),
 	  last_video_timestamp(0)
 {
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_send_stats(out int queue_depth, out int max_queue_depth, out int queued_bytes, "
+			 "out int dropped_packets, out int avg_pacing_delay_us, out int max_pacing_delay_us, "
+			 "out int avg_queue_wait_us, out int max_queue_wait_us)",
+			 get_send_stats_proc, this);
 }
 
 WHIPOutput::~WHIPOutput()
@@ -88,13 +112,22 @@ void WHIPOutput::Data(struct encoder_packet *packet)
 		return;
 	}
 
-	if (audio_track && packet->type == OBS_ENCODER_AUDIO) {
+	if ((audio_track && packet->type == OBS_ENCODER_AUDIO) || (video_track && packet->type == OBS_ENCODER_VIDEO))
+		send_queue.Push(packet);
+}
+
+/* runs on the send thread, durations are taken from the packets that are
+ * actually sent so that dropped ones are folded into the next */
+void WHIPOutput::SendPacket(struct encoder_packet *packet, uint64_t send_start_ts)
+{
+	if (packet->type == OBS_ENCODER_AUDIO) {
 		int64_t duration = packet->dts_usec - last_audio_timestamp;
 		Send(packet->data, packet->size, duration, audio_track, audio_sr_reporter);
 		last_audio_timestamp = packet->dts_usec;
-	} else if (video_track && packet->type == OBS_ENCODER_VIDEO) {
+	} else {
 		int64_t duration = packet->dts_usec - last_video_timestamp;
 		Send(packet->data, packet->size, duration, video_track, video_sr_reporter);
+		obs_output_packet_sent(output, packet, send_start_ts);
 		last_video_timestamp = packet->dts_usec;
 	}
 }
@@ -176,11 +209,15 @@ void WHIPOutput::ConfigureVideoTrack(std::string media_stream_id, std::string cn
 	packetizer->addToChain(video_sr_reporter);
 	packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>(video_nack_buffer_size));
 
+	// The send queue paces whole frames, this spreads the RTP packets of a
+	// frame so that keyframes don't go out in a single burst
 	if (video_bitrate != 0) {
 		packetizer->addToChain(std::make_shared<rtc::PacingHandler>(static_cast<double>(video_bitrate * 10000),
 									    std::chrono::milliseconds(5)));
 	}
 
+	video_bitrate_bps = video_bitrate > 0 ? (uint64_t)video_bitrate * 1000 : 0;
+
 	video_track = peer_connection->addTrack(video_description);
 	video_track->setMediaHandler(packetizer);
 }
@@ -524,6 +561,7 @@ void WHIPOutput::StartThread()
 		return;
 	}
 
+	send_queue.Start(video_bitrate_bps);
 	obs_output_begin_data_capture(output, 0);
 	running = true;
 }
@@ -581,6 +619,18 @@ void WHIPOutput::SendDelete()
 
 void WHIPOutput::StopThread(bool signal)
 {
+	WHIPSendStats stats = send_queue.GetStats();
+	send_queue.Stop();
+
+	if (stats.max_queue_depth) {
+		do_log(LOG_INFO,
+		       "Send queue: max depth %zu packets, %llu dropped, pacing delay avg %.1fms / max %.1fms, "
+		       "queue wait avg %.1fms / max %.1fms",
+		       stats.max_queue_depth, (unsigned long long)stats.dropped_packets,
+		       stats.avg_pacing_delay_ns / 1000000.0, stats.max_pacing_delay_ns / 1000000.0,
+		       stats.avg_queue_wait_ns / 1000000.0, stats.max_queue_wait_ns / 1000000.0);
+	}
+
 	if (peer_connection != nullptr) {
 		peer_connection->close();
 		peer_connection = nullptr;
@@ -610,14 +660,12 @@ void WHIPOutput::StopThread(bool signal)
 	last_video_timestamp = 0;
 }
 
-void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
+void WHIPOutput::Send(const void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
 		      std::shared_ptr<rtc::RtcpSrReporter> rtcp_sr_reporter)
 {
 	if (track == nullptr || !track->isOpen())
 		return;
 
-	std::vector<rtc::byte> sample{(rtc::byte *)data, (rtc::byte *)data + size};
-
 	auto rtp_config = rtcp_sr_reporter->rtpConfig;
 
 	// Sample time is in microseconds, we need to convert it to seconds
@@ -637,8 +685,8 @@ void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration, std::shared
 		rtcp_sr_reporter->setNeedsToReport();
 
 	try {
-		track->send(sample);
-		total_bytes_sent += sample.size();
+		track->send(reinterpret_cast<const rtc::byte *>(data), size);
+		total_bytes_sent += size;
 	} catch (const std::exception &e) {
 		do_log(LOG_ERROR, "error: %s ", e.what());
 	}
@@ -13,6 +13,8 @@
 
 #include <rtc/rtc.hpp>
 
+#include "whip-send-queue.h"
+
 class WHIPOutput {
 public:
 	WHIPOutput(obs_data_t *settings, obs_output_t *output);
@@ -23,6 +25,7 @@ public:
 	void Data(struct encoder_packet *packet);
 
 	inline size_t GetTotalBytes() { return total_bytes_sent; }
+	inline WHIPSendStats GetSendStats() { return send_queue.GetStats(); }
 
 	inline int GetConnectTime() { return connect_time_ms; }
 
@@ -37,7 +40,8 @@ private:
 	void StopThread(bool signal);
 	void ParseLinkHeader(std::string linkHeader, std::vector<rtc::IceServer> &iceServers);
 
-	void Send(void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
+	void SendPacket(struct encoder_packet *packet, uint64_t send_start_ts);
+	void Send(const void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
 		  std::shared_ptr<rtc::RtcpSrReporter> rtcp_sr_reporter);
 
 	obs_output_t *output;
@@ -57,6 +61,9 @@ private:
 	std::shared_ptr<rtc::Track> video_track;
 	std::shared_ptr<rtc::RtcpSrReporter> audio_sr_reporter;
 	std::shared_ptr<rtc::RtcpSrReporter> video_sr_reporter;
+	uint64_t video_bitrate_bps;
+
+	WHIPSendQueue send_queue;
 
 	std::atomic<size_t> total_bytes_sent;
 	std::atomic<int> connect_time_ms;
@@ -0,0 +1,264 @@
+#include "whip-send-queue.h"
+
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <algorithm>
+
+/* queued packets spanning more than this are dropped, as the connection is
+ * clearly not keeping up */
+static const int64_t max_queue_usec = 2000000;
+
+/* bytes that may go out in a burst before pacing kicks in, in seconds of
+ * bitrate.  keyframes larger than this still go out in one piece once the
+ * bucket is empty. */
+static const double pacing_burst_seconds = 0.25;
+
+WHIPSendQueue::WHIPSendQueue(SendFunc send)
+	: send(send),
+	  mutex(),
+	  cv(),
+	  send_thread(),
+	  running(false),
+	  stopping(false),
+	  packets(),
+	  queued_bytes(0),
+	  drop_until_keyframe(false),
+	  bucket_rate(0.0),
+	  bucket_capacity(0.0),
+	  bucket_level(0.0),
+	  bucket_ts(0),
+	  pacing_start_ts(0),
+	  max_queue_depth(0),
+	  dropped_packets(0),
+	  paced_packets(0),
+	  total_pacing_delay_ns(0),
+	  max_pacing_delay_ns(0),
+	  sent_packets(0),
+	  total_queue_wait_ns(0),
+	  max_queue_wait_ns(0)
+{
+}
+
+WHIPSendQueue::~WHIPSendQueue()
+{
+	Stop();
+}
+
+void WHIPSendQueue::Start(uint64_t video_bitrate_bps)
+{
+	Stop();
+
+	std::lock_guard<std::mutex> l(mutex);
+
+	/* bytes per nanosecond */
+	bucket_rate = (double)video_bitrate_bps / 8.0 / 1000000000.0;
+	bucket_capacity = (double)video_bitrate_bps / 8.0 * pacing_burst_seconds;
+	bucket_level = 0.0;
+	bucket_ts = os_gettime_ns();
+	pacing_start_ts = 0;
+
+	drop_until_keyframe = false;
+	max_queue_depth = 0;
+	dropped_packets = 0;
+	paced_packets = 0;
+	total_pacing_delay_ns = 0;
+	max_pacing_delay_ns = 0;
+	sent_packets = 0;
+	total_queue_wait_ns = 0;
+	max_queue_wait_ns = 0;
+
+	stopping = false;
+	running = true;
+	send_thread = std::thread(&WHIPSendQueue::SendThread, this);
+}
+
+void WHIPSendQueue::Stop()
+{
+	{
+		std::lock_guard<std::mutex> l(mutex);
+		if (!running)
+			return;
+
+		stopping = true;
+		running = false;
+	}
+
+	cv.notify_all();
+	send_thread.join();
+
+	std::lock_guard<std::mutex> l(mutex);
+	while (!packets.empty())
+		PopFront(false);
+}
+
+bool WHIPSendQueue::IsFull(const struct encoder_packet *packet)
+{
+	return !packets.empty() && packet->dts_usec - packets.front().packet.dts_usec > max_queue_usec;
+}
+
+/* stale video goes first, the decoder recovers at the next keyframe */
+void WHIPSendQueue::DropVideo()
+{
+	pacing_start_ts = 0;
+
+	for (auto it = packets.begin(); it != packets.end();) {
+		if (it->packet.type != OBS_ENCODER_VIDEO) {
+			++it;
+			continue;
+		}
+
+		queued_bytes -= it->packet.size;
+		obs_encoder_packet_release(&it->packet);
+		it = packets.erase(it);
+		dropped_packets++;
+	}
+
+	drop_until_keyframe = true;
+}
+
+void WHIPSendQueue::PopFront(bool dropped)
+{
+	QueuedPacket &front = packets.front();
+
+	queued_bytes -= front.packet.size;
+	obs_encoder_packet_release(&front.packet);
+	packets.pop_front();
+
+	if (dropped)
+		dropped_packets++;
+}
+
+bool WHIPSendQueue::Push(struct encoder_packet *packet)
+{
+	std::unique_lock<std::mutex> l(mutex);
+
+	if (!running)
+		return false;
+
+	const bool video = packet->type == OBS_ENCODER_VIDEO;
+
+	if (IsFull(packet))
+		DropVideo();
+
+	if (video && drop_until_keyframe) {
+		if (!packet->keyframe) {
+			dropped_packets++;
+			return false;
+		}
+		drop_until_keyframe = false;
+	}
+
+	/* only audio left and still full */
+	if (IsFull(packet)) {
+		dropped_packets++;
+		return false;
+	}
+
+	QueuedPacket queued = {};
+	obs_encoder_packet_ref(&queued.packet, packet);
+	queued.queued_ts = os_gettime_ns();
+
+	packets.push_back(queued);
+	queued_bytes += packet->size;
+	max_queue_depth = std::max(max_queue_depth, packets.size());
+
+	l.unlock();
+	cv.notify_one();
+	return true;
+}
+
+std::deque<WHIPSendQueue::QueuedPacket>::iterator WHIPSendQueue::FirstAudio()
+{
+	return std::find_if(packets.begin(), packets.end(),
+			    [](const QueuedPacket &queued) { return queued.packet.type != OBS_ENCODER_VIDEO; });
+}
+
+/* returns how long to wait before a video packet of the given size may be
+ * sent, and takes it out of the bucket if that is now */
+uint64_t WHIPSendQueue::PacingWait(size_t size, uint64_t now)
+{
+	if (bucket_rate <= 0.0)
+		return 0;
+
+	bucket_level = std::max(0.0, bucket_level - (double)(now - bucket_ts) * bucket_rate);
+	bucket_ts = now;
+
+	const double excess = std::min(bucket_level + (double)size - bucket_capacity, bucket_level);
+	if (excess > 0.0)
+		return std::max((uint64_t)(excess / bucket_rate), (uint64_t)1);
+
+	bucket_level += (double)size;
+	return 0;
+}
+
+void WHIPSendQueue::SendThread()
+{
+	os_set_thread_name("whip-output: send thread");
+
+	std::unique_lock<std::mutex> l(mutex);
+
+	while (true) {
+		cv.wait(l, [this] { return stopping || !packets.empty(); });
+		if (stopping)
+			break;
+
+		auto next = packets.begin();
+		uint64_t now = os_gettime_ns();
+
+		if (next->packet.type == OBS_ENCODER_VIDEO) {
+			const uint64_t wait_ns = PacingWait(next->packet.size, now);
+			if (wait_ns) {
+				if (!pacing_start_ts)
+					pacing_start_ts = now;
+
+				/* only video is paced, audio goes ahead of it */
+				next = FirstAudio();
+				if (next == packets.end()) {
+					/* the video may be dropped while waiting, so
+					 * start over afterwards */
+					cv.wait_for(l, std::chrono::nanoseconds(wait_ns),
+						    [this] { return stopping || FirstAudio() != packets.end(); });
+					continue;
+				}
+			} else if (pacing_start_ts) {
+				const uint64_t delay = now - pacing_start_ts;
+
+				paced_packets++;
+				total_pacing_delay_ns += delay;
+				max_pacing_delay_ns = std::max(max_pacing_delay_ns, delay);
+				pacing_start_ts = 0;
+			}
+		}
+
+		QueuedPacket queued = *next;
+		queued_bytes -= queued.packet.size;
+		packets.erase(next);
+
+		const uint64_t queue_wait = now - queued.queued_ts;
+		sent_packets++;
+		total_queue_wait_ns += queue_wait;
+		max_queue_wait_ns = std::max(max_queue_wait_ns, queue_wait);
+
+		l.unlock();
+		send(&queued.packet, now);
+		obs_encoder_packet_release(&queued.packet);
+		l.lock();
+	}
+}
+
+WHIPSendStats WHIPSendQueue::GetStats()
+{
+	std::lock_guard<std::mutex> l(mutex);
+
+	WHIPSendStats stats = {};
+	stats.queue_depth = packets.size();
+	stats.max_queue_depth = max_queue_depth;
+	stats.queued_bytes = queued_bytes;
+	stats.dropped_packets = dropped_packets;
+	stats.avg_pacing_delay_ns = paced_packets ? total_pacing_delay_ns / paced_packets : 0;
+	stats.max_pacing_delay_ns = max_pacing_delay_ns;
+	stats.avg_queue_wait_ns = sent_packets ? total_queue_wait_ns / sent_packets : 0;
+	stats.max_queue_wait_ns = max_queue_wait_ns;
+	return stats;
+}
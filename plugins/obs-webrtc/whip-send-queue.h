@@ -0,0 +1,86 @@
+#pragma once
+
+#include <obs.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct WHIPSendStats {
+	size_t queue_depth;
+	size_t max_queue_depth;
+	size_t queued_bytes;
+	uint64_t dropped_packets;
+	uint64_t avg_pacing_delay_ns;
+	uint64_t max_pacing_delay_ns;
+	uint64_t avg_queue_wait_ns;
+	uint64_t max_queue_wait_ns;
+};
+
+/*
+ * Hands encoded packets from the output's packet callback over to a send
+ * thread.  Packets are referenced rather than copied, and released once the
+ * send function has returned.  Video is paced by a leaky bucket draining at
+ * the encoder bitrate.  Audio is not paced and overtakes video that is waiting
+ * for the bucket, each track is still sent in order.
+ *
+ * The send function is the only link to the peer connection, which keeps the
+ * queue usable on its own against a stand-in endpoint.
+ */
+class WHIPSendQueue {
+public:
+	using SendFunc = std::function<void(struct encoder_packet *packet, uint64_t send_start_ts)>;
+
+	WHIPSendQueue(SendFunc send);
+	~WHIPSendQueue();
+
+	void Start(uint64_t video_bitrate_bps);
+	void Stop();
+
+	/* returns false if the packet was dropped */
+	bool Push(struct encoder_packet *packet);
+
+	WHIPSendStats GetStats();
+
+private:
+	struct QueuedPacket {
+		struct encoder_packet packet;
+		uint64_t queued_ts;
+	};
+
+	void SendThread();
+	std::deque<QueuedPacket>::iterator FirstAudio();
+	bool IsFull(const struct encoder_packet *packet);
+	void DropVideo();
+	void PopFront(bool dropped);
+	uint64_t PacingWait(size_t size, uint64_t now);
+
+	SendFunc send;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread send_thread;
+	bool running;
+	bool stopping;
+
+	std::deque<QueuedPacket> packets;
+	size_t queued_bytes;
+	bool drop_until_keyframe;
+
+	double bucket_rate;
+	double bucket_capacity;
+	double bucket_level;
+	uint64_t bucket_ts;
+	uint64_t pacing_start_ts;
+
+	size_t max_queue_depth;
+	uint64_t dropped_packets;
+	uint64_t paced_packets;
+	uint64_t total_pacing_delay_ns;
+	uint64_t max_pacing_delay_ns;
+	uint64_t sent_packets;
+	uint64_t total_queue_wait_ns;
+	uint64_t max_queue_wait_ns;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+/* Shared by the tests that start libobs, include after cmocka.h */
+
+#include <obs.h>
+
+/* Starts libobs, or skips the test where it can't be started because it needs
+ * a display for hotkeys on some platforms */
+static inline void obs_test_startup(void)
+{
+	if (!obs_startup("en-US", NULL, NULL))
+		skip();
+}
+
+/* Callbacks for test sources that need no data of their own */
+static inline const char *obs_test_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "test source";
+}
+
+static inline void *obs_test_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return (void *)1;
+}
+
+static inline void obs_test_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
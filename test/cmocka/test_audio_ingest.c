@@ -0,0 +1,147 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "libobs-test.h"
+
+#define FRAMES 1024
+
+static float left[FRAMES];
+static float right[FRAMES];
+
+static const uint8_t *last_ptr;
+static float last_left[FRAMES];
+static float last_right[FRAMES];
+
+static struct obs_source_info audio_source = {
+	.id = "audio_ingest_test",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+};
+
+/* halves the audio in place */
+static struct obs_audio_data *halve_filter_audio(void *data, struct obs_audio_data *audio)
+{
+	UNUSED_PARAMETER(data);
+
+	for (size_t i = 0; i < 2; i++) {
+		float *plane = (float *)audio->data[i];
+		for (uint32_t frame = 0; frame < audio->frames; frame++)
+			plane[frame] *= 0.5f;
+	}
+	return audio;
+}
+
+static struct obs_source_info halve_filter = {
+	.id = "audio_ingest_halve_filter",
+	.type = OBS_SOURCE_TYPE_FILTER,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.filter_audio = halve_filter_audio,
+};
+
+static void audio_capture(void *param, obs_source_t *source, const struct audio_data *data, bool muted)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(muted);
+
+	last_ptr = data->data[0];
+	memcpy(last_left, data->data[0], sizeof(last_left));
+	memcpy(last_right, data->data[1], sizeof(last_right));
+}
+
+static void output_block(obs_source_t *source, uint64_t ts)
+{
+	struct obs_source_audio audio = {
+		.data = {(uint8_t *)left, (uint8_t *)right},
+		.frames = FRAMES,
+		.speakers = SPEAKERS_STEREO,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.samples_per_sec = 48000,
+		.timestamp = ts,
+	};
+
+	obs_source_output_audio(source, &audio);
+}
+
+static void audio_ingest_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	struct obs_audio_info oai = {.samples_per_sec = 48000, .speakers = SPEAKERS_STEREO};
+	assert_true(obs_reset_audio(&oai));
+
+	obs_register_source(&audio_source);
+	obs_source_t *source = obs_source_create_private(audio_source.id, "audio", NULL);
+	assert_non_null(source);
+	obs_source_add_audio_capture_callback(source, audio_capture, NULL);
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		left[i] = sinf((float)i * 0.01f);
+		right[i] = cosf((float)i * 0.02f) * 0.5f;
+	}
+
+	/* matching planar float audio is passed on without a copy */
+	output_block(source, 0);
+	assert_true(last_ptr == (const uint8_t *)left);
+	assert_memory_equal(last_right, right, sizeof(right));
+
+	/* full left balance silences the right channel */
+	obs_source_set_balance_value(source, 0.0f);
+	output_block(source, 0);
+	assert_true(last_ptr != (const uint8_t *)left);
+	for (size_t i = 0; i < FRAMES; i++) {
+		assert_true(fabsf(last_left[i] - left[i]) < 1e-6f);
+		assert_true(fabsf(last_right[i]) < 1e-6f);
+	}
+	obs_source_set_balance_value(source, 0.5f);
+
+	obs_source_set_flags(source, OBS_SOURCE_FLAG_FORCE_MONO);
+	output_block(source, 0);
+	for (size_t i = 0; i < FRAMES; i++) {
+		const float mono = (left[i] + right[i]) * 0.5f;
+		assert_true(fabsf(last_left[i] - mono) < 1e-6f);
+		assert_true(fabsf(last_right[i] - mono) < 1e-6f);
+	}
+	obs_source_set_flags(source, 0);
+
+	/* filters get a copy, the source's own buffers are left alone */
+	obs_register_source(&halve_filter);
+	obs_source_t *filter = obs_source_create_private(halve_filter.id, "halve", NULL);
+	assert_non_null(filter);
+	obs_source_filter_add(source, filter);
+	output_block(source, 0);
+	assert_true(last_ptr != (const uint8_t *)left);
+	for (size_t i = 0; i < FRAMES; i++) {
+		assert_true(fabsf(last_left[i] - left[i] * 0.5f) < 1e-6f);
+		assert_true(fabsf(last_right[i] - right[i] * 0.5f) < 1e-6f);
+		assert_true(left[i] == sinf((float)i * 0.01f));
+	}
+	obs_source_filter_remove(source, filter);
+	obs_source_release(filter);
+
+	obs_source_remove_audio_capture_callback(source, audio_capture, NULL);
+	obs_source_release(source);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(audio_ingest_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
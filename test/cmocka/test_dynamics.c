@@ -0,0 +1,204 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media-io/audio-math.h>
+
+#include "dynamics.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 8
+#define FRAMES 1024
+
+static float channel_data[3][CHANNELS][FRAMES];
+static float *channels[CHANNELS];
+static float *ref_channels[CHANNELS];
+static float *envelopes[CHANNELS];
+static float env[FRAMES];
+static float ref_env[FRAMES];
+
+static void generate(size_t frames)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		for (size_t i = 0; i < frames; i++) {
+			const float noise = (float)rand() / (float)RAND_MAX - 0.5f;
+			const float burst = (i / 97 + c) % 3 == 0 ? 0.9f : 0.05f;
+			channels[c][i] = sinf((float)i * 0.013f * (float)(c + 1)) * burst + noise * 0.01f;
+		}
+		memcpy(ref_channels[c], channels[c], frames * sizeof(float));
+	}
+}
+
+/* the loops of the filters before they used the shared kernels */
+static void ref_envelope(float *dst, float **samples, size_t num_channels, size_t frames, float *envelope,
+			 float attack_gain, float release_gain)
+{
+	memset(dst, 0, frames * sizeof(float));
+	for (size_t chan = 0; chan < num_channels; ++chan) {
+		if (!samples[chan])
+			continue;
+
+		float e = *envelope;
+		for (size_t i = 0; i < frames; ++i) {
+			const float env_in = fabsf(samples[chan][i]);
+			if (e < env_in)
+				e = env_in + attack_gain * (e - env_in);
+			else
+				e = env_in + release_gain * (e - env_in);
+			dst[i] = fmaxf(dst[i], e);
+		}
+	}
+	*envelope = dst[frames - 1];
+}
+
+static void ref_compression(float **samples, size_t num_channels, const float *envelope, size_t frames,
+			    float threshold, float slope, float output_gain)
+{
+	for (size_t i = 0; i < frames; ++i) {
+		const float env_db = mul_to_db(envelope[i]);
+		float gain = slope * (threshold - env_db);
+		gain = db_to_mul(fminf(0, gain));
+
+		for (size_t c = 0; c < num_channels; ++c) {
+			if (samples[c])
+				samples[c][i] *= gain * output_gain;
+		}
+	}
+}
+
+static void ref_rms(float *dst, const float *samples, size_t frames, float *runave, float coef)
+{
+	float avg = *runave;
+	for (size_t i = 0; i < frames; ++i) {
+		avg = coef * avg + (1 - coef) * powf(samples[i], 2.0f);
+		dst[i] = sqrtf(fmaxf(avg, 0));
+	}
+	*runave = avg;
+}
+
+static void db_conversion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float mul[1001];
+	float db[1001];
+	float back[1001];
+
+	for (size_t i = 0; i < 1001; i++)
+		mul[i] = powf(10.0f, -7.0f + (float)i * 0.008f);
+
+	dynamics_mul_to_db(db, mul, 1001);
+	for (size_t i = 0; i < 1001; i++) {
+		if (fabsf(db[i] - mul_to_db(mul[i])) > 1e-4f)
+			fail_msg("mul_to_db(%g) is %g, expected %g", mul[i], db[i], mul_to_db(mul[i]));
+	}
+
+	for (size_t i = 0; i < 1001; i++)
+		db[i] = -150.0f + (float)i * 0.2f;
+
+	dynamics_db_to_mul(back, db, 1001);
+	for (size_t i = 0; i < 1001; i++) {
+		const float expected = db_to_mul(db[i]);
+		if (fabsf(back[i] - expected) > expected * 1e-5f)
+			fail_msg("db_to_mul(%g) is %g, expected %g", db[i], back[i], expected);
+	}
+
+	/* silence */
+	const float special[4] = {0.0f, 1e-40f, -INFINITY, 0.0f};
+	dynamics_mul_to_db(db, special, 2);
+	assert_true(isinf(db[0]) && db[0] < 0.0f);
+	assert_true(isinf(db[1]) && db[1] < 0.0f);
+	dynamics_db_to_mul(back, special + 2, 2);
+	assert_true(back[0] == 0.0f);
+	assert_true(back[1] == 1.0f);
+}
+
+static void envelope_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const size_t channel_counts[] = {1, 2, 3, 6, 8};
+	const size_t frames = FRAMES - 3;
+
+	srand(1);
+	for (size_t n = 0; n < sizeof(channel_counts) / sizeof(channel_counts[0]); n++) {
+		const size_t count = channel_counts[n];
+		float *samples[CHANNELS] = {0};
+		float e = 0.1f;
+		float ref_e = 0.1f;
+
+		generate(frames);
+		memcpy(samples, channels, sizeof(samples));
+		if (count > 2)
+			samples[1] = NULL;
+
+		dynamics_envelope(env, samples, count, frames, &e, 0.99f, 0.9995f);
+		ref_envelope(ref_env, samples, count, frames, &ref_e, 0.99f, 0.9995f);
+		assert_memory_equal(env, ref_env, frames * sizeof(float));
+		assert_true(e == ref_e);
+
+		/* gain within the precision of the dB approximation */
+		float *ref_samples[CHANNELS] = {0};
+		memcpy(ref_samples, ref_channels, sizeof(ref_samples));
+		if (count > 2)
+			ref_samples[1] = NULL;
+
+		dynamics_compress_gain(env, env, frames, -18.0f, 0.9f, 1.5f);
+		dynamics_apply_gain(samples, count, env, frames);
+		ref_compression(ref_samples, count, ref_env, frames, -18.0f, 0.9f, 1.5f);
+
+		for (size_t c = 0; c < count; c++) {
+			if (!samples[c])
+				continue;
+			for (size_t i = 0; i < frames; i++) {
+				if (fabsf(samples[c][i] - ref_samples[c][i]) > 1e-5f)
+					fail_msg("%zu channels: sample %zu of channel %zu is %g, expected %g", count, i,
+						 c, samples[c][i], ref_samples[c][i]);
+			}
+		}
+	}
+}
+
+static void rms_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const size_t frames = FRAMES - 1;
+	const float coef = exp2f(-100.0f / SAMPLE_RATE);
+	float runave[CHANNELS] = {0};
+	float ref_runave[CHANNELS] = {0};
+
+	srand(2);
+	for (int block = 0; block < 4; block++) {
+		generate(frames);
+		dynamics_rms(envelopes, channels, 6, frames, runave, coef);
+
+		for (size_t c = 0; c < 6; c++) {
+			ref_rms(ref_env, ref_channels[c], frames, &ref_runave[c], coef);
+			assert_memory_equal(envelopes[c], ref_env, frames * sizeof(float));
+			assert_true(runave[c] == ref_runave[c]);
+		}
+	}
+}
+
+int main()
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		channels[c] = channel_data[0][c];
+		ref_channels[c] = channel_data[1][c];
+		envelopes[c] = channel_data[2][c];
+	}
+
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(db_conversion_test),
+		cmocka_unit_test(envelope_test),
+		cmocka_unit_test(rms_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
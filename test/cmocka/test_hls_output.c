@@ -0,0 +1,660 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/c99defs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "libobs-test.h"
+#include <obs-module.h>
+
+#include "hls-playlist.h"
+#include "hls-upload.h"
+
+#define PART_USEC 500000
+#define SEGMENT_USEC 2000000
+#define PARTS_PER_SEGMENT (SEGMENT_USEC / PART_USEC)
+
+/* Adds a segment's worth of parts, starting with an independent one */
+static void add_segment(struct hls_playlist *pl, struct hls_update *update)
+{
+	for (int i = 0; i < PARTS_PER_SEGMENT; i++)
+		hls_playlist_add_part(pl, PART_USEC, i == 0, update);
+}
+
+static void playlist_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct hls_playlist pl;
+	struct hls_update update;
+	struct dstr text = {0};
+
+	hls_playlist_init(&pl, SEGMENT_USEC, PART_USEC, 2);
+
+	hls_playlist_add_part(&pl, PART_USEC, true, &update);
+	assert_int_equal(update.segment, 0);
+	assert_int_equal(update.part, 0);
+	assert_false(update.closed);
+
+	hls_playlist_write(&pl, &text);
+	assert_string_equal(text.array, "#EXTM3U\n"
+					"#EXT-X-VERSION:6\n"
+					"#EXT-X-TARGETDURATION:2\n"
+					"#EXT-X-PART-INF:PART-TARGET=0.50000\n"
+					"#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=1.50000\n"
+					"#EXT-X-MEDIA-SEQUENCE:0\n"
+					"#EXT-X-INDEPENDENT-SEGMENTS\n"
+					"#EXT-X-MAP:URI=\"init.mp4\"\n"
+					"#EXT-X-PART:DURATION=0.50000,URI=\"seg0.0.m4s\",INDEPENDENT=YES\n"
+					"#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg0.1.m4s\"\n");
+
+	/* Segments only close on independent parts */
+	for (int i = 1; i < 6; i++) {
+		hls_playlist_add_part(&pl, PART_USEC, false, &update);
+		assert_int_equal(update.segment, 0);
+		assert_int_equal(update.part, i);
+	}
+
+	hls_playlist_add_part(&pl, PART_USEC, true, &update);
+	assert_true(update.closed);
+	assert_int_equal(update.closed_segment, 0);
+	assert_int_equal(update.segment, 1);
+	assert_int_equal(update.part, 0);
+
+	/* The target duration stays fixed, even for a long segment */
+	hls_playlist_write(&pl, &text);
+	assert_non_null(strstr(text.array, "#EXT-X-TARGETDURATION:2\n"));
+	assert_non_null(strstr(text.array, "#EXT-X-PART:DURATION=0.50000,URI=\"seg0.5.m4s\"\n"
+					   "#EXTINF:3.00000,\nseg0.m4s\n"
+					   "#EXT-X-PART:DURATION=0.50000,URI=\"seg1.0.m4s\",INDEPENDENT=YES\n"));
+
+	/* Complete segments 1 to 6, segment 0 leaves the window with segment
+	 * 2 and expires a whole window later. */
+	for (uint64_t seq = 1; seq <= 6; seq++) {
+		hls_playlist_add_part(&pl, PART_USEC, false, &update);
+		hls_playlist_add_part(&pl, PART_USEC, false, &update);
+		hls_playlist_add_part(&pl, PART_USEC, false, &update);
+		hls_playlist_add_part(&pl, PART_USEC, true, &update);
+
+		assert_true(update.closed);
+		assert_int_equal(update.closed_segment, seq);
+		assert_int_equal(update.segment_expired, seq >= 4);
+		if (seq >= 4)
+			assert_int_equal(update.segment_expired_sequence, seq - 4);
+
+		assert_int_equal(update.parts_expired, seq >= HLS_PART_SEGMENTS * 2);
+		if (seq >= HLS_PART_SEGMENTS * 2) {
+			assert_int_equal(update.parts_expired_segment, seq - HLS_PART_SEGMENTS * 2);
+			assert_int_equal(update.parts_expired_count, seq == HLS_PART_SEGMENTS * 2 ? 6 : 4);
+		}
+	}
+
+	hls_playlist_write(&pl, &text);
+	assert_non_null(strstr(text.array, "#EXT-X-MEDIA-SEQUENCE:5\n"));
+	assert_null(strstr(text.array, "seg4.m4s"));
+	assert_non_null(strstr(text.array, "#EXTINF:2.00000,\nseg5.m4s\n"));
+	assert_non_null(strstr(text.array, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg7.1.m4s\"\n"));
+	assert_null(strstr(text.array, "ENDLIST"));
+
+	uint64_t closed;
+	assert_true(hls_playlist_end(&pl, &closed));
+	assert_int_equal(closed, 7);
+
+	hls_playlist_write(&pl, &text);
+	assert_non_null(strstr(text.array, "#EXTINF:0.50000,\nseg7.m4s\n#EXT-X-ENDLIST\n"));
+	assert_null(strstr(text.array, "PRELOAD-HINT"));
+
+	dstr_free(&text);
+	hls_playlist_free(&pl);
+}
+
+static void event_playlist_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct hls_playlist pl;
+	struct hls_update update;
+	struct dstr text = {0};
+
+	hls_playlist_init(&pl, SEGMENT_USEC, PART_USEC, 0);
+
+	for (int seq = 0; seq < 10; seq++) {
+		add_segment(&pl, &update);
+		assert_false(update.segment_expired);
+	}
+
+	hls_playlist_write(&pl, &text);
+	assert_non_null(strstr(text.array, "#EXT-X-MEDIA-SEQUENCE:0\n#EXT-X-PLAYLIST-TYPE:EVENT\n"));
+	assert_non_null(strstr(text.array, "\nseg0.m4s\n"));
+
+	/* Parts are only listed for the last segments */
+	assert_null(strstr(text.array, "seg5.0.m4s"));
+	assert_non_null(strstr(text.array, "seg6.0.m4s"));
+
+	dstr_free(&text);
+	hls_playlist_free(&pl);
+}
+
+static uint8_t *alloc_text(const char *text, size_t *size)
+{
+	*size = strlen(text);
+	return bmemdup(text, *size);
+}
+
+static void upload_directory_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const char *dir = "hls_upload_test";
+	size_t size;
+
+	struct hls_upload *up = hls_upload_create(dir);
+	assert_non_null(up);
+
+	uint8_t *data = alloc_text("part data", &size);
+	hls_upload_put(up, "seg0.0.m4s", data, size);
+	data = alloc_text("first", &size);
+	hls_upload_put(up, "index.m3u8", data, size);
+	data = alloc_text("second", &size);
+	hls_upload_put(up, "index.m3u8", data, size);
+	data = alloc_text("removed", &size);
+	hls_upload_put(up, "seg0.m4s", data, size);
+	hls_upload_delete(up, "seg0.m4s");
+	hls_upload_destroy(up);
+
+	char *text = os_quick_read_utf8_file("hls_upload_test/seg0.0.m4s");
+	assert_string_equal(text, "part data");
+	bfree(text);
+
+	text = os_quick_read_utf8_file("hls_upload_test/index.m3u8");
+	assert_string_equal(text, "second");
+	bfree(text);
+
+	assert_false(os_file_exists("hls_upload_test/seg0.m4s"));
+	assert_false(os_file_exists("hls_upload_test/index.m3u8.tmp"));
+
+	os_unlink("hls_upload_test/seg0.0.m4s");
+	os_unlink("hls_upload_test/index.m3u8");
+	os_rmdir(dir);
+}
+
+#ifndef _WIN32
+/* ------------------------------------------------------------------------- */
+/* HTTP stand-in server                                                      */
+
+#define MAX_REQUESTS 128
+
+struct request {
+	char method[16];
+	char path[64];
+	char content_type[64];
+	/* Always null terminated */
+	char *body;
+	size_t size;
+};
+
+struct server {
+	int fd;
+	int port;
+	pthread_t thread;
+	struct request requests[MAX_REQUESTS];
+	volatile long num_requests;
+	int connections;
+};
+
+static bool read_request(int fd, struct request *req)
+{
+	char buf[2048];
+	size_t len = 0;
+	char *end = NULL;
+
+	while (!end) {
+		ssize_t ret = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+		if (ret <= 0)
+			return false;
+		len += ret;
+		buf[len] = 0;
+		end = strstr(buf, "\r\n\r\n");
+	}
+
+	memset(req, 0, sizeof(*req));
+	sscanf(buf, "%15s %63s", req->method, req->path);
+
+	size_t content_length = 0;
+	const char *header = strstr(buf, "Content-Length:");
+	if (header)
+		content_length = strtoul(header + 15, NULL, 10);
+	header = strstr(buf, "Content-Type:");
+	if (header)
+		sscanf(header + 13, " %63[^\r]", req->content_type);
+
+	/* Requests aren't pipelined, so anything after the headers is body */
+	const char *body = end + 4;
+	size_t have = len - (body - buf);
+	if (have > content_length)
+		have = content_length;
+
+	req->body = bzalloc(content_length + 1);
+	req->size = content_length;
+	memcpy(req->body, body, have);
+
+	while (have < content_length) {
+		ssize_t ret = recv(fd, req->body + have, content_length - have, 0);
+		if (ret <= 0) {
+			bfree(req->body);
+			return false;
+		}
+		have += ret;
+	}
+
+	return true;
+}
+
+static void *server_thread(void *param)
+{
+	struct server *srv = param;
+	int fd;
+
+	while ((fd = accept(srv->fd, NULL, NULL)) >= 0) {
+		struct request req;
+
+		srv->connections++;
+
+		while (read_request(fd, &req)) {
+			const char *response = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+			if (strcmp(req.method, "DELETE") == 0)
+				response = "HTTP/1.1 204 No Content\r\n\r\n";
+			if (strstr(req.path, "fail"))
+				response = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+
+			long idx = srv->num_requests;
+			if (idx < MAX_REQUESTS) {
+				srv->requests[idx] = req;
+				os_atomic_inc_long(&srv->num_requests);
+			} else {
+				bfree(req.body);
+			}
+
+			send(fd, response, strlen(response), 0);
+		}
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static void server_start(struct server *srv)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+
+	memset(srv, 0, sizeof(*srv));
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	srv->fd = socket(AF_INET, SOCK_STREAM, 0);
+	assert_true(srv->fd >= 0);
+	assert_int_equal(bind(srv->fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	assert_int_equal(listen(srv->fd, 4), 0);
+	assert_int_equal(getsockname(srv->fd, (struct sockaddr *)&addr, &addr_len), 0);
+	srv->port = ntohs(addr.sin_port);
+
+	pthread_create(&srv->thread, NULL, server_thread, srv);
+}
+
+static void server_stop(struct server *srv)
+{
+	shutdown(srv->fd, SHUT_RDWR);
+	pthread_join(srv->thread, NULL);
+	close(srv->fd);
+}
+
+static void server_free(struct server *srv)
+{
+	for (long i = 0; i < srv->num_requests; i++)
+		bfree(srv->requests[i].body);
+}
+
+static void upload_http_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct server srv;
+	struct dstr url = {0};
+	size_t size;
+
+	server_start(&srv);
+	dstr_printf(&url, "http://127.0.0.1:%d/live", srv.port);
+
+	struct hls_upload *up = hls_upload_create(url.array);
+	assert_non_null(up);
+
+	uint8_t *data = alloc_text("init", &size);
+	hls_upload_put(up, "init.mp4", data, size);
+	data = alloc_text("part", &size);
+	hls_upload_put(up, "seg0.0.m4s", data, size);
+	data = alloc_text("#EXTM3U\n", &size);
+	hls_upload_put(up, "index.m3u8", data, size);
+	hls_upload_delete(up, "seg0.0.m4s");
+	data = alloc_text("lost", &size);
+	hls_upload_put(up, "fail.m4s", data, size);
+
+	for (int i = 0; i < 500 && hls_upload_errors(up) == 0; i++)
+		os_sleep_ms(10);
+	assert_int_equal(hls_upload_errors(up), 1);
+
+	data = alloc_text("part", &size);
+	hls_upload_put(up, "seg0.1.m4s", data, size);
+	hls_upload_destroy(up);
+	server_stop(&srv);
+
+	/* Requests arrive in order over a single connection */
+	assert_int_equal(srv.num_requests, 6);
+	assert_int_equal(srv.connections, 1);
+
+	const struct request expected[] = {
+		{"PUT", "/live/init.mp4", "video/mp4", "init"},
+		{"PUT", "/live/seg0.0.m4s", "video/iso.segment", "part"},
+		{"PUT", "/live/index.m3u8", "application/vnd.apple.mpegurl", "#EXTM3U\n"},
+		{"DELETE", "/live/seg0.0.m4s", "", ""},
+		{"PUT", "/live/fail.m4s", "video/iso.segment", "lost"},
+		{"PUT", "/live/seg0.1.m4s", "video/iso.segment", "part"},
+	};
+
+	for (size_t i = 0; i < 6; i++) {
+		assert_string_equal(srv.requests[i].method, expected[i].method);
+		assert_string_equal(srv.requests[i].path, expected[i].path);
+		assert_string_equal(srv.requests[i].content_type, expected[i].content_type);
+		assert_string_equal(srv.requests[i].body, expected[i].body);
+	}
+
+	server_free(&srv);
+	dstr_free(&url);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Output                                                                    */
+
+#define OUTPUT_FPS 30
+#define OUTPUT_FRAMES 100
+#define FRAME_SIZE 64
+
+extern struct obs_output_info hls_output_info;
+
+const char *obs_module_text(const char *lookup_string)
+{
+	return lookup_string;
+}
+
+static void *test_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return (void *)1;
+}
+
+static bool test_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet, bool *received_packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+	UNUSED_PARAMETER(packet);
+	UNUSED_PARAMETER(received_packet);
+	return false;
+}
+
+static struct obs_encoder_info test_encoder = {
+	.id = "hls_output_test_encoder",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = obs_test_get_name,
+	.create = test_encoder_create,
+	.destroy = obs_test_destroy,
+	.encode = test_encode,
+};
+
+/* an Annex B frame with a single NAL unit, with a keyframe every second */
+static void submit_frame(const struct obs_output_info *info, void *data, obs_encoder_t *encoder, int64_t frame,
+			 int64_t sys_dts_usec)
+{
+	const bool keyframe = frame % OUTPUT_FPS == 0;
+	long *refs = bzalloc(sizeof(long) + FRAME_SIZE);
+	uint8_t *payload = (uint8_t *)(refs + 1);
+	*refs = 1;
+
+	payload[3] = 1;
+	payload[4] = keyframe ? 0x65 : 0x41;
+	payload[5] = (uint8_t)frame;
+	memset(payload + 6, 0xaa, FRAME_SIZE - 6);
+
+	struct encoder_packet packet = {
+		.data = payload,
+		.size = FRAME_SIZE,
+		.type = OBS_ENCODER_VIDEO,
+		.pts = frame,
+		.dts = frame,
+		.timebase_num = 1,
+		.timebase_den = OUTPUT_FPS,
+		.dts_usec = frame * 1000000 / OUTPUT_FPS,
+		.sys_dts_usec = sys_dts_usec,
+		.keyframe = keyframe,
+		.encoder = encoder,
+	};
+
+	info->encoded_packet(data, &packet);
+	obs_encoder_packet_release(&packet);
+}
+
+static void destroy_queue_done(void *param)
+{
+	UNUSED_PARAMETER(param);
+}
+
+/* the last request for the path before the given one, if it was a PUT */
+static const struct request *find_put(const struct server *srv, long before, const char *name)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/live/%s", name);
+
+	for (long i = before - 1; i >= 0; i--) {
+		const struct request *req = &srv->requests[i];
+		if (strcmp(req->path, path) == 0)
+			return strcmp(req->method, "PUT") == 0 ? req : NULL;
+	}
+
+	return NULL;
+}
+
+/* every file a playlist lists must have been published before it */
+static void check_playlist(const struct server *srv, long idx)
+{
+	char *text = bstrdup(srv->requests[idx].body);
+	char *line = strtok(text, "\n");
+
+	assert_non_null(strstr(srv->requests[idx].body, "#EXT-X-TARGETDURATION:1\n"));
+	assert_non_null(find_put(srv, idx, HLS_INIT_NAME));
+
+	for (; line; line = strtok(NULL, "\n")) {
+		char *name = line;
+
+		if (strncmp(line, "#EXT-X-PART:", 12) == 0) {
+			char *uri = strstr(line, "URI=\"");
+			assert_non_null(uri);
+			name = uri + 5;
+			*strchr(name, '"') = 0;
+		} else if (*line == '#') {
+			continue;
+		}
+
+		assert_non_null(find_put(srv, idx, name));
+	}
+
+	bfree(text);
+}
+
+/* a segment is made up of the parts published for it */
+static void check_segment(const struct server *srv, long idx, uint64_t sequence)
+{
+	const struct request *seg = &srv->requests[idx];
+	struct dstr name = {0};
+	size_t offset = 0;
+	uint32_t part = 0;
+
+	for (;; part++) {
+		hls_part_name(&name, sequence, part);
+		const struct request *req = find_put(srv, idx, name.array);
+		if (!req)
+			break;
+
+		assert_true(offset + req->size <= seg->size);
+		assert_memory_equal(seg->body + offset, req->body, req->size);
+		offset += req->size;
+	}
+
+	assert_true(part > 0);
+	assert_int_equal(offset, seg->size);
+	dstr_free(&name);
+}
+
+static void output_http_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	struct server srv;
+	struct dstr url = {0};
+
+	server_start(&srv);
+	dstr_printf(&url, "http://127.0.0.1:%d/live", srv.port);
+
+	struct video_output_info voi = {
+		.name = "hls output test",
+		.format = VIDEO_FORMAT_NV12,
+		.fps_num = OUTPUT_FPS,
+		.fps_den = 1,
+		.width = 64,
+		.height = 64,
+		.cache_size = 1,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	video_t *video;
+	assert_int_equal(video_output_open(&video, &voi), VIDEO_OUTPUT_SUCCESS);
+
+	/* video only, so the test doesn't need an audio encoder */
+	struct obs_output_info info = hls_output_info;
+	info.id = "hls_output_test_output";
+	info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED;
+
+	obs_register_encoder(&test_encoder);
+	obs_register_output(&info);
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "keyint_sec", 1);
+	obs_encoder_t *encoder = obs_video_encoder_create(test_encoder.id, "video", settings, NULL);
+	obs_data_release(settings);
+
+	settings = obs_data_create();
+	obs_data_set_string(settings, "path", url.array);
+	obs_data_set_int(settings, "segment_duration", 1);
+	obs_data_set_int(settings, "part_duration", 250);
+	obs_data_set_int(settings, "window", 1);
+	obs_output_t *output = obs_output_create(info.id, "output", settings, NULL);
+	obs_data_release(settings);
+
+	assert_non_null(encoder);
+	assert_non_null(output);
+	obs_encoder_set_video(encoder, video);
+	obs_output_set_video_encoder(output, encoder);
+
+	/* packets are handed to the output directly, the encoder never
+	 * produces any */
+	assert_true(obs_output_start(output));
+	void *data = obs_obj_get_data(output);
+
+	for (int64_t frame = 0; frame < OUTPUT_FRAMES; frame++)
+		submit_frame(&info, data, encoder, frame, 0);
+
+	/* the first packet past the stop time ends the stream, the remaining
+	 * uploads finish on the destroy queue */
+	obs_output_stop(output);
+	submit_frame(&info, data, encoder, OUTPUT_FRAMES, INT64_MAX);
+	obs_queue_task(OBS_TASK_DESTROY, destroy_queue_done, NULL, true);
+	server_stop(&srv);
+
+	assert_true(srv.num_requests < MAX_REQUESTS);
+	assert_string_equal(srv.requests[0].path, "/live/" HLS_INIT_NAME);
+	assert_memory_equal(srv.requests[0].body + 4, "ftyp", 4);
+
+	long last_playlist = -1;
+	uint64_t segments = 0;
+
+	for (long i = 0; i < srv.num_requests; i++) {
+		const struct request *req = &srv.requests[i];
+		uint64_t sequence;
+		int len = 0;
+
+		if (strcmp(req->method, "PUT") != 0)
+			continue;
+
+		if (strcmp(req->path, "/live/index.m3u8") == 0) {
+			check_playlist(&srv, i);
+			last_playlist = i;
+		} else if (sscanf(req->path, "/live/seg%" SCNu64 "%n", &sequence, &len) == 1 &&
+			   strcmp(req->path + len, ".m4s") == 0) {
+			assert_int_equal(sequence, segments++);
+			check_segment(&srv, i, sequence);
+		}
+	}
+
+	/* a second of frames per segment, the last one is cut short */
+	assert_int_equal(segments, (OUTPUT_FRAMES + OUTPUT_FPS - 1) / OUTPUT_FPS);
+	assert_true(last_playlist > 0);
+	assert_non_null(strstr(srv.requests[last_playlist].body, "#EXT-X-ENDLIST\n"));
+
+	/* segments are removed a whole window after they left it */
+	assert_null(find_put(&srv, srv.num_requests, "seg0.m4s"));
+	assert_non_null(find_put(&srv, srv.num_requests, "seg2.m4s"));
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	video_output_close(video);
+	obs_shutdown();
+
+	server_free(&srv);
+	dstr_free(&url);
+}
+#endif
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(playlist_test),
+		cmocka_unit_test(event_playlist_test),
+		cmocka_unit_test(upload_directory_test),
+#ifndef _WIN32
+		cmocka_unit_test(upload_http_test),
+		cmocka_unit_test(output_http_test),
+#endif
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,123 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+
+#include "libobs-test.h"
+
+#define NUM_HOTKEYS 1000
+#define NUM_KEYS (35 + 10 + 26)
+
+static obs_hotkey_id ids[NUM_HOTKEYS];
+static int press_count[NUM_HOTKEYS];
+static int release_count[NUM_HOTKEYS];
+
+static void hotkey_func(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	size_t idx = (size_t)data;
+	if (pressed)
+		press_count[idx]++;
+	else
+		release_count[idx]++;
+}
+
+/* F1-F35, 0-9 and A-Z, each with all 16 modifier combinations */
+static obs_key_combination_t combination(size_t idx)
+{
+	const size_t key = idx % NUM_KEYS;
+	obs_key_combination_t combo = {0};
+
+	if (key < 35)
+		combo.key = OBS_KEY_F1 + (obs_key_t)key;
+	else if (key < 45)
+		combo.key = OBS_KEY_0 + (obs_key_t)(key - 35);
+	else
+		combo.key = OBS_KEY_A + (obs_key_t)(key - 45);
+
+	const size_t mods = idx / NUM_KEYS;
+	if (mods & 1)
+		combo.modifiers |= INTERACT_SHIFT_KEY;
+	if (mods & 2)
+		combo.modifiers |= INTERACT_CONTROL_KEY;
+	if (mods & 4)
+		combo.modifiers |= INTERACT_ALT_KEY;
+	if (mods & 8)
+		combo.modifiers |= INTERACT_COMMAND_KEY;
+	return combo;
+}
+
+static void set_modifiers(uint32_t modifiers)
+{
+	obs_hotkey_update_key_state(OBS_KEY_SHIFT, (modifiers & INTERACT_SHIFT_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_CONTROL, (modifiers & INTERACT_CONTROL_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_ALT, (modifiers & INTERACT_ALT_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_META, (modifiers & INTERACT_COMMAND_KEY) != 0);
+}
+
+static void check_counts(int expected)
+{
+	for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+		if (press_count[i] != expected || release_count[i] != expected)
+			fail_msg("hotkey %zu: %d presses, %d releases, expected %d", i, press_count[i],
+				 release_count[i], expected);
+	}
+}
+
+static void hotkeys_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	char name[32];
+
+	for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+		obs_key_combination_t combo = combination(i);
+
+		snprintf(name, sizeof(name), "hotkey %zu", i);
+		ids[i] = obs_hotkey_register_frontend(name, name, hotkey_func, (void *)i);
+		obs_hotkey_load_bindings(ids[i], &combo, 1);
+	}
+
+	/* key events only update the bindings of the key that changed */
+	for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+		obs_key_combination_t combo = combination(i);
+		set_modifiers(combo.modifiers);
+
+		obs_hotkey_update_key_state(combo.key, true);
+		obs_hotkey_update_key_state(combo.key, false);
+
+		if (press_count[i] != 1)
+			fail_msg("hotkey %zu was not triggered by its key", i);
+	}
+	set_modifiers(0);
+	check_counts(1);
+
+	/* injected events go through all bindings */
+	for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+		obs_key_combination_t combo = combination(i);
+
+		obs_hotkey_inject_event(combo, true);
+		obs_hotkey_inject_event(combo, false);
+	}
+	check_counts(2);
+
+	for (size_t i = 0; i < NUM_HOTKEYS; i++)
+		obs_hotkey_unregister(ids[i]);
+
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(hotkeys_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,221 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <media-io/media-remux.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define IN_FILE "media_remux_test.wav"
+#define OUT_FILE "media_remux_test.mkv"
+#define BAD_IN_FILE "media_remux_test_bad.wav"
+#define BAD_OUT_FILE "media_remux_test_bad.mkv"
+#define JOURNAL "media_remux_test.json"
+
+#define SAMPLE_RATE 48000
+
+enum job_result {
+	JOB_PENDING,
+	JOB_SUCCEEDED,
+	JOB_FAILED,
+};
+
+static const char *files[] = {
+	IN_FILE, OUT_FILE, OUT_FILE ".part", BAD_IN_FILE, BAD_OUT_FILE, BAD_OUT_FILE ".part", JOURNAL, JOURNAL ".bak",
+};
+
+static volatile long results[2];
+
+static void write_le(FILE *file, uint32_t value, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		fputc((int)(value >> (i * 8)) & 0xff, file);
+}
+
+/* 16-bit mono PCM, which remuxes into Matroska */
+static void write_wav(const char *path, size_t samples)
+{
+	FILE *file = os_fopen(path, "wb");
+	assert_non_null(file);
+
+	const uint32_t data_size = (uint32_t)samples * 2;
+
+	fwrite("RIFF", 1, 4, file);
+	write_le(file, 36 + data_size, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	write_le(file, 16, 4);              // fmt chunk size
+	write_le(file, 1, 2);               // PCM
+	write_le(file, 1, 2);               // channels
+	write_le(file, SAMPLE_RATE, 4);     // sample rate
+	write_le(file, SAMPLE_RATE * 2, 4); // byte rate
+	write_le(file, 2, 2);               // block align
+	write_le(file, 16, 2);              // bits per sample
+	fwrite("data", 1, 4, file);
+	write_le(file, data_size, 4);
+
+	for (size_t i = 0; i < samples; i++)
+		write_le(file, (uint32_t)(i * 37), 2);
+
+	fclose(file);
+}
+
+static void write_text(const char *path, const char *text)
+{
+	assert_true(os_quick_write_utf8_file(path, text, strlen(text), false));
+}
+
+static time_t get_mtime(const char *path)
+{
+	struct stat st;
+	assert_int_equal(os_stat(path, &st), 0);
+	return st.st_mtime;
+}
+
+static void set_mtime(const char *path, time_t mtime)
+{
+	struct utimbuf times = {.actime = mtime, .modtime = mtime};
+	assert_int_equal(utime(path, &times), 0);
+}
+
+static void remove_files(void)
+{
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+		os_unlink(files[i]);
+}
+
+/* called from the worker threads, so results are checked after waiting */
+static void job_finished(void *data, size_t job, bool success)
+{
+	UNUSED_PARAMETER(data);
+	if (job < 2)
+		os_atomic_set_long(&results[job], success ? JOB_SUCCEEDED : JOB_FAILED);
+}
+
+/* remuxes IN_FILE, and BAD_IN_FILE if bad_job is set, with the journal */
+static bool run_jobs(bool bad_job, struct media_remux_progress *progress)
+{
+	media_remux_scheduler_t sched = media_remux_scheduler_create(1, JOURNAL);
+	assert_non_null(sched);
+
+	for (size_t i = 0; i < 2; i++)
+		os_atomic_set_long(&results[i], JOB_PENDING);
+
+	assert_int_equal(media_remux_scheduler_add_job(sched, IN_FILE, OUT_FILE), 0);
+	if (bad_job)
+		assert_int_equal(media_remux_scheduler_add_job(sched, BAD_IN_FILE, BAD_OUT_FILE), 1);
+
+	assert_true(media_remux_scheduler_start(sched, job_finished, NULL));
+	const bool success = media_remux_scheduler_wait(sched);
+	media_remux_scheduler_get_progress(sched, progress);
+	media_remux_scheduler_destroy(sched);
+
+	assert_int_equal(os_atomic_load_long(&results[0]), JOB_SUCCEEDED);
+	if (bad_job)
+		assert_int_equal(os_atomic_load_long(&results[1]), JOB_FAILED);
+	return success;
+}
+
+static void journal_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct media_remux_progress progress;
+
+	remove_files();
+	write_wav(IN_FILE, SAMPLE_RATE);
+	write_text(BAD_IN_FILE, "not a media file");
+	/* left behind by an earlier run */
+	write_text(BAD_OUT_FILE ".part", "partial output");
+
+	/* completed outputs are moved into place, failed jobs leave no .part */
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 0);
+	assert_int_equal(progress.jobs_failed, 1);
+	assert_true(os_file_exists(OUT_FILE));
+	assert_false(os_file_exists(OUT_FILE ".part"));
+	assert_false(os_file_exists(BAD_OUT_FILE));
+	assert_false(os_file_exists(BAD_OUT_FILE ".part"));
+
+	/* the failed job keeps the journal, which skips the completed job */
+	assert_true(os_file_exists(JOURNAL));
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 1);
+
+	/* a new modification time of the input runs the job again */
+	set_mtime(IN_FILE, get_mtime(IN_FILE) - 10);
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 0);
+
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 1);
+
+	/* and so does a new size with the same modification time */
+	const time_t mtime = get_mtime(IN_FILE);
+	write_wav(IN_FILE, SAMPLE_RATE / 2);
+	set_mtime(IN_FILE, mtime);
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 0);
+
+	/* or a missing output */
+	assert_int_equal(os_unlink(OUT_FILE), 0);
+	assert_false(run_jobs(true, &progress));
+	assert_int_equal(progress.jobs_skipped, 0);
+	assert_true(os_file_exists(OUT_FILE));
+
+	/* nothing is left to resume once every job succeeded */
+	assert_true(run_jobs(false, &progress));
+	assert_int_equal(progress.jobs_skipped, 1);
+	assert_false(os_file_exists(JOURNAL));
+
+	remove_files();
+}
+
+static void cancel_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	remove_files();
+	write_wav(IN_FILE, SAMPLE_RATE * 60);
+
+	media_remux_scheduler_t sched = media_remux_scheduler_create(1, NULL);
+	assert_non_null(sched);
+	assert_int_equal(media_remux_scheduler_add_job(sched, IN_FILE, OUT_FILE), 0);
+
+	/* cancel the job while it is writing its .part file */
+	assert_true(media_remux_scheduler_start(sched, NULL, NULL));
+	for (;;) {
+		struct media_remux_progress progress;
+		media_remux_scheduler_get_progress(sched, &progress);
+		if (progress.jobs_active || progress.jobs_finished)
+			break;
+		os_sleep_ms(0);
+	}
+	media_remux_scheduler_cancel(sched);
+	assert_false(media_remux_scheduler_wait(sched));
+	media_remux_scheduler_destroy(sched);
+
+	assert_false(os_file_exists(OUT_FILE));
+	assert_false(os_file_exists(OUT_FILE ".part"));
+
+	remove_files();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(journal_test),
+		cmocka_unit_test(cancel_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,276 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+
+#include "libobs-test.h"
+#include <obs-module.h>
+#include <util/array-serializer.h>
+
+#include "mp4-mux.h"
+
+#define FPS 30
+#define GOP_FRAMES 90
+#define NUM_FRAMES 200
+#define FRAME_SIZE 64
+#define PART_USEC 250000
+
+/* ISO/IEC 14496-12 8.8.7 and 8.8.8 */
+#define TFHD_BASE_DATA_OFFSET_PRESENT 0x000001
+#define TFHD_DEFAULT_SAMPLE_FLAGS_PRESENT 0x000020
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+#define TRUN_DATA_OFFSET_PRESENT 0x000001
+#define TRUN_FIRST_SAMPLE_FLAGS_PRESENT 0x000004
+#define SAMPLE_IS_NON_SYNC 0x00010000
+
+const char *obs_module_text(const char *lookup_string)
+{
+	return lookup_string;
+}
+
+static void *test_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return (void *)1;
+}
+
+static bool test_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet, bool *received_packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+	UNUSED_PARAMETER(packet);
+	UNUSED_PARAMETER(received_packet);
+	return false;
+}
+
+static struct obs_encoder_info test_encoder = {
+	.id = "mp4_mux_test_encoder",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = obs_test_get_name,
+	.create = test_encoder_create,
+	.destroy = obs_test_destroy,
+	.encode = test_encode,
+};
+
+static void *test_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(output);
+	return (void *)1;
+}
+
+static bool test_output_start(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return false;
+}
+
+static void test_output_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static void test_encoded_packet(void *data, struct encoder_packet *packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(packet);
+}
+
+static struct obs_output_info test_output = {
+	.id = "mp4_mux_test_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = obs_test_get_name,
+	.create = test_output_create,
+	.destroy = obs_test_destroy,
+	.start = test_output_start,
+	.stop = test_output_stop,
+	.encoded_packet = test_encoded_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct cmaf_test {
+	struct array_output_data output;
+	size_t frames;
+	size_t parts;
+	size_t independent_parts;
+};
+
+static inline uint32_t rb32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/* payload of the first box of the type, the muxer only writes 32-bit sizes
+ * for boxes this small */
+static const uint8_t *find_box(const uint8_t *data, size_t size, const char *type, size_t *payload_size)
+{
+	while (size >= 8) {
+		const size_t box_size = rb32(data);
+		assert_true(box_size >= 8 && box_size <= size);
+
+		if (memcmp(data + 4, type, 4) == 0) {
+			*payload_size = box_size - 8;
+			return data + 8;
+		}
+
+		data += box_size;
+		size -= box_size;
+	}
+
+	fail_msg("no %s box", type);
+	return NULL;
+}
+
+static void check_fragment(void *param, const struct mp4_fragment_info *info)
+{
+	struct cmaf_test *test = param;
+	const uint8_t *fragment = test->output.bytes.array + info->init_size;
+	const size_t size = test->output.bytes.num - info->init_size;
+	size_t moof_size, traf_size, tfhd_size, trun_size;
+
+	/* parts are cut before they would run past the part duration, and a
+	 * part only starts independent on a keyframe */
+	assert_true(info->duration_usec > 0);
+	assert_true(info->duration_usec <= PART_USEC);
+	assert_int_equal(info->independent, test->frames % GOP_FRAMES == 0);
+
+	const uint8_t *moof = find_box(fragment, size, "moof", &moof_size);
+	const uint8_t *traf = find_box(moof, moof_size, "traf", &traf_size);
+	const uint8_t *tfhd = find_box(traf, traf_size, "tfhd", &tfhd_size);
+	const uint8_t *trun = find_box(traf, traf_size, "trun", &trun_size);
+
+	/* parts are delivered as separate files, so data offsets are relative
+	 * to the moof, and all samples but the first are non-sync */
+	const uint32_t tfhd_flags = rb32(tfhd) & 0xffffff;
+	assert_true(tfhd_flags & TFHD_DEFAULT_BASE_IS_MOOF);
+	assert_false(tfhd_flags & TFHD_BASE_DATA_OFFSET_PRESENT);
+	assert_true(tfhd_flags & TFHD_DEFAULT_SAMPLE_FLAGS_PRESENT);
+	assert_true(rb32(tfhd + tfhd_size - 4) & SAMPLE_IS_NON_SYNC);
+
+	const uint32_t trun_flags = rb32(trun) & 0xffffff;
+	assert_true(trun_flags & TRUN_DATA_OFFSET_PRESENT);
+	assert_true(trun_flags & TRUN_FIRST_SAMPLE_FLAGS_PRESENT);
+
+	const uint32_t sample_count = rb32(trun + 4);
+	const uint32_t data_offset = rb32(trun + 8);
+	const uint32_t first_sample_flags = rb32(trun + 12);
+	assert_int_equal((first_sample_flags & SAMPLE_IS_NON_SYNC) != 0, !info->independent);
+
+	/* the data offset points at the first sample of the part, a length
+	 * prefixed NAL unit that carries the frame number */
+	assert_true(data_offset + 6 <= size);
+	const uint8_t *sample = fragment + data_offset;
+	assert_int_equal(rb32(sample), FRAME_SIZE - 4);
+	assert_int_equal(sample[4], info->independent ? 0x65 : 0x41);
+	assert_int_equal(sample[5], (uint8_t)test->frames);
+
+	test->frames += sample_count;
+	test->parts++;
+	if (info->independent)
+		test->independent_parts++;
+
+	array_output_serializer_reset(&test->output);
+}
+
+/* an Annex B frame with a single NAL unit, IDR for keyframes */
+static void submit_frame(struct mp4_mux *mux, obs_encoder_t *encoder, int64_t frame)
+{
+	const bool keyframe = frame % GOP_FRAMES == 0;
+	long *refs = bzalloc(sizeof(long) + FRAME_SIZE);
+	uint8_t *data = (uint8_t *)(refs + 1);
+	*refs = 1;
+
+	data[3] = 1;
+	data[4] = keyframe ? 0x65 : 0x41;
+	data[5] = (uint8_t)frame;
+	memset(data + 6, 0xaa, FRAME_SIZE - 6);
+
+	struct encoder_packet packet = {
+		.data = data,
+		.size = FRAME_SIZE,
+		.type = OBS_ENCODER_VIDEO,
+		.pts = frame,
+		.dts = frame,
+		.timebase_num = 1,
+		.timebase_den = FPS,
+		.dts_usec = frame * 1000000 / FPS,
+		.keyframe = keyframe,
+		.encoder = encoder,
+	};
+
+	assert_true(mp4_mux_submit_packet(mux, &packet));
+	obs_encoder_packet_release(&packet);
+}
+
+static void cmaf_part_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	struct video_output_info voi = {
+		.name = "mp4 mux test",
+		.format = VIDEO_FORMAT_NV12,
+		.fps_num = FPS,
+		.fps_den = 1,
+		.width = 64,
+		.height = 64,
+		.cache_size = 1,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	video_t *video;
+	assert_int_equal(video_output_open(&video, &voi), VIDEO_OUTPUT_SUCCESS);
+
+	obs_register_encoder(&test_encoder);
+	obs_register_output(&test_output);
+
+	obs_encoder_t *encoder = obs_video_encoder_create(test_encoder.id, "video", NULL, NULL);
+	obs_output_t *output = obs_output_create(test_output.id, "output", NULL, NULL);
+	assert_non_null(encoder);
+	assert_non_null(output);
+
+	obs_encoder_set_video(encoder, video);
+	obs_output_set_video_encoder(output, encoder);
+
+	struct cmaf_test test = {0};
+	struct serializer s;
+	array_output_serializer_init(&s, &test.output);
+
+	struct mp4_mux *mux = mp4_mux_create(output, &s, MP4_CMAF);
+	mp4_mux_set_part_duration(mux, PART_USEC);
+	mp4_mux_set_fragment_callback(mux, check_fragment, &test);
+
+	/* GOPs of three seconds, much longer than a part */
+	for (int64_t frame = 0; frame < NUM_FRAMES; frame++)
+		submit_frame(mux, encoder, frame);
+	assert_true(mp4_mux_finalise(mux));
+
+	/* the last frame has no duration and isn't written */
+	assert_int_equal(test.frames, NUM_FRAMES - 1);
+	assert_int_equal(test.independent_parts, (NUM_FRAMES + GOP_FRAMES - 1) / GOP_FRAMES);
+	assert_true(test.parts > NUM_FRAMES * 1000000 / FPS / PART_USEC);
+
+	mp4_mux_destroy(mux);
+	array_output_serializer_free(&test.output);
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	video_output_close(video);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(cmaf_part_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
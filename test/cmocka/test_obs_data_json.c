@@ -0,0 +1,229 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <obs-data.h>
+#include <util/bmem.h>
+
+/* expected output is what json_dumps() produces for the same document */
+static const char *input = "{ \"name\": \"a\\\"b\\\\c\\/d\\n\\u0001\\u00e9\\u20ac\\ud83d\\ude00\",\n"
+			   "  \"min\": -9223372036854775808, \"max\": 9223372036854775807,\n"
+			   "  \"half\": 0.5, \"large\": 1.5e10, \"small\": 1e-7, \"tiny\": 9.3132257461547852E-10,\n"
+			   "  \"t\": true, \"f\": false, \"n\": null,\n"
+			   "  \"obj\": {\"x\": 1, \"y\": {}},\n"
+			   "  \"arr\": [{\"a\": 1}, 2, \"s\", [{\"b\": 2}], null, {}],\n"
+			   "  \"empty\": [] }\n";
+
+static const char *compact = "{\"name\":\"a\\\"b\\\\c/d\\n\\u0001\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\","
+			     "\"min\":-9223372036854775808,\"max\":9223372036854775807,"
+			     "\"half\":0.5,\"large\":15000000000.0,\"small\":9.9999999999999995e-8,"
+			     "\"tiny\":9.3132257461547852e-10,\"t\":true,\"f\":false,"
+			     "\"obj\":{\"x\":1,\"y\":{}},\"arr\":[{\"a\":1},{}],\"empty\":[]}";
+
+static const char *pretty = "{\n"
+			    "    \"half\": 0.5,\n"
+			    "    \"obj\": {\n"
+			    "        \"x\": 1,\n"
+			    "        \"y\": {}\n"
+			    "    },\n"
+			    "    \"arr\": [\n"
+			    "        {\n"
+			    "            \"a\": 1\n"
+			    "        },\n"
+			    "        {}\n"
+			    "    ],\n"
+			    "    \"empty\": []\n"
+			    "}";
+
+static void json_compat_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_data_t *data = obs_data_create_from_json(input);
+	assert_non_null(data);
+
+	assert_string_equal(obs_data_get_string(data, "name"),
+			    "a\"b\\c/d\n\x01\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+	assert_true(obs_data_get_int(data, "min") == LLONG_MIN);
+	assert_true(obs_data_get_int(data, "max") == LLONG_MAX);
+	assert_true(obs_data_get_double(data, "small") == 1e-7);
+	assert_false(obs_data_has_user_value(data, "n"));
+
+	obs_data_array_t *arr = obs_data_get_array(data, "arr");
+	assert_int_equal(obs_data_array_count(arr), 2);
+	obs_data_array_release(arr);
+
+	assert_string_equal(obs_data_get_json(data), compact);
+
+	obs_data_t *pretty_data = obs_data_create();
+	obs_data_set_double(pretty_data, "half", 0.5);
+	obs_data_t *obj = obs_data_get_obj(data, "obj");
+	obs_data_set_obj(pretty_data, "obj", obj);
+	obs_data_release(obj);
+	arr = obs_data_get_array(data, "arr");
+	obs_data_set_array(pretty_data, "arr", arr);
+	obs_data_array_release(arr);
+	arr = obs_data_get_array(data, "empty");
+	obs_data_set_array(pretty_data, "empty", arr);
+	obs_data_array_release(arr);
+
+	assert_string_equal(obs_data_get_json_pretty(pretty_data), pretty);
+	obs_data_release(pretty_data);
+
+	/* items jansson can't represent are dropped */
+	obs_data_set_string(data, "\xff", "invalid key");
+	obs_data_set_string(data, "invalid", "\xc0\xaf");
+	obs_data_set_double(data, "nan", NAN);
+	obs_data_set_default_int(data, "default", 1);
+	assert_string_equal(obs_data_get_json(data), compact);
+
+	obs_data_release(data);
+
+	/* a root array is accepted, but has no representation */
+	data = obs_data_create_from_json("[1, {\"a\": 2}]");
+	assert_non_null(data);
+	assert_string_equal(obs_data_get_json(data), "{}");
+	obs_data_release(data);
+}
+
+static void json_reject_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const char *invalid[] = {
+		"",
+		"\"str\"",
+		"{\"a\": 1,}",
+		"{\"a\": 1} x",
+		"{\"a\": 1, \"a\": 2}",
+		"{\"a\": [{\"b\": 1, \"b\": 1}]}",
+		"{\"a\": null, \"a\": 1}",
+		"{\"a\": null, \"a\": null}",
+		"{\"o\": {\"a\": null, \"b\": 1, \"a\": {}}}",
+		"{\"a\": 01}",
+		"{\"a\": 1.}",
+		"{\"a\": -}",
+		"{\"a\": 9223372036854775808}",
+		"{\"a\": -9223372036854775809}",
+		"{\"a\": 1e400}",
+		"{\"a\": tru}",
+		"{\"a\": \"\\ud800\"}",
+		"{\"a\": \"\\udc00\"}",
+		"{\"a\": \"\\u0000\"}",
+		"{\"a\": \"\\x\"}",
+		"{\"a\": \"\xff\"}",
+		"{\"a\": \"\xed\xa0\x80\"}",
+		"{\"a\": \"\t\"}",
+		"{\"a\": \"unterminated}",
+		"{\"a\" 1}",
+	};
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		obs_data_t *data = obs_data_create_from_json(invalid[i]);
+		if (data)
+			fail_msg("accepted invalid json: %s", invalid[i]);
+	}
+
+	/* keys bound to null only clash within the same object */
+	obs_data_t *data = obs_data_create_from_json("{\"a\": null, \"o\": {\"a\": null}, \"b\": null, \"c\": 1}");
+	assert_non_null(data);
+	assert_int_equal(obs_data_get_int(data, "c"), 1);
+	obs_data_release(data);
+}
+
+#define NUM_SOURCES 100
+#define NUM_FILTERS 3
+
+/* synthetic scene collection */
+static obs_data_t *create_collection(void)
+{
+	obs_data_t *root = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+	char name[64];
+
+	obs_data_set_string(root, "name", "Benchmark");
+	obs_data_set_string(root, "current_scene", "Scene 0");
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+		obs_data_array_t *filters = obs_data_array_create();
+
+		snprintf(name, sizeof(name), "Source \"%d\" \xe2\x80\x94 caf\xc3\xa9", i);
+		obs_data_set_string(source, "name", name);
+		obs_data_set_string(source, "id", "ffmpeg_source");
+		obs_data_set_string(source, "uuid", "0d9a1c8e-6f2b-4bb0-9d6e-3c1f5a7e2b44");
+		obs_data_set_int(source, "mixers", 255);
+		obs_data_set_double(source, "volume", 0.7 + i * 1e-6);
+		obs_data_set_bool(source, "enabled", i % 3 != 0);
+
+		obs_data_set_string(settings, "local_file", "C:\\Users\\streamer\\Videos\\clip.mp4");
+		obs_data_set_string(settings, "text", "Line one\nLine two\twith tab");
+		obs_data_set_int(settings, "buffering_mb", 2);
+		obs_data_set_int(settings, "speed_percent", 100);
+		obs_data_set_double(settings, "opacity", 0.333);
+		obs_data_set_bool(settings, "looping", true);
+		obs_data_set_bool(settings, "hw_decode", false);
+		obs_data_set_obj(source, "settings", settings);
+
+		for (int j = 0; j < NUM_FILTERS; j++) {
+			obs_data_t *filter = obs_data_create();
+			obs_data_t *filter_settings = obs_data_create();
+
+			obs_data_set_string(filter, "id", "color_filter_v2");
+			obs_data_set_string(filter, "name", "Color Correction");
+			obs_data_set_double(filter_settings, "gamma", -0.12 * j);
+			obs_data_set_double(filter_settings, "contrast", 0.25);
+			obs_data_set_int(filter_settings, "color_multiply", 0xFFFFFFFFLL - j);
+			obs_data_set_obj(filter, "settings", filter_settings);
+			obs_data_array_push_back(filters, filter);
+
+			obs_data_release(filter_settings);
+			obs_data_release(filter);
+		}
+
+		obs_data_set_array(source, "filters", filters);
+		obs_data_array_push_back(sources, source);
+
+		obs_data_array_release(filters);
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_set_array(root, "sources", sources);
+	obs_data_array_release(sources);
+	return root;
+}
+
+static void json_round_trip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_data_t *data = create_collection();
+	char *json = bstrdup(obs_data_get_json_pretty(data));
+
+	obs_data_t *parsed = obs_data_create_from_json(json);
+	assert_non_null(parsed);
+	assert_string_equal(obs_data_get_json_pretty(parsed), json);
+
+	bfree(json);
+	obs_data_release(parsed);
+	obs_data_release(data);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(json_compat_test),
+		cmocka_unit_test(json_reject_test),
+		cmocka_unit_test(json_round_trip_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
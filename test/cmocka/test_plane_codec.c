@@ -0,0 +1,143 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+
+#include "plane-codec.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define LINESIZE (WIDTH + 64)
+
+static uint8_t plane[LINESIZE * HEIGHT];
+static uint8_t decoded[LINESIZE * HEIGHT];
+static uint8_t encoded[(LINESIZE * HEIGHT / 16 + 1) * 17];
+
+/* smooth gradients with a bit of sensor noise, like a camera */
+static void generate(size_t width, size_t height, size_t step)
+{
+	for (size_t y = 0; y < height; y++) {
+		for (size_t x = 0; x < width; x++) {
+			const double c = (double)(x % step) * 40.0;
+			const double v = 128.0 + 80.0 * sin((double)(x / step) * 0.01 + c) * cos((double)y * 0.013) +
+					 (double)(rand() % 5) - 2.0;
+			plane[y * LINESIZE + x] = (uint8_t)(v < 0.0 ? 0.0 : v > 255.0 ? 255.0 : v);
+		}
+	}
+}
+
+static void roundtrip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const size_t widths[] = {1, 7, 16, 33, 640, WIDTH};
+	static const size_t heights[] = {1, 2, 31, 64};
+	static const size_t steps[] = {1, 2, 3, 4};
+
+	srand(1);
+	for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+		for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+			for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+				const size_t width = widths[w];
+				const size_t rows = heights[h];
+
+				generate(width, rows, steps[s]);
+				const size_t size = plane_encode(encoded, plane, LINESIZE, width, rows, steps[s], 1, 0);
+				assert_true(size <= plane_encode_bound(width, rows));
+
+				memset(decoded, 0, LINESIZE * rows);
+				assert_true(plane_decode(decoded, LINESIZE, encoded, size, width, rows, steps[s], 1, 0));
+				for (size_t y = 0; y < rows; y++) {
+					if (memcmp(decoded + y * LINESIZE, plane + y * LINESIZE, width) != 0)
+						fail_msg("%zux%zu step %zu: row %zu differs", width, rows, steps[s],
+							 y);
+				}
+
+				/* truncated data fails instead of reading past the end */
+				if (size > 1)
+					assert_false(plane_decode(decoded, LINESIZE, encoded, size / 2, width, rows,
+								  steps[s], 1, 0));
+			}
+		}
+	}
+
+	/* noise can't be compressed, but stays within the bound */
+	for (size_t i = 0; i < sizeof(plane); i++)
+		plane[i] = (uint8_t)rand();
+	const size_t size = plane_encode(encoded, plane, LINESIZE, WIDTH, 64, 1, 1, 0);
+	assert_true(size <= plane_encode_bound(WIDTH, 64));
+	assert_true(plane_decode(decoded, LINESIZE, encoded, size, WIDTH, 64, 1, 1, 0));
+	for (size_t y = 0; y < 64; y++)
+		assert_memory_equal(decoded + y * LINESIZE, plane + y * LINESIZE, WIDTH);
+}
+
+static void precision_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	srand(2);
+	generate(WIDTH, 64, 2);
+
+	size_t prev_size = plane_encode(encoded, plane, LINESIZE, WIDTH, 64, 2, 1, 0);
+	for (int shift = 1; shift <= PLANE_CODEC_MAX_SHIFT; shift++) {
+		const size_t size = plane_encode(encoded, plane, LINESIZE, WIDTH, 64, 2, 1, shift);
+		assert_true(size < prev_size);
+		prev_size = size;
+
+		assert_true(plane_decode(decoded, LINESIZE, encoded, size, WIDTH, 64, 2, 1, shift));
+		for (size_t y = 0; y < 64; y++) {
+			for (size_t x = 0; x < WIDTH; x++) {
+				const int error = abs((int)decoded[y * LINESIZE + x] - (int)plane[y * LINESIZE + x]);
+				if (error > (1 << (shift - 1)))
+					fail_msg("shift %d: error %d at %zu,%zu", shift, error, x, y);
+			}
+		}
+	}
+}
+
+/* 10-bit samples in 16 bits like I010, only the low byte loses precision */
+static void precision_16bit_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	srand(3);
+	for (size_t y = 0; y < 64; y++) {
+		for (size_t x = 0; x < WIDTH; x += 2) {
+			const uint16_t v = (uint16_t)((x * 3 + y * 5 + (size_t)(rand() % 5)) % 1024);
+			plane[y * LINESIZE + x] = (uint8_t)v;
+			plane[y * LINESIZE + x + 1] = (uint8_t)(v >> 8);
+		}
+	}
+
+	for (int shift = 0; shift <= PLANE_CODEC_MAX_SHIFT; shift++) {
+		const size_t size = plane_encode(encoded, plane, LINESIZE, WIDTH, 64, 2, 2, shift);
+		assert_true(plane_decode(decoded, LINESIZE, encoded, size, WIDTH, 64, 2, 2, shift));
+
+		for (size_t y = 0; y < 64; y++) {
+			for (size_t x = 0; x < WIDTH; x += 2) {
+				const uint8_t *a = decoded + y * LINESIZE + x;
+				const uint8_t *b = plane + y * LINESIZE + x;
+				const int error = abs((a[0] | a[1] << 8) - (b[0] | b[1] << 8));
+				if (error > (shift ? 1 << (shift - 1) : 0))
+					fail_msg("shift %d: error %d at %zu,%zu", shift, error, x, y);
+			}
+		}
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(roundtrip_test),
+		cmocka_unit_test(precision_test),
+		cmocka_unit_test(precision_16bit_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
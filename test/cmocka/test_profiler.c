@@ -0,0 +1,167 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/profiler.h>
+#include <util/threading.h>
+
+#define NUM_THREADS 8
+#define NUM_PAIRS 10000
+
+static const char *root_name = "test_profiler_root";
+static const char *child_name = "test_profiler_child";
+static const char *timed_root_name = "test_profiler_timed_root";
+
+static void *profile_thread(void *data)
+{
+	UNUSED_PARAMETER(data);
+
+	for (size_t i = 0; i < NUM_PAIRS; i++) {
+		profile_start(root_name);
+		profile_start(child_name);
+		profile_end(child_name);
+		profile_end(root_name);
+
+		profile_start(timed_root_name);
+		profile_end(timed_root_name);
+	}
+
+	return NULL;
+}
+
+static profiler_snapshot_entry_t *found;
+
+static bool find_entry(void *context, profiler_snapshot_entry_t *entry)
+{
+	if (profiler_snapshot_entry_name(entry) != context)
+		return true;
+
+	found = entry;
+	return false;
+}
+
+static profiler_snapshot_entry_t *get_root(profiler_snapshot_t *snap, const char *name)
+{
+	found = NULL;
+	profiler_snapshot_enumerate_roots(snap, find_entry, (void *)name);
+	return found;
+}
+
+static uint64_t count_times(profiler_time_entries_t *times)
+{
+	uint64_t count = 0;
+	for (size_t i = 0; i < times->num; i++)
+		count += times->array[i].count;
+	return count;
+}
+
+static void profiler_threads_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t threads[NUM_THREADS];
+
+	profiler_start();
+	profile_register_root(timed_root_name, 1000000);
+
+	for (size_t i = 0; i < NUM_THREADS; i++)
+		assert_int_equal(pthread_create(&threads[i], NULL, profile_thread, NULL), 0);
+	for (size_t i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	profiler_snapshot_t *snap = profile_snapshot_create();
+
+	profiler_snapshot_entry_t *root = get_root(snap, root_name);
+	assert_non_null(root);
+	assert_int_equal(profiler_snapshot_entry_overall_count(root), NUM_THREADS * NUM_PAIRS);
+
+	/* time between calls is only recorded for roots that expect it */
+	assert_int_equal(count_times(profiler_snapshot_entry_times_between_calls(root)), 0);
+
+	assert_int_equal(profiler_snapshot_num_children(root), 1);
+	found = NULL;
+	profiler_snapshot_enumerate_children(root, find_entry, (void *)child_name);
+	assert_non_null(found);
+	assert_int_equal(profiler_snapshot_entry_overall_count(found), NUM_THREADS * NUM_PAIRS);
+
+	/* measured between consecutive calls on the same thread */
+	profiler_snapshot_entry_t *timed = get_root(snap, timed_root_name);
+	assert_non_null(timed);
+	assert_int_equal(profiler_snapshot_entry_expected_time_between_calls(timed), 1000);
+	assert_int_equal(count_times(profiler_snapshot_entry_times_between_calls(timed)),
+			 NUM_THREADS * (NUM_PAIRS - 1));
+
+	profile_snapshot_free(snap);
+
+	/* data of exited threads must not be counted twice */
+	snap = profile_snapshot_create();
+	root = get_root(snap, root_name);
+	assert_non_null(root);
+	assert_int_equal(profiler_snapshot_entry_overall_count(root), NUM_THREADS * NUM_PAIRS);
+	profile_snapshot_free(snap);
+
+	profiler_stop();
+	profiler_free();
+}
+
+static os_event_t *step_event;
+static os_event_t *done_event;
+
+/* profiles a root once per step, while the profiler is freed and started
+ * again in between */
+static void *restart_thread(void *data)
+{
+	UNUSED_PARAMETER(data);
+
+	for (size_t i = 0; i < 2; i++) {
+		os_event_wait(step_event);
+		profile_reenable_thread();
+		profile_start(root_name);
+		profile_end(root_name);
+		os_event_signal(done_event);
+	}
+
+	return NULL;
+}
+
+static void profiler_restart_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t thread;
+
+	assert_int_equal(os_event_init(&step_event, OS_EVENT_TYPE_AUTO), 0);
+	assert_int_equal(os_event_init(&done_event, OS_EVENT_TYPE_AUTO), 0);
+	assert_int_equal(pthread_create(&thread, NULL, restart_thread, NULL), 0);
+
+	for (size_t i = 0; i < 2; i++) {
+		profiler_start();
+		os_event_signal(step_event);
+		os_event_wait(done_event);
+
+		/* the thread's table is reattached to the new profiler */
+		profiler_snapshot_t *snap = profile_snapshot_create();
+		profiler_snapshot_entry_t *root = get_root(snap, root_name);
+		assert_non_null(root);
+		assert_int_equal(profiler_snapshot_entry_overall_count(root), 1);
+		profile_snapshot_free(snap);
+
+		profiler_stop();
+		profiler_free();
+	}
+
+	pthread_join(thread, NULL);
+	os_event_destroy(step_event);
+	os_event_destroy(done_event);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(profiler_threads_test),
+		cmocka_unit_test(profiler_restart_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
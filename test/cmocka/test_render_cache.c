@@ -0,0 +1,137 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "libobs-test.h"
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define USES_PER_FRAME 3
+#define NUM_FRAMES 10
+
+static volatile long renders;
+static volatile long frames;
+
+static uint32_t test_get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 16;
+}
+
+static void test_video_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+	os_atomic_inc_long(&renders);
+}
+
+static struct obs_source_info video_source = {
+	.id = "render_cache_test",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.get_width = test_get_size,
+	.get_height = test_get_size,
+	.video_render = test_video_render,
+};
+
+/* uses the source several times per frame, like a source that is shown in
+ * several scenes */
+static void draw(void *param, uint32_t cx, uint32_t cy)
+{
+	UNUSED_PARAMETER(cx);
+	UNUSED_PARAMETER(cy);
+
+	for (int i = 0; i < USES_PER_FRAME; i++)
+		obs_source_video_render(param);
+
+	os_atomic_inc_long(&frames);
+}
+
+static long render_frames(obs_source_t *source, long count)
+{
+	os_atomic_set_long(&renders, 0);
+	os_atomic_set_long(&frames, 0);
+
+	obs_add_main_render_callback(draw, source);
+	for (int i = 0; i < 1000 && os_atomic_load_long(&frames) < count; i++)
+		os_sleep_ms(10);
+	obs_remove_main_render_callback(draw, source);
+
+	assert_true(os_atomic_load_long(&frames) >= count);
+	return os_atomic_load_long(&frames);
+}
+
+static void render_cache_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	struct obs_video_info ovi = {
+#ifdef _WIN32
+		.graphics_module = "libobs-d3d11",
+#else
+		.graphics_module = "libobs-opengl",
+#endif
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = 64,
+		.base_height = 64,
+		.output_width = 64,
+		.output_height = 64,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.gpu_conversion = true,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	/* rendering needs a graphics device, which needs a display */
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		obs_shutdown();
+		skip();
+	}
+
+	obs_register_source(&video_source);
+	obs_source_t *source = obs_source_create_private(video_source.id, "video", NULL);
+	assert_non_null(source);
+
+	uint64_t hits, misses;
+
+	/* without the cache every use renders the source */
+	long count = render_frames(source, NUM_FRAMES);
+	assert_int_equal(os_atomic_load_long(&renders), count * USES_PER_FRAME);
+	obs_source_get_render_cache_stats(source, &hits, &misses);
+	assert_int_equal(hits, 0);
+	assert_int_equal(misses, 0);
+
+	/* with the cache, only the first use of each frame renders it, the
+	 * cache is invalidated when sources are ticked for the next frame */
+	obs_source_set_render_cache(source, true);
+	count = render_frames(source, NUM_FRAMES);
+	assert_int_equal(os_atomic_load_long(&renders), count);
+	obs_source_get_render_cache_stats(source, &hits, &misses);
+	assert_int_equal(hits, count * (USES_PER_FRAME - 1));
+	assert_int_equal(misses, count);
+
+	/* and disabling it again renders every use */
+	obs_source_set_render_cache(source, false);
+	count = render_frames(source, NUM_FRAMES);
+	assert_int_equal(os_atomic_load_long(&renders), count * USES_PER_FRAME);
+
+	obs_source_release(source);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(render_cache_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,122 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+
+#include "rnn_data.h"
+#include "kiss_fft.h"
+
+extern const struct RNNModel rnnoise_model_orig;
+
+#define NUM_ITERATIONS 100
+#define FFT_SIZE 960
+
+/* lanes accumulate in scalar order, only FMA contraction may differ */
+#define TOLERANCE 1e-5f
+
+static float input[MAX_NEURONS * 3];
+
+static void randomize(float *data, int count)
+{
+	for (int i = 0; i < count; i++)
+		data[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static void check_close(const float *out, const float *ref, int count, const char *name)
+{
+	for (int i = 0; i < count; i++) {
+		if (fabsf(out[i] - ref[i]) > TOLERANCE)
+			fail_msg("%s: neuron %d is %g, expected %g", name, i, out[i], ref[i]);
+	}
+}
+
+static void check_dense(const DenseLayer *layer, const char *name)
+{
+	float out[MAX_NEURONS];
+	float ref[MAX_NEURONS];
+
+	for (int i = 0; i < NUM_ITERATIONS; i++) {
+		randomize(input, layer->nb_inputs);
+		compute_dense(layer, out, input);
+		compute_dense_c(layer, ref, input);
+		check_close(out, ref, layer->nb_neurons, name);
+	}
+}
+
+static void check_gru(const GRULayer *gru, const char *name)
+{
+	float state[MAX_NEURONS] = {0};
+	float ref[MAX_NEURONS] = {0};
+
+	for (int i = 0; i < NUM_ITERATIONS; i++) {
+		randomize(input, gru->nb_inputs);
+		compute_gru(gru, state, input);
+		compute_gru_c(gru, ref, input);
+		check_close(state, ref, gru->nb_neurons, name);
+
+		/* compare each step from the same state */
+		memcpy(ref, state, sizeof(ref));
+	}
+}
+
+static void rnn_kernels_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct RNNModel *model = &rnnoise_model_orig;
+
+	srand(1);
+	check_dense(model->input_dense, "input_dense");
+	check_gru(model->vad_gru, "vad_gru");
+	check_gru(model->noise_gru, "noise_gru");
+	check_gru(model->denoise_gru, "denoise_gru");
+	check_dense(model->denoise_output, "denoise_output");
+	check_dense(model->vad_output, "vad_output");
+}
+
+static void fft_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	kiss_fft_cpx in[FFT_SIZE];
+	kiss_fft_cpx out[FFT_SIZE];
+	kiss_fft_state *st = opus_fft_alloc(FFT_SIZE, NULL, NULL, 0);
+	assert_non_null(st);
+
+	srand(2);
+	randomize((float *)in, FFT_SIZE * 2);
+	opus_fft(st, in, out, 0);
+
+	for (int k = 0; k < FFT_SIZE; k++) {
+		double re = 0.0;
+		double im = 0.0;
+
+		for (int n = 0; n < FFT_SIZE; n++) {
+			const double phase = -2.0 * M_PI * (double)((k * n) % FFT_SIZE) / FFT_SIZE;
+			re += in[n].r * cos(phase) - in[n].i * sin(phase);
+			im += in[n].r * sin(phase) + in[n].i * cos(phase);
+		}
+
+		if (fabs(out[k].r - re / FFT_SIZE) > TOLERANCE || fabs(out[k].i - im / FFT_SIZE) > TOLERANCE)
+			fail_msg("bin %d is (%g, %g), expected (%g, %g)", k, out[k].r, out[k].i, re / FFT_SIZE,
+				 im / FFT_SIZE);
+	}
+
+	opus_fft_free(st, 0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(rnn_kernels_test),
+		cmocka_unit_test(fft_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,228 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+
+#include "libobs-test.h"
+#include <graphics/matrix4.h>
+
+#define NUM_ITEMS 100
+#define NUM_FRAMES 10
+
+static uint32_t test_get_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 320;
+}
+
+static uint32_t test_get_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 180;
+}
+
+static struct obs_source_info video_source = {
+	.id = "scene_transform_test",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.get_width = test_get_width,
+	.get_height = test_get_height,
+};
+
+static void make_info(struct obs_transform_info *info, size_t idx, int frame)
+{
+	vec2_set(&info->pos, (float)(idx % 40) * 48.0f + (float)frame, (float)(idx / 40) * 27.0f);
+	info->rot = (float)((idx + (size_t)frame) % 360);
+	vec2_set(&info->scale, 0.15f, 0.15f);
+	info->alignment = OBS_ALIGN_CENTER;
+	info->bounds_type = OBS_BOUNDS_NONE;
+	info->bounds_alignment = OBS_ALIGN_CENTER;
+	vec2_set(&info->bounds, 0.0f, 0.0f);
+	info->crop_to_bounds = false;
+}
+
+static bool matrix_close(const struct matrix4 *a, const struct matrix4 *b)
+{
+	const float *fa = (const float *)a;
+	const float *fb = (const float *)b;
+
+	for (size_t i = 0; i < 16; i++) {
+		if (fabsf(fa[i] - fb[i]) > 1e-3f)
+			return false;
+	}
+	return true;
+}
+
+/* plain row by column product, to check the SSE version against */
+static void reference_mul(struct matrix4 *dst, const struct matrix4 *m1, const struct matrix4 *m2)
+{
+	const float *a = (const float *)m1;
+	const float *b = (const float *)m2;
+	float out[16];
+
+	for (size_t row = 0; row < 4; row++) {
+		for (size_t col = 0; col < 4; col++) {
+			float sum = 0.0f;
+			for (size_t i = 0; i < 4; i++)
+				sum += a[row * 4 + i] * b[i * 4 + col];
+			out[row * 4 + col] = sum;
+		}
+	}
+
+	memcpy(dst, out, sizeof(out));
+}
+
+/* how scene items built their matrices before matrix4_from_transform_2d */
+static void reference_transform(struct matrix4 *dst, const struct vec2 *scale, const struct vec2 *origin, float angle,
+				const struct vec2 *pos)
+{
+	matrix4_identity(dst);
+	matrix4_scale3f(dst, dst, scale->x, scale->y, 1.0f);
+	matrix4_translate3f(dst, dst, -origin->x, -origin->y, 0.0f);
+	matrix4_rotate_aa4f(dst, dst, 0.0f, 0.0f, 1.0f, angle);
+	matrix4_translate3f(dst, dst, pos->x, pos->y, 0.0f);
+}
+
+static void matrix_reference_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint32_t rand = 1;
+	for (int n = 0; n < 100; n++) {
+		struct matrix4 a, b, expected, result;
+		float *fa = (float *)&a;
+		float *fb = (float *)&b;
+
+		for (size_t i = 0; i < 16; i++) {
+			rand = rand * 1103515245 + 12345;
+			fa[i] = (float)((rand >> 16) % 2001) / 100.0f - 10.0f;
+			rand = rand * 1103515245 + 12345;
+			fb[i] = (float)((rand >> 16) % 2001) / 100.0f - 10.0f;
+		}
+
+		reference_mul(&expected, &a, &b);
+		matrix4_mul(&result, &a, &b);
+		assert_true(matrix_close(&result, &expected));
+
+		/* the destination may be one of the operands */
+		matrix4_mul(&a, &a, &b);
+		assert_true(matrix_close(&a, &expected));
+	}
+
+	for (int n = 0; n < 360; n += 15) {
+		struct matrix4 expected, result;
+		struct vec2 scale, origin, pos;
+
+		vec2_set(&scale, 0.25f + (float)n / 90.0f, n % 2 ? -1.5f : 0.75f);
+		vec2_set(&origin, (float)n, 180.0f - (float)n / 2.0f);
+		vec2_set(&pos, 1920.0f - (float)n * 3.0f, (float)n * 2.0f);
+
+		reference_transform(&expected, &scale, &origin, RAD((float)n), &pos);
+		matrix4_from_transform_2d(&result, &scale, &origin, RAD((float)n), &pos);
+		if (!matrix_close(&result, &expected))
+			fail_msg("transform at %d degrees differs", n);
+	}
+}
+
+static void scene_transform_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	obs_register_source(&video_source);
+
+	/* there is no canvas without video, so use absolute positions */
+	obs_data_t *private_data = obs_get_private_data();
+	obs_data_set_bool(private_data, "AbsoluteCoordinates", true);
+	obs_data_release(private_data);
+
+	obs_source_t *source = obs_source_create_private(video_source.id, "video", NULL);
+	obs_scene_t *scene = obs_scene_create_private("scene");
+	obs_scene_t *reference = obs_scene_create_private("reference");
+	assert_non_null(source);
+	assert_non_null(scene);
+	assert_non_null(reference);
+
+	obs_sceneitem_t *items[NUM_ITEMS];
+	obs_sceneitem_t *ref_items[NUM_ITEMS];
+	for (size_t i = 0; i < NUM_ITEMS; i++) {
+		items[i] = obs_scene_add(scene, source);
+		ref_items[i] = obs_scene_add(reference, source);
+	}
+
+	struct obs_transform_info info;
+	struct obs_sceneitem_crop crop = {.left = 8, .top = 4};
+
+	/* only the latest queued transform is applied, on the next frame */
+	make_info(&info, 0, 1);
+	obs_sceneitem_queue_transform(items[0], &info, NULL);
+	make_info(&info, 0, 2);
+	obs_sceneitem_queue_transform(items[0], &info, &crop);
+
+	struct vec2 pos;
+	obs_sceneitem_get_pos(items[0], &pos);
+	assert_true(pos.x == 0.0f);
+
+	obs_scene_prune_sources(scene);
+
+	struct obs_sceneitem_crop applied_crop;
+	obs_sceneitem_get_pos(items[0], &pos);
+	obs_sceneitem_get_crop(items[0], &applied_crop);
+	assert_true(pos.x == info.pos.x);
+	assert_int_equal(applied_crop.left, 8);
+
+	/* queued transforms end up with the same matrices as set_info */
+	for (int frame = 0; frame < NUM_FRAMES; frame++) {
+		for (size_t i = 0; i < NUM_ITEMS; i++) {
+			make_info(&info, i, frame);
+			obs_sceneitem_set_info2(ref_items[i], &info);
+		}
+
+		for (size_t i = 0; i < NUM_ITEMS; i++) {
+			make_info(&info, i, frame);
+			obs_sceneitem_queue_transform(items[i], &info, NULL);
+		}
+		obs_scene_prune_sources(scene);
+	}
+
+	for (size_t i = 1; i < NUM_ITEMS; i++) {
+		struct matrix4 a, b;
+
+		obs_sceneitem_get_draw_transform(items[i], &a);
+		obs_sceneitem_get_draw_transform(ref_items[i], &b);
+		if (!matrix_close(&a, &b))
+			fail_msg("draw transform of item %zu differs", i);
+
+		obs_sceneitem_get_box_transform(items[i], &a);
+		obs_sceneitem_get_box_transform(ref_items[i], &b);
+		if (!matrix_close(&a, &b))
+			fail_msg("box transform of item %zu differs", i);
+	}
+
+	/* queued transforms of removed items are dropped */
+	make_info(&info, 1, 0);
+	obs_sceneitem_queue_transform(items[1], &info, NULL);
+	obs_sceneitem_remove(items[1]);
+	obs_scene_prune_sources(scene);
+
+	obs_scene_release(scene);
+	obs_scene_release(reference);
+	obs_source_release(source);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(matrix_reference_test),
+		cmocka_unit_test(scene_transform_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -26,10 +26,34 @@ static void serialize_test(void **state)
 	array_output_serializer_free(&output);
 }
 
+static void seek_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	struct array_output_data output;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &output);
+
+	s_wb32(&s, 0);
+	s_wb32(&s, 0x12345678);
+
+	serializer_seek(&s, 0, SERIALIZE_SEEK_START);
+	assert_true(serializer_get_pos(&s) == 0);
+	s_wb32(&s, 8);
+	assert_true(serializer_get_pos(&s) == 4);
+
+	assert_int_equal(output.bytes.num, 8);
+	uint8_t expected[8] = {0x00, 0x00, 0x00, 0x08, 0x12, 0x34, 0x56, 0x78};
+	assert_memory_equal(output.bytes.array, expected, 8);
+
+	array_output_serializer_free(&output);
+}
+
 int main()
 {
 	const struct CMUnitTest tests[] = {
 		cmocka_unit_test(serialize_test),
+		cmocka_unit_test(seek_test),
 	};
 
 	return cmocka_run_group_tests(tests, NULL, NULL);
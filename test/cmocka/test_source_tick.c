@@ -0,0 +1,163 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+
+#include "libobs-test.h"
+#include <util/threading.h>
+
+#define NUM_SOURCES 10000
+#define NUM_TICKING 500
+#define NUM_SHOWN_TICKING 500
+#define NUM_FRAMES 100
+
+/* internal, declared in obs-internal.h */
+EXPORT void obs_tick_sources(float seconds);
+
+static volatile long tick_count = 0;
+static volatile long update_count = 0;
+static volatile long show_count = 0;
+static volatile long hide_count = 0;
+
+static void test_update(void *data, obs_data_t *settings)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(settings);
+	os_atomic_inc_long(&update_count);
+}
+
+static void test_show(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_atomic_inc_long(&show_count);
+}
+
+static void test_hide(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_atomic_inc_long(&hide_count);
+}
+
+static void test_video_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(seconds);
+	os_atomic_inc_long(&tick_count);
+}
+
+static struct obs_source_info idle_source = {
+	.id = "tick_test_idle",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.update = test_update,
+	.show = test_show,
+	.hide = test_hide,
+};
+
+static struct obs_source_info ticking_source = {
+	.id = "tick_test_ticking",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.video_tick = test_video_tick,
+};
+
+/* like image and text sources, which only do work while they are shown */
+static struct obs_source_info shown_ticking_source = {
+	.id = "tick_test_shown_ticking",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_TICK_WHILE_SHOWING,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+	.video_tick = test_video_tick,
+};
+
+static void source_tick_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	obs_source_t **sources = bzalloc(sizeof(obs_source_t *) * NUM_SOURCES);
+	char name[32];
+
+	obs_register_source(&idle_source);
+	obs_register_source(&ticking_source);
+	obs_register_source(&shown_ticking_source);
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		const char *id = idle_source.id;
+		if (i < NUM_TICKING)
+			id = ticking_source.id;
+		else if (i < NUM_TICKING + NUM_SHOWN_TICKING)
+			id = shown_ticking_source.id;
+
+		snprintf(name, sizeof(name), "source %d", i);
+		sources[i] = obs_source_create_private(id, name, NULL);
+		assert_non_null(sources[i]);
+	}
+
+	/* the first tick removes idle sources from the set */
+	obs_tick_sources(1.0f / 60.0f);
+
+	/* only sources with a video_tick callback are left, hidden sources that
+	 * only tick while shown are dropped as well */
+	os_atomic_set_long(&tick_count, 0);
+	for (int i = 0; i < NUM_FRAMES; i++)
+		obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&tick_count), NUM_FRAMES * NUM_TICKING);
+
+	/* they are ticked while shown, and once more after they were hidden */
+	obs_source_t *shown = sources[NUM_TICKING];
+
+	obs_source_inc_showing(shown);
+	os_atomic_set_long(&tick_count, 0);
+	for (int i = 0; i < NUM_FRAMES; i++)
+		obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&tick_count), NUM_FRAMES * (NUM_TICKING + 1));
+
+	obs_source_dec_showing(shown);
+	os_atomic_set_long(&tick_count, 0);
+	for (int i = 0; i < NUM_FRAMES; i++)
+		obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&tick_count), NUM_FRAMES * NUM_TICKING + 1);
+
+	/* idle sources are woken up by activation and updates */
+	obs_source_t *idle = sources[NUM_SOURCES - 1];
+
+	obs_source_inc_showing(idle);
+	obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&show_count), 1);
+
+	obs_source_dec_showing(idle);
+	obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&hide_count), 1);
+
+	os_atomic_set_long(&update_count, 0);
+	obs_source_update(idle, NULL);
+	obs_tick_sources(1.0f / 60.0f);
+	assert_int_equal(os_atomic_load_long(&update_count), 1);
+
+	for (int i = 0; i < NUM_SOURCES; i++)
+		obs_source_release(sources[i]);
+	bfree(sources);
+
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(source_tick_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
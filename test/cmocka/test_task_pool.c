@@ -0,0 +1,244 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/task.h>
+#include <util/threading.h>
+
+#include "libobs-test.h"
+
+#define NUM_SUBTASKS 10000
+
+static os_event_t *blocker_event;
+static volatile long blocker_started;
+
+static char order[16];
+static volatile long order_len;
+
+static void blocker(void *param)
+{
+	UNUSED_PARAMETER(param);
+	os_atomic_set_long(&blocker_started, 1);
+	os_event_wait(blocker_event);
+}
+
+static void record(void *param)
+{
+	long idx = os_atomic_inc_long(&order_len) - 1;
+	order[idx] = (char)(uintptr_t)param;
+}
+
+static void block_pool(os_task_pool_t *pool)
+{
+	os_atomic_set_long(&blocker_started, 0);
+	os_task_pool_queue_task(pool, OS_TASK_PRIORITY_NORMAL, blocker, NULL);
+	while (!os_atomic_load_long(&blocker_started))
+		os_sleep_ms(1);
+}
+
+static void priority_cancel_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_t *pool = os_task_pool_create(1);
+	struct os_task_pool_stats stats;
+
+	assert_non_null(pool);
+	assert_int_equal(os_event_init(&blocker_event, OS_EVENT_TYPE_MANUAL), 0);
+
+	block_pool(pool);
+
+	os_task_pool_queue_task(pool, OS_TASK_PRIORITY_LOW, record, (void *)'l');
+	uint64_t id = os_task_pool_queue_task(pool, OS_TASK_PRIORITY_NORMAL, record, (void *)'x');
+	os_task_pool_queue_task(pool, OS_TASK_PRIORITY_NORMAL, record, (void *)'n');
+	os_task_pool_queue_task(pool, OS_TASK_PRIORITY_HIGH, record, (void *)'h');
+	assert_true(id != 0);
+
+	os_task_pool_get_stats(pool, &stats);
+	assert_int_equal(stats.running, 1);
+	assert_int_equal(stats.queued[OS_TASK_PRIORITY_HIGH], 1);
+	assert_int_equal(stats.queued[OS_TASK_PRIORITY_NORMAL], 2);
+	assert_int_equal(stats.queued[OS_TASK_PRIORITY_LOW], 1);
+
+	assert_true(os_task_pool_cancel(pool, id));
+	assert_false(os_task_pool_cancel(pool, id));
+	assert_false(os_task_pool_cancel(pool, 0));
+
+	os_event_signal(blocker_event);
+	assert_true(os_task_pool_wait(pool));
+
+	assert_int_equal(os_atomic_load_long(&order_len), 3);
+	assert_memory_equal(order, "hnl", 3);
+
+	os_task_pool_get_stats(pool, &stats);
+	assert_int_equal(stats.running, 0);
+	assert_int_equal(stats.queued[OS_TASK_PRIORITY_NORMAL], 0);
+	assert_int_equal(stats.completed, 4);
+	assert_int_equal(stats.canceled, 1);
+
+	os_event_destroy(blocker_event);
+	os_task_pool_destroy(pool);
+}
+
+static os_task_pool_t *cur_pool;
+static volatile long subtasks_done;
+static volatile long wait_inside_failed;
+
+static void subtask(void *param)
+{
+	uint64_t *val = param;
+
+	for (int i = 0; i < 2000; i++)
+		*val = *val * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	os_atomic_inc_long(&subtasks_done);
+}
+
+/* everything queued from inside the pool lands on one worker's queue, the
+ * other workers have to steal it */
+static void spawn_subtasks(void *param)
+{
+	uint64_t *vals = param;
+
+	if (!os_task_pool_wait(cur_pool))
+		os_atomic_inc_long(&wait_inside_failed);
+
+	for (int i = 0; i < NUM_SUBTASKS; i++)
+		os_task_pool_queue_task(cur_pool, OS_TASK_PRIORITY_NORMAL, subtask, &vals[i]);
+}
+
+static void run_subtasks(size_t threads, struct os_task_pool_stats *stats)
+{
+	uint64_t *vals = bzalloc(sizeof(uint64_t) * NUM_SUBTASKS);
+
+	cur_pool = os_task_pool_create(threads);
+	assert_non_null(cur_pool);
+	assert_false(os_task_pool_inside(cur_pool));
+
+	os_atomic_set_long(&subtasks_done, 0);
+	os_atomic_set_long(&wait_inside_failed, 0);
+
+	os_task_pool_queue_task(cur_pool, OS_TASK_PRIORITY_HIGH, spawn_subtasks, vals);
+	assert_true(os_task_pool_wait(cur_pool));
+
+	assert_int_equal(os_atomic_load_long(&subtasks_done), NUM_SUBTASKS);
+	assert_int_equal(os_atomic_load_long(&wait_inside_failed), 1);
+
+	os_task_pool_get_stats(cur_pool, stats);
+	assert_int_equal(stats->threads, threads);
+	assert_int_equal(stats->completed, NUM_SUBTASKS + 1);
+
+	os_task_pool_destroy(cur_pool);
+	bfree(vals);
+}
+
+static void work_stealing_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct os_task_pool_stats stats;
+	run_subtasks(1, &stats);
+	assert_int_equal(stats.stolen, 0);
+
+	run_subtasks(4, &stats);
+}
+
+static void *wait_thread(void *param)
+{
+	return os_task_pool_wait(param) ? param : NULL;
+}
+
+/* workers and waiters block until they are signaled, so a wakeup that gets
+ * lost shows up as a hang here */
+static void wait_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_t *pool = os_task_pool_create(4);
+	assert_non_null(pool);
+	assert_true(os_task_pool_wait(pool));
+	assert_int_equal(os_event_init(&blocker_event, OS_EVENT_TYPE_MANUAL), 0);
+
+	/* all waiters return once the pool is idle */
+	pthread_t threads[4];
+	block_pool(pool);
+	for (size_t i = 0; i < 4; i++)
+		assert_int_equal(pthread_create(&threads[i], NULL, wait_thread, pool), 0);
+
+	os_event_signal(blocker_event);
+	for (size_t i = 0; i < 4; i++) {
+		void *ret;
+		pthread_join(threads[i], &ret);
+		assert_ptr_equal(ret, pool);
+	}
+
+	for (int i = 0; i < 1000; i++) {
+		uint64_t vals[8] = {0};
+		os_atomic_set_long(&subtasks_done, 0);
+
+		for (int j = 0; j < i % 8; j++)
+			os_task_pool_queue_task(pool, OS_TASK_PRIORITY_NORMAL, subtask, &vals[j]);
+		assert_true(os_task_pool_wait(pool));
+		assert_int_equal(os_atomic_load_long(&subtasks_done), i % 8);
+	}
+
+	os_event_destroy(blocker_event);
+	os_task_pool_destroy(pool);
+}
+
+static os_event_t *queued_event;
+static os_event_t *nested_done_event;
+static volatile long nested_inline;
+
+static void nested_task(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	/* run inline, this would time out before the queueing task continues */
+	if (os_event_timedwait(queued_event, 1000) != 0)
+		os_atomic_set_long(&nested_inline, 1);
+	os_event_signal(nested_done_event);
+}
+
+static void queueing_task(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	obs_queue_task(OBS_TASK_BACKGROUND, nested_task, NULL, false);
+	os_event_signal(queued_event);
+}
+
+/* background tasks queued from a pool worker without waiting are queued, not
+ * run inline */
+static void nested_background_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	assert_int_equal(os_event_init(&queued_event, OS_EVENT_TYPE_MANUAL), 0);
+	assert_int_equal(os_event_init(&nested_done_event, OS_EVENT_TYPE_MANUAL), 0);
+
+	obs_queue_task(OBS_TASK_BACKGROUND, queueing_task, NULL, false);
+	os_event_wait(nested_done_event);
+	assert_int_equal(os_atomic_load_long(&nested_inline), 0);
+
+	os_event_destroy(queued_event);
+	os_event_destroy(nested_done_event);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(priority_cancel_test),
+		cmocka_unit_test(work_stealing_test),
+		cmocka_unit_test(wait_test),
+		cmocka_unit_test(nested_background_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
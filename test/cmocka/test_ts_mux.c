@@ -0,0 +1,727 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+
+#include "ts-mux.h"
+
+#define MAX_OUTPUT (4 * 1024 * 1024)
+#define MAX_FRAMES 1024
+#define MAX_FRAME_DATA (4 * 1024 * 1024)
+#define MAX_PES (256 * 1024)
+#define MAX_STREAMS 4
+
+#define CLOCK_RATE 90000
+#define TIMESTAMP_OFFSET (CLOCK_RATE + CLOCK_RATE * 7 / 10)
+#define MAX_PCR_SPACING (CLOCK_RATE * 40 / 1000)
+
+#define VIDEO_PID 0x100
+#define PMT_PID 0x1000
+
+/* ------------------------------------------------------------------------- */
+/* Synthetic encoder output                                                  */
+
+struct frame {
+	int stream; /* 0 for video, audio tracks from 1 */
+	bool keyframe;
+	int64_t pts;
+	int64_t dts;
+	int32_t timebase_num;
+	int32_t timebase_den;
+	size_t offset;
+	size_t size;
+};
+
+static struct frame frames[MAX_FRAMES];
+static size_t num_frames;
+static uint8_t frame_data[MAX_FRAME_DATA];
+static size_t frame_data_size;
+
+static uint32_t rng;
+
+static inline uint8_t next_byte(void)
+{
+	rng = rng * 1664525 + 1013904223;
+	return (uint8_t)(rng >> 24);
+}
+
+/* bytes of NAL units must not contain start codes */
+static inline uint8_t next_nal_byte(void)
+{
+	return (uint8_t)(next_byte() % 255 + 1);
+}
+
+static struct frame *add_frame(int stream, bool keyframe, int64_t pts, int64_t dts, int32_t den)
+{
+	struct frame *f = &frames[num_frames++];
+	f->stream = stream;
+	f->keyframe = keyframe;
+	f->pts = pts;
+	f->dts = dts;
+	f->timebase_num = 1;
+	f->timebase_den = den;
+	f->offset = frame_data_size;
+	f->size = 0;
+	return f;
+}
+
+static void put(struct frame *f, const uint8_t *data, size_t size)
+{
+	memcpy(frame_data + frame_data_size, data, size);
+	frame_data_size += size;
+	f->size += size;
+}
+
+static void put_random(struct frame *f, size_t size, bool nal)
+{
+	for (size_t i = 0; i < size; i++)
+		frame_data[frame_data_size + i] = nal ? next_nal_byte() : next_byte();
+	frame_data_size += size;
+	f->size += size;
+}
+
+static const uint8_t h264_header[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40,
+				      0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+static const uint8_t hevc_header[] = {0, 0, 0, 1, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+				      0, 0, 0, 1, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+				      0, 0, 0, 1, 0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40};
+
+/* AAC-LC, 48 kHz, stereo */
+static const uint8_t aac_header[] = {0x11, 0x90};
+
+static uint8_t av1_header[32];
+static size_t av1_header_size;
+
+struct bit_writer {
+	uint8_t *data;
+	size_t bits;
+};
+
+static void put_bits(struct bit_writer *w, uint32_t value, int count)
+{
+	for (int i = count - 1; i >= 0; i--) {
+		if (value >> i & 1)
+			w->data[w->bits / 8] |= (uint8_t)(0x80 >> (w->bits % 8));
+		w->bits++;
+	}
+}
+
+/* 1920x1080 main profile sequence header OBU at level 4.0 */
+static void make_av1_header(void)
+{
+	uint8_t payload[32] = {0};
+	struct bit_writer w = {payload, 0};
+
+	put_bits(&w, 0, 3);      /* seq_profile */
+	put_bits(&w, 0, 1);      /* still_picture */
+	put_bits(&w, 0, 1);      /* reduced_still_picture_header */
+	put_bits(&w, 0, 1);      /* timing_info_present_flag */
+	put_bits(&w, 0, 1);      /* initial_display_delay_present_flag */
+	put_bits(&w, 0, 5);      /* operating_points_cnt_minus_1 */
+	put_bits(&w, 0, 12);     /* operating_point_idc[0] */
+	put_bits(&w, 8, 5);      /* seq_level_idx[0] */
+	put_bits(&w, 0, 1);      /* seq_tier[0] */
+	put_bits(&w, 10, 4);     /* frame_width_bits_minus_1 */
+	put_bits(&w, 10, 4);     /* frame_height_bits_minus_1 */
+	put_bits(&w, 1919, 11);  /* max_frame_width_minus_1 */
+	put_bits(&w, 1079, 11);  /* max_frame_height_minus_1 */
+	put_bits(&w, 0, 1);      /* frame_id_numbers_present_flag */
+	put_bits(&w, 0, 3);      /* 128x128 superblocks, filter intra, intra edge filter */
+	put_bits(&w, 0, 4);      /* interintra, masked compound, warped motion, dual filter */
+	put_bits(&w, 1, 1);      /* enable_order_hint */
+	put_bits(&w, 0, 2);      /* enable_jnt_comp, enable_ref_frame_mvs */
+	put_bits(&w, 1, 1);      /* seq_choose_screen_content_tools */
+	put_bits(&w, 1, 1);      /* seq_choose_integer_mv */
+	put_bits(&w, 6, 3);      /* order_hint_bits_minus_1 */
+	put_bits(&w, 0, 1);      /* enable_superres */
+	put_bits(&w, 1, 2);      /* enable_cdef, enable_restoration */
+	put_bits(&w, 0, 1);      /* high_bitdepth */
+	put_bits(&w, 0, 1);      /* mono_chrome */
+	put_bits(&w, 0, 1);      /* color_description_present_flag */
+	put_bits(&w, 0, 1);      /* color_range */
+	put_bits(&w, 0, 2);      /* chroma_sample_position */
+	put_bits(&w, 0, 1);      /* separate_uv_delta_q */
+	put_bits(&w, 0, 1);      /* film_grain_params_present */
+	put_bits(&w, 1, 1);      /* trailing one bit */
+
+	const size_t size = (w.bits + 7) / 8;
+	av1_header[0] = 1 << 3 | 0x02;
+	av1_header[1] = (uint8_t)size;
+	memcpy(av1_header + 2, payload, size);
+	av1_header_size = 2 + size;
+}
+
+static void generate_video(const char *codec, int count, size_t key_size)
+{
+	for (int i = 0; i < count; i++) {
+		const bool key = i % 30 == 0;
+		/* one frame of reordering delay */
+		struct frame *f = add_frame(0, key, i, i - 1, 30);
+		const size_t size = key ? key_size : 300 + (size_t)(i * 37 % 900);
+
+		if (strcmp(codec, "h264") == 0) {
+			const uint8_t nal[] = {0, 0, 0, 1, key ? 0x65 : 0x41};
+			put(f, nal, sizeof(nal));
+			put_random(f, size, true);
+		} else if (strcmp(codec, "hevc") == 0) {
+			const uint8_t nal[] = {0, 0, 0, 1, key ? 0x26 : 0x02, 0x01};
+			put(f, nal, sizeof(nal));
+			put_random(f, size, true);
+		} else {
+			/* frame OBU with a two byte size field */
+			const uint8_t obu[] = {6 << 3 | 0x02, (uint8_t)((size & 0x7f) | 0x80), (uint8_t)(size >> 7)};
+			put(f, obu, sizeof(obu));
+			put_random(f, size, false);
+			/* make sure there is something to escape */
+			memset(frame_data + frame_data_size - size + 10, 0, 5);
+		}
+	}
+}
+
+static void generate_audio(int stream, const char *codec, int count)
+{
+	const int64_t samples = strcmp(codec, "aac") == 0 ? 1024 : 960;
+
+	for (int i = 0; i < count; i++) {
+		struct frame *f = add_frame(stream, true, i * samples, i * samples, 48000);
+		/* sizes past 255 and 510 exercise the Opus size runs */
+		put_random(f, 200 + (size_t)(i * 53 % 400), false);
+	}
+}
+
+static int compare_frames(const void *a, const void *b)
+{
+	const struct frame *fa = a;
+	const struct frame *fb = b;
+	const int64_t ta = fa->dts * 48000 / fa->timebase_den;
+	const int64_t tb = fb->dts * 48000 / fb->timebase_den;
+
+	if (ta != tb)
+		return ta < tb ? -1 : 1;
+	if (fa->stream != fb->stream)
+		return fa->stream - fb->stream;
+	return fa->offset < fb->offset ? -1 : 1;
+}
+
+static void reset_frames(void)
+{
+	num_frames = 0;
+	frame_data_size = 0;
+	rng = 1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Muxing                                                                    */
+
+static uint8_t output[MAX_OUTPUT];
+static size_t output_size;
+static bool flushing;
+
+static void write_datagram(void *param, const uint8_t *data, size_t size)
+{
+	UNUSED_PARAMETER(param);
+
+	if (!flushing)
+		assert_int_equal(size, TS_DATAGRAM_SIZE);
+	assert_true(size && size <= TS_DATAGRAM_SIZE && size % TS_PACKET_SIZE == 0);
+	assert_true(output_size + size <= MAX_OUTPUT);
+
+	memcpy(output + output_size, data, size);
+	output_size += size;
+}
+
+static void mux_frames(const struct ts_mux_track *video, const struct ts_mux_track *audio, size_t num_audio)
+{
+	struct ts_mux *mux = ts_mux_create(video, audio, num_audio, write_datagram, NULL);
+	assert_non_null(mux);
+
+	qsort(frames, num_frames, sizeof(frames[0]), compare_frames);
+
+	output_size = 0;
+	for (size_t i = 0; i < num_frames; i++) {
+		const struct frame *f = &frames[i];
+		struct encoder_packet packet = {
+			.data = frame_data + f->offset,
+			.size = f->size,
+			.pts = f->pts,
+			.dts = f->dts,
+			.timebase_num = f->timebase_num,
+			.timebase_den = f->timebase_den,
+			.type = f->stream ? OBS_ENCODER_AUDIO : OBS_ENCODER_VIDEO,
+			.keyframe = f->keyframe,
+			.track_idx = f->stream ? (size_t)f->stream - 1 : 0,
+		};
+		assert_true(ts_mux_write_packet(mux, &packet));
+	}
+
+	flushing = true;
+	ts_mux_flush(mux);
+	flushing = false;
+	ts_mux_destroy(mux);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Transport stream checks, independent of the muxer                         */
+
+struct pid_state {
+	int cc;
+	uint8_t pes[MAX_PES];
+	size_t pes_size;
+	size_t next_frame;
+};
+
+static struct pid_state pids[MAX_STREAMS];
+static uint16_t first_pid;
+static uint16_t pcr_pid;
+static uint8_t stream_types[MAX_STREAMS];
+static size_t num_pmt_streams;
+static int pat_cc, pmt_cc;
+static size_t num_psi;
+
+static uint32_t crc32_mpeg(const uint8_t *data, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+
+	for (size_t i = 0; i < size; i++) {
+		for (int bit = 7; bit >= 0; bit--) {
+			const bool top = (crc >> 31) ^ ((data[i] >> bit) & 1);
+			crc <<= 1;
+			if (top)
+				crc ^= 0x04c11db7;
+		}
+	}
+	return crc;
+}
+
+static inline int64_t read_pcr(const uint8_t *p)
+{
+	return (int64_t)p[0] << 25 | (int64_t)p[1] << 17 | (int64_t)p[2] << 9 | (int64_t)p[3] << 1 | p[4] >> 7;
+}
+
+static inline int64_t read_timestamp(const uint8_t *p)
+{
+	return (int64_t)(p[0] & 0x0e) << 29 | (int64_t)p[1] << 22 | (int64_t)(p[2] & 0xfe) << 14 |
+	       (int64_t)p[3] << 7 | p[4] >> 1;
+}
+
+static void check_psi(const uint8_t *p, int *cc)
+{
+	assert_true(p[1] & 0x40);
+	assert_int_equal(p[3] >> 4, 1);
+	if (*cc >= 0)
+		assert_int_equal(p[3] & 0x0f, (*cc + 1) & 0x0f);
+	*cc = p[3] & 0x0f;
+
+	assert_int_equal(p[4], 0);
+	const uint8_t *section = p + 5;
+	const size_t length = (size_t)((section[1] & 0x0f) << 8 | section[2]);
+	assert_true(3 + length <= TS_PACKET_SIZE - 5);
+	assert_int_equal(crc32_mpeg(section, 3 + length), 0);
+
+	if (section[0] == 0x00) {
+		/* one program pointing at the PMT */
+		assert_int_equal(length, 13);
+		assert_int_equal(section[8] << 8 | section[9], 1);
+		assert_int_equal((section[10] & 0x1f) << 8 | section[11], PMT_PID);
+	} else {
+		assert_int_equal(section[0], 0x02);
+		pcr_pid = (uint16_t)((section[8] & 0x1f) << 8 | section[9]);
+
+		const uint8_t *s = section + 12 + ((section[10] & 0x0f) << 8 | section[11]);
+		const uint8_t *end = section + 3 + length - 4;
+		num_pmt_streams = 0;
+		while (s < end) {
+			const uint16_t pid = (uint16_t)((s[1] & 0x1f) << 8 | s[2]);
+			assert_int_equal(pid, first_pid + num_pmt_streams);
+			stream_types[num_pmt_streams++] = s[0];
+			s += 5 + ((s[3] & 0x0f) << 8 | s[4]);
+		}
+		assert_true(s == end);
+	}
+	num_psi++;
+}
+
+/* removes start codes and emulation prevention, OBUs are cut to their size
+ * field as a trailing 0x03 may follow */
+static size_t unescape_obus(uint8_t *dst, const uint8_t *es, size_t size)
+{
+	size_t out = 0;
+	size_t i = 0;
+
+	while (i < size) {
+		assert_true(i + 3 < size && es[i] == 0 && es[i + 1] == 0 && es[i + 2] == 1);
+		i += 3;
+
+		size_t end = i;
+		while (end < size && !(end + 3 <= size && es[end] == 0 && es[end + 1] == 0 && es[end + 2] == 1))
+			end++;
+
+		const size_t obu = out;
+		int zeros = 0;
+		for (size_t j = i; j < end; j++) {
+			if (zeros >= 2 && es[j] == 3) {
+				zeros = 0;
+				continue;
+			}
+			dst[out++] = es[j];
+			zeros = es[j] ? 0 : zeros + 1;
+		}
+
+		/* header, then a size field of up to two bytes in these streams */
+		assert_true(dst[obu] & 0x02);
+		size_t obu_size = dst[obu + 1] & 0x7f;
+		size_t header = 2;
+		if (dst[obu + 1] & 0x80)
+			obu_size |= (size_t)dst[obu + header++] << 7;
+		assert_true(obu + header + obu_size <= out);
+		out = obu + header + obu_size;
+		i = end;
+	}
+	return out;
+}
+
+/* payload of a whole PES packet against the next frame of its stream */
+static void check_pes(struct pid_state *state, int stream, const char *codec)
+{
+	const uint8_t *p = state->pes;
+	assert_true(state->pes_size >= 14);
+	assert_true(p[0] == 0 && p[1] == 0 && p[2] == 1);
+
+	const size_t length = (size_t)(p[4] << 8 | p[5]);
+	if (length)
+		assert_int_equal(length, state->pes_size - 6);
+	else
+		assert_int_equal(stream, 0);
+
+	const uint8_t flags = p[7];
+	const int64_t pts = read_timestamp(p + 9);
+	const int64_t dts = flags & 0x40 ? read_timestamp(p + 14) : pts;
+	const uint8_t *es = p + 9 + p[8];
+	const size_t es_size = state->pes_size - 9 - p[8];
+
+	const struct frame *f = NULL;
+	while (state->next_frame < num_frames) {
+		const struct frame *candidate = &frames[state->next_frame++];
+		if (candidate->stream == stream) {
+			f = candidate;
+			break;
+		}
+	}
+	assert_non_null(f);
+
+	const uint8_t *data = frame_data + f->offset;
+	const int64_t scale = CLOCK_RATE * f->timebase_num;
+	assert_int_equal(pts, f->pts * scale / f->timebase_den + TIMESTAMP_OFFSET);
+	assert_int_equal(dts, f->dts * scale / f->timebase_den + TIMESTAMP_OFFSET);
+
+	if (strcmp(codec, "aac") == 0) {
+		assert_int_equal(p[3], 0xc0);
+		assert_int_equal(es_size, 7 + f->size);
+		assert_true(es[0] == 0xff && (es[1] & 0xf6) == 0xf0);
+		assert_int_equal((es[3] & 3) << 11 | es[4] << 3 | es[5] >> 5, es_size);
+		assert_memory_equal(es + 7, data, f->size);
+	} else if (strcmp(codec, "opus") == 0) {
+		assert_int_equal(p[3], 0xbd);
+		assert_true(es[0] == 0x7f && (es[1] & 0xe0) == 0xe0);
+		size_t au_size = 0, i = 2;
+		do {
+			au_size += es[i];
+		} while (es[i++] == 0xff);
+		assert_int_equal(au_size, f->size);
+		assert_int_equal(es_size, i + f->size);
+		assert_memory_equal(es + i, data, f->size);
+	} else if (strcmp(codec, "av1") == 0) {
+		assert_int_equal(p[3], 0xbd);
+
+		static uint8_t obus[MAX_PES];
+		const size_t size = unescape_obus(obus, es, es_size);
+
+		/* temporal delimiter, sequence header on keyframes, then the frame */
+		assert_true(obus[0] == 0x12 && obus[1] == 0);
+		size_t offset = 2;
+		if (f->keyframe) {
+			assert_memory_equal(obus + offset, av1_header, av1_header_size);
+			offset += av1_header_size;
+		}
+		assert_true(offset + f->size <= size);
+		assert_memory_equal(obus + offset, data, f->size);
+	} else {
+		const bool h264 = strcmp(codec, "h264") == 0;
+		assert_int_equal(p[3], 0xe0);
+		assert_true(es[0] == 0 && es[1] == 0 && es[2] == 0 && es[3] == 1);
+		assert_int_equal(h264 ? es[4] & 0x1f : es[4] >> 1, h264 ? 9 : 35);
+
+		const uint8_t *header = h264 ? h264_header : hevc_header;
+		const size_t header_size = h264 ? sizeof(h264_header) : sizeof(hevc_header);
+		const size_t aud_size = h264 ? 6 : 7;
+		assert_int_equal(es_size, aud_size + (f->keyframe ? header_size : 0) + f->size);
+		if (f->keyframe)
+			assert_memory_equal(es + aud_size, header, header_size);
+		assert_memory_equal(es + es_size - f->size, data, f->size);
+	}
+}
+
+static uint8_t stream_type(const char *codec)
+{
+	if (strcmp(codec, "h264") == 0)
+		return 0x1b;
+	if (strcmp(codec, "hevc") == 0)
+		return 0x24;
+	if (strcmp(codec, "aac") == 0)
+		return 0x0f;
+	return 0x06;
+}
+
+static void check_stream(const char *video, const char *const *audio, size_t num_audio)
+{
+	const size_t num_streams = (video ? 1 : 0) + num_audio;
+	const char *codecs[MAX_STREAMS];
+	int64_t last_pcr = -1;
+	size_t num_pcr = 0;
+
+	for (size_t i = 0; i < num_streams; i++) {
+		pids[i].cc = -1;
+		pids[i].pes_size = 0;
+		pids[i].next_frame = 0;
+		codecs[i] = video && !i ? video : audio[i - (video ? 1 : 0)];
+	}
+	first_pid = video ? VIDEO_PID : VIDEO_PID + 1;
+	pat_cc = pmt_cc = -1;
+	num_psi = 0;
+	num_pmt_streams = 0;
+
+	assert_true(output_size > 0);
+	assert_int_equal(output_size % TS_PACKET_SIZE, 0);
+
+	for (size_t offset = 0; offset < output_size; offset += TS_PACKET_SIZE) {
+		const uint8_t *p = output + offset;
+		assert_int_equal(p[0], 0x47);
+
+		const uint16_t pid = (uint16_t)((p[1] & 0x1f) << 8 | p[2]);
+		const bool start = p[1] & 0x40;
+		const int afc = p[3] >> 4 & 3;
+		const int cc = p[3] & 0x0f;
+
+		if (pid == 0) {
+			check_psi(p, &pat_cc);
+			continue;
+		}
+		if (pid == PMT_PID) {
+			check_psi(p, &pmt_cc);
+			continue;
+		}
+
+		const size_t index = (size_t)(pid - first_pid);
+		assert_true(index < num_streams);
+		assert_true(num_psi >= 2);
+		struct pid_state *state = &pids[index];
+
+		if (afc & 1) {
+			if (state->cc >= 0)
+				assert_int_equal(cc, (state->cc + 1) & 0x0f);
+			state->cc = cc;
+		} else if (state->cc >= 0) {
+			assert_int_equal(cc, state->cc);
+		}
+
+		size_t payload = 4;
+		if (afc & 2) {
+			const uint8_t length = p[4];
+			assert_true(length <= 183);
+			assert_true(afc == 3 || length == 183);
+			if (length && (p[5] & 0x10)) {
+				assert_int_equal(pid, pcr_pid);
+				const int64_t pcr = read_pcr(p + 6);
+				if (last_pcr >= 0) {
+					assert_true(pcr >= last_pcr);
+					assert_true(pcr - last_pcr <= MAX_PCR_SPACING);
+				}
+				last_pcr = pcr;
+				num_pcr++;
+			}
+			payload += 1 + length;
+		}
+
+		if (start && state->pes_size) {
+			check_pes(state, (int)(index + (video ? 0 : 1)), codecs[index]);
+			state->pes_size = 0;
+		}
+		if (afc & 1) {
+			assert_true(start || state->pes_size);
+			assert_true(state->pes_size + TS_PACKET_SIZE - payload <= MAX_PES);
+			memcpy(state->pes + state->pes_size, p + payload, TS_PACKET_SIZE - payload);
+			state->pes_size += TS_PACKET_SIZE - payload;
+		}
+	}
+
+	for (size_t i = 0; i < num_streams; i++) {
+		check_pes(&pids[i], (int)(i + (video ? 0 : 1)), codecs[i]);
+
+		/* every frame was found */
+		int stream = (int)(i + (video ? 0 : 1));
+		for (size_t f = pids[i].next_frame; f < num_frames; f++)
+			assert_true(frames[f].stream != stream);
+	}
+
+	assert_int_equal(num_pmt_streams, num_streams);
+	for (size_t i = 0; i < num_streams; i++)
+		assert_int_equal(stream_types[i], stream_type(codecs[i]));
+	assert_int_equal(pcr_pid, first_pid);
+	assert_true(num_pcr > 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Golden files                                                              */
+
+static void compare_golden(const char *name)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", TS_MUX_DATA_DIR, name);
+
+	/* regenerate with TS_MUX_UPDATE_GOLDEN=1 after intended changes */
+	if (getenv("TS_MUX_UPDATE_GOLDEN")) {
+		FILE *file = fopen(path, "wb");
+		assert_non_null(file);
+		assert_int_equal(fwrite(output, 1, output_size, file), output_size);
+		fclose(file);
+		return;
+	}
+
+	static uint8_t golden[MAX_OUTPUT];
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		fail_msg("missing golden file %s", path);
+	const size_t size = fread(golden, 1, sizeof(golden), file);
+	fclose(file);
+
+	assert_int_equal(size, output_size);
+	for (size_t i = 0; i < size; i++) {
+		if (golden[i] != output[i])
+			fail_msg("%s differs at packet %zu, byte %zu", name, i / TS_PACKET_SIZE, i % TS_PACKET_SIZE);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void h264_aac_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	reset_frames();
+	generate_video("h264", 60, 6000);
+	generate_audio(1, "aac", 94);
+
+	const struct ts_mux_track video = {"h264", h264_header, sizeof(h264_header), 0};
+	const struct ts_mux_track audio = {"aac", aac_header, sizeof(aac_header), 2};
+	mux_frames(&video, &audio, 1);
+
+	const char *codecs[] = {"aac"};
+	check_stream("h264", codecs, 1);
+	compare_golden("h264-aac.ts");
+}
+
+static void hevc_opus_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	reset_frames();
+	generate_video("hevc", 60, 6000);
+	generate_audio(1, "opus", 100);
+
+	const struct ts_mux_track video = {"hevc", hevc_header, sizeof(hevc_header), 0};
+	const struct ts_mux_track audio = {"opus", NULL, 0, 2};
+	mux_frames(&video, &audio, 1);
+
+	const char *codecs[] = {"opus"};
+	check_stream("hevc", codecs, 1);
+	compare_golden("hevc-opus.ts");
+}
+
+static void av1_aac_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	reset_frames();
+	make_av1_header();
+	generate_video("av1", 60, 6000);
+	generate_audio(1, "aac", 94);
+
+	const struct ts_mux_track video = {"av1", av1_header, av1_header_size, 0};
+	const struct ts_mux_track audio = {"aac", aac_header, sizeof(aac_header), 2};
+	mux_frames(&video, &audio, 1);
+
+	const char *codecs[] = {"aac"};
+	check_stream("av1", codecs, 1);
+	compare_golden("av1-aac.ts");
+}
+
+/* frames over 64 KiB have an unbounded PES length */
+static void large_frame_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	reset_frames();
+	generate_video("h264", 31, 200000);
+	generate_audio(1, "aac", 48);
+	generate_audio(2, "aac", 48);
+
+	const struct ts_mux_track video = {"h264", h264_header, sizeof(h264_header), 0};
+	const struct ts_mux_track audio[] = {
+		{"aac", aac_header, sizeof(aac_header), 2},
+		{"aac", aac_header, sizeof(aac_header), 2},
+	};
+	mux_frames(&video, audio, 2);
+
+	const char *codecs[] = {"aac", "aac"};
+	check_stream("h264", codecs, 2);
+}
+
+/* without video the PCR moves to the first audio track */
+static void audio_only_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	reset_frames();
+	generate_audio(1, "opus", 100);
+
+	const struct ts_mux_track audio = {"opus", NULL, 0, 2};
+	mux_frames(NULL, &audio, 1);
+
+	const char *codecs[] = {"opus"};
+	check_stream(NULL, codecs, 1);
+}
+
+static void unsupported_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct ts_mux_track vp9 = {"vp9", NULL, 0, 0};
+	const struct ts_mux_track opus = {"opus", NULL, 0, 0};
+	const struct ts_mux_track he_aac_v2 = {"aac", (const uint8_t[]){0xeb, 0x09}, 2, 2};
+
+	assert_null(ts_mux_create(&vp9, NULL, 0, write_datagram, NULL));
+	assert_null(ts_mux_create(NULL, &opus, 1, write_datagram, NULL));
+	assert_null(ts_mux_create(NULL, &he_aac_v2, 1, write_datagram, NULL));
+	assert_null(ts_mux_create(NULL, NULL, 0, write_datagram, NULL));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(h264_aac_test),
+		cmocka_unit_test(hevc_opus_test),
+		cmocka_unit_test(av1_aac_test),
+		cmocka_unit_test(large_frame_test),
+		cmocka_unit_test(audio_only_test),
+		cmocka_unit_test(unsupported_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,105 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "libobs-test.h"
+#include <media-io/video-frame.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define NUM_LOCKS 100000
+
+static uint64_t frame_time;
+static uint64_t expected_ts;
+static volatile long outputs;
+static volatile long bad_timestamps;
+
+static void raw_video(void *param, struct video_data *frame)
+{
+	UNUSED_PARAMETER(param);
+
+	/* repeated frames carry on where the dropped ones would have been */
+	if (frame->timestamp != expected_ts)
+		os_atomic_inc_long(&bad_timestamps);
+	expected_ts = frame->timestamp + frame_time;
+
+	/* stall now and then so that the cache fills up */
+	if (os_atomic_inc_long(&outputs) % 4096 == 0)
+		os_sleep_ms(2);
+}
+
+static void stress_cache(size_t cache_size)
+{
+	struct video_output_info info = {
+		.name = "stress",
+		.format = VIDEO_FORMAT_RGBA,
+		.fps_num = 60,
+		.fps_den = 1,
+		.width = 16,
+		.height = 16,
+		.cache_size = cache_size,
+	};
+	video_t *video;
+
+	assert_int_equal(video_output_open(&video, &info), VIDEO_OUTPUT_SUCCESS);
+	frame_time = video_output_get_frame_time(video);
+	expected_ts = 0;
+	os_atomic_set_long(&outputs, 0);
+	os_atomic_set_long(&bad_timestamps, 0);
+	assert_true(video_output_connect(video, NULL, raw_video, NULL));
+
+	uint32_t rand = 1;
+	long frames = 0;
+	long dropped = 0;
+
+	for (int i = 0; i < NUM_LOCKS; i++) {
+		struct video_frame frame;
+
+		rand = rand * 1103515245 + 12345;
+		const int count = 1 + (int)((rand >> 16) % 3);
+
+		if (video_output_lock_frame(video, &frame, count, (uint64_t)frames * frame_time)) {
+			frame.data[0][0] = (uint8_t)i;
+			video_output_unlock_frame(video);
+		} else {
+			dropped += count;
+		}
+
+		frames += count;
+	}
+
+	for (int i = 0; i < 10000 && os_atomic_load_long(&outputs) < frames; i++)
+		os_sleep_ms(1);
+
+	/* every frame is output once, dropped frames as repeats */
+	assert_int_equal(os_atomic_load_long(&outputs), frames);
+	assert_int_equal(os_atomic_load_long(&bad_timestamps), 0);
+	assert_int_equal(video_output_get_skipped_frames(video), dropped);
+	assert_int_equal(video_output_get_total_frames(video), frames);
+
+	video_output_disconnect(video, raw_video, NULL);
+	video_output_close(video);
+}
+
+static void video_output_cache_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	stress_cache(1);
+	stress_cache(6);
+	stress_cache(64);
+
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(video_output_cache_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
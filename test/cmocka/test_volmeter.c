@@ -0,0 +1,134 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+
+#include "libobs-test.h"
+
+#define FRAMES 1024
+#define SECONDS 10
+
+/* one extra sample so that the audio can be passed unaligned */
+static float left[FRAMES + 1];
+static float right[FRAMES + 1];
+
+static int updates[2];
+static float last_input_peak;
+
+static struct obs_source_info audio_source = {
+	.id = "volmeter_test",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = obs_test_get_name,
+	.create = obs_test_create,
+	.destroy = obs_test_destroy,
+};
+
+static void levels_updated(void *param, const float magnitude[MAX_AUDIO_CHANNELS],
+			   const float peak[MAX_AUDIO_CHANNELS], const float input_peak[MAX_AUDIO_CHANNELS])
+{
+	UNUSED_PARAMETER(magnitude);
+	UNUSED_PARAMETER(peak);
+
+	updates[(size_t)param]++;
+	last_input_peak = input_peak[0];
+}
+
+static void output_block(obs_source_t *source, size_t offset)
+{
+	struct obs_source_audio audio = {
+		.data = {(uint8_t *)(left + offset), (uint8_t *)(right + offset)},
+		.frames = FRAMES,
+		.speakers = SPEAKERS_STEREO,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.samples_per_sec = 48000,
+	};
+
+	obs_source_output_audio(source, &audio);
+}
+
+static void volmeter_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_test_startup();
+
+	struct obs_audio_info oai = {.samples_per_sec = 48000, .speakers = SPEAKERS_STEREO};
+	assert_true(obs_reset_audio(&oai));
+
+	obs_register_source(&audio_source);
+	obs_source_t *source = obs_source_create_private(audio_source.id, "audio", NULL);
+	assert_non_null(source);
+
+	/* 1 kHz sine, which K-weighting leaves close to unchanged */
+	const float amplitude = powf(10.0f, -23.0f / 20.0f);
+	for (size_t i = 0; i < FRAMES + 1; i++) {
+		left[i] = right[i] = amplitude * sinf(2.0f * (float)M_PI * 1000.0f * (float)i / 48000.0f);
+	}
+
+	obs_volmeter_t *meters[2];
+	for (size_t i = 0; i < 2; i++) {
+		meters[i] = obs_volmeter_create(OBS_FADER_LOG);
+		obs_volmeter_add_callback(meters[i], levels_updated, (void *)i);
+		assert_true(obs_volmeter_attach_source(meters[i], source));
+	}
+	obs_volmeter_set_peak_meter_type(meters[1], TRUE_PEAK_METER);
+	obs_volmeter_set_loudness_enabled(meters[0], true);
+	assert_true(isinf(obs_volmeter_get_loudness(meters[0])));
+
+	/* unaligned audio is measured like any other */
+	output_block(source, 1);
+	assert_int_equal(updates[0], 1);
+	assert_int_equal(updates[1], 1);
+	assert_true(fabsf(last_input_peak + 23.0f) < 0.5f);
+
+	const size_t blocks = SECONDS * 48000 / FRAMES;
+	for (size_t i = 0; i < blocks; i++)
+		output_block(source, 0);
+
+	assert_int_equal(updates[0], blocks + 1);
+	assert_int_equal(updates[1], blocks + 1);
+
+	assert_true(fabsf(obs_volmeter_get_loudness(meters[0]) + 23.0f) < 0.3f);
+	assert_true(isinf(obs_volmeter_get_loudness(meters[1])));
+
+	/* loudness is gated per meter, enabling or resetting one meter leaves
+	 * the other one alone */
+	obs_volmeter_set_loudness_enabled(meters[1], true);
+	for (size_t i = 0; i < 48000 / FRAMES; i++)
+		output_block(source, 0);
+
+	assert_true(fabsf(obs_volmeter_get_loudness(meters[0]) + 23.0f) < 0.3f);
+	assert_true(fabsf(obs_volmeter_get_loudness(meters[1]) + 23.0f) < 0.3f);
+
+	obs_volmeter_reset_loudness(meters[1]);
+	assert_true(isinf(obs_volmeter_get_loudness(meters[1])));
+	output_block(source, 0);
+	assert_true(fabsf(obs_volmeter_get_loudness(meters[0]) + 23.0f) < 0.3f);
+	assert_true(isinf(obs_volmeter_get_loudness(meters[1])));
+
+	obs_volmeter_set_loudness_enabled(meters[1], false);
+	obs_volmeter_reset_loudness(meters[0]);
+	assert_true(isinf(obs_volmeter_get_loudness(meters[0])));
+
+	/* the remaining meter still receives levels */
+	const int prev_updates = updates[1];
+	obs_volmeter_destroy(meters[0]);
+	output_block(source, 0);
+	assert_int_equal(updates[1], prev_updates + 1);
+
+	obs_volmeter_destroy(meters[1]);
+	obs_source_release(source);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(volmeter_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,163 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+extern "C" {
+#include <cmocka.h>
+}
+
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#include <mutex>
+#include <vector>
+
+#include "whip-send-queue.h"
+
+/* 100 bytes per millisecond, so the bucket holds 25000 bytes */
+#define BITRATE 800000
+#define VIDEO_SIZE 10000
+#define AUDIO_SIZE 100
+#define NUM_PACKETS 5
+
+struct SentPacket {
+	enum obs_encoder_type type;
+	int64_t dts_usec;
+	uint64_t sent_ts;
+};
+
+static std::mutex sent_mutex;
+static std::vector<SentPacket> sent;
+
+static void send_packet(struct encoder_packet *packet, uint64_t send_start_ts)
+{
+	std::lock_guard<std::mutex> l(sent_mutex);
+	sent.push_back({packet->type, packet->dts_usec, send_start_ts});
+}
+
+/* packet data is refcounted like the data of real encoder packets */
+static bool push_packet(WHIPSendQueue &queue, enum obs_encoder_type type, size_t size, int64_t dts_usec)
+{
+	long *refs = (long *)bzalloc(sizeof(long) + size);
+	*refs = 1;
+
+	struct encoder_packet packet = {};
+	packet.data = (uint8_t *)(refs + 1);
+	packet.size = size;
+	packet.type = type;
+	packet.keyframe = type == OBS_ENCODER_VIDEO && dts_usec == 0;
+	packet.dts_usec = dts_usec;
+
+	const bool queued = queue.Push(&packet);
+	obs_encoder_packet_release(&packet);
+	return queued;
+}
+
+static size_t count_sent()
+{
+	std::lock_guard<std::mutex> l(sent_mutex);
+	return sent.size();
+}
+
+static void pacing_order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	WHIPSendQueue queue(send_packet);
+	sent.clear();
+
+	/* not started, so nothing is taken */
+	assert_false(push_packet(queue, OBS_ENCODER_AUDIO, AUDIO_SIZE, 0));
+
+	queue.Start(BITRATE);
+
+	const uint64_t start = os_gettime_ns();
+	for (int i = 0; i < NUM_PACKETS; i++)
+		assert_true(push_packet(queue, OBS_ENCODER_VIDEO, VIDEO_SIZE, i * 1000));
+	for (int i = 0; i < NUM_PACKETS; i++)
+		assert_true(push_packet(queue, OBS_ENCODER_AUDIO, AUDIO_SIZE, i * 1000));
+
+	for (int i = 0; i < 1000 && count_sent() < NUM_PACKETS * 2; i++)
+		os_sleep_ms(1);
+
+	WHIPSendStats stats = queue.GetStats();
+	queue.Stop();
+
+	assert_int_equal(sent.size(), NUM_PACKETS * 2);
+	assert_int_equal(stats.dropped_packets, 0);
+	assert_int_equal(stats.queue_depth, 0);
+
+	/* each track is sent in order */
+	int64_t next_dts[2] = {0, 0};
+	uint64_t last_audio_ts = 0;
+	uint64_t first_video_ts = 0;
+	uint64_t last_video_ts = 0;
+
+	for (const SentPacket &packet : sent) {
+		const size_t track = packet.type == OBS_ENCODER_VIDEO ? 1 : 0;
+
+		assert_int_equal(packet.dts_usec, next_dts[track]);
+		next_dts[track] += 1000;
+
+		if (packet.type == OBS_ENCODER_AUDIO) {
+			last_audio_ts = packet.sent_ts;
+		} else {
+			if (!first_video_ts)
+				first_video_ts = packet.sent_ts;
+			last_video_ts = packet.sent_ts;
+		}
+	}
+
+	/* the first two video packets fit into the bucket, the other three wait
+	 * 50, 100 and 100 ms for it to drain */
+	assert_true(last_video_ts - first_video_ts >= 200000000);
+	assert_true(stats.max_pacing_delay_ns > 0);
+
+	/* the wait in the queue includes the wait for the bucket */
+	assert_true(stats.max_queue_wait_ns >= stats.max_pacing_delay_ns);
+	assert_true(stats.avg_queue_wait_ns > 0);
+
+	/* audio isn't held back by the paced video queued before it */
+	assert_true(last_audio_ts < last_video_ts);
+	assert_true(last_audio_ts - start < 50000000);
+}
+
+static void drop_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	WHIPSendQueue queue(send_packet);
+	sent.clear();
+
+	/* a bitrate this low holds all but the first video packet back */
+	queue.Start(8000);
+
+	assert_true(push_packet(queue, OBS_ENCODER_VIDEO, 1000, 0));
+	assert_true(push_packet(queue, OBS_ENCODER_VIDEO, 1000, 1000000));
+	assert_true(push_packet(queue, OBS_ENCODER_VIDEO, 1000, 2000000));
+
+	/* more than two seconds queued drops the stale video, and video until
+	 * the next keyframe */
+	assert_true(push_packet(queue, OBS_ENCODER_AUDIO, AUDIO_SIZE, 3500000));
+	assert_false(push_packet(queue, OBS_ENCODER_VIDEO, 1000, 3500000));
+
+	for (int i = 0; i < 1000 && queue.GetStats().queue_depth > 0; i++)
+		os_sleep_ms(1);
+
+	WHIPSendStats stats = queue.GetStats();
+	queue.Stop();
+
+	assert_true(stats.dropped_packets >= 3);
+	assert_int_equal(stats.queue_depth, 0);
+	assert_int_equal(sent.back().type, OBS_ENCODER_AUDIO);
+	assert_int_equal(sent.back().dts_usec, 3500000);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(pacing_order_test),
+		cmocka_unit_test(drop_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,133 @@
+/*
+ *   Hotkey dispatch benchmark.  Binds a large number of frontend hotkeys to
+ * distinct key combinations and compares the cost of a press/release that
+ * platform code reports through obs_hotkey_update_key_state(), which only
+ * updates the bindings of that key, with obs_hotkey_inject_event(), which
+ * goes through all bindings.
+ *
+ * Usage: hotkey-bench [hotkeys, up to 1136]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+#define NUM_KEYS (35 + 10 + 26)
+#define MAX_HOTKEYS (NUM_KEYS * 16)
+
+static long presses;
+
+static void hotkey_func(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	if (pressed)
+		presses++;
+}
+
+/* F1-F35, 0-9 and A-Z, each with all 16 modifier combinations */
+static obs_key_combination_t combination(size_t idx)
+{
+	const size_t key = idx % NUM_KEYS;
+	obs_key_combination_t combo = {0};
+
+	if (key < 35)
+		combo.key = OBS_KEY_F1 + (obs_key_t)key;
+	else if (key < 45)
+		combo.key = OBS_KEY_0 + (obs_key_t)(key - 35);
+	else
+		combo.key = OBS_KEY_A + (obs_key_t)(key - 45);
+
+	const size_t mods = idx / NUM_KEYS;
+	if (mods & 1)
+		combo.modifiers |= INTERACT_SHIFT_KEY;
+	if (mods & 2)
+		combo.modifiers |= INTERACT_CONTROL_KEY;
+	if (mods & 4)
+		combo.modifiers |= INTERACT_ALT_KEY;
+	if (mods & 8)
+		combo.modifiers |= INTERACT_COMMAND_KEY;
+	return combo;
+}
+
+static void set_modifiers(uint32_t modifiers)
+{
+	obs_hotkey_update_key_state(OBS_KEY_SHIFT, (modifiers & INTERACT_SHIFT_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_CONTROL, (modifiers & INTERACT_CONTROL_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_ALT, (modifiers & INTERACT_ALT_KEY) != 0);
+	obs_hotkey_update_key_state(OBS_KEY_META, (modifiers & INTERACT_COMMAND_KEY) != 0);
+}
+
+static void quiet_log(int log_level, const char *format, va_list args, void *param)
+{
+	UNUSED_PARAMETER(log_level);
+	UNUSED_PARAMETER(format);
+	UNUSED_PARAMETER(args);
+	UNUSED_PARAMETER(param);
+}
+
+int main(int argc, char *argv[])
+{
+	static obs_hotkey_id ids[MAX_HOTKEYS];
+	size_t num_hotkeys = 1000;
+	char name[32];
+
+	if (argc > 1)
+		num_hotkeys = strtoul(argv[1], NULL, 10);
+	if (!num_hotkeys || num_hotkeys > MAX_HOTKEYS) {
+		printf("Usage: hotkey-bench [hotkeys, up to %d]\n", MAX_HOTKEYS);
+		return 1;
+	}
+
+	base_set_log_handler(quiet_log, NULL);
+
+	/* needs a display for hotkeys on some platforms */
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize libobs\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < num_hotkeys; i++) {
+		obs_key_combination_t combo = combination(i);
+
+		snprintf(name, sizeof(name), "hotkey %zu", i);
+		ids[i] = obs_hotkey_register_frontend(name, name, hotkey_func, NULL);
+		obs_hotkey_load_bindings(ids[i], &combo, 1);
+	}
+
+	uint64_t event_ns = 0;
+	for (size_t i = 0; i < num_hotkeys; i++) {
+		obs_key_combination_t combo = combination(i);
+		set_modifiers(combo.modifiers);
+
+		const uint64_t start = os_gettime_ns();
+		obs_hotkey_update_key_state(combo.key, true);
+		obs_hotkey_update_key_state(combo.key, false);
+		event_ns += os_gettime_ns() - start;
+	}
+	set_modifiers(0);
+
+	uint64_t inject_ns = 0;
+	for (size_t i = 0; i < num_hotkeys; i++) {
+		obs_key_combination_t combo = combination(i);
+
+		const uint64_t start = os_gettime_ns();
+		obs_hotkey_inject_event(combo, true);
+		obs_hotkey_inject_event(combo, false);
+		inject_ns += os_gettime_ns() - start;
+	}
+
+	printf("hotkeys: %zu bindings, %.2f us per key press/release, %.2f us with a full scan, %ld presses\n",
+	       num_hotkeys, (double)event_ns / num_hotkeys / 1000.0, (double)inject_ns / num_hotkeys / 1000.0,
+	       presses);
+
+	for (size_t i = 0; i < num_hotkeys; i++)
+		obs_hotkey_unregister(ids[i]);
+
+	obs_shutdown();
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ *   obs_data JSON benchmark.  Builds a synthetic scene collection, writes it
+ * with obs_data_get_json_pretty() and parses it back with
+ * obs_data_create_from_json(), and reports the throughput of both.
+ *
+ * Usage: obs-data-bench [sources]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs-data.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#define NUM_FILTERS 3
+
+/* synthetic scene collection, 32000 sources make roughly 50 MB */
+static obs_data_t *create_collection(int num_sources)
+{
+	obs_data_t *root = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+	char name[64];
+
+	obs_data_set_string(root, "name", "Benchmark");
+	obs_data_set_string(root, "current_scene", "Scene 0");
+
+	for (int i = 0; i < num_sources; i++) {
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+		obs_data_array_t *filters = obs_data_array_create();
+
+		snprintf(name, sizeof(name), "Source \"%d\" \xe2\x80\x94 caf\xc3\xa9", i);
+		obs_data_set_string(source, "name", name);
+		obs_data_set_string(source, "id", "ffmpeg_source");
+		obs_data_set_string(source, "uuid", "0d9a1c8e-6f2b-4bb0-9d6e-3c1f5a7e2b44");
+		obs_data_set_int(source, "mixers", 255);
+		obs_data_set_double(source, "volume", 0.7 + i * 1e-6);
+		obs_data_set_bool(source, "enabled", i % 3 != 0);
+
+		obs_data_set_string(settings, "local_file", "C:\\Users\\streamer\\Videos\\clip.mp4");
+		obs_data_set_string(settings, "text", "Line one\nLine two\twith tab");
+		obs_data_set_int(settings, "buffering_mb", 2);
+		obs_data_set_int(settings, "speed_percent", 100);
+		obs_data_set_double(settings, "opacity", 0.333);
+		obs_data_set_bool(settings, "looping", true);
+		obs_data_set_bool(settings, "hw_decode", false);
+		obs_data_set_obj(source, "settings", settings);
+
+		for (int j = 0; j < NUM_FILTERS; j++) {
+			obs_data_t *filter = obs_data_create();
+			obs_data_t *filter_settings = obs_data_create();
+
+			obs_data_set_string(filter, "id", "color_filter_v2");
+			obs_data_set_string(filter, "name", "Color Correction");
+			obs_data_set_double(filter_settings, "gamma", -0.12 * j);
+			obs_data_set_double(filter_settings, "contrast", 0.25);
+			obs_data_set_int(filter_settings, "color_multiply", 0xFFFFFFFFLL - j);
+			obs_data_set_obj(filter, "settings", filter_settings);
+			obs_data_array_push_back(filters, filter);
+
+			obs_data_release(filter_settings);
+			obs_data_release(filter);
+		}
+
+		obs_data_set_array(source, "filters", filters);
+		obs_data_array_push_back(sources, source);
+
+		obs_data_array_release(filters);
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_set_array(root, "sources", sources);
+	obs_data_array_release(sources);
+	return root;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = 32000;
+
+	if (argc > 1)
+		num_sources = atoi(argv[1]);
+	if (num_sources <= 0) {
+		printf("Usage: obs-data-bench [sources]\n");
+		return 1;
+	}
+
+	obs_data_t *data = create_collection(num_sources);
+
+	uint64_t start = os_gettime_ns();
+	const char *json = obs_data_get_json_pretty(data);
+	const uint64_t write_ns = os_gettime_ns() - start;
+
+	const size_t size = strlen(json);
+	char *copy = bstrdup(json);
+
+	start = os_gettime_ns();
+	obs_data_t *parsed = obs_data_create_from_json(copy);
+	const uint64_t read_ns = os_gettime_ns() - start;
+
+	if (!parsed || strcmp(obs_data_get_json_pretty(parsed), copy) != 0) {
+		fprintf(stderr, "Round trip of the collection failed\n");
+		return 1;
+	}
+
+	const double mb = (double)size / (1024.0 * 1024.0);
+	printf("obs_data json: %.1f MB, write %.1f ms (%.0f MB/s), read %.1f ms (%.0f MB/s)\n", mb,
+	       write_ns / 1000000.0, mb * 1000000000.0 / (double)write_ns, read_ns / 1000000.0,
+	       mb * 1000000000.0 / (double)read_ns);
+
+	bfree(copy);
+	obs_data_release(parsed);
+	obs_data_release(data);
+	return 0;
+}
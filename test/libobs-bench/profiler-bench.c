@@ -0,0 +1,90 @@
+/*
+ *   Profiler overhead benchmark.  Runs nested profile_start/profile_end pairs
+ * on several threads at once, which all merge into the same roots, and
+ * reports the cost of a pair per thread and the overall throughput.
+ *
+ * Usage: profiler-bench [threads] [pairs per thread]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+#define MAX_THREADS 256
+
+static const char *root_name = "profiler_bench_root";
+static const char *child_name = "profiler_bench_child";
+
+static size_t num_pairs = 100000;
+
+struct bench_thread {
+	pthread_t thread;
+	uint64_t elapsed_ns;
+};
+
+static void *bench_thread(void *data)
+{
+	struct bench_thread *bt = data;
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < num_pairs; i++) {
+		profile_start(root_name);
+		profile_start(child_name);
+		profile_end(child_name);
+		profile_end(root_name);
+	}
+
+	bt->elapsed_ns = os_gettime_ns() - start;
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	static struct bench_thread threads[MAX_THREADS];
+	size_t num_threads = 16;
+	uint64_t total_ns = 0;
+
+	if (argc > 1)
+		num_threads = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		num_pairs = strtoul(argv[2], NULL, 10);
+	if (!num_threads || num_threads > MAX_THREADS || !num_pairs) {
+		printf("Usage: profiler-bench [threads, 1-%d] [pairs per thread]\n", MAX_THREADS);
+		return 1;
+	}
+
+	profiler_start();
+	const uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]) != 0) {
+			fprintf(stderr, "Failed to create thread %zu\n", i);
+			return 1;
+		}
+	}
+
+	for (size_t i = 0; i < num_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		total_ns += threads[i].elapsed_ns;
+	}
+
+	const uint64_t elapsed_ns = os_gettime_ns() - start;
+
+	/* folds the per-thread tables */
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	const uint64_t fold_ns = os_gettime_ns() - start - elapsed_ns;
+	profile_snapshot_free(snap);
+
+	profiler_stop();
+	profiler_free();
+
+	/* each iteration is two start/end pairs, one root and one nested */
+	const double pairs = (double)num_threads * (double)num_pairs * 2.0;
+	printf("profiler: %zu threads, %.1f ns per pair per thread, %.0f pairs/s overall, snapshot %.2f ms\n",
+	       num_threads, (double)total_ns / pairs, pairs * 1000000000.0 / (double)elapsed_ns,
+	       (double)fold_ns / 1000000.0);
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ *   RNNoise benchmark.  Runs the layers of the noise suppression model with
+ * the scalar and the vectorized kernels, and denoises whole 10 ms frames,
+ * reporting the time per model evaluation and per frame.
+ *
+ * Usage: rnnoise-bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/c99defs.h>
+#include <util/platform.h>
+
+#include "rnn_data.h"
+
+extern const struct RNNModel rnnoise_model_orig;
+
+typedef void (*dense_func)(const DenseLayer *layer, float *output, const float *input);
+typedef void (*gru_func)(const GRULayer *gru, float *state, const float *input);
+
+static float input[MAX_NEURONS * 3];
+
+static void randomize(float *data, int count)
+{
+	for (int i = 0; i < count; i++)
+		data[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+/* returns the time per model evaluation in microseconds */
+static double run_model(dense_func dense, gru_func gru, int num_frames)
+{
+	const struct RNNModel *model = &rnnoise_model_orig;
+	float out[MAX_NEURONS];
+	float vad_state[MAX_NEURONS] = {0};
+	float noise_state[MAX_NEURONS] = {0};
+	float denoise_state[MAX_NEURONS] = {0};
+
+	const uint64_t start = os_gettime_ns();
+	for (int i = 0; i < num_frames; i++) {
+		dense(model->input_dense, out, input);
+		gru(model->vad_gru, vad_state, input);
+		gru(model->noise_gru, noise_state, input);
+		gru(model->denoise_gru, denoise_state, input);
+		dense(model->denoise_output, out, denoise_state);
+		dense(model->vad_output, out, vad_state);
+	}
+
+	return (double)(os_gettime_ns() - start) / num_frames / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	float frame[480];
+	int num_frames = 2000;
+
+	if (argc > 1)
+		num_frames = atoi(argv[1]);
+	if (num_frames <= 0) {
+		printf("Usage: rnnoise-bench [frames]\n");
+		return 1;
+	}
+
+	DenoiseState *st = rnnoise_create(NULL);
+	if (!st) {
+		fprintf(stderr, "Failed to create the denoiser\n");
+		return 1;
+	}
+
+	srand(3);
+	randomize(input, MAX_NEURONS * 3);
+
+	const double scalar_us = run_model(compute_dense_c, compute_gru_c, num_frames);
+	const double simd_us = run_model(compute_dense, compute_gru, num_frames);
+
+	uint64_t frame_ns = 0;
+	for (int i = 0; i < num_frames; i++) {
+		randomize(frame, 480);
+		for (int j = 0; j < 480; j++)
+			frame[j] *= 8000.0f;
+
+		const uint64_t start = os_gettime_ns();
+		rnnoise_process_frame(st, frame, frame);
+		frame_ns += os_gettime_ns() - start;
+	}
+
+	printf("rnnoise: model %.1f us scalar, %.1f us vectorized, %.1f us per 10 ms frame\n", scalar_us, simd_us,
+	       (double)frame_ns / num_frames / 1000.0);
+
+	rnnoise_destroy(st);
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ *   Source tick benchmark.  Creates a large number of private sources, of
+ * which only a few are shown, and measures how long obs_tick_sources() takes
+ * per frame for sources without a video_tick, for sources that are ticked
+ * every frame, and for sources that are only ticked while they are shown
+ * (OBS_SOURCE_TICK_WHILE_SHOWING), like image and text sources.
+ *
+ * Usage: tick-bench [sources] [shown sources] [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+/* internal, declared in obs-internal.h */
+EXPORT void obs_tick_sources(float seconds);
+
+static const char *bench_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Tick benchmark source";
+}
+
+static void *bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return bzalloc(sizeof(uint64_t));
+}
+
+static void bench_destroy(void *data)
+{
+	bfree(data);
+}
+
+/* a little work per tick, about what an image or text source does */
+static void bench_video_tick(void *data, float seconds)
+{
+	uint64_t *state = data;
+
+	for (int i = 0; i < 64; i++)
+		*state = *state * 6364136223846793005ULL + (uint64_t)(seconds * 1000.0f) + 1;
+}
+
+static struct obs_source_info idle_source = {
+	.id = "tick_bench_idle",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+};
+
+static struct obs_source_info ticking_source = {
+	.id = "tick_bench_ticking",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+	.video_tick = bench_video_tick,
+};
+
+static struct obs_source_info shown_ticking_source = {
+	.id = "tick_bench_shown_ticking",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_TICK_WHILE_SHOWING,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+	.video_tick = bench_video_tick,
+};
+
+/* returns the time per frame in microseconds */
+static double bench_ticks(const char *id, int num_sources, int num_shown, int num_frames)
+{
+	obs_source_t **sources = bmalloc(sizeof(obs_source_t *) * num_sources);
+	char name[32];
+
+	for (int i = 0; i < num_sources; i++) {
+		snprintf(name, sizeof(name), "source %d", i);
+		sources[i] = obs_source_create_private(id, name, NULL);
+	}
+	for (int i = 0; i < num_shown; i++)
+		obs_source_inc_showing(sources[i]);
+
+	/* the first tick drops the sources that don't need ticking */
+	obs_tick_sources(1.0f / 60.0f);
+
+	const uint64_t start = os_gettime_ns();
+	for (int i = 0; i < num_frames; i++)
+		obs_tick_sources(1.0f / 60.0f);
+	const uint64_t elapsed = os_gettime_ns() - start;
+
+	for (int i = 0; i < num_shown; i++)
+		obs_source_dec_showing(sources[i]);
+	for (int i = 0; i < num_sources; i++)
+		obs_source_release(sources[i]);
+	bfree(sources);
+
+	return (double)elapsed / num_frames / 1000.0;
+}
+
+static void quiet_log(int log_level, const char *format, va_list args, void *param)
+{
+	UNUSED_PARAMETER(log_level);
+	UNUSED_PARAMETER(format);
+	UNUSED_PARAMETER(args);
+	UNUSED_PARAMETER(param);
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = 10000;
+	int num_shown = 100;
+	int num_frames = 1000;
+
+	if (argc > 1)
+		num_sources = atoi(argv[1]);
+	if (argc > 2)
+		num_shown = atoi(argv[2]);
+	if (argc > 3)
+		num_frames = atoi(argv[3]);
+	if (num_sources <= 0 || num_shown < 0 || num_shown > num_sources || num_frames <= 0) {
+		printf("Usage: tick-bench [sources] [shown sources] [frames]\n");
+		return 1;
+	}
+
+	base_set_log_handler(quiet_log, NULL);
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize libobs\n");
+		return 1;
+	}
+
+	obs_register_source(&idle_source);
+	obs_register_source(&ticking_source);
+	obs_register_source(&shown_ticking_source);
+
+	const double idle_us = bench_ticks(idle_source.id, num_sources, num_shown, num_frames);
+	const double ticking_us = bench_ticks(ticking_source.id, num_sources, num_shown, num_frames);
+	const double shown_us = bench_ticks(shown_ticking_source.id, num_sources, num_shown, num_frames);
+
+	printf("source tick: %d sources, %d shown, per frame: %.1f us without video_tick, "
+	       "%.1f us ticked every frame, %.1f us ticked while showing\n",
+	       num_sources, num_shown, idle_us, ticking_us, shown_us);
+
+	obs_shutdown();
+	return 0;
+}
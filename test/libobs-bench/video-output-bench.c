@@ -0,0 +1,117 @@
+/*
+ *   Video output frame cache benchmark.  Locks and unlocks frames of a small
+ * video output as fast as possible, against a consumer that stalls now and
+ * then so that the cache fills up, and reports the cost of a locked frame
+ * and how many frames had to be repeated, for several cache sizes.
+ *
+ * Usage: video-output-bench [locks per cache size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <media-io/video-frame.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+static volatile long outputs;
+
+static void raw_video(void *param, struct video_data *frame)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(frame);
+
+	/* stall now and then so that the cache fills up */
+	if (os_atomic_inc_long(&outputs) % 4096 == 0)
+		os_sleep_ms(2);
+}
+
+static void bench_cache(size_t cache_size, int num_locks)
+{
+	struct video_output_info info = {
+		.name = "bench",
+		.format = VIDEO_FORMAT_RGBA,
+		.fps_num = 60,
+		.fps_den = 1,
+		.width = 16,
+		.height = 16,
+		.cache_size = cache_size,
+	};
+	video_t *video;
+
+	if (video_output_open(&video, &info) != VIDEO_OUTPUT_SUCCESS) {
+		fprintf(stderr, "Failed to open video output\n");
+		return;
+	}
+
+	const uint64_t frame_time = video_output_get_frame_time(video);
+	os_atomic_set_long(&outputs, 0);
+	video_output_connect(video, NULL, raw_video, NULL);
+
+	uint32_t rand = 1;
+	long frames = 0;
+	long dropped = 0;
+
+	const uint64_t start = os_gettime_ns();
+	for (int i = 0; i < num_locks; i++) {
+		struct video_frame frame;
+
+		rand = rand * 1103515245 + 12345;
+		const int count = 1 + (int)((rand >> 16) % 3);
+
+		if (video_output_lock_frame(video, &frame, count, (uint64_t)frames * frame_time)) {
+			frame.data[0][0] = (uint8_t)i;
+			video_output_unlock_frame(video);
+		} else {
+			dropped += count;
+		}
+
+		frames += count;
+	}
+	const uint64_t elapsed = os_gettime_ns() - start;
+
+	for (int i = 0; i < 10000 && os_atomic_load_long(&outputs) < frames; i++)
+		os_sleep_ms(1);
+
+	printf("video output cache %zu: %.0f ns per locked frame, %ld of %ld frames repeated\n", cache_size,
+	       (double)elapsed / num_locks, dropped, frames);
+
+	video_output_disconnect(video, raw_video, NULL);
+	video_output_close(video);
+}
+
+static void quiet_log(int log_level, const char *format, va_list args, void *param)
+{
+	UNUSED_PARAMETER(log_level);
+	UNUSED_PARAMETER(format);
+	UNUSED_PARAMETER(args);
+	UNUSED_PARAMETER(param);
+}
+
+int main(int argc, char *argv[])
+{
+	int num_locks = 100000;
+
+	if (argc > 1)
+		num_locks = atoi(argv[1]);
+	if (num_locks <= 0) {
+		printf("Usage: video-output-bench [locks per cache size]\n");
+		return 1;
+	}
+
+	base_set_log_handler(quiet_log, NULL);
+
+	/* the video thread registers its profiler name with libobs */
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize libobs\n");
+		return 1;
+	}
+
+	bench_cache(1, num_locks);
+	bench_cache(6, num_locks);
+	bench_cache(64, num_locks);
+
+	obs_shutdown();
+	return 0;
+}
@@ -0,0 +1,1110 @@
+/*
+ *   Throughput benchmark for the FLV and MP4 muxers of obs-outputs and the
+ * obs-ffmpeg-mux child process.  Synthetic encoder packets are generated up
+ * front and fed through each muxer into an array serializer and a null file,
+ * so only the muxing itself is measured.  No graphics or encoders are needed,
+ * the benchmark registers stand-in encoders that only provide headers.
+ *
+ * Usage: mux-bench [--video h264|hevc|av1] [--audio aac|opus]
+ *                  [--video-bitrate kbps] [--audio-bitrate kbps]
+ *                  [--audio-tracks n] [--fps n] [--duration seconds]
+ *                  [--muxers flv,mp4,ffmpeg] [--ffmpeg-mux path]
+ *                  [--ffmpeg-output path.mkv] [--verbose]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <obs-avc.h>
+#ifdef ENABLE_HEVC
+#include <obs-hevc.h>
+#endif
+#include <util/array-serializer.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/file-serializer.h>
+#include <util/pipe.h>
+#include <util/platform.h>
+
+#include "flv-mux.h"
+#include "mp4-mux.h"
+#include "rtmp-av1.h"
+#ifdef ENABLE_HEVC
+#include "rtmp-hevc.h"
+#endif
+#include "ffmpeg-mux.h"
+
+#ifdef _WIN32
+#define NULL_FILE "NUL"
+#define FFMPEG_MUX "obs-ffmpeg-mux.exe"
+#else
+#define NULL_FILE "/dev/null"
+#define FFMPEG_MUX "obs-ffmpeg-mux"
+#endif
+
+#define SAMPLE_RATE 48000
+#define WIDTH 1920
+#define HEIGHT 1080
+
+/* ------------------------------------------------------------------------- */
+/* Allocation counting                                                       */
+
+/* Only allocations made by the benchmark thread are counted, the muxers run
+ * synchronously on it while libobs threads keep running in the background.
+ * bmalloc is a thin wrapper around malloc on Linux, so interposing the glibc
+ * allocator catches libobs and FFmpeg allocations alike. */
+#ifdef __GLIBC__
+#define COUNTS_ALLOCS true
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static __thread long thread_allocs;
+
+void *malloc(size_t size)
+{
+	thread_allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+	thread_allocs++;
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	thread_allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+static inline long get_allocs(void)
+{
+	return thread_allocs;
+}
+#else
+#define COUNTS_ALLOCS false
+
+static inline long get_allocs(void)
+{
+	return 0;
+}
+#endif
+
+/* mp4-mux.c is built into the benchmark instead of being loaded as part of
+ * the obs-outputs module */
+const char *obs_module_text(const char *lookup)
+{
+	return lookup;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Options                                                                   */
+
+struct options {
+	const char *video_codec;
+	const char *audio_codec;
+	int video_bitrate;
+	int audio_bitrate;
+	int audio_tracks;
+	int fps;
+	int duration;
+	const char *muxers;
+	const char *ffmpeg_mux;
+	const char *ffmpeg_output;
+	bool verbose;
+};
+
+static void usage(void)
+{
+	printf("Usage: mux-bench [options]\n"
+	       "  --video h264|hevc|av1      video codec (h264)\n"
+	       "  --audio aac|opus           audio codec (aac)\n"
+	       "  --video-bitrate kbps       video bitrate (6000)\n"
+	       "  --audio-bitrate kbps       bitrate per audio track (160)\n"
+	       "  --audio-tracks n           number of audio tracks, 0-%d (1)\n"
+	       "  --fps n                    video frame rate (60)\n"
+	       "  --duration seconds         length of the synthetic stream (60)\n"
+	       "  --muxers list              comma separated flv,mp4,ffmpeg (flv,mp4,ffmpeg)\n"
+	       "  --ffmpeg-mux path          obs-ffmpeg-mux executable\n"
+	       "  --ffmpeg-output path       file written by obs-ffmpeg-mux (mux-bench.mkv)\n"
+	       "  --verbose                  show libobs log messages\n",
+	       MAX_OUTPUT_AUDIO_ENCODERS);
+}
+
+static bool parse_options(struct options *opts, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			opts->verbose = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--video") == 0)
+			opts->video_codec = val;
+		else if (strcmp(arg, "--audio") == 0)
+			opts->audio_codec = val;
+		else if (strcmp(arg, "--video-bitrate") == 0)
+			opts->video_bitrate = atoi(val);
+		else if (strcmp(arg, "--audio-bitrate") == 0)
+			opts->audio_bitrate = atoi(val);
+		else if (strcmp(arg, "--audio-tracks") == 0)
+			opts->audio_tracks = atoi(val);
+		else if (strcmp(arg, "--fps") == 0)
+			opts->fps = atoi(val);
+		else if (strcmp(arg, "--duration") == 0)
+			opts->duration = atoi(val);
+		else if (strcmp(arg, "--muxers") == 0)
+			opts->muxers = val;
+		else if (strcmp(arg, "--ffmpeg-mux") == 0)
+			opts->ffmpeg_mux = val;
+		else if (strcmp(arg, "--ffmpeg-output") == 0)
+			opts->ffmpeg_output = val;
+		else
+			return false;
+		i++;
+	}
+
+	if (strcmp(opts->video_codec, "h264") != 0 && strcmp(opts->video_codec, "hevc") != 0 &&
+	    strcmp(opts->video_codec, "av1") != 0)
+		return false;
+	if (strcmp(opts->audio_codec, "aac") != 0 && strcmp(opts->audio_codec, "opus") != 0)
+		return false;
+
+	return opts->video_bitrate > 0 && opts->audio_bitrate > 0 && opts->audio_tracks >= 0 &&
+	       opts->audio_tracks <= MAX_OUTPUT_AUDIO_ENCODERS && opts->fps > 0 && opts->duration > 0;
+}
+
+static bool muxer_enabled(const struct options *opts, const char *name)
+{
+	const size_t len = strlen(name);
+
+	for (const char *p = opts->muxers; (p = strstr(p, name)) != NULL; p += len) {
+		if ((p == opts->muxers || p[-1] == ',') && (p[len] == ',' || p[len] == 0))
+			return true;
+	}
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Stand-in encoders                                                         */
+
+/* Headers taken from 1080p x264, x265 and libaom output */
+static const uint8_t h264_header[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x2a, 0xda, 0x01, 0xe0, 0x08,
+				      0x9f, 0x97, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x07,
+				      0x80, 0xf1, 0x83, 0x2a, 0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x0f, 0xc8};
+
+static const uint8_t hevc_header[] = {
+	0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+	0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x7b, 0x95, 0x94, 0x09, 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+	0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x7b, 0xa0, 0x03, 0xc0, 0x80,
+	0x11, 0x07, 0xcb, 0x96, 0x56, 0x54, 0xa4, 0xc2, 0xf0, 0x16, 0x80, 0x80, 0x00, 0x00, 0x03, 0x00, 0x80, 0x00,
+	0x00, 0x1e, 0x04, 0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x73, 0xc1, 0x89};
+
+static const uint8_t av1_header[] = {0x0a, 0x0b, 0x00, 0x00, 0x00, 0x4a, 0xab, 0xbf, 0xc3, 0x77, 0x2b, 0xe4, 0x01};
+
+/* AAC-LC, 48 kHz, stereo */
+static const uint8_t aac_header[] = {0x11, 0x90};
+
+/* OpusHead, stereo, 312 samples of pre-skip, 48 kHz */
+static const uint8_t opus_header[] = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x02,
+				      0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+struct bench_encoder {
+	const uint8_t *header;
+	size_t header_size;
+	uint32_t frame_size;
+};
+
+static const char *bench_encoder_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Benchmark encoder";
+}
+
+static void *bench_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct bench_encoder *enc = bzalloc(sizeof(struct bench_encoder));
+	const char *codec = obs_encoder_get_codec(encoder);
+
+	if (strcmp(codec, "h264") == 0) {
+		enc->header = h264_header;
+		enc->header_size = sizeof(h264_header);
+	} else if (strcmp(codec, "hevc") == 0) {
+		enc->header = hevc_header;
+		enc->header_size = sizeof(hevc_header);
+	} else if (strcmp(codec, "av1") == 0) {
+		enc->header = av1_header;
+		enc->header_size = sizeof(av1_header);
+	} else if (strcmp(codec, "aac") == 0) {
+		enc->header = aac_header;
+		enc->header_size = sizeof(aac_header);
+		enc->frame_size = 1024;
+	} else {
+		enc->header = opus_header;
+		enc->header_size = sizeof(opus_header);
+		enc->frame_size = 960;
+	}
+
+	UNUSED_PARAMETER(settings);
+	return enc;
+}
+
+static void bench_encoder_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool bench_encoder_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+				 bool *received_packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+	UNUSED_PARAMETER(packet);
+	*received_packet = false;
+	return false;
+}
+
+static bool bench_encoder_extra_data(void *data, uint8_t **extra_data, size_t *size)
+{
+	struct bench_encoder *enc = data;
+
+	*extra_data = (uint8_t *)enc->header;
+	*size = enc->header_size;
+	return true;
+}
+
+static size_t bench_encoder_frame_size(void *data)
+{
+	struct bench_encoder *enc = data;
+	return enc->frame_size;
+}
+
+static void register_encoder(const char *id, const char *codec, enum obs_encoder_type type)
+{
+	struct obs_encoder_info info = {
+		.id = id,
+		.type = type,
+		.codec = codec,
+		.get_name = bench_encoder_name,
+		.create = bench_encoder_create,
+		.destroy = bench_encoder_destroy,
+		.encode = bench_encoder_encode,
+		.get_extra_data = bench_encoder_extra_data,
+		.get_frame_size = type == OBS_ENCODER_AUDIO ? bench_encoder_frame_size : NULL,
+	};
+
+	obs_register_encoder(&info);
+}
+
+/* The muxers only read the encoders and settings of the output, it is never
+ * started */
+static const char *bench_output_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Benchmark output";
+}
+
+static void *bench_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void bench_output_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool bench_output_start(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return false;
+}
+
+static void bench_output_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static void bench_output_packet(void *data, struct encoder_packet *packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(packet);
+}
+
+static struct obs_output_info bench_output_info = {
+	.id = "mux_bench_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK_AV,
+	.encoded_video_codecs = "h264;hevc;av1",
+	.encoded_audio_codecs = "aac;opus",
+	.get_name = bench_output_name,
+	.create = bench_output_create,
+	.destroy = bench_output_destroy,
+	.start = bench_output_start,
+	.stop = bench_output_stop,
+	.encoded_packet = bench_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* Synthetic encoder output                                                  */
+
+struct bench {
+	struct options opts;
+
+	video_t *video;
+	obs_output_t *output;
+	obs_encoder_t *video_encoder;
+	obs_encoder_t *audio_encoders[MAX_OUTPUT_AUDIO_ENCODERS];
+
+	/* Packets reference the arena, each one preceded by the reference
+	 * count libobs keeps in front of packet data.  The benchmark holds
+	 * one reference so the muxers never free them. */
+	uint8_t *arena;
+	DARRAY(struct encoder_packet) packets;
+	uint64_t packet_bytes;
+};
+
+struct bench_result {
+	size_t packets;
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t mux_ns;
+	uint64_t finalise_ns;
+	long allocs;
+	bool counted_allocs;
+};
+
+static uint32_t rng = 1;
+
+static inline uint32_t next_random(void)
+{
+	rng = rng * 1664525 + 1013904223;
+	return rng >> 8;
+}
+
+/* Varies size by up to a quarter either way */
+static inline size_t vary(size_t size)
+{
+	const size_t range = size / 2 + 1;
+	return size - size / 4 + next_random() % range;
+}
+
+static inline size_t align_ref(size_t offset)
+{
+	return (offset + sizeof(long) - 1) & ~(sizeof(long) - 1);
+}
+
+static size_t video_prefix_size(const char *codec, size_t size)
+{
+	if (strcmp(codec, "av1") == 0) {
+		size_t leb128 = 1;
+		while (size >> (7 * leb128))
+			leb128++;
+		/* temporal delimiter, frame OBU header and size */
+		return 2 + 1 + leb128;
+	}
+	return strcmp(codec, "hevc") == 0 ? 6 : 5;
+}
+
+static size_t write_video_prefix(uint8_t *dst, const char *codec, size_t size, bool keyframe)
+{
+	uint8_t *p = dst;
+
+	if (strcmp(codec, "av1") == 0) {
+		*(p++) = 2 << 3 | 0x02;
+		*(p++) = 0;
+		*(p++) = 6 << 3 | 0x02;
+		do {
+			*p = size & 0x7f;
+			size >>= 7;
+			*(p++) |= size ? 0x80 : 0;
+		} while (size);
+		return p - dst;
+	}
+
+	*(p++) = 0;
+	*(p++) = 0;
+	*(p++) = 0;
+	*(p++) = 1;
+	if (strcmp(codec, "hevc") == 0) {
+		/* IDR_W_RADL or TRAIL_R */
+		*(p++) = keyframe ? 0x26 : 0x02;
+		*(p++) = 0x01;
+	} else {
+		/* IDR or non-IDR slice */
+		*(p++) = keyframe ? 0x65 : 0x41;
+	}
+	return p - dst;
+}
+
+static int compare_packets(const void *a, const void *b)
+{
+	const struct encoder_packet *pa = a;
+	const struct encoder_packet *pb = b;
+
+	if (pa->dts_usec != pb->dts_usec)
+		return pa->dts_usec < pb->dts_usec ? -1 : 1;
+	if (pa->type != pb->type)
+		return pa->type == OBS_ENCODER_VIDEO ? -1 : 1;
+	return pa->track_idx < pb->track_idx ? -1 : pa->track_idx > pb->track_idx;
+}
+
+static void generate_packets(struct bench *b)
+{
+	const struct options *opts = &b->opts;
+	const char *codec = opts->video_codec;
+	const size_t frames = (size_t)opts->fps * opts->duration;
+	const size_t gop = (size_t)opts->fps * 2;
+	const size_t samples = strcmp(opts->audio_codec, "aac") == 0 ? 1024 : 960;
+	const size_t audio_frames = (size_t)opts->duration * SAMPLE_RATE / samples;
+
+	const size_t avg_size = (size_t)opts->video_bitrate * 1000 / 8 / opts->fps;
+	const size_t key_size = avg_size * 4;
+	const size_t delta_size = gop > 1 ? (avg_size * gop - key_size) / (gop - 1) : avg_size;
+	const size_t audio_size = (size_t)opts->audio_bitrate * 1000 / 8 * samples / SAMPLE_RATE;
+
+	/* Sizes and timestamps first, the arena is sized after */
+	for (size_t i = 0; i < frames; i++) {
+		struct encoder_packet *pkt = da_push_back_new(b->packets);
+		size_t size = i % gop == 0 ? key_size : vary(delta_size);
+
+		pkt->type = OBS_ENCODER_VIDEO;
+		pkt->encoder = b->video_encoder;
+		pkt->keyframe = i % gop == 0;
+		pkt->timebase_num = 1;
+		pkt->timebase_den = opts->fps;
+		/* one frame of reordering delay */
+		pkt->pts = (int64_t)i;
+		pkt->dts = (int64_t)i - 1;
+		pkt->dts_usec = pkt->dts * 1000000 / opts->fps;
+		pkt->sys_dts_usec = pkt->dts_usec;
+		/* payload only, the NAL or OBU headers are added below */
+		pkt->size = size;
+	}
+
+	for (int track = 0; track < opts->audio_tracks; track++) {
+		for (size_t i = 0; i < audio_frames; i++) {
+			struct encoder_packet *pkt = da_push_back_new(b->packets);
+
+			pkt->type = OBS_ENCODER_AUDIO;
+			pkt->encoder = b->audio_encoders[track];
+			pkt->track_idx = track;
+			pkt->keyframe = true;
+			pkt->timebase_num = 1;
+			pkt->timebase_den = SAMPLE_RATE;
+			pkt->pts = pkt->dts = (int64_t)(i * samples);
+			pkt->dts_usec = pkt->dts * 1000000 / SAMPLE_RATE;
+			pkt->sys_dts_usec = pkt->dts_usec;
+			pkt->size = vary(audio_size) + 1;
+		}
+	}
+
+	qsort(b->packets.array, b->packets.num, sizeof(struct encoder_packet), compare_packets);
+
+	size_t arena_size = 0;
+	size_t max_size = 0;
+	for (size_t i = 0; i < b->packets.num; i++) {
+		const struct encoder_packet *pkt = &b->packets.array[i];
+		size_t size = pkt->size;
+
+		if (pkt->type == OBS_ENCODER_VIDEO)
+			size += video_prefix_size(codec, pkt->size);
+
+		arena_size = align_ref(arena_size) + sizeof(long) + size;
+		if (pkt->size > max_size)
+			max_size = pkt->size;
+	}
+
+	/* Payloads are copied from a random pool without zero bytes, so there
+	 * are no start codes to trip up NAL parsing */
+	uint8_t *pool = bmalloc(max_size);
+	for (size_t i = 0; i < max_size; i++)
+		pool[i] = (uint8_t)(next_random() % 255 + 1);
+
+	b->arena = bmalloc(arena_size);
+
+	size_t offset = 0;
+	for (size_t i = 0; i < b->packets.num; i++) {
+		struct encoder_packet *pkt = &b->packets.array[i];
+		size_t prefix = 0;
+		long refs = 1;
+
+		offset = align_ref(offset);
+		memcpy(b->arena + offset, &refs, sizeof(refs));
+		offset += sizeof(long);
+
+		pkt->data = b->arena + offset;
+		if (pkt->type == OBS_ENCODER_VIDEO)
+			prefix = write_video_prefix(pkt->data, codec, pkt->size, pkt->keyframe);
+		memcpy(pkt->data + prefix, pool, pkt->size);
+		pkt->size += prefix;
+
+		offset += pkt->size;
+		b->packet_bytes += pkt->size;
+	}
+
+	bfree(pool);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Sinks                                                                     */
+
+enum sink_type {
+	SINK_ARRAY,
+	SINK_NULL_FILE,
+};
+
+struct sink {
+	enum sink_type type;
+	struct serializer s;
+	struct array_output_data data;
+
+	/* Writes to the null device go through the file serializer, but the
+	 * muxers need real positions to fill in box sizes */
+	struct serializer file;
+	int64_t pos;
+	int64_t size;
+};
+
+static const char *sink_name(enum sink_type type)
+{
+	return type == SINK_ARRAY ? "array" : "null file";
+}
+
+static size_t null_file_write(void *param, const void *data, size_t size)
+{
+	struct sink *sink = param;
+	size_t written = s_write(&sink->file, data, size);
+
+	sink->pos += (int64_t)written;
+	if (sink->pos > sink->size)
+		sink->size = sink->pos;
+	return written;
+}
+
+static int64_t null_file_seek(void *param, int64_t offset, enum serialize_seek_type seek_type)
+{
+	struct sink *sink = param;
+	int64_t pos = offset;
+
+	if (seek_type == SERIALIZE_SEEK_CURRENT)
+		pos += sink->pos;
+	else if (seek_type == SERIALIZE_SEEK_END)
+		pos += sink->size;
+
+	if (pos < 0 || serializer_seek(&sink->file, pos, SERIALIZE_SEEK_START) < 0)
+		return -1;
+
+	sink->pos = pos;
+	return pos;
+}
+
+static int64_t null_file_get_pos(void *param)
+{
+	struct sink *sink = param;
+	return sink->pos;
+}
+
+static bool sink_open(struct sink *sink, enum sink_type type)
+{
+	sink->type = type;
+
+	if (type == SINK_ARRAY) {
+		array_output_serializer_init(&sink->s, &sink->data);
+		return true;
+	}
+
+	if (!file_output_serializer_init(&sink->file, NULL_FILE))
+		return false;
+
+	sink->s.data = sink;
+	sink->s.write = null_file_write;
+	sink->s.seek = null_file_seek;
+	sink->s.get_pos = null_file_get_pos;
+	return true;
+}
+
+static uint64_t sink_close(struct sink *sink)
+{
+	if (sink->type == SINK_ARRAY) {
+		uint64_t size = sink->data.bytes.num;
+		array_output_serializer_free(&sink->data);
+		return size;
+	}
+
+	file_output_serializer_free(&sink->file);
+	return (uint64_t)sink->size;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Muxers                                                                    */
+
+static inline bool flv_has_audio(const struct bench *b)
+{
+	return to_audio_type(b->opts.audio_codec) != AUDIO_CODEC_NONE;
+}
+
+static void flv_write(struct serializer *s, uint8_t *data, size_t size)
+{
+	s_write(s, data, size);
+	bfree(data);
+}
+
+/* Same header and packet sequence as flv_output, with video on one track */
+static void flv_write_headers(struct bench *b, struct serializer *s, enum video_id_t codec)
+{
+	struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1, .keyframe = true};
+	uint8_t *header;
+	size_t header_size;
+	uint8_t *data;
+	size_t size;
+
+	flv_meta_data(b->output, &data, &size, true);
+	flv_write(s, data, size);
+
+	if (flv_has_audio(b) && b->opts.audio_tracks) {
+		struct encoder_packet audio = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1};
+		obs_encoder_get_extra_data(b->audio_encoders[0], &audio.data, &audio.size);
+		flv_packet_mux(&audio, 0, &data, &size, true);
+		flv_write(s, data, size);
+	}
+
+	obs_encoder_get_extra_data(b->video_encoder, &header, &header_size);
+
+	if (codec == CODEC_H264) {
+		packet.size = obs_parse_avc_header(&packet.data, header, header_size);
+		flv_packet_mux(&packet, 0, &data, &size, true);
+	} else {
+#ifdef ENABLE_HEVC
+		if (codec == CODEC_HEVC)
+			packet.size = obs_parse_hevc_header(&packet.data, header, header_size);
+		else
+#endif
+			packet.size = obs_parse_av1_header(&packet.data, header, header_size);
+		flv_packet_start(&packet, codec, &data, &size, 0);
+	}
+	flv_write(s, data, size);
+	bfree(packet.data);
+
+	for (int i = 1; flv_has_audio(b) && i < b->opts.audio_tracks; i++) {
+		struct encoder_packet audio = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1};
+		obs_encoder_get_extra_data(b->audio_encoders[i], &audio.data, &audio.size);
+		flv_packet_audio_start(&audio, AUDIO_CODEC_AAC, &data, &size, i);
+		flv_write(s, data, size);
+	}
+}
+
+static bool run_flv(struct bench *b, struct serializer *s, struct bench_result *r)
+{
+	const enum video_id_t codec = to_video_type(b->opts.video_codec);
+	struct encoder_packet parsed;
+	int32_t dts_offset = 0;
+	uint8_t *data;
+	size_t size;
+
+	if (codec == CODEC_NONE)
+		return false;
+
+	flv_write_headers(b, s, codec);
+
+	const long allocs = get_allocs();
+	const uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < b->packets.num; i++) {
+		struct encoder_packet *pkt = &b->packets.array[i];
+
+		if (pkt->type == OBS_ENCODER_AUDIO && !flv_has_audio(b))
+			continue;
+		if (!r->packets)
+			dts_offset = get_ms_time(pkt, pkt->dts);
+
+		if (pkt->type == OBS_ENCODER_VIDEO) {
+			if (codec == CODEC_H264)
+				obs_parse_avc_packet(&parsed, pkt);
+#ifdef ENABLE_HEVC
+			else if (codec == CODEC_HEVC)
+				obs_parse_hevc_packet(&parsed, pkt);
+#endif
+			else
+				obs_parse_av1_packet(&parsed, pkt);
+
+			if (codec == CODEC_H264)
+				flv_packet_mux(&parsed, dts_offset, &data, &size, false);
+			else
+				flv_packet_frames(&parsed, codec, dts_offset, &data, &size, 0);
+			obs_encoder_packet_release(&parsed);
+		} else if (pkt->track_idx == 0) {
+			flv_packet_mux(pkt, dts_offset, &data, &size, false);
+		} else {
+			flv_packet_audio_frames(pkt, AUDIO_CODEC_AAC, dts_offset, &data, &size, pkt->track_idx);
+		}
+
+		flv_write(s, data, size);
+		r->packets++;
+		r->bytes_in += pkt->size;
+	}
+
+	r->mux_ns = os_gettime_ns() - start;
+	r->allocs = get_allocs() - allocs;
+
+	if (codec != CODEC_H264) {
+		const uint64_t finalise_start = os_gettime_ns();
+		struct encoder_packet footer = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1};
+
+		flv_packet_end(&footer, codec, &data, &size, 0);
+		flv_write(s, data, size);
+		r->finalise_ns = os_gettime_ns() - finalise_start;
+	}
+
+	return true;
+}
+
+static bool run_mp4(struct bench *b, struct serializer *s, struct bench_result *r)
+{
+	struct mp4_mux *mux = mp4_mux_create(b->output, s, 0);
+	bool success = true;
+
+	const long allocs = get_allocs();
+	const uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < b->packets.num && success; i++) {
+		success = mp4_mux_submit_packet(mux, &b->packets.array[i]);
+		r->bytes_in += b->packets.array[i].size;
+		r->packets++;
+	}
+
+	r->mux_ns = os_gettime_ns() - start;
+	r->allocs = get_allocs() - allocs;
+
+	const uint64_t finalise_start = os_gettime_ns();
+	success = mp4_mux_finalise(mux) && success;
+	r->finalise_ns = os_gettime_ns() - finalise_start;
+
+	mp4_mux_destroy(mux);
+	return success;
+}
+
+static bool run_in_process(struct bench *b, const char *name, enum sink_type type,
+			   bool (*run)(struct bench *b, struct serializer *s, struct bench_result *r),
+			   struct bench_result *r)
+{
+	struct sink sink = {0};
+
+	if (!sink_open(&sink, type)) {
+		fprintf(stderr, "%s: failed to open %s sink\n", name, sink_name(type));
+		return false;
+	}
+
+	r->counted_allocs = COUNTS_ALLOCS;
+	bool success = run(b, &sink.s, r);
+
+	const uint64_t start = os_gettime_ns();
+	r->bytes_out = sink_close(&sink);
+	r->finalise_ns += os_gettime_ns() - start;
+
+	return success;
+}
+
+static bool ffmpeg_write(os_process_pipe_t *pipe, const struct encoder_packet *pkt)
+{
+	struct ffm_packet_info info = {
+		.pts = pkt->pts,
+		.dts = pkt->dts,
+		.size = (uint32_t)pkt->size,
+		.index = (uint32_t)pkt->track_idx,
+		.type = pkt->type == OBS_ENCODER_VIDEO ? FFM_PACKET_VIDEO : FFM_PACKET_AUDIO,
+		.keyframe = pkt->keyframe,
+	};
+
+	return os_process_pipe_write(pipe, (const uint8_t *)&info, sizeof(info)) == sizeof(info) &&
+	       os_process_pipe_write(pipe, pkt->data, pkt->size) == pkt->size;
+}
+
+/* Same command line as obs_ffmpeg_muxer builds for a recording */
+static os_process_args_t *ffmpeg_args(struct bench *b, const char *exe)
+{
+	const struct options *opts = &b->opts;
+	os_process_args_t *args = os_process_args_create(exe);
+
+	os_process_args_add_arg(args, opts->ffmpeg_output);
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_argf(args, "%d", opts->audio_tracks);
+
+	os_process_args_add_arg(args, opts->video_codec);
+	os_process_args_add_argf(args, "%d", opts->video_bitrate);
+	os_process_args_add_argf(args, "%d", WIDTH);
+	os_process_args_add_argf(args, "%d", HEIGHT);
+	/* BT.709 primaries, transfer and matrix, limited range, left chroma
+	 * siting, no HDR luminance */
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "0");
+	os_process_args_add_argf(args, "%d", opts->fps);
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "0");
+
+	if (opts->audio_tracks) {
+		os_process_args_add_arg(args, opts->audio_codec);
+
+		for (int i = 0; i < opts->audio_tracks; i++) {
+			os_process_args_add_argf(args, "Track%d", i + 1);
+			os_process_args_add_argf(args, "%d", opts->audio_bitrate);
+			os_process_args_add_argf(args, "%d", SAMPLE_RATE);
+			os_process_args_add_argf(args, "%d", (int)obs_encoder_get_frame_size(b->audio_encoders[i]));
+			os_process_args_add_arg(args, "2");
+		}
+	}
+
+	/* stream key and muxer settings */
+	os_process_args_add_arg(args, "");
+	os_process_args_add_arg(args, "");
+	return args;
+}
+
+static bool run_ffmpeg(struct bench *b, struct bench_result *r)
+{
+	char *exe = b->opts.ffmpeg_mux ? bstrdup(b->opts.ffmpeg_mux) : os_get_executable_path_ptr(FFMPEG_MUX);
+	bool success = false;
+
+	if (!exe || !os_file_exists(exe)) {
+		fprintf(stderr, "ffmpeg: obs-ffmpeg-mux not found, use --ffmpeg-mux\n");
+		bfree(exe);
+		return false;
+	}
+
+	os_process_args_t *args = ffmpeg_args(b, exe);
+	os_process_pipe_t *pipe = os_process_pipe_create2(args, "w");
+	os_process_args_destroy(args);
+	bfree(exe);
+
+	if (!pipe) {
+		fprintf(stderr, "ffmpeg: failed to start obs-ffmpeg-mux\n");
+		return false;
+	}
+
+	/* Headers go first, as sent by obs_ffmpeg_muxer */
+	struct encoder_packet header = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1};
+	obs_encoder_get_extra_data(b->video_encoder, &header.data, &header.size);
+	success = ffmpeg_write(pipe, &header);
+
+	for (int i = 0; success && i < b->opts.audio_tracks; i++) {
+		header.type = OBS_ENCODER_AUDIO;
+		header.track_idx = i;
+		obs_encoder_get_extra_data(b->audio_encoders[i], &header.data, &header.size);
+		success = ffmpeg_write(pipe, &header);
+	}
+
+	const uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; success && i < b->packets.num; i++) {
+		success = ffmpeg_write(pipe, &b->packets.array[i]);
+		r->bytes_in += b->packets.array[i].size;
+		r->packets++;
+	}
+
+	r->mux_ns = os_gettime_ns() - start;
+
+	/* Closing the pipe makes obs-ffmpeg-mux write the trailer and exit */
+	const uint64_t finalise_start = os_gettime_ns();
+	int code = os_process_pipe_destroy(pipe);
+	r->finalise_ns = os_gettime_ns() - finalise_start;
+
+	if (code != 0) {
+		fprintf(stderr, "ffmpeg: obs-ffmpeg-mux exited with %d\n", code);
+		success = false;
+	}
+
+	r->bytes_out = (uint64_t)os_get_file_size(b->opts.ffmpeg_output);
+	os_unlink(b->opts.ffmpeg_output);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void print_result(const char *muxer, const char *sink, const struct bench_result *r)
+{
+	const double seconds = (double)r->mux_ns / 1000000000.0;
+	char allocs[32] = "-";
+
+	if (r->counted_allocs && r->packets)
+		snprintf(allocs, sizeof(allocs), "%.2f", (double)r->allocs / (double)r->packets);
+
+	printf("%-6s %-10s %9zu %12.0f %10.1f %11s %10.1f %11.2f\n", muxer, sink, r->packets,
+	       seconds > 0.0 ? (double)r->packets / seconds : 0.0,
+	       seconds > 0.0 ? (double)r->bytes_in / seconds / 1000000.0 : 0.0, allocs,
+	       (double)r->bytes_out / 1000000.0, (double)r->finalise_ns / 1000000.0);
+}
+
+static void quiet_log(int lvl, const char *msg, va_list args, void *p)
+{
+	UNUSED_PARAMETER(p);
+
+	if (lvl > LOG_WARNING)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+static bool init_obs(struct bench *b)
+{
+	const struct options *opts = &b->opts;
+	struct obs_audio_info oai = {.samples_per_sec = SAMPLE_RATE, .speakers = SPEAKERS_STEREO};
+	struct video_output_info voi = {
+		.name = "mux-bench",
+		.format = VIDEO_FORMAT_NV12,
+		.fps_num = (uint32_t)opts->fps,
+		.fps_den = 1,
+		.width = WIDTH,
+		.height = HEIGHT,
+		.cache_size = 1,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+	if (!obs_reset_audio(&oai))
+		return false;
+	if (video_output_open(&b->video, &voi) != VIDEO_OUTPUT_SUCCESS)
+		return false;
+
+	register_encoder("mux_bench_h264", "h264", OBS_ENCODER_VIDEO);
+	register_encoder("mux_bench_hevc", "hevc", OBS_ENCODER_VIDEO);
+	register_encoder("mux_bench_av1", "av1", OBS_ENCODER_VIDEO);
+	register_encoder("mux_bench_aac", "aac", OBS_ENCODER_AUDIO);
+	register_encoder("mux_bench_opus", "opus", OBS_ENCODER_AUDIO);
+	obs_register_output(&bench_output_info);
+
+	b->output = obs_output_create("mux_bench_output", "mux-bench", NULL, NULL);
+	if (!b->output)
+		return false;
+
+	struct dstr id = {0};
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "bitrate", opts->video_bitrate);
+	dstr_printf(&id, "mux_bench_%s", opts->video_codec);
+	b->video_encoder = obs_video_encoder_create(id.array, "video", settings, NULL);
+	obs_encoder_set_video(b->video_encoder, b->video);
+	obs_output_set_video_encoder(b->output, b->video_encoder);
+
+	obs_data_set_int(settings, "bitrate", opts->audio_bitrate);
+	dstr_printf(&id, "mux_bench_%s", opts->audio_codec);
+	for (int i = 0; i < opts->audio_tracks; i++) {
+		b->audio_encoders[i] = obs_audio_encoder_create(id.array, "audio", settings, i, NULL);
+		obs_output_set_audio_encoder(b->output, b->audio_encoders[i], i);
+	}
+
+	obs_data_release(settings);
+	dstr_free(&id);
+
+	/* Encoders provide their headers once initialized */
+	return obs_output_initialize_encoders(b->output, 0);
+}
+
+static void free_obs(struct bench *b)
+{
+	obs_output_release(b->output);
+	obs_encoder_release(b->video_encoder);
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+		obs_encoder_release(b->audio_encoders[i]);
+
+	obs_shutdown();
+	video_output_close(b->video);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench b = {
+		.opts =
+			{
+				.video_codec = "h264",
+				.audio_codec = "aac",
+				.video_bitrate = 6000,
+				.audio_bitrate = 160,
+				.audio_tracks = 1,
+				.fps = 60,
+				.duration = 60,
+				.muxers = "flv,mp4,ffmpeg",
+				.ffmpeg_output = "mux-bench.mkv",
+			},
+	};
+	int ret = 0;
+
+	if (!parse_options(&b.opts, argc, argv)) {
+		usage();
+		return 1;
+	}
+
+	if (!b.opts.verbose)
+		base_set_log_handler(quiet_log, NULL);
+
+	if (!init_obs(&b)) {
+		fprintf(stderr, "Failed to initialize libobs\n");
+		free_obs(&b);
+		return 1;
+	}
+
+	generate_packets(&b);
+
+	printf("%s %d kbps, %d x %s %d kbps, %d fps, %d s: %zu packets, %.1f MB\n\n", b.opts.video_codec,
+	       b.opts.video_bitrate, b.opts.audio_tracks, b.opts.audio_codec, b.opts.audio_bitrate, b.opts.fps,
+	       b.opts.duration, b.packets.num, (double)b.packet_bytes / 1000000.0);
+	printf("%-6s %-10s %9s %12s %10s %11s %10s %11s\n", "muxer", "sink", "packets", "packets/s", "MB/s",
+	       "allocs/pkt", "output MB", "finalise ms");
+
+	for (enum sink_type type = SINK_ARRAY; type <= SINK_NULL_FILE; type++) {
+		struct bench_result r = {0};
+
+		if (!muxer_enabled(&b.opts, "flv"))
+			break;
+		if (!flv_has_audio(&b) && type == SINK_ARRAY && b.opts.audio_tracks)
+			fprintf(stderr, "flv: %s is not supported, muxing video only\n", b.opts.audio_codec);
+
+		if (run_in_process(&b, "flv", type, run_flv, &r))
+			print_result("flv", sink_name(type), &r);
+		else
+			ret = 1;
+	}
+
+	for (enum sink_type type = SINK_ARRAY; type <= SINK_NULL_FILE; type++) {
+		struct bench_result r = {0};
+
+		if (!muxer_enabled(&b.opts, "mp4"))
+			break;
+
+		if (run_in_process(&b, "mp4", type, run_mp4, &r))
+			print_result("mp4", sink_name(type), &r);
+		else
+			ret = 1;
+	}
+
+	if (muxer_enabled(&b.opts, "ffmpeg")) {
+		struct bench_result r = {0};
+
+		if (run_ffmpeg(&b, &r))
+			print_result("ffmpeg", "file", &r);
+		else
+			ret = 1;
+	}
+
+	da_free(b.packets);
+	bfree(b.arena);
+	free_obs(&b);
+	return ret;
+}